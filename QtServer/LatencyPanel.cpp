@@ -0,0 +1,97 @@
+#include "LatencyPanel.h"
+#include "LatencyTracker.h"
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+// Microseconds shown as milliseconds
+static QString formatMs(qint64 us)
+{
+    return QString::number(us / 1000.0, 'f', 2);
+}
+
+LatencyPanel::LatencyPanel(const LatencyTracker& tracker, QWidget* parent)
+    : QDialog(parent)
+    , tracker(tracker)
+    , table(new QTableWidget(LatencyTracker::STAGES, 5, this))
+    , clockLabel(new QLabel(this))
+    , refreshTimer(new QTimer(this))
+{
+    setWindowTitle(tr("Sample Latency"));
+
+    table->setHorizontalHeaderLabels({tr("Samples"), tr("p50 (ms)"), tr("p90 (ms)"), tr("p99 (ms)"), tr("Max (ms)")});
+    for (int s = 0; s < LatencyTracker::STAGES; ++s) {
+        table->setVerticalHeaderItem(s, new QTableWidgetItem(LatencyTracker::stageName(LatencyTracker::Stage(s))));
+        for (int c = 0; c < 5; ++c) {
+            QTableWidgetItem* item = new QTableWidgetItem;
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(s, c, item);
+        }
+    }
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    QPushButton* exportButton = new QPushButton(tr("Export CSV…"), this);
+    connect(exportButton, &QPushButton::clicked, this, &LatencyPanel::exportCsv);
+
+    QHBoxLayout* bottom = new QHBoxLayout;
+    bottom->addWidget(clockLabel, 1);
+    bottom->addWidget(exportButton);
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(table);
+    layout->addLayout(bottom);
+    resize(560, 260);
+
+    refreshTimer->setInterval(1000);
+    connect(refreshTimer, &QTimer::timeout, this, &LatencyPanel::refresh);
+}
+
+void LatencyPanel::showEvent(QShowEvent* event)
+{
+    refresh();
+    refreshTimer->start();
+    QDialog::showEvent(event);
+}
+
+void LatencyPanel::hideEvent(QHideEvent* event)
+{
+    refreshTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void LatencyPanel::refresh()
+{
+    for (int s = 0; s < LatencyTracker::STAGES; ++s) {
+        LatencyTracker::Percentiles p = tracker.percentiles(LatencyTracker::Stage(s));
+        table->item(s, 0)->setText(QString::number(p.count));
+        table->item(s, 1)->setText(p.count ? formatMs(p.p50) : QString("-"));
+        table->item(s, 2)->setText(p.count ? formatMs(p.p90) : QString("-"));
+        table->item(s, 3)->setText(p.count ? formatMs(p.p99) : QString("-"));
+        table->item(s, 4)->setText(p.count ? formatMs(p.max) : QString("-"));
+    }
+    if (tracker.clockSynced()) {
+        clockLabel->setText(tr("Node clock offset: %1 ms (± %2 ms)")
+                            .arg(formatMs(tracker.clockOffsetUs()))
+                            .arg(formatMs(tracker.clockRttUs() / 2)));
+    } else {
+        clockLabel->setText(tr("Node clock offset: not measured, clocks assumed synchronised"));
+    }
+}
+
+void LatencyPanel::exportCsv()
+{
+    QString path = QFileDialog::getSaveFileName(this, tr("Export latency samples"), "latency.csv", tr("CSV files (*.csv)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    QString error;
+    if (!tracker.exportCsv(path, &error)) {
+        QMessageBox::warning(this, tr("Export failed"), error);
+    }
+}
@@ -0,0 +1,38 @@
+// LatencyPanel.h
+#ifndef LATENCYPANEL_H
+#define LATENCYPANEL_H
+
+#include <QDialog>
+
+class QLabel;
+class QTableWidget;
+class QTimer;
+class LatencyTracker;
+
+/**
+ * @brief Window with the per-stage latency percentiles of the displayed samples
+ * Refreshed every second while shown; the samples behind it can be exported as CSV.
+ */
+class LatencyPanel : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LatencyPanel(const LatencyTracker& tracker, QWidget* parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    void refresh();      // Recompute the table from the tracker
+    void exportCsv();    // Ask for a file and write the samples to it
+
+private:
+    const LatencyTracker& tracker;  // Source of the measurements
+    QTableWidget* table;            // One row per stage
+    QLabel* clockLabel;             // Clock offset estimate in use
+    QTimer* refreshTimer;           // Periodic refresh while shown
+};
+
+#endif // LATENCYPANEL_H
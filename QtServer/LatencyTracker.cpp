@@ -0,0 +1,131 @@
+#include "LatencyTracker.h"
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+LatencyTracker::LatencyTracker()
+    : records(CAPACITY)
+    , next(0)
+    , count(0)
+    , offset(0)
+    , rtt(0)
+    , synced(false)
+{
+    pending.reserve(16);
+}
+
+const char* LatencyTracker::stageName(Stage stage)
+{
+    static const char* names[STAGES] = {"Node to server", "Parse", "Dispatch", "Render", "Total"};
+    return names[stage];
+}
+
+void LatencyTracker::setClockOffset(qint64 offsetUs, qint64 rttUs)
+{
+    offset = offsetUs;
+    rtt = rttUs;
+    synced = true;
+}
+
+void LatencyTracker::sampleDisplayed(const QJsonObject& data, qint64 updatedUs)
+{
+    if (!data.contains("ts") || !data.contains("rx_us") || !data.contains("parsed_us")) {
+        return;
+    }
+    if (pending.size() >= 16) {
+        pending.removeFirst();  // No paint for a while (window hidden): keep the newest
+    }
+    Record r;
+    r.seq = quint64(data["seq"].toDouble());
+    r.offsetUs = offset;
+    r.synced = synced;
+    r.acquiredUs = qint64(data["ts"].toDouble()) - offset;
+    r.receivedUs = qint64(data["rx_us"].toDouble());
+    r.parsedUs = qint64(data["parsed_us"].toDouble());
+    r.updatedUs = updatedUs;
+    r.paintedUs = 0;
+    pending.append(r);
+}
+
+void LatencyTracker::painted(qint64 paintedUs)
+{
+    for (Record& r : pending) {
+        r.paintedUs = paintedUs;
+        records[next] = r;
+        next = (next + 1) % CAPACITY;
+        count = qMin(count + 1, int(CAPACITY));
+    }
+    pending.clear();
+}
+
+qint64 LatencyTracker::stageValue(const Record& r, Stage stage)
+{
+    switch (stage) {
+    case NETWORK:
+        return r.receivedUs - r.acquiredUs;
+    case PARSE:
+        return r.parsedUs - r.receivedUs;
+    case DISPATCH:
+        return r.updatedUs - r.parsedUs;
+    case RENDER:
+        return r.paintedUs - r.updatedUs;
+    default:
+        return r.paintedUs - r.acquiredUs;
+    }
+}
+
+LatencyTracker::Percentiles LatencyTracker::percentiles(Stage stage) const
+{
+    Percentiles p = {count, 0, 0, 0, 0};
+    if (count == 0) {
+        return p;
+    }
+    QVector<qint64> values;
+    values.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        values.append(stageValue(records[i], stage));
+    }
+    std::sort(values.begin(), values.end());
+    // Nearest-rank percentiles
+    auto rank = [&values](double q) { return values[qMax(0, int(q * values.size() + 0.999999) - 1)]; };
+    p.p50 = rank(0.50);
+    p.p90 = rank(0.90);
+    p.p99 = rank(0.99);
+    p.max = values.last();
+    return p;
+}
+
+bool LatencyTracker::exportCsv(const QString& path, QString* error) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        *error = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+    out << "# clock offset (node - server) us," << offset << ",rtt us," << rtt << ",synced," << (synced ? 1 : 0) << "\n";
+    out << "# stage,count,p50_us,p90_us,p99_us,max_us\n";
+    for (int s = 0; s < STAGES; ++s) {
+        Percentiles p = percentiles(Stage(s));
+        out << "# " << stageName(Stage(s)) << "," << p.count << "," << p.p50 << "," << p.p90 << "," << p.p99 << "," << p.max << "\n";
+    }
+    out << "seq,acquired_us,received_us,parsed_us,updated_us,painted_us,clock_offset_us,synced,"
+           "network_us,parse_us,dispatch_us,render_us,total_us\n";
+    // Oldest first
+    int first = count < CAPACITY ? 0 : next;
+    for (int i = 0; i < count; ++i) {
+        const Record& r = records[(first + i) % CAPACITY];
+        out << r.seq << "," << r.acquiredUs << "," << r.receivedUs << "," << r.parsedUs << "," << r.updatedUs << ","
+            << r.paintedUs << "," << r.offsetUs << "," << (r.synced ? 1 : 0);
+        for (int s = 0; s < STAGES; ++s) {
+            out << "," << stageValue(r, Stage(s));
+        }
+        out << "\n";
+    }
+    out.flush();
+    if (file.error() != QFileDevice::NoError) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
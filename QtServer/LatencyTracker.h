@@ -0,0 +1,112 @@
+// LatencyTracker.h
+#ifndef LATENCYTRACKER_H
+#define LATENCYTRACKER_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include <chrono>
+
+/**
+ * @brief End-to-end latency of the displayed samples, split into stages
+ * Every sample carries its acquisition time (node clock) in "ts"; TcpServer adds the receive ("rx_us") and parse
+ * ("parsed_us") times, MainWindow the time the values were set and the time they were painted. The node time is
+ * moved onto the server clock with the offset estimated from PING/PONG round trips. The most recent CAPACITY
+ * samples are kept for percentiles and CSV export.
+ */
+class LatencyTracker
+{
+public:
+    enum Stage {
+        NETWORK,   // Acquisition on the node to receipt on the server (node processing, queueing, network)
+        PARSE,     // Receipt to decoded sample
+        DISPATCH,  // Decoded sample to values set on the window
+        RENDER,    // Values set to the next paint of the window
+        TOTAL,     // Acquisition to paint
+        STAGES
+    };
+
+    struct Percentiles {
+        int count;    // Samples measured
+        qint64 p50;   // Median, microseconds
+        qint64 p90;
+        qint64 p99;
+        qint64 max;
+    };
+
+    static const int CAPACITY = 4096;  // Samples kept
+
+    LatencyTracker();
+
+    /**
+     * @brief Current wall-clock time in microseconds (same epoch as the node's timestamps)
+     */
+    static qint64 nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static const char* stageName(Stage stage);
+
+    /**
+     * @brief Use a new clock offset estimate
+     * @param offsetUs Node clock minus server clock
+     * @param rttUs Round trip of the estimate (its uncertainty is half of it)
+     */
+    void setClockOffset(qint64 offsetUs, qint64 rttUs);
+
+    bool clockSynced() const { return synced; }
+    qint64 clockOffsetUs() const { return offset; }
+    qint64 clockRttUs() const { return rtt; }
+
+    /**
+     * @brief Record a sample whose values have just been set on the window
+     * @param data Sample with "ts", "rx_us" and "parsed_us" (ignored otherwise)
+     * @param updatedUs Time the values were set
+     */
+    void sampleDisplayed(const QJsonObject& data, qint64 updatedUs);
+
+    /**
+     * @brief Complete the samples displayed since the previous paint
+     * @param paintedUs Time of the paint event
+     */
+    void painted(qint64 paintedUs);
+
+    /**
+     * @brief Latency percentiles of one stage over the kept samples
+     */
+    Percentiles percentiles(Stage stage) const;
+
+    /**
+     * @brief Write the per-stage percentiles and every kept sample to a CSV file
+     * @param path Destination file
+     * @param error Receives the reason on failure
+     * @return bool false if the file cannot be written
+     */
+    bool exportCsv(const QString& path, QString* error) const;
+
+private:
+    struct Record {
+        quint64 seq;
+        qint64 acquiredUs;  // Acquisition time moved onto the server clock
+        qint64 receivedUs;
+        qint64 parsedUs;
+        qint64 updatedUs;
+        qint64 paintedUs;
+        qint64 offsetUs;    // Clock offset applied
+        bool synced;        // Whether an offset estimate existed
+    };
+
+    static qint64 stageValue(const Record& r, Stage stage);
+
+    QVector<Record> records;  // Ring of completed samples
+    int next;                 // Ring position of the next record
+    int count;                // Completed samples kept
+    QVector<Record> pending;  // Displayed, waiting for the paint
+    qint64 offset;            // Node clock minus server clock
+    qint64 rtt;               // Round trip of the offset estimate
+    bool synced;              // Whether an offset estimate exists
+};
+
+#endif // LATENCYTRACKER_H
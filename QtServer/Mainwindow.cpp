@@ -1,12 +1,19 @@
 #include <QMessageBox>
 #include <QDebug>
+#include <QAction>
+#include <QDateTime>
+#include <QMenuBar>
+#include <QEvent>
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "tcpserver.h"
+#include "MulticastReceiver.h"
+#include "LatencyPanel.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , latencyPanel(nullptr)
 {
     ui->setupUi(this);
     setWindowTitle("Water Quality Monitor");
@@ -20,6 +27,32 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::onSensorDataUpdated);
     connect(tcpServer, &TcpServer::connectionStatusChanged,
             this, &MainWindow::onConnectionStatusChanged);
+
+    // Recover the node's stored history after a server restart
+    QAction* backfillAction = ui->menuBar->addAction(tr("Backfill last 24 h"));
+    connect(backfillAction, &QAction::triggered, tcpServer, [tcpServer]() {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        tcpServer->requestBackfill(now - 24 * 3600 * 1000LL, now);
+    });
+    connect(tcpServer, &TcpServer::backfillFinished, this, [this](int received, int duplicates) {
+        onConnectionStatusChanged(QString("🔵 Backfill complete: %1 new samples, %2 duplicates skipped")
+                                  .arg(received).arg(duplicates));
+    });
+
+    // Latency tracing: the node's clock offset moves its timestamps onto ours, the pH label is set last and its
+    // paint marks when a sample became visible
+    connect(tcpServer, &TcpServer::clockOffsetUpdated, this, [this](qint64 offsetUs, qint64 rttUs) {
+        latency.setClockOffset(offsetUs, rttUs);
+    });
+    ui->phVal->installEventFilter(this);
+    QAction* latencyAction = ui->menuBar->addAction(tr("Latency…"));
+    connect(latencyAction, &QAction::triggered, this, [this]() {
+        if (!latencyPanel) {
+            latencyPanel = new LatencyPanel(latency, this);
+        }
+        latencyPanel->show();
+        latencyPanel->raise();
+    });
 }
 
 MainWindow::~MainWindow()
@@ -27,6 +60,22 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+// Receiver mode: listen to the multicast group next to the TCP server
+void MainWindow::startMulticastReceiver(const QHostAddress& group, quint16 port)
+{
+    MulticastReceiver* receiver = new MulticastReceiver(group, port, this);
+    connect(receiver, &MulticastReceiver::sensorDataUpdated,
+            this, &MainWindow::onSensorDataUpdated);
+    connect(receiver, &MulticastReceiver::connectionStatusChanged,
+            this, &MainWindow::onConnectionStatusChanged);
+    connect(receiver, &MulticastReceiver::gapDetected, this, [this, receiver](quint32 nodeId, quint64 missing) {
+        onConnectionStatusChanged(QString("🟠 Multicast: %1 datagrams lost from node %2 (%3 of %4 lost in total)")
+                                  .arg(missing).arg(nodeId)
+                                  .arg(receiver->lostCount()).arg(receiver->lostCount() + receiver->receivedCount()));
+    });
+    receiver->start();
+}
+
 // Initialize UI (button style, initial value, etc.)
 void MainWindow::initUI()
 {
@@ -64,17 +113,27 @@ void MainWindow::setButtonTransParent()
 void MainWindow::onSensorDataUpdated(const QJsonObject &data)
 {
     if (data.contains("tur")) {
-        double tur = data["tur"].toDouble();
+        double tur = data["tur"].toVariant().toDouble();  // Sent as a string in JSON mode
         ui->turbidVal->setText(QString::number(tur, 'f', 2));
     }
     if (data.contains("tmp")) {
-        double tmp = data["tmp"].toDouble();
+        double tmp = data["tmp"].toVariant().toDouble();
         ui->tempVal->setText(QString::number(tmp, 'f', 2) + "℃");
     }
     if (data.contains("pH")) {
-        double ph = data["pH"].toDouble();
+        double ph = data["pH"].toVariant().toDouble();
         ui->phVal->setText(QString::number(ph, 'f', 2));
     }
+    latency.sampleDisplayed(data, LatencyTracker::nowUs());
+    ui->phVal->update();  // setText() skips the repaint of an unchanged value
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == ui->phVal && event->type() == QEvent::Paint) {
+        latency.painted(LatencyTracker::nowUs());
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 // Receive connection status and update UI
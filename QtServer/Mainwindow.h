@@ -4,11 +4,14 @@
 #include <QMainWindow>
 #include <memory>  // Smart pointers manage resources
 #include <QJsonObject>
+#include "LatencyTracker.h"
 
 // Forward declaration to reduce header file dependency
 class QTcpServer;
 class QTcpSocket;
 class QPushButton;
+class QHostAddress;
+class LatencyPanel;
 namespace Ui { class MainWindow; }
 
 /**
@@ -27,6 +30,13 @@ public:
     MainWindow(const MainWindow&) = delete;
     MainWindow& operator=(const MainWindow&) = delete;
 
+    /**
+     * @brief Also receive the samples multicast by the nodes (receiver mode)
+     * @param group Multicast group address
+     * @param port UDP port
+     */
+    void startMulticastReceiver(const QHostAddress& group, quint16 port);
+
 public slots:
     /**
      * @brief Receive sensor data from the business layer and update the UI
@@ -40,6 +50,12 @@ public slots:
      */
     void onConnectionStatusChanged(const QString& status);
 
+protected:
+    /**
+     * @brief Stamp the paint of the value labels for the latency measurement
+     */
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private:
     /**
      * @brief Initialize UI components (button style, layout, etc.)
@@ -57,6 +73,8 @@ private:
 
 private:
     Ui::MainWindow* ui;  // UI form pointer
+    LatencyTracker latency;  // Acquisition-to-paint latency of the displayed samples
+    LatencyPanel* latencyPanel;  // Percentile window, created on first use
 };
 
 #endif // MAINWINDOW_H
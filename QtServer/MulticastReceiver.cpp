@@ -0,0 +1,87 @@
+#include "MulticastReceiver.h"
+#include <QUdpSocket>
+#include <QDebug>
+#include "datagram.h"
+#include "LatencyTracker.h"
+
+MulticastReceiver::MulticastReceiver(const QHostAddress& group, quint16 port, QObject* parent)
+    : QObject(parent)
+    , socket(new QUdpSocket(this))
+    , group(group)
+    , port(port)
+    , received(0)
+    , lost(0)
+    , late(0)
+    , invalid(0)
+{
+}
+
+bool MulticastReceiver::start()
+{
+    // Several receivers on one machine may share the port
+    if (!socket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        emit connectionStatusChanged("🔴 Multicast Error: " + socket->errorString());
+        return false;
+    }
+    if (!socket->joinMulticastGroup(group)) {
+        emit connectionStatusChanged("🔴 Multicast Error: " + socket->errorString());
+        return false;
+    }
+    connect(socket, &QUdpSocket::readyRead, this, &MulticastReceiver::onReadyRead);
+    emit connectionStatusChanged("🟢 Listening to multicast " + group.toString() + ":" + QString::number(port));
+    return true;
+}
+
+void MulticastReceiver::onReadyRead()
+{
+    while (socket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(int(socket->pendingDatagramSize()));
+        qint64 size = socket->readDatagram(datagram.data(), datagram.size());
+        qint64 receivedUs = LatencyTracker::nowUs();
+        if (size < 0) {
+            break;
+        }
+
+        Datagram::Header header;
+        Sample s;
+        if (!Datagram::decode(reinterpret_cast<const uint8_t*>(datagram.constData()), size_t(size), &header, &s)) {
+            invalid++;
+            continue;
+        }
+
+        // A new session means the publisher restarted and its sequence numbers start over
+        QHash<quint32, NodeState>::iterator node = nodes.find(header.node_id);
+        if (node == nodes.end() || node->session != header.session_id) {
+            NodeState state;
+            state.session = header.session_id;
+            state.nextSequence = header.sequence + 1;
+            nodes.insert(header.node_id, state);
+        } else if (header.sequence >= node->nextSequence) {
+            quint64 missing = header.sequence - node->nextSequence;
+            if (missing > 0) {
+                lost += missing;
+                qDebug() << "Multicast: lost" << missing << "datagrams from node" << header.node_id;
+                emit gapDetected(header.node_id, missing);
+            }
+            node->nextSequence = header.sequence + 1;
+        } else {
+            // Older than what is already displayed
+            late++;
+            continue;
+        }
+
+        received++;
+        QJsonObject obj;
+        obj["seq"] = double(s.seq);
+        obj["ts"] = double(s.timestamp_us);
+        obj["tur"] = s.turbidity;
+        obj["tmp"] = s.temperature;
+        obj["pH"] = s.pH;
+        obj["node"] = double(header.node_id);
+        // No clock offset is known for multicast nodes, so their network stage assumes synchronised clocks
+        obj["rx_us"] = double(receivedUs);
+        obj["parsed_us"] = double(LatencyTracker::nowUs());
+        emit sensorDataUpdated(obj);
+    }
+}
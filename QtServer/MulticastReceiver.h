@@ -0,0 +1,76 @@
+// MulticastReceiver.h
+#ifndef MULTICASTRECEIVER_H
+#define MULTICASTRECEIVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+
+class QUdpSocket;
+
+/**
+ * @brief UDP multicast receiver, the counterpart of the node's multicast publishing mode
+ * Responsibilities: join the multicast group, decode the sample datagrams (datagram.h), detect lost datagrams per node
+ * from their sequence numbers, and hand the samples to the UI through the same signal as TcpServer
+ */
+class MulticastReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param group Multicast group address (e.g. 239.255.0.1)
+     * @param port UDP port the nodes publish to
+     */
+    MulticastReceiver(const QHostAddress& group, quint16 port, QObject* parent = nullptr);
+
+    /**
+     * @brief Bind the port and join the group
+     * @return bool false on failure (the reason is reported through connectionStatusChanged)
+     */
+    bool start();
+
+    quint64 receivedCount() const { return received; }  // Valid sample datagrams received
+    quint64 lostCount() const { return lost; }          // Datagrams missing from the sequence numbers
+
+signals:
+    /**
+     * @brief Emitted for every received sample
+     * @param data JSON object with "seq", "ts", "tur", "tmp", "pH" and "node"
+     */
+    void sensorDataUpdated(const QJsonObject& data);
+
+    /**
+     * @brief Emitted when the receiver state changes
+     * @param status Status description
+     */
+    void connectionStatusChanged(const QString& status);
+
+    /**
+     * @brief Emitted when datagrams from a node were lost
+     * @param nodeId Publishing node
+     * @param missing Number of datagrams missing before the one just received
+     */
+    void gapDetected(quint32 nodeId, quint64 missing);
+
+private slots:
+    void onReadyRead();  // Read every pending datagram
+
+private:
+    struct NodeState {
+        quint32 session;       // Publisher run the sequence numbers belong to
+        quint64 nextSequence;  // Datagram sequence number expected next
+    };
+
+    QUdpSocket* socket;              // Bound UDP socket
+    QHostAddress group;              // Joined multicast group
+    quint16 port;                    // Bound port
+    QHash<quint32, NodeState> nodes; // Sequence tracking per publishing node
+    quint64 received;                // Valid sample datagrams
+    quint64 lost;                    // Missing datagrams
+    quint64 late;                    // Datagrams older than one already received (reordered or duplicated)
+    quint64 invalid;                 // Datagrams that were not valid sample datagrams
+};
+
+#endif // MULTICASTRECEIVER_H
@@ -24,12 +24,22 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# Record formats shared with the Raspberry Pi node
+INCLUDEPATH += "$$PWD/../Raspberrry Pi/src/common"
+
 SOURCES += \
         main.cpp \
-        mainwindow.cpp
+        mainwindow.cpp \
+        MulticastReceiver.cpp \
+        LatencyTracker.cpp \
+        LatencyPanel.cpp \
+        "../Raspberrry Pi/src/common/sample_codec.cpp"
 
 HEADERS += \
-        mainwindow.h
+        mainwindow.h \
+        MulticastReceiver.h \
+        LatencyTracker.h \
+        LatencyPanel.h
 
 FORMS += \
         mainwindow.ui
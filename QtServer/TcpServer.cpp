@@ -5,13 +5,29 @@
 #include <QJsonParseError>
 #include <QDebug>
 #include <QMessageBox>
+#include "sample_codec.h"
+#include "sample_record.h"
+#include "LatencyTracker.h"
 
 TcpServer::TcpServer(quint16 port, QObject *parent)
     : QObject(parent)
     , port(port)
     , tcpServer(new QTcpServer(this))
     , clientSocket(nullptr)
+    , binaryStream(false)
+    , backfillRemaining(0)
+    , backfillEncoded(false)
+    , recordSize(SampleRecord::SIZE)
+    , backfillReceived(0)
+    , backfillDuplicates(0)
+    , receiveUs(0)
+    , pingTimer(new QTimer(this))
+    , clockCount(0)
 {
+    // Round trips every few seconds keep the offset estimate fresh as the clocks drift
+    pingTimer->setInterval(5000);
+    connect(pingTimer, &QTimer::timeout, this, &TcpServer::sendPing);
+
     // Start server listening
     if (!tcpServer->listen(QHostAddress::Any, port)) {
         emit connectionStatusChanged("🔴 Server Error: " + tcpServer->errorString());
@@ -49,15 +65,23 @@ void TcpServer::onNewConnection()
     connect(clientSocket, &QTcpSocket::readyRead, this, &TcpServer::onReadyRead);
     
     emit connectionStatusChanged("🔵 Client Connected: " + clientSocket->peerAddress().toString());
+
+    // Estimate the node's clock offset right away, then periodically
+    clockCount = 0;
+    sendPing();
+    pingTimer->start();
 }
 
 // Handling client disconnects
 void TcpServer::onClientDisconnected()
 {
     emit connectionStatusChanged("🟠 Client Disconnected");
+    pingTimer->stop();
     clientSocket->deleteLater();
     clientSocket = nullptr;
     dataBuffer.clear();
+    backfillRemaining = 0;
+    binaryStream = false;
 }
 
 // Read client data
@@ -65,13 +89,258 @@ void TcpServer::onReadyRead()
 {
     if (!clientSocket) return;
     
-    // Read all data into the buffer
+    // Read all data into the buffer; everything parsed from it counts as received now
+    receiveUs = LatencyTracker::nowUs();
     QByteArray data = clientSocket->readAll();
     dataBuffer.append(data);
     qDebug() << "Received data: " << data;
     
-    // Parse JSON data in the buffer
-    parseJsonData(dataBuffer);
+    // Parse JSON data and backfill responses in the buffer
+    processBuffer();
+}
+
+// Ask the node for its history; the reply arrives interleaved with nothing else on the connection
+void TcpServer::requestBackfill(qint64 fromMs, qint64 toMs)
+{
+    if (!clientSocket) {
+        emit connectionStatusChanged("🟠 Backfill: no node connected");
+        return;
+    }
+    clientSocket->write(QString("BACKFILL %1 %2\n").arg(fromMs).arg(toMs).toLatin1());
+}
+
+// Send the server time; the node answers "#PONG <that time> <node time>"
+void TcpServer::sendPing()
+{
+    if (!clientSocket) {
+        return;
+    }
+    clientSocket->write(QString("PING %1\n").arg(LatencyTracker::nowUs()).toLatin1());
+}
+
+// NTP-style estimate: the node answered half-way through the round trip. The round trip with the lowest delay of the
+// recent ones is used, as its halves are the least likely to be asymmetric.
+void TcpServer::handlePong(qint64 sentUs, qint64 nodeUs)
+{
+    qint64 now = LatencyTracker::nowUs();
+    qint64 rtt = now - sentUs;
+    if (sentUs <= 0 || rtt < 0) {
+        return;
+    }
+    int slot = clockCount % CLOCK_SAMPLES;
+    clockOffsets[slot] = nodeUs - (sentUs + now) / 2;
+    clockRtts[slot] = rtt;
+    clockCount++;
+
+    int best = 0;
+    for (int i = 1; i < qMin(clockCount, int(CLOCK_SAMPLES)); ++i) {
+        if (clockRtts[i] < clockRtts[best]) {
+            best = i;
+        }
+    }
+    emit clockOffsetUpdated(clockOffsets[best], clockRtts[best]);
+}
+
+// Convert a decoded sample into the JSON shape used by the live stream
+static QJsonObject sampleToJson(const Sample& s)
+{
+    QJsonObject obj;
+    obj["seq"] = double(s.seq);
+    obj["ts"] = double(s.timestamp_us);
+    obj["tur"] = s.turbidity;
+    obj["tmp"] = s.temperature;
+    obj["pH"] = s.pH;
+    return obj;
+}
+
+// Live messages are JSON objects or SampleCodec frames; "#..." lines announce the encoding or a backfill response
+void TcpServer::processBuffer()
+{
+    for (;;) {
+        if (backfillRemaining > 0) {
+            if (!consumeBackfill()) {
+                return;
+            }
+            continue;
+        }
+
+        if (binaryStream) {
+            if (dataBuffer.isEmpty()) {
+                return;
+            }
+            if (dataBuffer.at(0) != '#') {
+                if (!consumeFrame()) {
+                    return;
+                }
+                continue;
+            }
+        } else {
+            parseJsonData(dataBuffer);
+        }
+
+        int hash = dataBuffer.indexOf('#');
+        if (hash == -1) {
+            return;
+        }
+        int newline = dataBuffer.indexOf('\n', hash);
+        if (newline == -1) {
+            return;
+        }
+        QList<QByteArray> fields = dataBuffer.mid(hash, newline - hash).split(' ');
+        dataBuffer.remove(0, newline + 1);
+        handleControlLine(fields);
+    }
+}
+
+// "#STREAM <encoding>", "#BACKFILL <format> <record_size> <byte_length>", "#PONG <server_us> <node_us>"
+// or "#BUSY BACKFILL"
+void TcpServer::handleControlLine(const QList<QByteArray>& fields)
+{
+    if (fields.size() == 3 && fields[0] == "#PONG") {
+        handlePong(fields[1].toLongLong(), fields[2].toLongLong());
+        return;
+    }
+    if (fields.size() == 2 && fields[0] == "#BUSY") {
+        emit connectionStatusChanged("🟠 Backfill refused: the previous one is still running");
+        return;
+    }
+    if (fields.size() == 2 && fields[0] == "#STREAM") {
+        binaryStream = (fields[1] == "gorilla");
+        liveDecoder.reset();
+        return;
+    }
+    if (fields.size() != 4 || fields[0] != "#BACKFILL") {
+        emit connectionStatusChanged("🟠 Unsupported control line: " + QString::fromLatin1(fields.join(' ')));
+        return;
+    }
+    if (fields[1] == "raw" && fields[2].toInt() == int(SampleRecord::SIZE)) {
+        backfillEncoded = false;
+    } else if (fields[1] == "gorilla") {
+        backfillEncoded = true;
+        backfillDecoder.reset();
+    } else {
+        emit connectionStatusChanged("🟠 Unsupported backfill format: " + QString::fromLatin1(fields[1]));
+        return;
+    }
+    backfillRemaining = fields[3].toLongLong();
+    backfillReceived = 0;
+    backfillDuplicates = 0;
+    if (backfillRemaining == 0) {
+        emit backfillFinished(0, 0);
+    }
+}
+
+// Decode one live SampleCodec frame
+bool TcpServer::consumeFrame()
+{
+    Sample s;
+    size_t used = 0;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(dataBuffer.constData());
+    switch (liveDecoder.decode(data, size_t(dataBuffer.size()), &s, &used)) {
+    case SampleDecoder::NEED_MORE:
+        return false;
+    case SampleDecoder::CORRUPT:
+        dataBuffer.remove(0, 1);  // Resynchronise byte by byte
+        return true;
+    case SampleDecoder::SKIPPED:
+        dataBuffer.remove(0, int(used));  // Waiting for the next keyframe
+        return true;
+    case SampleDecoder::SAMPLE:
+        break;
+    }
+    dataBuffer.remove(0, int(used));
+    markSequence(s.seq);
+    QJsonObject obj = sampleToJson(s);
+    obj["rx_us"] = double(receiveUs);
+    obj["parsed_us"] = double(LatencyTracker::nowUs());
+    emit sensorDataUpdated(obj);
+    return true;
+}
+
+void TcpServer::deliverBackfillSample(const Sample& s)
+{
+    if (!markSequence(s.seq)) {
+        backfillDuplicates++;
+        return;
+    }
+    backfillReceived++;
+    emit historySampleReceived(sampleToJson(s));
+}
+
+bool TcpServer::consumeBackfill()
+{
+    int available = int(qMin<qint64>(backfillRemaining, dataBuffer.size()));
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(dataBuffer.constData());
+    int used = 0;
+
+    if (backfillEncoded) {
+        while (used < available) {
+            Sample s;
+            size_t n = 0;
+            SampleDecoder::Status status = backfillDecoder.decode(p + used, size_t(available - used), &s, &n);
+            if (status == SampleDecoder::NEED_MORE) {
+                // A frame cut off by the announced length can never complete
+                if (available == backfillRemaining) {
+                    used = available;
+                }
+                break;
+            }
+            if (status == SampleDecoder::CORRUPT) {
+                n = 1;
+            } else if (status == SampleDecoder::SAMPLE) {
+                deliverBackfillSample(s);
+            }
+            used += int(n);
+        }
+    } else {
+        int records = available / recordSize;
+        for (int i = 0; i < records; ++i) {
+            Sample s;
+            if (SampleRecord::decode(p + i * recordSize, &s)) {
+                deliverBackfillSample(s);
+            }
+        }
+        used = records * recordSize;
+    }
+
+    if (used == 0) {
+        return false;
+    }
+    dataBuffer.remove(0, used);
+    backfillRemaining -= used;
+    if (backfillRemaining == 0) {
+        emit backfillFinished(backfillReceived, backfillDuplicates);
+    }
+    return true;
+}
+
+// Insert a sequence number into the merged ranges, reporting whether it is new
+bool TcpServer::markSequence(quint64 seq)
+{
+    QMap<quint64, quint64>::iterator next = seenRanges.upperBound(seq);
+    if (next != seenRanges.begin()) {
+        QMap<quint64, quint64>::iterator prev = next;
+        --prev;
+        if (seq <= prev.value()) {
+            return false;
+        }
+        if (prev.value() + 1 == seq) {
+            prev.value() = seq;
+            if (next != seenRanges.end() && next.key() == seq + 1) {
+                prev.value() = next.value();
+                seenRanges.erase(next);
+            }
+            return true;
+        }
+    }
+    if (next != seenRanges.end() && next.key() == seq + 1) {
+        quint64 last = next.value();
+        seenRanges.erase(next);
+        seenRanges.insert(seq, last);
+        return true;
+    }
+    seenRanges.insert(seq, seq);
+    return true;
 }
 
 // Parsing JSON data and emitting signals
@@ -82,6 +351,12 @@ void TcpServer::parseJsonData(QByteArray &buffer)
     int end = buffer.indexOf('}', start);
     
     while (start != -1 && end != -1) {
+        // Leave a backfill header (and everything after it) to processBuffer
+        int hash = buffer.indexOf('#');
+        if (hash != -1 && hash < start) {
+            break;
+        }
+
         // Extract and remove parsed JSON fragments
         QByteArray jsonData = buffer.mid(start, end - start + 1);
         buffer.remove(0, end + 1);
@@ -90,7 +365,13 @@ void TcpServer::parseJsonData(QByteArray &buffer)
         QJsonParseError error;
         QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
         if (error.error == QJsonParseError::NoError) {
-            emit sensorDataUpdated(doc.object()); // Emit parsed data
+            QJsonObject obj = doc.object();
+            if (obj.contains("seq")) {
+                markSequence(quint64(obj["seq"].toDouble()));
+            }
+            obj["rx_us"] = double(receiveUs);
+            obj["parsed_us"] = double(LatencyTracker::nowUs());
+            emit sensorDataUpdated(obj); // Emit parsed data
         } else {
             qDebug() << "JSON parse error: " << error.errorString();
             emit connectionStatusChanged("🟠 JSON Error: " + error.errorString());
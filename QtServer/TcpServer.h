@@ -6,6 +6,10 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QTimer>
+#include "sample_codec.h"
 
 /**
  * @brief TCP server class, responsible for network communication logic
@@ -32,10 +36,39 @@ signals:
      */
     void connectionStatusChanged(const QString& status);
 
+    /**
+     * @brief Emitted for every backfilled sample that had not been received before
+     * @param data JSON object with "seq", "ts" (microseconds), "tur", "tmp" and "pH"
+     */
+    void historySampleReceived(const QJsonObject& data);
+
+    /**
+     * @brief Emitted when a backfill response has been fully received
+     * @param received Number of new samples
+     * @param duplicates Number of samples dropped because their sequence number was already seen
+     */
+    void backfillFinished(int received, int duplicates);
+
+    /**
+     * @brief Emitted when a PING round trip gave a new clock offset estimate
+     * @param offsetUs Node clock minus server clock (microseconds), from the round trip with the lowest delay
+     * @param rttUs Round trip of that estimate; the offset is known to within half of it
+     */
+    void clockOffsetUpdated(qint64 offsetUs, qint64 rttUs);
+
+public slots:
+    /**
+     * @brief Ask the connected node for its stored history in a time range
+     * @param fromMs Start of the range (milliseconds since the epoch)
+     * @param toMs End of the range (milliseconds since the epoch)
+     */
+    void requestBackfill(qint64 fromMs, qint64 toMs);
+
 private slots:
     void onNewConnection();       // Handling new connections
     void onClientDisconnected();  // Handling Client Disconnects
     void onReadyRead();           // Read client data
+    void sendPing();              // Start a clock offset round trip
 
 private:
     /**
@@ -44,11 +77,67 @@ private:
      */
     void parseJsonData(QByteArray& buffer);
 
+    /**
+     * @brief Split the buffer into live JSON messages and backfill responses
+     */
+    void processBuffer();
+
+    /**
+     * @brief Derive the clock offset from a "#PONG" reply
+     * @param sentUs Server time the PING was sent (echoed by the node)
+     * @param nodeUs Node time the PING was answered
+     */
+    void handlePong(qint64 sentUs, qint64 nodeUs);
+
+    /**
+     * @brief Act on a "#STREAM", "#BACKFILL", "#PONG" or "#BUSY" line
+     * @param fields The line split at spaces
+     */
+    void handleControlLine(const QList<QByteArray>& fields);
+
+    /**
+     * @brief Decode the live SampleCodec frame at the front of the buffer
+     * @return bool false if more data is needed
+     */
+    bool consumeFrame();
+
+    /**
+     * @brief Decode the complete backfill records at the front of the buffer
+     * @return bool false if more data is needed
+     */
+    bool consumeBackfill();
+
+    /**
+     * @brief De-duplicate and emit one backfilled sample
+     */
+    void deliverBackfillSample(const Sample& s);
+
+    /**
+     * @brief Record a sequence number as received
+     * @return bool true if the sequence number had not been seen before
+     */
+    bool markSequence(quint64 seq);
+
 private:
     QTcpServer* tcpServer;        // TCP Server Example
     QTcpSocket* clientSocket;     // The currently connected client socket
     QByteArray dataBuffer;        // Data buffer (handling packet sticking/unpacking)
     quint16 port;                 // Listening Port
+    QMap<quint64, quint64> seenRanges;  // Received sequence numbers as merged [first, last] ranges
+    bool binaryStream;            // Live samples arrive as SampleCodec frames instead of JSON
+    SampleDecoder liveDecoder;    // Decoder of the live frame stream
+    SampleDecoder backfillDecoder;  // Decoder of an encoded backfill response
+    qint64 backfillRemaining;     // Bytes of the current backfill response still to be read (0 if none)
+    bool backfillEncoded;         // Backfill response holds SampleCodec frames instead of fixed records
+    int recordSize;               // Record size announced by the backfill header
+    int backfillReceived;         // New samples in the current backfill
+    int backfillDuplicates;       // Already known samples in the current backfill
+    qint64 receiveUs;             // Time the data being parsed was read from the socket
+    QTimer* pingTimer;            // Periodic PING while a node is connected
+    static const int CLOCK_SAMPLES = 8;  // Round trips the offset estimate is chosen from
+    qint64 clockOffsets[CLOCK_SAMPLES];  // Offset of each recent round trip
+    qint64 clockRtts[CLOCK_SAMPLES];     // Round trip time of each recent round trip
+    int clockCount;               // Round trips recorded since the node connected
 };
 
 #endif // TCPSERVER_H
@@ -1,4 +1,6 @@
 #include <QApplication> 
+#include <QCommandLineParser>
+#include <QHostAddress>
 
 #include "mainwindow.h" 
 
@@ -15,6 +17,13 @@ int main(int argc, char *argv[])
     // QApplication Manages the application life cycle, event loop, and resources, and is an essential object for Qt GUI programs
     QApplication qApplication(argc, argv);
 
+    // Optional receiver mode: --multicast <group[:port]> also listens to the samples multicast by the nodes
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption multicastOption("multicast", "Receive the samples multicast to <group[:port]> (default port 8890).", "group[:port]");
+    parser.addOption(multicastOption);
+    parser.process(qApplication);
+
     // Create the main window object
     // MainWindow It is a user-defined main window class, inherited from QMainWindow or QWidget
     MainWindow mainWindow;
@@ -23,6 +32,12 @@ int main(int argc, char *argv[])
     // Call the show() method to make the window visible (the window is invisible when created by default)
     mainWindow.show();
 
+    if (parser.isSet(multicastOption)) {
+        QString value = parser.value(multicastOption);
+        quint16 port = value.contains(':') ? value.section(':', 1, 1).toUShort() : 8890;
+        mainWindow.startMulticastReceiver(QHostAddress(value.section(':', 0, 0)), port);
+    }
+
     // Start the event loop of the Qt application
     // The event loop is responsible for processing user input (such as mouse and keyboard events), system events, etc. It is the core of Qt program operation.
     // The function blocks until the application exits (for example, the user closes all windows) and returns an exit status code.
@@ -0,0 +1,357 @@
+// water_quality_bench.cpp
+// Benchmarks of the node's hot paths against simulated sensors and a simulated display, so that they run on any
+// Linux machine. Run with --benchmark_format=json (or the run_benchmarks target) for machine-readable results.
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "../src/common/logger.h"
+#include "../src/common/sample.h"
+#include "../src/common/shm_reader.h"
+#include "../src/common/water_quality.h"
+#include "../src/data_collection/data_collector.h"
+#include "../src/data_collection/ds18b20.h"
+#include "../src/data_collection/pcf8591.h"
+#include "../src/display/headless_backend.h"
+#include "../src/display/layout.h"
+#include "../src/display/rgb565.h"
+#include "../src/display/text_field.h"
+#include "../src/display/tft_freetype.h"
+#include "../src/event_loop/event_loop.h"
+#include "../src/networking/stream_encoder.h"
+#include "../src/storage/history_cursor.h"
+#include "../src/storage/sample_log.h"
+#include "../src/storage/shm_publisher.h"
+
+static const char* FONT_PATH = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+
+// ADC returning slowly changing readings instead of talking to the I2C bus
+class SimulatedPCF8591 : public PCF8591 {
+public:
+    SimulatedPCF8591() : PCF8591(-1), value(0) {}
+    int readMultiple(int channels[], int numChannels, int results[]) override {
+        for (int i = 0; i < numChannels; ++i) {
+            results[i] = (value + channels[i] * 37) & 0xFF;
+        }
+        value++;
+        return 0;
+    }
+private:
+    int value;
+};
+
+class SimulatedDS18B20 : public DS18B20 {
+public:
+    float readTemperature() override { return 23.125f; }
+};
+
+// Temporary directory removed at exit
+static std::string scratchDir(const char* name) {
+    static std::string base;
+    if (base.empty()) {
+        char tmpl[] = "/tmp/wqm_bench_XXXXXX";
+        if (mkdtemp(tmpl) == nullptr) {
+            perror("mkdtemp");
+            exit(EXIT_FAILURE);
+        }
+        base = tmpl;
+        atexit([]() { std::string cmd = "rm -rf " + base; if (system(cmd.c_str()) != 0) {} });
+    }
+    return base + "/" + name;
+}
+
+static Sample makeSample(uint64_t i, int64_t t0) {
+    Sample s;
+    s.seq = i + 1;
+    s.timestamp_us = t0 + static_cast<int64_t>(i) * 1000000;
+    s.turbidity = 42.0f + static_cast<float>(i % 7) * 0.25f;
+    s.temperature = 23.0f + static_cast<float>(i % 11) * 0.0625f;
+    s.pH = 7.0f + static_cast<float>(i % 5) * 0.01f;
+    return s;
+}
+
+// ---- Acquisition ----
+
+static void BM_CollectSample(benchmark::State& state) {
+    SimulatedPCF8591 adc;
+    SimulatedDS18B20 thermometer;
+    DataCollector collector(adc, thermometer);
+    for (auto _ : state) {
+        collector.collectData();
+    }
+    benchmark::DoNotOptimize(WaterQuality::getInstance().getpH());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollectSample);
+
+static void BM_DS18B20Read(benchmark::State& state) {
+    std::string path = scratchDir("w1_slave");
+    FILE* f = fopen(path.c_str(), "w");
+    fputs("72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n72 01 4b 46 7f ff 0e 10 57 t=23125\n", f);
+    fclose(f);
+    DS18B20 sensor(path.c_str());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sensor.readTemperature());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DS18B20Read);
+
+// ---- Stream encoding ----
+
+static void BM_Encode(benchmark::State& state) {
+    StreamEncoder encoder(static_cast<StreamEncoder::Encoding>(state.range(0)), 60);
+    uint8_t out[StreamEncoder::MAX_MESSAGE];
+    bool keyframe;
+    uint64_t i = 0;
+    size_t bytes = 0;
+    int64_t t0 = realtimeMicros();
+    for (auto _ : state) {
+        bytes += encoder.encode(makeSample(i++, t0), out, &keyframe);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_sample"] = static_cast<double>(bytes) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_Encode)->Arg(StreamEncoder::JSON)->Arg(StreamEncoder::GORILLA)->ArgName("gorilla");
+
+// ---- Display ----
+
+static void BM_FreeTypeRenderGlyph(benchmark::State& state) {
+    FT_Library library;
+    FT_Face face;
+    if (FT_Init_FreeType(&library) || FT_New_Face(library, FONT_PATH, 0, &face)) {
+        state.SkipWithError("font not available");
+        return;
+    }
+    FT_Set_Pixel_Sizes(face, 0, 16);
+    const char digits[] = "0123456789.";
+    size_t i = 0;
+    for (auto _ : state) {
+        FT_Load_Char(face, static_cast<FT_ULong>(digits[i++ % 11]), FT_LOAD_RENDER);
+        benchmark::DoNotOptimize(face->glyph->bitmap.buffer);
+    }
+    state.SetItemsProcessed(state.iterations());
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+BENCHMARK(BM_FreeTypeRenderGlyph);
+
+// Anti-aliasing of one 12x16 glyph: coverage blended into RGB565 by the vector kernel
+static void BM_BlendGlyph(benchmark::State& state) {
+    uint8_t coverage[12 * 16];
+    for (size_t i = 0; i < sizeof(coverage); ++i) {
+        coverage[i] = static_cast<uint8_t>(i * 37);
+    }
+    uint16_t pixels[12 * 16];
+    for (auto _ : state) {
+        Rgb565::blendRow(coverage, sizeof(coverage), 0xFFFF, 0x0010, pixels);
+        benchmark::DoNotOptimize(pixels);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(Rgb565::kernel());
+}
+BENCHMARK(BM_BlendGlyph);
+
+// Glyph lookup, framebuffer blit, diff and the flush of the changed digits, decoded by a headless panel
+static void BM_DrawString(benchmark::State& state) {
+    TFTFreetype tft(new HeadlessBackend(), FONT_PATH, 16);
+    const wchar_t* texts[] = {L"Turbidity: 42.25", L"Turbidity: 42.26"};
+    size_t i = 0;
+    for (auto _ : state) {
+        tft.drawString(5, 20, texts[i++ & 1], 0xFFFF);
+        tft.flush();
+    }
+    state.SetItemsProcessed(state.iterations() * 16);
+}
+BENCHMARK(BM_DrawString)->Unit(benchmark::kMicrosecond);
+
+// A typical dashboard update: one digit of a retained line changes; reports what each update costs on the bus
+static void BM_TextFieldUpdate(benchmark::State& state) {
+    HeadlessBackend* panel = new HeadlessBackend();
+    TFTFreetype tft(panel, FONT_PATH, 16);
+    TextField field(tft, 5, 20, 0xFFFF);
+    field.set(L"Turbidity: 42.24");
+    tft.flush();
+    uint64_t bytes = panel->bytes();
+    uint64_t transactions = panel->transactions();
+    uint64_t toggles = panel->gpioToggles();
+    const wchar_t* texts[] = {L"Turbidity: 42.25", L"Turbidity: 42.26"};
+    size_t i = 0;
+    for (auto _ : state) {
+        field.set(texts[i++ & 1]);
+        tft.flush();
+    }
+    double updates = static_cast<double>(state.iterations());
+    state.SetItemsProcessed(state.iterations());
+    state.counters["spi_bytes"] = static_cast<double>(panel->bytes() - bytes) / updates;
+    state.counters["spi_messages"] = static_cast<double>(panel->transactions() - transactions) / updates;
+    state.counters["gpio_toggles"] = static_cast<double>(panel->gpioToggles() - toggles) / updates;
+}
+BENCHMARK(BM_TextFieldUpdate)->Unit(benchmark::kMicrosecond);
+
+// One value of a paged layout changes; the cost does not grow with the number of probes
+static void BM_LayoutUpdate(benchmark::State& state) {
+    TFTFreetype tft(new HeadlessBackend(), FONT_PATH, 16);
+    std::vector<Layout::Probe> probes(state.range(0), Layout::Probe{L"Probe", L"%", 2, NAN, NAN});
+    const Layout::Style style = {0xBDF7, 0xFFFF, 0xF800, 0x0000};
+    Layout layout(tft, probes.data(), probes.size(), 0, 100, 5000000, style);
+    std::vector<float> values(probes.size(), 42.25f);
+    layout.update(0, values.data());
+    tft.flush();
+    size_t i = 0;
+    for (auto _ : state) {
+        values[0] = (i++ & 1) ? 42.26f : 42.25f;
+        layout.update(1, values.data());
+        tft.flush();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LayoutUpdate)->Arg(3)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+static void BM_FillScreen(benchmark::State& state) {
+    TFTFreetype tft(new HeadlessBackend(), FONT_PATH, 16);
+    uint16_t color = 0x0000;
+    for (auto _ : state) {
+        color = ~color;  // Every pixel changes, so the whole frame is sent
+        tft.fillScreen(color);
+        tft.flush();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * FrameBuffer::WIDTH * FrameBuffer::HEIGHT * 2);
+}
+BENCHMARK(BM_FillScreen)->Unit(benchmark::kMicrosecond);
+
+// ---- Event loop ----
+
+// One wakeup through epoll, dispatched to its handler
+static void BM_EventLoopDispatch(benchmark::State& state) {
+    std::atomic<bool> running(true);
+    EventLoop loop(running);
+    int efd = eventfd(0, EFD_NONBLOCK);
+    loop.add_fd(efd, [efd, &running]() {
+        uint64_t value;
+        if (read(efd, &value, sizeof(value)) != sizeof(value)) {
+            return;
+        }
+        running = false;
+    });
+    uint64_t one = 1;
+    for (auto _ : state) {
+        if (write(efd, &one, sizeof(one)) != sizeof(one)) {
+            state.SkipWithError("eventfd write failed");
+            break;
+        }
+        running = true;
+        loop.run();
+    }
+    loop.remove_fd(efd);
+    close(efd);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventLoopDispatch);
+
+static void BM_EventLoopPost(benchmark::State& state) {
+    std::atomic<bool> running(true);
+    EventLoop loop(running);
+    for (auto _ : state) {
+        running = true;
+        loop.post([&running]() { running = false; });
+        loop.run();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventLoopPost);
+
+// ---- History ----
+
+static const uint32_t SHM_CAPACITY = 3600;
+
+static void BM_ShmPublish(benchmark::State& state) {
+    ShmPublisher shm;
+    std::string name = "/wqm_bench_" + std::to_string(getpid());
+    if (!shm.open(name, SHM_CAPACITY)) {
+        state.SkipWithError("shared memory not available");
+        return;
+    }
+    uint64_t i = 0;
+    int64_t t0 = realtimeMicros();
+    for (auto _ : state) {
+        shm.publish(makeSample(i++, t0));
+    }
+    shm.close();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShmPublish);
+
+// Copy the whole shared-memory history ring, as a local consumer does on start
+static void BM_ShmReadRecent(benchmark::State& state) {
+    ShmPublisher shm;
+    std::string name = "/wqm_bench_" + std::to_string(getpid());
+    if (!shm.open(name, SHM_CAPACITY)) {
+        state.SkipWithError("shared memory not available");
+        return;
+    }
+    int64_t t0 = realtimeMicros();
+    for (uint64_t i = 0; i < SHM_CAPACITY; ++i) {
+        shm.publish(makeSample(i, t0));
+    }
+    ShmReader reader;
+    reader.open(name);
+    std::vector<Sample> out(SHM_CAPACITY);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(reader.recent(out.data(), out.size()));
+    }
+    reader.close();
+    shm.close();
+    state.SetItemsProcessed(state.iterations() * SHM_CAPACITY);
+}
+BENCHMARK(BM_ShmReadRecent)->Unit(benchmark::kMicrosecond);
+
+static const uint64_t HISTORY_SAMPLES = 50000;
+
+// Scan the whole on-device history through a query cursor
+static void BM_HistoryScan(benchmark::State& state) {
+    SampleLog::Format format = state.range(0) ? SampleLog::GORILLA : SampleLog::RAW;
+    SampleLog log;
+    std::string dir = scratchDir(format == SampleLog::GORILLA ? "history_gorilla" : "history_raw");
+    if (!log.open(dir, 365, format, 60)) {
+        state.SkipWithError("history not available");
+        return;
+    }
+    int64_t t0 = realtimeMicros() - static_cast<int64_t>(HISTORY_SAMPLES) * 1000000;
+    if (log.size() == 0) {
+        for (uint64_t i = 0; i < HISTORY_SAMPLES; ++i) {
+            log.append(makeSample(i, t0));
+        }
+    }
+    HistoryCursor cursor;
+    Sample chunk[128];
+    size_t scanned = 0;
+    for (auto _ : state) {
+        cursor.start(log, 0, INT64_MAX);
+        while (size_t n = cursor.next(chunk, 128)) {
+            scanned += n;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(scanned));
+}
+BENCHMARK(BM_HistoryScan)->Arg(0)->Arg(1)->ArgName("gorilla")->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    Logger::getInstance().setLevel(Logger::WARN);  // Keep stdout for the results
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "app.h"
 #include <iostream>
+#include <cerrno>
 #include <cstring>
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
@@ -10,17 +11,47 @@
 #include <algorithm> // New: Used for std::all_of
 #include <fstream>   // New: For std::ifstream
 #include <vector>    // Ensure that the vector header file is included.
-#include "../info_updating/debug_info_updater.h"
-#include "../info_updating/tft_info_updater.h"
-#include "../info_updating/socket_info_updater.h"
+#include <cstdio>
+#include "../common/logger.h"
+#include "../common/metrics.h"
+#include "../common/trace.h"
+#include <sys/signalfd.h>
 
-App::App() : running(true), loop(running) {}
+App::App() : running(true), loop(running), history_open(false), signal_fd(-1), startup(loop) {}
 
-// signal processing function
-void App::sigint_handler(int signum, siginfo_t *info, void *context) {
-    App* app = static_cast<App*>(context);
-    std::cout << ‘Catching Ctrl+C interrupt signal (SIGINT), program about to exit...’ << std::endl;
-    app->running = false;
+/**
+ * @brief Receive SIGINT and SIGTERM on the event loop
+ * @details The signals are blocked before any thread is started, so every thread inherits the mask and the kernel
+ *          queues them on the signalfd instead of interrupting whichever thread happens to run. Stopping the loop
+ *          from its own thread lets run() return and cleanup() close the history, the shared memory, the trace
+ *          and the logger as on a normal exit.
+ */
+void App::handleExitSignals() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigset_t blocked = mask;
+#ifdef WQM_TRACING
+    sigaddset(&blocked, SIGUSR1);  // Read by the trace signalfd
+#endif
+    if (sigprocmask(SIG_BLOCK, &blocked, NULL) == -1) {
+        perror("sigprocmask");
+        exit(EXIT_FAILURE);
+    }
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+    loop.add_fd(signal_fd, [this]() {
+        signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            LOG_INFO("Caught {}, program about to exit...", info.ssi_signo == SIGINT ? "SIGINT" : "SIGTERM");
+            running = false;
+        }
+    });
+    loop.set_name(signal_fd, "exit_signal");
 }
 
 // Create timer fd
@@ -49,7 +80,7 @@ void App::read_timer_fd(int fd) {
     uint64_t expirations;
     ssize_t s = read(fd, &expirations, sizeof(expirations));
     if (s != sizeof(expirations)) {
-        perror("read timerfd");
+        LOG_ERROR("Reading a timerfd failed: {}", s < 0 ? strerror(errno) : "short read");
     }
 }
 
@@ -117,7 +148,182 @@ bool isValidIpAddress(const std::string& ip) {
     return true;
 }
 
+// Deadbands of 0 (the default) leave the updater unfiltered
+InfoUpdater* App::filtered(InfoUpdater* target, std::unique_ptr<DeadbandFilter>& filter) {
+    double tur = config.getDouble("deadband_turbidity", 0);
+    double tmp = config.getDouble("deadband_temperature", 0);
+    double ph = config.getDouble("deadband_ph", 0);
+    if (tur <= 0 && tmp <= 0 && ph <= 0) {
+        return target;
+    }
+    long heartbeat_s = config.getInt("heartbeat_s", 60);
+    filter.reset(new DeadbandFilter(target, static_cast<float>(tur), static_cast<float>(tmp), static_cast<float>(ph),
+                                    static_cast<uint32_t>(heartbeat_s > 0 ? heartbeat_s * 1000 : 0)));
+    return filter.get();
+}
+
+// Node identifier for multicast datagrams: "node_id" from the configuration, otherwise a hash of the host name
+uint32_t App::nodeId() const {
+    long configured = config.getInt("node_id", -1);
+    if (configured >= 0) {
+        return static_cast<uint32_t>(configured);
+    }
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    return SampleRecord::checksum(reinterpret_cast<const uint8_t*>(host), strlen(host));
+}
+
+void App::reportFilterStats() const {
+    const DeadbandFilter* filters[] = {tftFilter.get(), socketFilter.get(), pubsubFilter.get(), multicastFilter.get()};
+    const char* names[] = {"TFT", "Socket", "Subscriber", "Multicast"};
+    for (int i = 0; i < 4; ++i) {
+        if (!filters[i]) {
+            continue;
+        }
+        const DeadbandFilter::Stats& st = filters[i]->stats();
+        std::cout << names[i] << " deadband: " << st.forwarded << " forwarded (" << st.heartbeats << " heartbeats), "
+                  << st.suppressed << " suppressed (" << filters[i]->suppressionRatio() << "%), triggered by turbidity "
+                  << st.triggered[DeadbandFilter::TURBIDITY] << ", temperature " << st.triggered[DeadbandFilter::TEMPERATURE]
+                  << ", pH " << st.triggered[DeadbandFilter::PH] << std::endl;
+    }
+}
+
+// Everything is read from counters the modules keep anyway; labels are formatted into stack buffers
+void App::renderMetrics(MetricsWriter& w) const {
+    const WaterQuality& wq = WaterQuality::getInstance();
+    Metrics& m = Metrics::getInstance();
+    char labels[96];
+
+    w.family("wqm_turbidity_percent", "gauge", "Latest turbidity reading.");
+    w.sample("wqm_turbidity_percent", nullptr, static_cast<double>(wq.getTurbidity()));
+    w.family("wqm_temperature_celsius", "gauge", "Latest DS18B20 temperature reading.");
+    w.sample("wqm_temperature_celsius", nullptr, static_cast<double>(wq.getDS18B20()));
+    w.family("wqm_ph", "gauge", "Latest pH reading.");
+    w.sample("wqm_ph", nullptr, static_cast<double>(wq.getpH()));
+    w.family("wqm_sample_sequence", "gauge", "Sequence number of the latest sample.");
+    w.sample("wqm_sample_sequence", nullptr, wq.getSequence());
+    w.family("wqm_samples_collected_total", "counter", "Acquisition cycles completed since start.");
+    w.sample("wqm_samples_collected_total", nullptr, Metrics::read(m.samples_collected));
+    w.family("wqm_history_samples", "gauge", "Samples kept in the on-device history.");
+    w.sample("wqm_history_samples", nullptr, history.size());
+
+    w.family("wqm_bus_errors_total", "counter", "Failed sensor and display bus transfers.");
+    w.sample("wqm_bus_errors_total", "bus=\"i2c\"", Metrics::read(m.i2c_errors));
+    w.sample("wqm_bus_errors_total", "bus=\"w1\"", Metrics::read(m.w1_errors));
+    w.sample("wqm_bus_errors_total", "bus=\"spi\"", Metrics::read(m.spi_errors));
+
+    w.family("wqm_log_records_lost_total", "counter", "Log records not written.");
+    w.sample("wqm_log_records_lost_total", "reason=\"ring_full\"", Logger::getInstance().dropped());
+    w.sample("wqm_log_records_lost_total", "reason=\"rate_limit\"", Logger::getInstance().suppressed());
+
+    // Event loop handlers: a cumulative histogram per named handler
+    w.family("wqm_handler_duration_seconds", "histogram", "Run time of the event loop handlers.");
+    loop.visit_stats([&w, &labels](const EventLoop::HandlerStats& st) {
+        for (int i = 0; i < EventLoop::LATENCY_BUCKETS; ++i) {
+            std::snprintf(labels, sizeof(labels), "handler=\"%s\",le=\"%g\"", st.name, EventLoop::BUCKET_BOUNDS_NS[i] / 1e9);
+            w.sample("wqm_handler_duration_seconds_bucket", labels, st.buckets[i]);
+        }
+        std::snprintf(labels, sizeof(labels), "handler=\"%s\",le=\"+Inf\"", st.name);
+        w.sample("wqm_handler_duration_seconds_bucket", labels, st.calls);
+        std::snprintf(labels, sizeof(labels), "handler=\"%s\"", st.name);
+        w.sample("wqm_handler_duration_seconds_sum", labels, st.total_ns / 1e9);
+        w.sample("wqm_handler_duration_seconds_count", labels, st.calls);
+    });
+    w.family("wqm_handler_duration_max_seconds", "gauge", "Longest run of each event loop handler.");
+    loop.visit_stats([&w, &labels](const EventLoop::HandlerStats& st) {
+        std::snprintf(labels, sizeof(labels), "handler=\"%s\"", st.name);
+        w.sample("wqm_handler_duration_max_seconds", labels, st.max_ns / 1e9);
+    });
+
+    if (socketInfoUpdater) {
+        const char* families[][3] = {
+            {"wqm_upstream_connected", "gauge", "Whether the upstream server is connected."},
+            {"wqm_upstream_queue_depth", "gauge", "Messages waiting to be written to the upstream server."},
+            {"wqm_upstream_reconnects_total", "counter", "Connections to the upstream server after the first one."},
+            {"wqm_upstream_dropped_samples_total", "counter", "Samples the upstream server did not get."},
+        };
+        for (int f = 0; f < 4; ++f) {
+            w.family(families[f][0], families[f][1], families[f][2]);
+            for (size_t i = 0; i < socketInfoUpdater->endpointCount(); ++i) {
+                const UpstreamEndpoint& e = socketInfoUpdater->endpoint(i);
+                std::snprintf(labels, sizeof(labels), "endpoint=\"%s\"", e.name());
+                uint64_t values[] = {e.connected() ? 1u : 0u, e.queued(), e.reconnects(), e.droppedSamples()};
+                w.sample(families[f][0], labels, values[f]);
+            }
+        }
+    }
+    if (pubsubServer) {
+        w.family("wqm_subscribers", "gauge", "Connected subscribers.");
+        w.sample("wqm_subscribers", nullptr, static_cast<uint64_t>(pubsubServer->subscriberCount()));
+        w.family("wqm_subscriber_queue_depth", "gauge", "Messages waiting to be written to the subscribers.");
+        w.sample("wqm_subscriber_queue_depth", nullptr, static_cast<uint64_t>(pubsubServer->queuedMessages()));
+        w.family("wqm_subscriber_dropped_samples_total", "counter", "Samples lost by slow subscribers.");
+        w.sample("wqm_subscriber_dropped_samples_total", nullptr, pubsubServer->droppedSamples());
+        w.family("wqm_subscriber_rejected_total", "counter", "Subscribers refused because the server was full.");
+        w.sample("wqm_subscriber_rejected_total", nullptr, pubsubServer->rejectedClients());
+    }
+    if (multicastPublisher) {
+        w.family("wqm_multicast_datagrams_total", "counter", "Datagrams sent to the multicast group.");
+        w.sample("wqm_multicast_datagrams_total", nullptr, multicastPublisher->sentDatagrams());
+        w.family("wqm_multicast_dropped_total", "counter", "Datagrams the socket did not accept.");
+        w.sample("wqm_multicast_dropped_total", nullptr, multicastPublisher->droppedDatagrams());
+    }
+
+    const DeadbandFilter* filters[] = {tftFilter.get(), socketFilter.get(), pubsubFilter.get(), multicastFilter.get()};
+    const char* sinks[] = {"tft", "socket", "subscriber", "multicast"};
+    w.family("wqm_deadband_samples_total", "counter", "Samples seen by the report-by-exception filters.");
+    for (int i = 0; i < 4; ++i) {
+        if (filters[i]) {
+            const DeadbandFilter::Stats& st = filters[i]->stats();
+            std::snprintf(labels, sizeof(labels), "sink=\"%s\",result=\"forwarded\"", sinks[i]);
+            w.sample("wqm_deadband_samples_total", labels, st.forwarded);
+            std::snprintf(labels, sizeof(labels), "sink=\"%s\",result=\"suppressed\"", sinks[i]);
+            w.sample("wqm_deadband_samples_total", labels, st.suppressed);
+        }
+    }
+}
+
+// Parse "ip[:port] [json|gorilla]"; the port defaults to PORT and the encoding to the given default
+static bool parseUpstream(const std::string& value, StreamEncoder::Encoding def, SocketInfoUpdater::Target* target) {
+    std::stringstream ss(value);
+    std::string address;
+    std::string encoding;
+    ss >> address >> encoding;
+
+    int port = PORT;
+    size_t colon = address.find(':');
+    if (colon != std::string::npos) {
+        try {
+            port = std::stoi(address.substr(colon + 1));
+        } catch (...) {
+            return false;
+        }
+        address = address.substr(0, colon);
+    }
+    if (port < 1 || port > 65535) {
+        return false;
+    }
+
+    memset(&target->addr, 0, sizeof(target->addr));
+    target->addr.sin_family = AF_INET;
+    target->addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &target->addr.sin_addr) != 1) {
+        return false;
+    }
+    if (encoding.empty()) {
+        target->encoding = def;
+    } else if (encoding == "json" || encoding == "gorilla") {
+        target->encoding = StreamEncoder::parse(encoding);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void App::init() {
+    // Before the logger and the startup threads exist, so none of them is left with the signals unblocked
+    handleExitSignals();
+
     // 1. Read IP address from file (includes <fstream>, can be used normally)
     std::string ip;
     std::ifstream file("config.txt");
@@ -129,7 +335,13 @@ void App::init() {
     // Read the first line and remove leading and trailing spaces
     std::getline(file, ip);
     ip = trim(ip);
+    // The remaining lines hold optional "key = value" settings
+    config.load(file);
     file.close();
+
+    // From here on, messages are formatted and written by the logger thread
+    Logger::getInstance().setLevel(Logger::parseLevel(config.get("log_level", "info")));
+    Logger::getInstance().start();
     
     // 2. Verify IP address validity and range
     if (ip.empty()) {
@@ -141,66 +353,220 @@ void App::init() {
         exit(EXIT_FAILURE);
     }
 
-    // 3. Connect to server (fix socket function parameters and return values)
-    int port = 8888;
-    // Socket::connectToServer Modified to return int，The parameter is const char*
-    if (Socket::connectToServer(&sock, ip.c_str(), port) != 0) {
-        std::cerr << "Error: Connecting to server " << ip << ":" << port << " failure" << std::endl;
-        exit(EXIT_FAILURE);
+    // 3. Upstream servers: the one on the first line, then any "upstream = ip[:port] [json|gorilla]" lines.
+    // Connections are opened from the event loop and retried in the background, so an unreachable server
+    // never stops the node from sampling
+    StreamEncoder::Encoding encoding = StreamEncoder::parse(config.get("stream_encoding", "json"));
+    std::vector<SocketInfoUpdater::Target> targets;
+    SocketInfoUpdater::Target primary;
+    parseUpstream(ip + ":" + std::to_string(PORT), encoding, &primary);
+    targets.push_back(primary);
+    for (const std::string& value : config.getAll("upstream")) {
+        SocketInfoUpdater::Target target;
+        if (!parseUpstream(value, encoding, &target)) {
+            std::cerr << "Error: Invalid upstream " << value << " (expected ip[:port] [json|gorilla])" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        targets.push_back(target);
     }
-    std::cout << "Connection successful: " << ip << ":" << port << std::endl;
 
-    // Signal processing settings
-    struct sigaction sa;
-    sa.sa_flags = SA_SIGINFO;
-    sa.sa_sigaction = sigint_handler;
-    sigemptyset(&sa.sa_mask);
+    // Samples between keyframes of the compressed history and streams
+    uint32_t keyframe_interval = static_cast<uint32_t>(config.getInt("keyframe_interval", 60));
 
-    if (sigaction(SIGINT, &sa, NULL) == -1) {
-        perror("sigaction");
+#ifdef WQM_TRACING
+    // Tracing build: SIGUSR1 writes the recorded timeline (kill -USR1 <pid>), read on the loop thread.
+    // It was blocked with the exit signals
+    trace_file = config.get("trace_file", "trace.json");
+    sigset_t trace_mask;
+    sigemptyset(&trace_mask);
+    sigaddset(&trace_mask, SIGUSR1);
+    trace_fd = signalfd(-1, &trace_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (trace_fd == -1) {
+        perror("signalfd");
         exit(EXIT_FAILURE);
     }
+    loop.add_fd(trace_fd, [this]() {
+        signalfd_siginfo info;
+        while (read(trace_fd, &info, sizeof(info)) == sizeof(info)) {
+        }
+        if (Trace::dump(trace_file.c_str())) {
+            LOG_INFO("Trace: {} events recorded, latest written to {}", Trace::recorded(), trace_file);
+        }
+    });
+    loop.set_name(trace_fd, "trace_signal");
+#endif
 
     std::cout << "The program is running，The program is running. Press Ctrl+C log out" << std::endl;
 
-    // Data acquisition timer
-    DataCollector dataCollector;
-    int data_timer_fd = create_timer_fd(1000);
-    loop.add_fd(data_timer_fd, [this, &dataCollector, data_timer_fd]() {
-        read_timer_fd(data_timer_fd);
-        dataCollector.collectData();
-    });
-    timer_fds.push_back(data_timer_fd);
-
-    // Debugging information timer
-    DebugInfoUpdater debugInfoUpdater;
-    int debug_timer_fd = create_timer_fd(1000);
-    loop.add_fd(debug_timer_fd, [this, &debugInfoUpdater, debug_timer_fd]() {
-        read_timer_fd(debug_timer_fd);
-        debugInfoUpdater.update();
-    });
-    updaters.push_back(&debugInfoUpdater);
-    timer_fds.push_back(debug_timer_fd);
-
-    // TFT display timer
-    TFTInfoUpdater tftInfoUpdater;
-    int tft_timer_fd = create_timer_fd(1000);
-    loop.add_fd(tft_timer_fd, [this, &tftInfoUpdater, tft_timer_fd]() {
-        read_timer_fd(tft_timer_fd);
-        tftInfoUpdater.update();
-    });
-    updaters.push_back(&tftInfoUpdater);
-    timer_fds.push_back(tft_timer_fd);
-
-    // Socket communication timer
-    SocketInfoUpdater socketInfoUpdater(sock);
-    int sock_timer_fd = create_timer_fd(1000);
-    loop.add_fd(sock_timer_fd, [this, &socketInfoUpdater, sock_timer_fd]() {
-        read_timer_fd(sock_timer_fd);
-        socketInfoUpdater.update();
+    // The subsystems come up concurrently: each blocking part runs on a thread of its own and the subsystem joins
+    // the event loop when it is done. Sampling starts once the sensors and the history are open, without waiting
+    // for the display reset; the upstream connections are opened from the loop as before.
+
+    // Open the on-device history; the sequence numbers continue from the last stored sample
+    std::string history_dir = config.get("history_dir", "history");
+    long history_segments = config.getInt("history_segments", 365);
+    SampleLog::Format history_format = config.get("history_format", "raw") == "gorilla" ? SampleLog::GORILLA : SampleLog::RAW;
+    // Shared memory for local consumers; they read it without any system call
+    std::string shm_name = config.get("shm_name");
+    if (!shm_name.empty() && shm_name[0] != '/') {
+        shm_name = "/" + shm_name;
+    }
+    long shm_history = config.getInt("shm_history", 3600);
+    startup.add("history",
+        [this, history_dir, history_segments, history_format, keyframe_interval, shm_name, shm_history]() {
+            history_open = history.open(history_dir, history_segments, history_format, keyframe_interval);
+            if (!shm_name.empty()) {
+                shm.open(shm_name, static_cast<uint32_t>(shm_history > 0 ? shm_history : 1));
+            }
+        },
+        [this]() {
+            if (history_open) {
+                WaterQuality::getInstance().setSequence(history.lastSequence());
+                LOG_INFO("History: {} samples stored, last sequence {}", history.size(), history.lastSequence());
+            }
+        });
+
+    // I2C bus and 1-Wire sensor
+    startup.add("sensors", [this]() { dataCollector.reset(new DataCollector()); }, nullptr);
+
+    // Data acquisition timer; the first sample is taken right away instead of one period later
+    startup.add("collection", nullptr, [this]() {
+        int data_timer_fd = create_timer_fd(1000);
+        loop.add_fd(data_timer_fd, [this, data_timer_fd]() {
+            read_timer_fd(data_timer_fd);
+            collectSample();
+        });
+        loop.set_name(data_timer_fd, "data_timer");
+        timer_fds.push_back(data_timer_fd);
+        collectSample();
+        startup.milestone("first sample");
+
+        // Debugging information timer
+        debugInfoUpdater.reset(new DebugInfoUpdater());
+        int debug_timer_fd = create_timer_fd(1000);
+        loop.add_fd(debug_timer_fd, [this, debug_timer_fd]() {
+            read_timer_fd(debug_timer_fd);
+            debugInfoUpdater->update();
+        });
+        updaters.push_back(debugInfoUpdater.get());
+        loop.set_name(debug_timer_fd, "debug_timer");
+        timer_fds.push_back(debug_timer_fd);
+    }, {"sensors", "history"});
+
+    // TFT display timer; the panel reset and font loading take most of a second
+    startup.add("display", [this]() { tftInfoUpdater.reset(new TFTInfoUpdater()); }, [this]() {
+        InfoUpdater* tftOutput = filtered(tftInfoUpdater.get(), tftFilter);
+        int tft_timer_fd = create_timer_fd(1000);
+        loop.add_fd(tft_timer_fd, [this, tft_timer_fd, tftOutput]() {
+            read_timer_fd(tft_timer_fd);
+            tftOutput->update();
+        });
+        updaters.push_back(tftInfoUpdater.get());
+        loop.set_name(tft_timer_fd, "tft_timer");
+        timer_fds.push_back(tft_timer_fd);
     });
-    updaters.push_back(&socketInfoUpdater);
-    timer_fds.push_back(sock_timer_fd);
+
+    // Socket communication timer; backfill requests read the history
+    startup.add("network", nullptr, [this, targets, keyframe_interval]() {
+        socketInfoUpdater.reset(new SocketInfoUpdater(loop, targets, &history,
+                                                      static_cast<size_t>(config.getInt("upstream_queue", 120)), keyframe_interval));
+        InfoUpdater* socketOutput = filtered(socketInfoUpdater.get(), socketFilter);
+        int sock_timer_fd = create_timer_fd(1000);
+        loop.add_fd(sock_timer_fd, [this, sock_timer_fd, socketOutput]() {
+            read_timer_fd(sock_timer_fd);
+            socketOutput->update();
+        });
+        updaters.push_back(socketInfoUpdater.get());
+        loop.set_name(sock_timer_fd, "socket_timer");
+        timer_fds.push_back(sock_timer_fd);
+    }, {"history"});
+
+    startup.add("servers", nullptr, [this, keyframe_interval]() { startServers(keyframe_interval); }, {"history"});
+
+    try {
+        startup.start();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Subscriber, multicast, query and metrics servers, each only if configured
+void App::startServers(uint32_t keyframe_interval) {
+    // Subscriber server: dashboards and loggers connect to the node
+    int pubsub_port = static_cast<int>(config.getInt("pubsub_port", 0));
+    if (pubsub_port > 0) {
+        try {
+            pubsubServer.reset(new PubSubServer(loop, pubsub_port,
+                                                StreamEncoder::parse(config.get("pubsub_encoding", config.get("stream_encoding", "json"))),
+                                                static_cast<size_t>(config.getInt("pubsub_max_clients", 16)),
+                                                static_cast<size_t>(config.getInt("pubsub_queue", 64)), keyframe_interval));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        InfoUpdater* pubsubOutput = filtered(pubsubServer.get(), pubsubFilter);
+        int pubsub_timer_fd = create_timer_fd(1000);
+        loop.add_fd(pubsub_timer_fd, [this, pubsub_timer_fd, pubsubOutput]() {
+            read_timer_fd(pubsub_timer_fd);
+            pubsubOutput->update();
+        });
+        updaters.push_back(pubsubServer.get());
+        loop.set_name(pubsub_timer_fd, "pubsub_timer");
+        timer_fds.push_back(pubsub_timer_fd);
+    }
+
+    // UDP multicast: one datagram per sample, whatever the number of receivers
+    std::string multicast_group = config.get("multicast_group");
+    if (!multicast_group.empty()) {
+        try {
+            multicastPublisher.reset(new MulticastPublisher(multicast_group, static_cast<int>(config.getInt("multicast_port", 8890)),
+                                                            static_cast<int>(config.getInt("multicast_ttl", 1)),
+                                                            config.get("multicast_interface"), nodeId()));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        InfoUpdater* multicastOutput = filtered(multicastPublisher.get(), multicastFilter);
+        int multicast_timer_fd = create_timer_fd(1000);
+        loop.add_fd(multicast_timer_fd, [this, multicast_timer_fd, multicastOutput]() {
+            read_timer_fd(multicast_timer_fd);
+            multicastOutput->update();
+        });
+        updaters.push_back(multicastPublisher.get());
+        loop.set_name(multicast_timer_fd, "multicast_timer");
+        timer_fds.push_back(multicast_timer_fd);
+    }
+
+    // Local history queries over a Unix domain socket, answered in slices between the ticks
+    std::string query_socket = config.get("query_socket");
+    if (!query_socket.empty()) {
+        try {
+            queryServer.reset(new QueryServer(loop, query_socket, &history));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Prometheus endpoint: rendered on the loop thread into a preallocated buffer at scrape time
+    int metrics_port = static_cast<int>(config.getInt("metrics_port", 0));
+    if (metrics_port > 0) {
+        try {
+            metricsServer.reset(new MetricsServer(loop, metrics_port, [this](MetricsWriter& w) { renderMetrics(w); }));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// One acquisition cycle: read the sensors, then store and publish the sample
+void App::collectSample() {
+    dataCollector->collectData();
+    Sample sample = WaterQuality::getInstance().snapshot();
+    history.append(sample);
+    shm.publish(sample);
 }
 
 void App::run() {
@@ -208,8 +574,16 @@ void App::run() {
 }
 
 void App::cleanup() {
+    reportFilterStats();
     for (int fd : timer_fds) {
         close(fd);
     }
-    close(sock);
+    // The upstream sockets are closed with their endpoints
+    shm.close();
+    close(signal_fd);
+#ifdef WQM_TRACING
+    close(trace_fd);
+    Trace::dump(trace_file.c_str());  // Keep the timeline of the last seconds before the exit
+#endif
+    Logger::getInstance().stop();
 }
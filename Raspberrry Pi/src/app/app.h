@@ -4,23 +4,57 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <vector>
+#include "config.h"
+#include "startup.h"
 #include "../event_loop/event_loop.h"
 #include "../data_collection/data_collector.h"
 #include "../info_updating/info_updater.h"
+#include "../info_updating/debug_info_updater.h"
+#include "../info_updating/tft_info_updater.h"
+#include "../info_updating/socket_info_updater.h"
+#include "../info_updating/deadband_filter.h"
+#include "../networking/metrics_server.h"
+#include "../networking/multicast_publisher.h"
+#include "../networking/pubsub_server.h"
+#include "../networking/query_server.h"
 #include "../networking/sock.h"
+#include "../storage/sample_log.h"
+#include "../storage/shm_publisher.h"
 #include <signal.h> // add <signal.h> header file
 
 class App {
 private:
     std::atomic<bool> running;
     EventLoop loop;
-    int sock;
+    Config config;                         ///< Options following the IP address in config.txt
+    SampleLog history;                     ///< On-device history of every sample
+    ShmPublisher shm;                      ///< Latest sample and recent history for local processes (optional)
+    std::unique_ptr<DataCollector> dataCollector;
+    std::unique_ptr<DebugInfoUpdater> debugInfoUpdater;
+    std::unique_ptr<TFTInfoUpdater> tftInfoUpdater;
+    std::unique_ptr<SocketInfoUpdater> socketInfoUpdater;
+    std::unique_ptr<DeadbandFilter> tftFilter;     ///< Report-by-exception filter in front of the display (optional)
+    std::unique_ptr<DeadbandFilter> socketFilter;  ///< Report-by-exception filter in front of the server stream (optional)
+    std::unique_ptr<PubSubServer> pubsubServer;    ///< Subscriber server (optional)
+    std::unique_ptr<DeadbandFilter> pubsubFilter;  ///< Report-by-exception filter in front of the subscribers (optional)
+    std::unique_ptr<MulticastPublisher> multicastPublisher;  ///< LAN-wide UDP multicast sink (optional)
+    std::unique_ptr<DeadbandFilter> multicastFilter;         ///< Report-by-exception filter in front of the multicast sink (optional)
+    std::unique_ptr<MetricsServer> metricsServer;            ///< Prometheus /metrics endpoint (optional)
+    std::unique_ptr<QueryServer> queryServer;                ///< Local history query socket (optional)
     std::vector<InfoUpdater*> updaters;
     std::vector<int> timer_fds;
+    bool history_open;                     ///< The history directory was opened (set by the startup task)
+    int signal_fd;                         ///< signalfd delivering SIGINT and SIGTERM (exit request)
+#ifdef WQM_TRACING
+    std::string trace_file;                ///< Destination of the trace dumps
+    int trace_fd;                          ///< signalfd delivering SIGUSR1 (dump request)
+#endif
+    Startup startup;                       ///< Concurrent bring-up of the subsystems (last: its workers use the members above)
 
-    // signal processing function
-    static void sigint_handler(int signum, siginfo_t *info, void *context);
+    // Stop the event loop on SIGINT or SIGTERM
+    void handleExitSignals();
 
     // Create timer fd
     int create_timer_fd(int interval_ms);
@@ -28,6 +62,24 @@ private:
     // Read timer event
     void read_timer_fd(int fd);
 
+    // One acquisition cycle: collect, store and publish a sample
+    void collectSample();
+
+    // Start the optional servers (subscribers, multicast, queries, metrics)
+    void startServers(uint32_t keyframe_interval);
+
+    // Put a deadband filter in front of an updater if one is configured; returns what the timer should call
+    InfoUpdater* filtered(InfoUpdater* target, std::unique_ptr<DeadbandFilter>& filter);
+
+    // Print the suppression statistics of the deadband filters
+    void reportFilterStats() const;
+
+    // Identifier of this node in multicast datagrams
+    uint32_t nodeId() const;
+
+    // Write the node's metrics for a /metrics scrape (no allocation)
+    void renderMetrics(MetricsWriter& w) const;
+
 public:
     App();
     void init();
@@ -0,0 +1,73 @@
+// config.cpp
+#include "config.h"
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+// Trim leading and trailing whitespace
+static std::string strip(const std::string& s) {
+    size_t b = 0;
+    size_t e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) {
+        b++;
+    }
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) {
+        e--;
+    }
+    return s.substr(b, e - b);
+}
+
+void Config::load(std::istream& in) {
+    std::string line;
+    while (std::getline(in, line)) {
+        line = strip(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Warning: Ignoring malformed configuration line: " << line << std::endl;
+            continue;
+        }
+        entries.push_back(std::make_pair(strip(line.substr(0, eq)), strip(line.substr(eq + 1))));
+    }
+}
+
+std::string Config::get(const std::string& key, const std::string& def) const {
+    for (size_t i = entries.size(); i > 0; --i) {
+        if (entries[i - 1].first == key) {
+            return entries[i - 1].second;
+        }
+    }
+    return def;
+}
+
+long Config::getInt(const std::string& key, long def) const {
+    std::string v = get(key);
+    if (v.empty()) {
+        return def;
+    }
+    char* end = nullptr;
+    long n = std::strtol(v.c_str(), &end, 10);
+    return (end && *end == '\0') ? n : def;
+}
+
+double Config::getDouble(const std::string& key, double def) const {
+    std::string v = get(key);
+    if (v.empty()) {
+        return def;
+    }
+    char* end = nullptr;
+    double d = std::strtod(v.c_str(), &end);
+    return (end && *end == '\0') ? d : def;
+}
+
+std::vector<std::string> Config::getAll(const std::string& key) const {
+    std::vector<std::string> values;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first == key) {
+            values.push_back(entries[i].second);
+        }
+    }
+    return values;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file config.h
+ * @brief Optional settings read from config.txt
+ * @details The first line of config.txt is still the server IP address. Every following non-empty line may hold
+ *          a "key = value" option; lines starting with '#' are comments. Keys may repeat, in which case all values
+ *          are kept in file order.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class Config
+ * @brief Key/value store for the optional settings following the IP address in config.txt
+ */
+class Config {
+private:
+    std::vector<std::pair<std::string, std::string>> entries;  ///< Options in file order
+
+public:
+    /**
+     * @brief Parse the remaining lines of the configuration stream
+     * @param in Stream positioned after the IP address line
+     * @note Malformed lines (no '=') are reported on standard error and skipped
+     */
+    void load(std::istream& in);
+
+    /**
+     * @brief Get the last value of a key
+     * @param key Option name
+     * @param def Value returned when the key is absent
+     * @return std::string Option value
+     */
+    std::string get(const std::string& key, const std::string& def = "") const;
+
+    /**
+     * @brief Get an integer option
+     * @param key Option name
+     * @param def Value returned when the key is absent or not a number
+     * @return long Option value
+     */
+    long getInt(const std::string& key, long def) const;
+
+    /**
+     * @brief Get a floating point option
+     * @param key Option name
+     * @param def Value returned when the key is absent or not a number
+     * @return double Option value
+     */
+    double getDouble(const std::string& key, double def) const;
+
+    /**
+     * @brief Get every value of a repeated key
+     * @param key Option name
+     * @return std::vector<std::string> Values in file order (empty when absent)
+     */
+    std::vector<std::string> getAll(const std::string& key) const;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,166 @@
+// startup.cpp
+#include "startup.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "../common/logger.h"
+#include "../common/sample.h"
+
+Startup::Startup(EventLoop& l) : loop(l), origin_us(monotonicMicros()), event_fd(-1), joined(0) {}
+
+Startup::~Startup() {
+    for (auto& t : tasks) {
+        if (t->worker.joinable()) {
+            t->worker.join();
+        }
+    }
+    if (event_fd >= 0) {
+        close(event_fd);
+    }
+}
+
+uint64_t Startup::elapsedUs() const {
+    return static_cast<uint64_t>(monotonicMicros() - origin_us);
+}
+
+void Startup::add(const char* name, Step work, Step ready, std::initializer_list<const char*> after) {
+    std::unique_ptr<Task> t(new Task());
+    t->name = name;
+    t->work = std::move(work);
+    t->ready = std::move(ready);
+    t->started = false;
+    t->ready_done = false;
+    t->start_us = t->work_done_us = t->ready_us = 0;
+    // Dependencies must already be known, so the tasks cannot form a cycle
+    for (const char* dep : after) {
+        size_t i = 0;
+        while (i < tasks.size() && std::strcmp(tasks[i]->name, dep) != 0) {
+            ++i;
+        }
+        if (i == tasks.size()) {
+            throw std::runtime_error(std::string("Unknown startup dependency ") + dep + " of " + name);
+        }
+        t->after.push_back(i);
+    }
+    tasks.push_back(std::move(t));
+}
+
+void Startup::start() {
+    completed.reserve(tasks.size());
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd == -1) {
+        throw std::runtime_error("Startup eventfd creation failed：" + std::string(strerror(errno)));
+    }
+    loop.add_fd(event_fd, [this]() { onCompleted(); });
+    loop.set_name(event_fd, "startup");
+    advance();
+}
+
+void Startup::milestone(const char* name) {
+    Milestone m = {name, elapsedUs()};
+    milestones.push_back(m);
+}
+
+// Loop thread: run the ready steps of the workers that finished, then start what they unblocked
+void Startup::onCompleted() {
+    uint64_t count;
+    while (read(event_fd, &count, sizeof(count)) == sizeof(count)) {
+    }
+    std::vector<Task*> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.swap(completed);
+    }
+    for (Task* t : done) {
+        join(t);
+    }
+    advance();
+}
+
+void Startup::join(Task* t) {
+    if (t->worker.joinable()) {
+        t->worker.join();
+    }
+    if (!t->error.empty()) {
+        // Same as a failed constructor in App::init
+        std::cerr << "Error: " << t->error << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (t->ready) {
+        t->ready();
+    }
+    t->ready_us = elapsedUs();
+    t->ready_done = true;
+    ++joined;
+}
+
+// Start every task whose dependencies are ready; tasks without work are joined on the spot
+void Startup::advance() {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto& task : tasks) {
+            Task* t = task.get();
+            if (t->started) {
+                continue;
+            }
+            bool blocked = false;
+            for (size_t dep : t->after) {
+                blocked = blocked || !tasks[dep]->ready_done;
+            }
+            if (blocked) {
+                continue;
+            }
+            t->started = true;
+            t->start_us = elapsedUs();
+            if (!t->work) {
+                t->work_done_us = t->start_us;
+                join(t);
+                progress = true;
+                continue;
+            }
+            t->worker = std::thread([this, t]() {
+                try {
+                    t->work();
+                } catch (const std::exception& e) {
+                    t->error = e.what();
+                }
+                t->work_done_us = elapsedUs();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    completed.push_back(t);
+                }
+                uint64_t one = 1;
+                if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+                    LOG_ERROR("Startup: unable to signal the event loop: {}", strerror(errno));
+                }
+            });
+        }
+    }
+
+    if (finished() && event_fd >= 0) {
+        loop.remove_fd(event_fd);
+        close(event_fd);
+        event_fd = -1;
+        report();
+    }
+}
+
+void Startup::report() const {
+    uint64_t total = 0;
+    for (auto& t : tasks) {
+        total = t->ready_us > total ? t->ready_us : total;
+    }
+    LOG_INFO("Startup: all subsystems ready after {} ms", total / 1000.0);
+    for (auto& t : tasks) {
+        LOG_INFO("Startup {}: started at {} ms, work {} ms, ready at {} ms", t->name, t->start_us / 1000.0,
+                 (t->work_done_us - t->start_us) / 1000.0, t->ready_us / 1000.0);
+    }
+    for (const Milestone& m : milestones) {
+        LOG_INFO("Startup: {} at {} ms", m.name, m.at_us / 1000.0);
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file startup.h
+ * @brief Concurrent bring-up of the node's subsystems with dependency tracking and a per-phase timing report
+ * @details Each subsystem is a named task of two steps. The work step runs on a thread of its own and may block
+ *          (panel reset delays, opening devices, scanning the history directory). The ready step then runs on the
+ *          loop thread and joins the subsystem to the EventLoop, typically by registering its timer. A task starts
+ *          once the ready steps of the tasks it depends on have run, so sampling begins as soon as the sensors are
+ *          open while a slow display is still being reset. Finished workers wake the loop through an eventfd.
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../event_loop/event_loop.h"
+
+/**
+ * @class Startup
+ * @brief Runs the startup tasks and reports how long each phase took
+ */
+class Startup {
+public:
+    typedef std::function<void()> Step;
+
+    /**
+     * @brief Constructor; the report measures from here
+     * @param loop Event loop the ready steps run on
+     */
+    explicit Startup(EventLoop& loop);
+
+    /**
+     * @brief Waits for workers still running (e.g. when the node is stopped during startup)
+     */
+    ~Startup();
+
+    Startup(const Startup&) = delete;
+    Startup& operator=(const Startup&) = delete;
+
+    /**
+     * @brief Add a task; call before start()
+     * @param name Static string used in the report and by dependent tasks
+     * @param work Blocking part, run on a thread of its own (empty if there is none); an exception stops the node
+     * @param ready Part run on the loop thread once the work is done (may be empty)
+     * @param after Names of tasks added earlier that must be ready first
+     * @throws std::runtime_error If a dependency is unknown
+     */
+    void add(const char* name, Step work, Step ready, std::initializer_list<const char*> after = {});
+
+    /**
+     * @brief Start every task whose dependencies are met; the rest follow as the loop joins their dependencies
+     * @details Tasks without work or pending dependencies are joined immediately, on the calling (loop) thread.
+     */
+    void start();
+
+    /**
+     * @brief Record a point in time for the report (e.g. "first sample"); loop thread only
+     * @param name Static string
+     */
+    void milestone(const char* name);
+
+    bool finished() const { return joined == tasks.size(); }  ///< Every task is ready
+
+private:
+    struct Task {
+        const char* name;            ///< Label
+        Step work;                   ///< Blocking part (worker thread)
+        Step ready;                  ///< Joining part (loop thread)
+        std::vector<size_t> after;   ///< Indices of the dependencies
+        std::thread worker;          ///< Thread running the work
+        std::string error;           ///< Message of an exception thrown by the work (stops the node)
+        bool started;                ///< Work started
+        bool ready_done;             ///< Ready step has run
+        uint64_t start_us;           ///< Work started, relative to construction
+        uint64_t work_done_us;       ///< Work finished
+        uint64_t ready_us;           ///< Ready step finished
+    };
+
+    struct Milestone {
+        const char* name;  ///< Label
+        uint64_t at_us;    ///< Relative to construction
+    };
+
+    EventLoop& loop;
+    int64_t origin_us;                         ///< Monotonic time of construction
+    int event_fd;                              ///< Signalled by finished workers (-1 once everything is ready)
+    std::vector<std::unique_ptr<Task>> tasks;  ///< In the order they were added
+    std::vector<Milestone> milestones;         ///< Points recorded with milestone()
+    size_t joined;                             ///< Tasks whose ready step has run
+    std::mutex mutex;                          ///< Guards completed
+    std::vector<Task*> completed;              ///< Work finished, ready step pending
+
+    uint64_t elapsedUs() const;
+    void onCompleted();
+    void join(Task* t);
+    void advance();
+    void report() const;
+};
+
+#endif // STARTUP_H
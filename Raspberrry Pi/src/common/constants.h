@@ -12,6 +12,11 @@ constexpr int CS_PIN  = 27;
 
 // --- SPI Equipment path ---
 constexpr const char* SPI_DEV = "/dev/spidev0.0";
+constexpr uint8_t SPI_MODE = 0;              // CPOL 0, CPHA 0: the ST7735 samples on the rising edge
+constexpr uint32_t SPI_SPEED_HZ = 32000000;  // A full 128x160 frame takes 10.2 ms on the wire
+constexpr int SPIDEV_BUFSIZ = 4096;  // Largest spidev message (default of the bufsiz module parameter)
+// --- Display font ---
+constexpr const char* DASHBOARD_FONT_PATH = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";  // BAKED_FONT_FILE in CMakeLists
 // --- I2C Equipment path ---
 constexpr const char* I2C_DEV = "/dev/i2c-1";
 
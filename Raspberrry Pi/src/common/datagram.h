@@ -0,0 +1,91 @@
+/**
+ * @file datagram.h
+ * @brief Self-describing UDP datagram carrying one sample (multicast publishing)
+ * @details Layout (56 bytes, little-endian):
+ *          | offset | size | field                                                        |
+ *          |--------|------|--------------------------------------------------------------|
+ *          | 0      | 2    | magic "WQ"                                                   |
+ *          | 2      | 1    | format version (1)                                           |
+ *          | 3      | 1    | payload type (1 = SampleRecord)                              |
+ *          | 4      | 2    | payload length in bytes                                      |
+ *          | 6      | 2    | header length in bytes (24)                                  |
+ *          | 8      | 4    | node id (tells several nodes on one group apart)             |
+ *          | 12     | 4    | session id (new random value whenever the publisher starts)  |
+ *          | 16     | 8    | datagram sequence number (+1 per datagram within a session)  |
+ *          | 24     | 32   | SampleRecord (see sample_record.h, carries its own checksum) |
+ *          The datagram sequence number has no gaps on the sending side, so a receiver can count lost datagrams.
+ *          It is separate from the sample sequence number, which also skips samples suppressed by the deadband
+ *          filter. Receivers skip unknown payload types and use the header length to find the payload, so fields
+ *          can be appended to the header in later versions.
+ */
+
+#ifndef DATAGRAM_H
+#define DATAGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sample_record.h"
+
+namespace Datagram {
+
+static const uint8_t VERSION = 1;              ///< Current format version
+static const uint8_t TYPE_SAMPLE = 1;          ///< Payload is one SampleRecord
+static const size_t HEADER_SIZE = 24;          ///< Header length written by this version
+static const size_t SIZE = HEADER_SIZE + SampleRecord::SIZE;  ///< Length of a sample datagram
+
+/**
+ * @brief Decoded datagram header
+ */
+struct Header {
+    uint32_t node_id;     ///< Publishing node
+    uint32_t session_id;  ///< Publisher run
+    uint64_t sequence;    ///< Datagram sequence number within the session
+};
+
+/**
+ * @brief Encode a sample datagram
+ * @param h Header values
+ * @param s Sample
+ * @param out Destination, at least SIZE bytes
+ */
+inline void encode(const Header& h, const Sample& s, uint8_t* out) {
+    out[0] = 'W';
+    out[1] = 'Q';
+    out[2] = VERSION;
+    out[3] = TYPE_SAMPLE;
+    out[4] = static_cast<uint8_t>(SampleRecord::SIZE);
+    out[5] = static_cast<uint8_t>(SampleRecord::SIZE >> 8);
+    out[6] = static_cast<uint8_t>(HEADER_SIZE);
+    out[7] = static_cast<uint8_t>(HEADER_SIZE >> 8);
+    SampleRecord::put32(out + 8, h.node_id);
+    SampleRecord::put32(out + 12, h.session_id);
+    SampleRecord::put64(out + 16, h.sequence);
+    SampleRecord::encode(s, out + HEADER_SIZE);
+}
+
+/**
+ * @brief Decode a sample datagram
+ * @param in Received bytes
+ * @param len Datagram length
+ * @param h Decoded header
+ * @param s Decoded sample
+ * @return bool false if the datagram is not a valid sample datagram
+ */
+inline bool decode(const uint8_t* in, size_t len, Header* h, Sample* s) {
+    if (len < 16 || in[0] != 'W' || in[1] != 'Q' || in[2] < VERSION || in[3] != TYPE_SAMPLE) {
+        return false;
+    }
+    size_t payload = in[4] | (static_cast<size_t>(in[5]) << 8);
+    size_t header = in[6] | (static_cast<size_t>(in[7]) << 8);
+    if (header < HEADER_SIZE || payload < SampleRecord::SIZE || header + payload > len) {
+        return false;
+    }
+    h->node_id = SampleRecord::get32(in + 8);
+    h->session_id = SampleRecord::get32(in + 12);
+    h->sequence = SampleRecord::get64(in + 16);
+    return SampleRecord::decode(in + header, s);
+}
+
+}  // namespace Datagram
+
+#endif // DATAGRAM_H
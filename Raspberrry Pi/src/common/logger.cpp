@@ -0,0 +1,256 @@
+// logger.cpp
+#include "logger.h"
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// Define static instances
+Logger Logger::instance;
+
+const size_t Logger::MAX_ARGS;
+const size_t Logger::TEXT_CAPACITY;
+const size_t Logger::RING_RECORDS;
+const uint32_t Logger::RATE_LIMIT_PER_SECOND;
+const int Logger::WRITE_INTERVAL_MS;
+
+static const size_t LINE_CAPACITY = 1024;         // Longest formatted line
+static const size_t BATCH_CAPACITY = 64 * 1024;   // Bytes written per write() call
+
+Logger::Logger()
+    : cells(new Cell[RING_RECORDS]), enqueue_pos(0), dequeue_pos(0), min_level(INFO), running(false),
+      dropped_records(0), suppressed_records(0), reported_drops(0) {
+    for (size_t i = 0; i < RING_RECORDS; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+Logger::~Logger() {
+    stop();
+    delete[] cells;
+}
+
+Logger::Level Logger::parseLevel(const std::string& name) {
+    if (name == "debug") {
+        return DEBUG;
+    }
+    if (name == "warn" || name == "warning") {
+        return WARN;
+    }
+    if (name == "error") {
+        return ERROR;
+    }
+    return INFO;
+}
+
+uint64_t Logger::realtimeMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+// At most RATE_LIMIT_PER_SECOND records per site and second; the others are only counted
+bool Logger::admit(Site& site, uint64_t now_us, uint32_t* suppressed_before) {
+    uint64_t second = now_us / 1000000ULL;
+    if (site.second.load(std::memory_order_relaxed) != second) {
+        site.second.store(second, std::memory_order_relaxed);
+        site.count.store(0, std::memory_order_relaxed);
+    }
+    if (site.count.fetch_add(1, std::memory_order_relaxed) >= RATE_LIMIT_PER_SECOND) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        suppressed_records.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    *suppressed_before = site.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+// Claim the cell at the enqueue position; nullptr when the writer has not freed it yet (ring full)
+Logger::Record* Logger::reserve(uint64_t* pos) {
+    uint64_t p = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[p & (RING_RECORDS - 1)];
+        int64_t diff = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(p);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+                *pos = p;
+                return &cell.record;
+            }
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            p = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::commit(uint64_t pos) {
+    cells[pos & (RING_RECORDS - 1)].sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::putString(Record& r, const char* s, size_t len) {
+    size_t room = TEXT_CAPACITY - r.text_len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(r.text + r.text_len, s, len);
+    r.types[r.nargs] = STRING;
+    r.args[r.nargs++].u = (static_cast<uint64_t>(r.text_len) << 16) | len;
+    r.text_len = static_cast<uint16_t>(r.text_len + len);
+}
+
+void Logger::put(Record& r, const char* s) {
+    if (s == nullptr) {
+        s = "(null)";
+    }
+    putString(r, s, strlen(s));
+}
+
+// "YYYY-MM-DD HH:MM:SS.uuuuuu LEVEL message\n"
+size_t Logger::format(const Record& r, char* out, size_t cap) {
+    static const char* names[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+    time_t seconds = static_cast<time_t>(r.time_us / 1000000ULL);
+    tm local;
+    localtime_r(&seconds, &local);
+    size_t n = strftime(out, cap, "%Y-%m-%d %H:%M:%S", &local);
+    n += snprintf(out + n, cap - n, ".%06u %s ", static_cast<unsigned>(r.time_us % 1000000ULL), names[r.level & 3]);
+
+    // Keep one byte for the newline
+    size_t limit = cap - 1;
+    size_t arg = 0;
+    for (const char* f = r.format; *f != '\0' && n < limit; ++f) {
+        if (f[0] != '{' || f[1] != '}' || arg >= r.nargs) {
+            out[n++] = *f;
+            continue;
+        }
+        ++f;
+        const Arg& a = r.args[arg];
+        size_t room = limit - n;
+        int written = 0;
+        switch (r.types[arg]) {
+        case INT:
+            written = snprintf(out + n, room + 1, "%" PRId64, a.i);
+            break;
+        case UINT:
+            written = snprintf(out + n, room + 1, "%" PRIu64, a.u);
+            break;
+        case DOUBLE:
+            written = snprintf(out + n, room + 1, "%g", a.d);
+            break;
+        case CHAR:
+            out[n] = static_cast<char>(a.i);
+            written = 1;
+            break;
+        case STRING: {
+            size_t len = static_cast<size_t>(a.u & 0xFFFF);
+            if (len > room) {
+                len = room;
+            }
+            memcpy(out + n, r.text + (a.u >> 16), len);
+            written = static_cast<int>(len);
+            break;
+        }
+        }
+        n += written > 0 ? (static_cast<size_t>(written) < room ? static_cast<size_t>(written) : room) : 0;
+        ++arg;
+    }
+    if (r.suppressed > 0 && n < limit) {
+        int written = snprintf(out + n, limit - n + 1, " (%u similar messages suppressed)", r.suppressed);
+        n += written > 0 ? (static_cast<size_t>(written) < limit - n ? static_cast<size_t>(written) : limit - n) : 0;
+    }
+    out[n++] = '\n';
+    return n;
+}
+
+static void writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  // Nowhere left to report it
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+static int destination(uint8_t level) {
+    return level >= Logger::WARN ? STDERR_FILENO : STDOUT_FILENO;
+}
+
+void Logger::writeNow(const Record& r) {
+    char line[LINE_CAPACITY];
+    size_t n = format(r, line, sizeof(line));
+    writeAll(destination(r.level), line, n);
+}
+
+// Format every committed record into batches, one write() per batch and destination
+size_t Logger::drain() {
+    static char batch[BATCH_CAPACITY];
+    size_t used = 0;
+    int fd = STDOUT_FILENO;
+    size_t records = 0;
+
+    for (;;) {
+        Cell& cell = cells[dequeue_pos & (RING_RECORDS - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;  // Empty, or the next record is still being written
+        }
+        int target = destination(cell.record.level);
+        if (used > 0 && (target != fd || used + LINE_CAPACITY > BATCH_CAPACITY)) {
+            writeAll(fd, batch, used);
+            used = 0;
+        }
+        fd = target;
+        used += format(cell.record, batch + used, LINE_CAPACITY);
+        cell.sequence.store(dequeue_pos + RING_RECORDS, std::memory_order_release);
+        ++dequeue_pos;
+        ++records;
+    }
+
+    uint64_t drops = dropped_records.load(std::memory_order_relaxed);
+    if (drops != reported_drops) {
+        if (used > 0) {
+            writeAll(fd, batch, used);
+            used = 0;
+        }
+        char line[96];
+        int n = snprintf(line, sizeof(line), "Logger: %" PRIu64 " records dropped (ring full)\n", drops - reported_drops);
+        writeAll(STDERR_FILENO, line, static_cast<size_t>(n));
+        reported_drops = drops;
+    }
+    if (used > 0) {
+        writeAll(fd, batch, used);
+    }
+    return records;
+}
+
+void Logger::writerMain() {
+    pthread_setname_np(pthread_self(), "logger");
+    while (running.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+            timespec interval = {0, WRITE_INTERVAL_MS * 1000000L};
+            nanosleep(&interval, nullptr);
+        }
+    }
+}
+
+void Logger::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    writer = std::thread(&Logger::writerMain, this);
+}
+
+void Logger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    writer.join();
+    drain();  // Records queued while the writer was finishing
+}
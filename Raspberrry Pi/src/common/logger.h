@@ -0,0 +1,213 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * @file logger.h
+ * @brief Asynchronous logger: the event loop only copies a binary record, a background thread formats and writes
+ * @details LOG_INFO("pH value -> pH: {}", ph) reserves a slot in a lock-free ring and copies the format pointer and
+ *          the arguments into it (strings are copied, truncated to the space left in the record). No formatting,
+ *          allocation or system call happens in the caller. A writer thread wakes every WRITE_INTERVAL_MS, formats
+ *          the queued records as "time LEVEL message" lines and writes them in batches: DEBUG/INFO to stdout,
+ *          WARN/ERROR to stderr. A slow console or journald therefore never stalls the caller.
+ *
+ *          When the ring is full the record is dropped and counted; each call site may log at most
+ *          RATE_LIMIT_PER_SECOND records per second, the rest is counted and reported with the next record of that
+ *          site. Before start() and after stop(), records are formatted and written synchronously.
+ *
+ *          The format string must be a literal: only its address is stored. Each "{}" is replaced by the next
+ *          argument; integers, floating point (printed like std::cout), characters, C strings and std::string are
+ *          supported, up to MAX_ARGS arguments.
+ */
+class Logger {
+public:
+    enum Level : uint8_t { DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3 };
+
+    static const size_t MAX_ARGS = 8;                 ///< Arguments per record
+    static const size_t TEXT_CAPACITY = 152;          ///< Bytes for the copied string arguments of one record
+    static const size_t RING_RECORDS = 1024;          ///< Records queued before new ones are dropped (power of two)
+    static const uint32_t RATE_LIMIT_PER_SECOND = 20; ///< Records per call site and second
+    static const int WRITE_INTERVAL_MS = 20;          ///< Writer thread polling interval
+
+    /// Rate limiting state of one LOG_* call site (zero-initialised static, no guard needed)
+    struct Site {
+        std::atomic<uint64_t> second;       ///< Second of the current window
+        std::atomic<uint32_t> count;        ///< Records logged in that second
+        std::atomic<uint32_t> suppressed;   ///< Records suppressed since the last logged one
+    };
+
+    /**
+     * @brief Obtain a singleton instance
+     */
+    static Logger& getInstance() {
+        return instance;
+    }
+
+    /**
+     * @brief Parse a level name ("debug", "info", "warn" or "error")
+     * @return Level INFO if the name is not recognised
+     */
+    static Level parseLevel(const std::string& name);
+
+    /**
+     * @brief Set the lowest level that is logged
+     */
+    void setLevel(Level l) { min_level.store(l, std::memory_order_relaxed); }
+
+    /**
+     * @brief Whether records of a level are logged
+     */
+    bool enabled(Level l) const { return l >= min_level.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Start the writer thread; records are queued from now on
+     */
+    void start();
+
+    /**
+     * @brief Write the queued records and stop the writer thread; later records are written synchronously
+     */
+    void stop();
+
+    /**
+     * @brief Records dropped because the ring was full
+     */
+    uint64_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records suppressed by the per-site rate limit
+     */
+    uint64_t suppressed() const { return suppressed_records.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Log one record (use the LOG_* macros)
+     */
+    template <typename... Args>
+    void log(Level level, Site& site, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+        uint64_t now_us = realtimeMicros();
+        uint32_t suppressed_before = 0;
+        if (!admit(site, now_us, &suppressed_before)) {
+            return;
+        }
+        Record local;
+        Record* r = &local;  // Not started: formatted right away
+        uint64_t pos = 0;
+        if (running.load(std::memory_order_acquire)) {
+            r = reserve(&pos);
+            if (r == nullptr) {
+                dropped_records.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        r->time_us = now_us;
+        r->format = format;
+        r->level = level;
+        r->nargs = 0;
+        r->text_len = 0;
+        r->suppressed = suppressed_before;
+        pack(*r, args...);
+        if (r == &local) {
+            writeNow(local);
+        } else {
+            commit(pos);
+        }
+    }
+
+private:
+    enum ArgType : uint8_t { INT, UINT, DOUBLE, CHAR, STRING };
+
+    union Arg {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+
+    /// One binary log record (256 bytes with its ring sequence number)
+    struct Record {
+        uint64_t time_us;              ///< Wall-clock time of the call
+        const char* format;            ///< Format literal
+        uint8_t level;                 ///< Level
+        uint8_t nargs;                 ///< Arguments stored
+        uint16_t text_len;             ///< Bytes of text used by the string arguments
+        uint32_t suppressed;           ///< Records of the same site suppressed before this one
+        uint8_t types[MAX_ARGS];       ///< ArgType of each argument
+        Arg args[MAX_ARGS];            ///< Values; strings hold offset << 16 | length into text
+        char text[TEXT_CAPACITY];      ///< Copied string arguments
+    };
+
+    struct Cell {
+        std::atomic<uint64_t> sequence;  ///< Ring position this cell is ready for (Vyukov bounded queue)
+        Record record;
+    };
+
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger instance;
+
+    static uint64_t realtimeMicros();
+
+    bool admit(Site& site, uint64_t now_us, uint32_t* suppressed_before);
+    Record* reserve(uint64_t* pos);
+    void commit(uint64_t pos);
+    void writeNow(const Record& r);
+    void writerMain();
+    size_t drain();
+    static size_t format(const Record& r, char* out, size_t cap);
+
+    static void pack(Record&) {}
+    template <typename T, typename... Rest>
+    static void pack(Record& r, const T& first, const Rest&... rest) {
+        put(r, first);
+        pack(r, rest...);
+    }
+
+    static void putInt(Record& r, int64_t v) { r.types[r.nargs] = INT; r.args[r.nargs++].i = v; }
+    static void putUint(Record& r, uint64_t v) { r.types[r.nargs] = UINT; r.args[r.nargs++].u = v; }
+    static void putString(Record& r, const char* s, size_t len);
+
+    static void put(Record& r, int v) { putInt(r, v); }
+    static void put(Record& r, long v) { putInt(r, v); }
+    static void put(Record& r, long long v) { putInt(r, v); }
+    static void put(Record& r, unsigned v) { putUint(r, v); }
+    static void put(Record& r, unsigned long v) { putUint(r, v); }
+    static void put(Record& r, unsigned long long v) { putUint(r, v); }
+    static void put(Record& r, double v) { r.types[r.nargs] = DOUBLE; r.args[r.nargs++].d = v; }
+    static void put(Record& r, float v) { put(r, static_cast<double>(v)); }
+    static void put(Record& r, char v) { r.types[r.nargs] = CHAR; r.args[r.nargs++].i = v; }
+    static void put(Record& r, const char* s);
+    static void put(Record& r, const std::string& s) { putString(r, s.data(), s.size()); }
+
+    Cell* cells;                               ///< Ring of RING_RECORDS cells
+    std::atomic<uint64_t> enqueue_pos;         ///< Next position to reserve (producers)
+    uint64_t dequeue_pos;                      ///< Next position to write (writer thread)
+    std::atomic<uint8_t> min_level;            ///< Lowest level logged
+    std::atomic<bool> running;                 ///< Writer thread active
+    std::thread writer;                        ///< Formats and writes the queued records
+    std::atomic<uint64_t> dropped_records;     ///< Records lost to a full ring
+    std::atomic<uint64_t> suppressed_records;  ///< Records lost to the rate limit
+    uint64_t reported_drops;                   ///< Dropped count last reported (writer thread)
+};
+
+#define LOG_AT(level, ...)                                                  \
+    do {                                                                    \
+        if (Logger::getInstance().enabled(level)) {                         \
+            static Logger::Site log_site_;                                  \
+            Logger::getInstance().log(level, log_site_, __VA_ARGS__);       \
+        }                                                                   \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(Logger::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(Logger::INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(Logger::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Logger::ERROR, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -0,0 +1,5 @@
+// metrics.cpp
+#include "metrics.h"
+
+// Define static instances
+Metrics Metrics::instance;
@@ -0,0 +1,52 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Single instance class of the node's health counters (Hungry Man implementation)
+ *
+ * The drivers and the acquisition code increment these counters where an operation succeeds or fails; the /metrics
+ * endpoint reads them. The counters are atomic so that modules running outside the event loop thread can update
+ * them too; relaxed ordering is enough because each counter is independent.
+ */
+class Metrics {
+private:
+    Metrics() : samples_collected(0), i2c_errors(0), w1_errors(0), spi_errors(0) {}
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    static Metrics instance;
+
+public:
+    /**
+     * @brief Obtain a singleton instance
+     * @return Metrics& Reference to a singleton instance
+     */
+    static Metrics& getInstance() {
+        return instance;
+    }
+
+    /**
+     * @brief Add one to a counter
+     * @param counter One of the counters below
+     */
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Read a counter
+     */
+    static uint64_t read(const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> samples_collected;  ///< Acquisition cycles completed since start
+    std::atomic<uint64_t> i2c_errors;         ///< Failed I2C transfers (PCF8591 ADC)
+    std::atomic<uint64_t> w1_errors;          ///< Failed 1-Wire reads (DS18B20)
+    std::atomic<uint64_t> spi_errors;         ///< Failed or short SPI writes (TFT display)
+};
+
+#endif // METRICS_H
@@ -0,0 +1,138 @@
+/**
+ * @file query_protocol.h
+ * @brief Binary request/response format of the local history query socket
+ * @details Local tools connect to the node's Unix domain socket (query_socket option) and send fixed-size requests:
+ *          | offset | size | field                                         |
+ *          |--------|------|-----------------------------------------------|
+ *          | 0      | 1    | 'Q'                                           |
+ *          | 1      | 1    | protocol version (1)                          |
+ *          | 2      | 1    | operation (LATEST, RANGE, AGGREGATE)          |
+ *          | 3      | 1    | flags (COMPRESSED)                            |
+ *          | 4      | 4    | request id, echoed in the response            |
+ *          | 8      | 8    | range start, CLOCK_REALTIME microseconds      |
+ *          | 16     | 8    | range end (inclusive)                         |
+ *          The node answers every request with one or more chunks, the last one flagged FINAL:
+ *          | 0      | 1    | 'R'                                           |
+ *          | 1      | 1    | operation of the request                      |
+ *          | 2      | 1    | status                                        |
+ *          | 3      | 1    | flags (FINAL, COMPRESSED)                     |
+ *          | 4      | 4    | request id                                    |
+ *          | 8      | 4    | payload length                                |
+ *          | 12     | n    | payload                                       |
+ *          LATEST returns one SampleRecord. RANGE returns SampleRecord entries, or with COMPRESSED SampleCodec frames
+ *          where every chunk starts with a keyframe, so chunks decode independently. AGGREGATE returns the payload
+ *          described at Aggregate. Requests on one connection are answered in order. All integers are little-endian.
+ */
+
+#ifndef QUERY_PROTOCOL_H
+#define QUERY_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sample_record.h"
+
+namespace QueryProtocol {
+
+static const uint8_t REQUEST_MAGIC = 'Q';
+static const uint8_t RESPONSE_MAGIC = 'R';
+static const uint8_t VERSION = 1;
+static const size_t REQUEST_SIZE = 24;      ///< Size of a request
+static const size_t RESPONSE_HEADER = 12;   ///< Size of a response chunk header
+
+/**
+ * @brief Operations
+ */
+enum Op : uint8_t {
+    LATEST = 1,     ///< Newest sample
+    RANGE = 2,      ///< Every stored sample in [from_us, to_us]
+    AGGREGATE = 3   ///< Count, first/last time and min/max/mean per value over [from_us, to_us]
+};
+
+/**
+ * @brief Response status
+ */
+enum Status : uint8_t {
+    OK = 0,
+    BAD_REQUEST = 1,  ///< Unknown operation, version or malformed request; the connection is closed
+    NOT_FOUND = 2,    ///< No sample (LATEST before the first sample, AGGREGATE over an empty range)
+    NO_HISTORY = 3    ///< The node keeps no history
+};
+
+static const uint8_t FLAG_COMPRESSED = 0x01;  ///< Request/response: SampleCodec frames instead of records
+static const uint8_t FLAG_FINAL = 0x02;       ///< Response: last chunk of the answer
+
+/**
+ * @brief Decoded request
+ */
+struct Request {
+    uint8_t op;
+    uint8_t flags;
+    uint32_t id;
+    int64_t from_us;
+    int64_t to_us;
+};
+
+/**
+ * @brief AGGREGATE payload (60 bytes): count (8), first and last timestamp (8 + 8), then min, max and mean
+ *        as floats for turbidity, temperature and pH (3 x 12)
+ */
+struct Aggregate {
+    uint64_t count;
+    int64_t first_us;
+    int64_t last_us;
+    float min[3];
+    float max[3];
+    float mean[3];
+};
+
+static const size_t AGGREGATE_SIZE = 60;  ///< Encoded size of an Aggregate
+
+inline void encodeRequest(const Request& r, uint8_t* out) {
+    out[0] = REQUEST_MAGIC;
+    out[1] = VERSION;
+    out[2] = r.op;
+    out[3] = r.flags;
+    SampleRecord::put32(out + 4, r.id);
+    SampleRecord::put64(out + 8, static_cast<uint64_t>(r.from_us));
+    SampleRecord::put64(out + 16, static_cast<uint64_t>(r.to_us));
+}
+
+/**
+ * @brief Decode a request
+ * @return bool false if the magic or version does not match
+ */
+inline bool decodeRequest(const uint8_t* in, Request* r) {
+    if (in[0] != REQUEST_MAGIC || in[1] != VERSION) {
+        return false;
+    }
+    r->op = in[2];
+    r->flags = in[3];
+    r->id = SampleRecord::get32(in + 4);
+    r->from_us = static_cast<int64_t>(SampleRecord::get64(in + 8));
+    r->to_us = static_cast<int64_t>(SampleRecord::get64(in + 16));
+    return true;
+}
+
+inline void encodeHeader(uint8_t op, uint8_t status, uint8_t flags, uint32_t id, uint32_t payload_len, uint8_t* out) {
+    out[0] = RESPONSE_MAGIC;
+    out[1] = op;
+    out[2] = status;
+    out[3] = flags;
+    SampleRecord::put32(out + 4, id);
+    SampleRecord::put32(out + 8, payload_len);
+}
+
+inline void encodeAggregate(const Aggregate& a, uint8_t* out) {
+    SampleRecord::put64(out, a.count);
+    SampleRecord::put64(out + 8, static_cast<uint64_t>(a.first_us));
+    SampleRecord::put64(out + 16, static_cast<uint64_t>(a.last_us));
+    for (int i = 0; i < 3; ++i) {
+        SampleRecord::put32(out + 24 + 12 * i, SampleRecord::floatBits(a.min[i]));
+        SampleRecord::put32(out + 28 + 12 * i, SampleRecord::floatBits(a.max[i]));
+        SampleRecord::put32(out + 32 + 12 * i, SampleRecord::floatBits(a.mean[i]));
+    }
+}
+
+} // namespace QueryProtocol
+
+#endif // QUERY_PROTOCOL_H
@@ -0,0 +1,46 @@
+/**
+ * @file sample.h
+ * @brief A single time-stamped water quality sample
+ * @details The WaterQuality singleton only holds the latest values. Modules that need to keep, store or
+ *          transmit a reading as one unit (history log, network sinks) work with this plain value type instead.
+ */
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @struct Sample
+ * @brief Snapshot of one acquisition cycle
+ */
+struct Sample {
+    uint64_t seq;          ///< Monotonic sequence number, continues across restarts (used for de-duplication)
+    int64_t timestamp_us;  ///< Acquisition time, CLOCK_REALTIME in microseconds
+    float turbidity;       ///< Turbidity value (0-100%)
+    float temperature;     ///< Temperature value from the DS18B20, in degrees Celsius
+    float pH;              ///< pH value (0-14)
+};
+
+/**
+ * @brief Current wall-clock time in microseconds
+ * @return int64_t CLOCK_REALTIME expressed in microseconds since the epoch
+ */
+inline int64_t realtimeMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Current monotonic time in microseconds (for intervals and timeouts, unaffected by clock changes)
+ * @return int64_t CLOCK_MONOTONIC expressed in microseconds
+ */
+inline int64_t monotonicMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif // SAMPLE_H
@@ -0,0 +1,333 @@
+// sample_codec.cpp
+#include "sample_codec.h"
+#include <cstring>
+
+namespace {
+
+uint32_t floatBits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float bitsFloat(uint32_t u) {
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = static_cast<uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(v);
+    return p;
+}
+
+// Returns false if the varint runs past the end or is longer than 10 bytes
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t* v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 70 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        result |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+int leadingZeros(uint32_t x) {
+    return __builtin_clz(x);
+}
+
+int trailingZeros(uint32_t x) {
+    return __builtin_ctz(x);
+}
+
+// MSB-first bit packer over a caller-provided buffer
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* p) : out(p), acc(0), used(0) {}
+
+    void put(uint32_t value, int nbits) {
+        for (int i = nbits - 1; i >= 0; --i) {
+            acc = static_cast<uint8_t>((acc << 1) | ((value >> i) & 1));
+            if (++used == 8) {
+                *out++ = acc;
+                acc = 0;
+                used = 0;
+            }
+        }
+    }
+
+    // Pad the last byte with zero bits and return the end of the written data
+    uint8_t* finish() {
+        if (used > 0) {
+            *out++ = static_cast<uint8_t>(acc << (8 - used));
+            acc = 0;
+            used = 0;
+        }
+        return out;
+    }
+
+private:
+    uint8_t* out;
+    uint8_t acc;
+    int used;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* p, const uint8_t* e) : in(p), end(e), bit(0), ok(true) {}
+
+    uint32_t get(int nbits) {
+        uint32_t v = 0;
+        for (int i = 0; i < nbits; ++i) {
+            if (in >= end) {
+                ok = false;
+                return 0;
+            }
+            v = (v << 1) | ((*in >> (7 - bit)) & 1);
+            if (++bit == 8) {
+                bit = 0;
+                ++in;
+            }
+        }
+        return v;
+    }
+
+    bool good() const { return ok; }
+
+private:
+    const uint8_t* in;
+    const uint8_t* end;
+    int bit;
+    bool ok;
+};
+
+uint8_t frameCheck(const uint8_t* p, size_t n) {
+    uint8_t x = 0;
+    for (size_t i = 0; i < n; ++i) {
+        x ^= p[i];
+    }
+    return x;
+}
+
+}  // namespace
+
+SampleEncoder::SampleEncoder(uint32_t keyframe_interval)
+    : interval(keyframe_interval > 0 ? keyframe_interval : 1) {
+    reset();
+}
+
+void SampleEncoder::reset() {
+    since_key = 0;
+    have_prev = false;
+    prev_seq = 0;
+    prev_ts = 0;
+    prev_delta = 0;
+    for (int i = 0; i < 3; ++i) {
+        prev_bits[i] = 0;
+        leading[i] = -1;
+        trailing[i] = -1;
+    }
+}
+
+size_t SampleEncoder::encode(const Sample& s, uint8_t* out) {
+    uint32_t bits[3] = {floatBits(s.turbidity), floatBits(s.temperature), floatBits(s.pH)};
+    uint8_t* p = out + 2;
+    // A sequence number that does not move forward means the producer restarted: start over with a keyframe
+    bool key = !have_prev || since_key >= interval || s.seq <= prev_seq;
+
+    if (key) {
+        out[0] = SampleCodec::KEYFRAME;
+        p = putVarint(p, s.seq);
+        p = putVarint(p, zigzag(s.timestamp_us));
+        for (int i = 0; i < 3; ++i) {
+            for (int b = 0; b < 4; ++b) {
+                *p++ = static_cast<uint8_t>(bits[i] >> (8 * b));
+            }
+            leading[i] = -1;
+            trailing[i] = -1;
+        }
+        prev_delta = 0;
+        since_key = 1;
+    } else {
+        out[0] = SampleCodec::DELTA;
+        int64_t delta = s.timestamp_us - prev_ts;
+        p = putVarint(p, s.seq - prev_seq - 1);
+        p = putVarint(p, zigzag(delta - prev_delta));
+
+        BitWriter w(p);
+        for (int i = 0; i < 3; ++i) {
+            uint32_t x = bits[i] ^ prev_bits[i];
+            if (x == 0) {
+                w.put(0, 1);
+                continue;
+            }
+            int lead = leadingZeros(x);
+            int trail = trailingZeros(x);
+            if (leading[i] >= 0 && lead >= leading[i] && trail >= trailing[i]) {
+                // Reuse the previous window
+                w.put(2, 2);
+                w.put(x >> trailing[i], 32 - leading[i] - trailing[i]);
+            } else {
+                int len = 32 - lead - trail;
+                w.put(3, 2);
+                w.put(static_cast<uint32_t>(lead), 5);
+                w.put(static_cast<uint32_t>(len - 1), 5);
+                w.put(x >> trail, len);
+                leading[i] = lead;
+                trailing[i] = trail;
+            }
+        }
+        p = w.finish();
+        prev_delta = delta;
+        since_key++;
+    }
+
+    have_prev = true;
+    prev_seq = s.seq;
+    prev_ts = s.timestamp_us;
+    for (int i = 0; i < 3; ++i) {
+        prev_bits[i] = bits[i];
+    }
+
+    size_t payload = static_cast<size_t>(p - out - 2);
+    out[1] = static_cast<uint8_t>(payload);
+    *p = frameCheck(out, payload + 2);
+    return payload + 3;
+}
+
+SampleDecoder::SampleDecoder() {
+    reset();
+}
+
+void SampleDecoder::reset() {
+    synced = false;
+    prev_seq = 0;
+    prev_ts = 0;
+    prev_delta = 0;
+    for (int i = 0; i < 3; ++i) {
+        prev_bits[i] = 0;
+        leading[i] = -1;
+        trailing[i] = -1;
+    }
+}
+
+SampleDecoder::Status SampleDecoder::decode(const uint8_t* in, size_t len, Sample* out, size_t* consumed) {
+    if (len < 2) {
+        return NEED_MORE;
+    }
+    uint8_t tag = in[0];
+    size_t payload = in[1];
+    // Any invalid frame also drops the reference sample: a delta after it would be applied to the wrong base
+    if ((tag != SampleCodec::KEYFRAME && tag != SampleCodec::DELTA) || payload + 3 > SampleCodec::MAX_FRAME) {
+        reset();
+        return CORRUPT;
+    }
+    if (len < payload + 3) {
+        return NEED_MORE;
+    }
+    if (frameCheck(in, payload + 2) != in[payload + 2]) {
+        reset();
+        return CORRUPT;
+    }
+
+    const uint8_t* p = in + 2;
+    const uint8_t* end = p + payload;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (!getVarint(p, end, &a) || !getVarint(p, end, &b)) {
+        reset();
+        return CORRUPT;
+    }
+
+    uint32_t bits[3];
+    int64_t ts;
+    uint64_t seq;
+    if (tag == SampleCodec::KEYFRAME) {
+        if (end - p != 12) {
+            reset();
+            return CORRUPT;
+        }
+        seq = a;
+        ts = unzigzag(b);
+        for (int i = 0; i < 3; ++i) {
+            bits[i] = 0;
+            for (int k = 3; k >= 0; --k) {
+                bits[i] = (bits[i] << 8) | p[4 * i + k];
+            }
+            leading[i] = -1;
+            trailing[i] = -1;
+        }
+        prev_delta = 0;
+        synced = true;
+    } else {
+        if (!synced) {
+            *consumed = payload + 3;
+            return SKIPPED;
+        }
+        seq = prev_seq + a + 1;
+        int64_t delta = prev_delta + unzigzag(b);
+        ts = prev_ts + delta;
+
+        BitReader r(p, end);
+        for (int i = 0; i < 3; ++i) {
+            if (r.get(1) == 0) {
+                bits[i] = prev_bits[i];
+                continue;
+            }
+            uint32_t x;
+            if (r.get(1) == 0) {
+                if (leading[i] < 0) {
+                    reset();
+                    return CORRUPT;
+                }
+                x = r.get(32 - leading[i] - trailing[i]) << trailing[i];
+            } else {
+                int lead = static_cast<int>(r.get(5));
+                int n = static_cast<int>(r.get(5)) + 1;
+                int trail = 32 - lead - n;
+                if (trail < 0) {
+                    reset();
+                    return CORRUPT;
+                }
+                x = r.get(n) << trail;
+                leading[i] = lead;
+                trailing[i] = trail;
+            }
+            bits[i] = prev_bits[i] ^ x;
+        }
+        if (!r.good()) {
+            reset();
+            return CORRUPT;
+        }
+        prev_delta = delta;
+    }
+
+    prev_seq = seq;
+    prev_ts = ts;
+    for (int i = 0; i < 3; ++i) {
+        prev_bits[i] = bits[i];
+    }
+
+    out->seq = seq;
+    out->timestamp_us = ts;
+    out->turbidity = bitsFloat(bits[0]);
+    out->temperature = bitsFloat(bits[1]);
+    out->pH = bitsFloat(bits[2]);
+    *consumed = payload + 3;
+    return SAMPLE;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file sample_record.h
+ * @brief Fixed-size binary record used by the on-device history log and the backfill transfer
+ * @details Layout (32 bytes, little-endian):
+ *          | offset | size | field                                   |
+ *          |--------|------|-----------------------------------------|
+ *          | 0      | 8    | sequence number                         |
+ *          | 8      | 8    | acquisition time, microseconds (signed) |
+ *          | 16     | 4    | turbidity (IEEE-754 float)              |
+ *          | 20     | 4    | temperature (IEEE-754 float)            |
+ *          | 24     | 4    | pH (IEEE-754 float)                     |
+ *          | 28     | 4    | FNV-1a checksum of bytes 0-27           |
+ *          This header has no dependencies besides sample.h so that QtServer can decode backfilled records too.
+ */
+
+#ifndef SAMPLE_RECORD_H
+#define SAMPLE_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "sample.h"
+
+namespace SampleRecord {
+
+static const size_t SIZE = 32;  ///< Size of one encoded record in bytes
+
+inline void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline void put64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline uint32_t get32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+inline uint64_t get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+inline uint32_t floatBits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float bitsFloat(uint32_t u) {
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief FNV-1a hash, used to detect torn or corrupted records
+ */
+inline uint32_t checksum(const uint8_t* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief Encode a sample into a record
+ * @param s Sample to encode
+ * @param out Destination, at least SIZE bytes
+ */
+inline void encode(const Sample& s, uint8_t* out) {
+    put64(out, s.seq);
+    put64(out + 8, static_cast<uint64_t>(s.timestamp_us));
+    put32(out + 16, floatBits(s.turbidity));
+    put32(out + 20, floatBits(s.temperature));
+    put32(out + 24, floatBits(s.pH));
+    put32(out + 28, checksum(out, 28));
+}
+
+/**
+ * @brief Decode a record
+ * @param in Source, at least SIZE bytes
+ * @param s Decoded sample
+ * @return bool false if the checksum does not match
+ */
+inline bool decode(const uint8_t* in, Sample* s) {
+    if (get32(in + 28) != checksum(in, 28)) {
+        return false;
+    }
+    s->seq = get64(in);
+    s->timestamp_us = static_cast<int64_t>(get64(in + 8));
+    s->turbidity = bitsFloat(get32(in + 16));
+    s->temperature = bitsFloat(get32(in + 20));
+    s->pH = bitsFloat(get32(in + 24));
+    return true;
+}
+
+}  // namespace SampleRecord
+
+#endif // SAMPLE_RECORD_H
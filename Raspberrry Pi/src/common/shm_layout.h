@@ -0,0 +1,142 @@
+/**
+ * @file shm_layout.h
+ * @brief Layout of the shared-memory region with the latest sample and a ring of recent samples
+ * @details The node creates the region with shm_open() and local processes map it read-only (see ShmReader).
+ *          Layout, version 1 (native byte order, all offsets in bytes):
+ *          | offset | size             | field                                              |
+ *          |--------|------------------|----------------------------------------------------|
+ *          | 0      | 4                | magic "WQSM" (0x4D535157), set last on creation    |
+ *          | 4      | 2                | layout version (1)                                 |
+ *          | 6      | 2                | header size (128)                                  |
+ *          | 8      | 4                | slot size (48)                                     |
+ *          | 12     | 4                | ring capacity in slots                             |
+ *          | 16     | 4                | process id of the writer                           |
+ *          | 20     | 4                | closed flag, set when the writer exits             |
+ *          | 24     | 8                | creation time, CLOCK_REALTIME microseconds         |
+ *          | 32     | 8                | samples published since creation                   |
+ *          | 40     | 48               | latest sample slot                                 |
+ *          | 88     | 40               | reserved (zero)                                    |
+ *          | 128    | capacity * 48    | ring; sample n is in slot n % capacity             |
+ *          A slot holds a seqlock counter (4), padding (4), the ring position of its sample (8) and the Sample (32:
+ *          seq, timestamp_us, turbidity, temperature, pH, 4 bytes padding). The counter is odd while the writer
+ *          updates the slot; a reader copies the slot and retries if the counter was odd or changed meanwhile.
+ *          Readers never write to the region, so any number of them can attach without slowing the writer.
+ *          Fields are only ever appended (in the reserved bytes or after the ring); incompatible changes bump the version.
+ */
+
+#ifndef SHM_LAYOUT_H
+#define SHM_LAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+
+// The counters are shared between processes, which requires them to be lock-free (and hence address-free)
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared-memory counters must be lock-free");
+static_assert(sizeof(Sample) == 32 && offsetof(Sample, timestamp_us) == 8 && offsetof(Sample, turbidity) == 16 &&
+              offsetof(Sample, temperature) == 20 && offsetof(Sample, pH) == 24, "unexpected Sample layout");
+
+namespace Shm {
+
+static const uint32_t MAGIC = 0x4D535157;     ///< "WQSM" in memory on a little-endian machine
+static const uint16_t VERSION = 1;            ///< Layout version
+static const char* const DEFAULT_NAME = "/water_quality";  ///< Default shm_open() name
+
+/**
+ * @struct Slot
+ * @brief One seqlock-protected sample
+ */
+struct Slot {
+    std::atomic<uint32_t> lock;  ///< Seqlock counter, odd while being written
+    uint32_t reserved;           ///< Zero
+    uint64_t position;           ///< Ring position of the sample (number of samples published before it)
+    Sample sample;               ///< The sample
+};
+
+/**
+ * @struct Header
+ * @brief Start of the region
+ */
+struct Header {
+    std::atomic<uint32_t> magic;      ///< MAGIC once the region is initialised
+    uint16_t version;                 ///< VERSION
+    uint16_t header_size;             ///< sizeof(Header), offset of the ring
+    uint32_t slot_size;               ///< sizeof(Slot)
+    uint32_t capacity;                ///< Ring slots
+    uint32_t writer_pid;              ///< Process id of the node
+    std::atomic<uint32_t> closed;     ///< 1 once the node has exited (the region is then no longer updated)
+    int64_t created_us;               ///< Creation time, CLOCK_REALTIME microseconds
+    std::atomic<uint64_t> published;  ///< Samples published since creation
+    Slot latest;                      ///< Newest sample
+    uint8_t reserved[40];             ///< Zero, room for later fields
+};
+
+static_assert(sizeof(Slot) == 48 && offsetof(Slot, position) == 8 && offsetof(Slot, sample) == 16, "unexpected Slot layout");
+static_assert(sizeof(Header) == 128 && offsetof(Header, published) == 32 && offsetof(Header, latest) == 40,
+              "unexpected Header layout");
+
+/**
+ * @brief Size of a region with the given ring capacity
+ */
+inline size_t regionSize(uint32_t capacity) {
+    return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Slot);
+}
+
+/**
+ * @brief First ring slot of a mapped region
+ */
+inline Slot* ring(Header* h) {
+    return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(h) + h->header_size);
+}
+
+inline const Slot* ring(const Header* h) {
+    return reinterpret_cast<const Slot*>(reinterpret_cast<const uint8_t*>(h) + h->header_size);
+}
+
+/**
+ * @brief Update a slot (single writer)
+ * @param slot Slot to update
+ * @param position Ring position of the sample
+ * @param s Sample to store
+ */
+inline void write(Slot& slot, uint64_t position, const Sample& s) {
+    uint32_t lock = slot.lock.load(std::memory_order_relaxed);
+    slot.lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.position = position;
+    slot.sample = s;
+    slot.lock.store(lock + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Copy a slot consistently
+ * @param slot Slot to read
+ * @param out Copy of the sample
+ * @param position Ring position of the sample (may be null)
+ * @param attempts Tries before giving up while the writer keeps updating the slot
+ * @return bool false if no consistent copy was obtained
+ */
+inline bool read(const Slot& slot, Sample* out, uint64_t* position, int attempts = 16) {
+    for (int i = 0; i < attempts; ++i) {
+        uint32_t before = slot.lock.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        uint64_t pos = slot.position;
+        Sample copy = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.lock.load(std::memory_order_relaxed) == before) {
+            *out = copy;
+            if (position != nullptr) {
+                *position = pos;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace Shm
+
+#endif // SHM_LAYOUT_H
@@ -0,0 +1,115 @@
+// shm_reader.cpp
+#include "shm_reader.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmReader::ShmReader() : header(nullptr), size(0) {}
+
+ShmReader::~ShmReader() {
+    close();
+}
+
+bool ShmReader::open(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Shm::Header)) {
+        ::close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* mem = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+
+    const Shm::Header* h = static_cast<const Shm::Header*>(mem);
+    bool valid = h->magic.load(std::memory_order_acquire) == Shm::MAGIC && h->version == Shm::VERSION &&
+                 h->header_size >= sizeof(Shm::Header) && h->slot_size == sizeof(Shm::Slot) && h->capacity > 0 &&
+                 h->header_size + static_cast<size_t>(h->capacity) * h->slot_size <= length;
+    if (!valid) {
+        munmap(mem, length);
+        return false;
+    }
+    header = h;
+    size = length;
+    return true;
+}
+
+void ShmReader::close() {
+    if (header != nullptr) {
+        munmap(const_cast<Shm::Header*>(header), size);
+        header = nullptr;
+        size = 0;
+    }
+}
+
+bool ShmReader::latest(Sample* out) const {
+    if (header == nullptr || header->published.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    return Shm::read(header->latest, out, nullptr);
+}
+
+// Copy positions [first, end); a slot that no longer holds the expected position was overwritten and is skipped
+size_t ShmReader::copyRange(uint64_t first, uint64_t end, Sample* out) const {
+    const Shm::Slot* ring = Shm::ring(header);
+    size_t n = 0;
+    for (uint64_t pos = first; pos < end; ++pos) {
+        uint64_t stored;
+        if (Shm::read(ring[pos % header->capacity], &out[n], &stored) && stored == pos) {
+            n++;
+        }
+    }
+    return n;
+}
+
+size_t ShmReader::recent(Sample* out, size_t max) const {
+    if (header == nullptr) {
+        return 0;
+    }
+    uint64_t end = header->published.load(std::memory_order_acquire);
+    uint64_t count = end < header->capacity ? end : header->capacity;
+    if (count > max) {
+        count = max;
+    }
+    return copyRange(end - count, end, out);
+}
+
+size_t ShmReader::since(uint64_t since, Sample* out, size_t max, uint64_t* next) const {
+    if (header == nullptr) {
+        *next = since;
+        return 0;
+    }
+    uint64_t end = header->published.load(std::memory_order_acquire);
+    uint64_t first = since;
+    if (end > header->capacity && first < end - header->capacity) {
+        first = end - header->capacity;  // Older samples have been overwritten
+    }
+    if (first > end) {
+        first = end;  // A new run started with a lower count
+    }
+    if (end - first > max) {
+        end = first + max;
+    }
+    *next = end;
+    return copyRange(first, end, out);
+}
+
+uint64_t ShmReader::published() const {
+    return header != nullptr ? header->published.load(std::memory_order_acquire) : 0;
+}
+
+uint32_t ShmReader::capacity() const {
+    return header != nullptr ? header->capacity : 0;
+}
+
+bool ShmReader::closed() const {
+    return header == nullptr || header->closed.load(std::memory_order_acquire) != 0;
+}
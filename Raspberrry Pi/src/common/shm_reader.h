@@ -0,0 +1,85 @@
+/**
+ * @file shm_reader.h
+ * @brief Reader library for the node's shared-memory region (see shm_layout.h)
+ * @details Only depends on the C++ standard library and POSIX, so local tools can link the wqm_shm_reader library
+ *          or compile this file directly. After open(), every read is a plain memory access: no system call and no
+ *          copy through the kernel. Example:
+ * @code
+ *     ShmReader reader;
+ *     Sample s;
+ *     if (reader.open() && reader.latest(&s)) {
+ *         printf("pH %.2f\n", s.pH);
+ *     }
+ * @endcode
+ */
+
+#ifndef SHM_READER_H
+#define SHM_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_layout.h"
+
+/**
+ * @class ShmReader
+ * @brief Read-only view of the region; any number of readers may attach
+ */
+class ShmReader {
+public:
+    ShmReader();
+    ~ShmReader();
+
+    ShmReader(const ShmReader&) = delete;
+    ShmReader& operator=(const ShmReader&) = delete;
+
+    /**
+     * @brief Map the region
+     * @param name shm_open() name used by the node (shm_name option)
+     * @return bool false if the region does not exist, is not initialised yet or has an unsupported version
+     */
+    bool open(const std::string& name = Shm::DEFAULT_NAME);
+
+    /**
+     * @brief Unmap the region
+     */
+    void close();
+
+    /**
+     * @brief Copy the newest sample
+     * @param out Newest sample
+     * @return bool false if nothing has been published yet
+     */
+    bool latest(Sample* out) const;
+
+    /**
+     * @brief Copy the most recent samples, oldest first
+     * @param out Destination array
+     * @param max Size of the destination array
+     * @return size_t Number of samples copied (samples overwritten while copying are left out)
+     */
+    size_t recent(Sample* out, size_t max) const;
+
+    /**
+     * @brief Copy the samples published after a given count, oldest first (for polling consumers)
+     * @param since Value of published() at the previous call
+     * @param out Destination array
+     * @param max Size of the destination array
+     * @param next Receives the count to pass as since next time
+     * @return size_t Number of samples copied; samples that fell out of the ring are skipped
+     */
+    size_t since(uint64_t since, Sample* out, size_t max, uint64_t* next) const;
+
+    uint64_t published() const;  ///< Samples published since the node created the region
+    uint32_t capacity() const;   ///< Ring capacity in samples
+    bool closed() const;         ///< The node has exited; reopen to attach to the next run
+    bool isOpen() const { return header != nullptr; }  ///< Region mapped
+
+private:
+    size_t copyRange(uint64_t first, uint64_t end, Sample* out) const;
+
+    const Shm::Header* header;  ///< Mapped region, null when closed
+    size_t size;                ///< Mapped length
+};
+
+#endif // SHM_READER_H
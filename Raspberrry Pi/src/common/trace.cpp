@@ -0,0 +1,105 @@
+// trace.cpp
+#include "trace.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "logger.h"
+
+namespace Trace {
+
+static std::atomic<Ring*> rings(nullptr);  // Registered rings, newest first (never freed: threads may still record)
+static std::mutex dump_mutex;             // One dump at a time
+
+Ring* registerThread() {
+    Ring* ring = new Ring();
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    if (pthread_getname_np(pthread_self(), ring->thread_name, sizeof(ring->thread_name)) != 0) {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "thread %u", ring->tid);
+    }
+    Ring* first = rings.load(std::memory_order_relaxed);
+    do {
+        ring->next = first;
+    } while (!rings.compare_exchange_weak(first, ring, std::memory_order_release, std::memory_order_relaxed));
+    threadRing() = ring;
+    return ring;
+}
+
+uint64_t recorded() {
+    uint64_t total = 0;
+    for (Ring* r = rings.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+        total += r->head.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Copy the events of a ring that are still intact after the copy
+static size_t snapshot(const Ring* ring, std::vector<Event>& out) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t first = head > RING_EVENTS ? head - RING_EVENTS : 0;
+    out.resize(static_cast<size_t>(head - first));
+    for (uint64_t i = first; i < head; ++i) {
+        out[static_cast<size_t>(i - first)] = ring->events[i & (RING_EVENTS - 1)];
+    }
+    // Slots the writer reached again while they were being copied may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = ring->head.load(std::memory_order_relaxed);
+    uint64_t valid_from = after > RING_EVENTS ? after - RING_EVENTS : 0;
+    return valid_from > first ? static_cast<size_t>(valid_from - first) : 0;
+}
+
+bool dump(const char* path) {
+    std::lock_guard<std::mutex> lock(dump_mutex);
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (f == nullptr) {
+        LOG_ERROR("Trace dump to {} failed: {}", tmp.c_str(), strerror(errno));
+        return false;
+    }
+
+    unsigned pid = static_cast<unsigned>(getpid());
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":\"water_quality_monitor\"}}", pid);
+
+    std::vector<Event> events;
+    for (Ring* r = rings.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                pid, r->tid, r->thread_name);
+        size_t skip = snapshot(r, events);
+        for (size_t i = skip; i < events.size(); ++i) {
+            const Event& e = events[i];
+            // Chrome expects microseconds; keep the nanoseconds as decimals
+            if (e.type == COMPLETE) {
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+                        e.name, pid, r->tid,
+                        static_cast<unsigned long long>(e.start_ns / 1000), static_cast<unsigned>(e.start_ns % 1000),
+                        static_cast<unsigned long long>(e.value / 1000), static_cast<unsigned>(e.value % 1000));
+            } else {
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%u,\"tid\":%u,\"ts\":%llu.%03u,\"args\":{\"value\":%llu}}",
+                        e.name, pid, r->tid,
+                        static_cast<unsigned long long>(e.start_ns / 1000), static_cast<unsigned>(e.start_ns % 1000),
+                        static_cast<unsigned long long>(e.value));
+            }
+        }
+    }
+    fprintf(f, "\n]}\n");
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp.c_str(), path) != 0) {
+        LOG_ERROR("Trace dump to {} failed: {}", path, strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace Trace
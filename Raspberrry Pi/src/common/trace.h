@@ -0,0 +1,145 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+
+/**
+ * @file trace.h
+ * @brief Timeline tracing of the node's stages, exported as Chrome trace JSON
+ * @details TRACE_SCOPE("name") records the duration of the enclosing scope, TRACE_COUNTER("name", value) the value of
+ *          a counter. Each thread writes its events into its own ring of RING_EVENTS entries: no lock, no allocation
+ *          and no system call after the first event of the thread (clock_gettime goes through the vDSO), so an event
+ *          costs a few tens of nanoseconds. The rings keep the most recent events; Trace::dump() writes them in the
+ *          Chrome trace event format, which chrome://tracing and ui.perfetto.dev open directly.
+ *
+ *          The macros compile to nothing unless WQM_TRACING is defined (CMake option ENABLE_TRACING).
+ *          Event names must be string literals (or otherwise outlive the process) without quotes or backslashes:
+ *          only the pointer is stored.
+ */
+namespace Trace {
+
+/// Kinds of trace events
+enum Type : uint32_t {
+    COMPLETE = 0,  ///< Scope with a start and a duration
+    COUNTER = 1    ///< Value of a counter at a point in time
+};
+
+/// One recorded event (32 bytes)
+struct Event {
+    const char* name;   ///< Static name
+    uint64_t start_ns;  ///< CLOCK_MONOTONIC time of the event (start of a scope)
+    uint64_t value;     ///< Duration in nanoseconds, or the counter value
+    uint32_t type;      ///< Type
+    uint32_t reserved;
+};
+
+static const size_t RING_EVENTS = 16384;  ///< Events kept per thread (power of two)
+
+/// Events of one thread; written by that thread only
+struct Ring {
+    std::atomic<uint64_t> head;   ///< Events written so far (the next one goes to head % RING_EVENTS)
+    uint32_t tid;                 ///< Kernel thread id
+    char thread_name[16];         ///< Name of the thread when it recorded its first event
+    Ring* next;                   ///< Next registered ring
+    Event events[RING_EVENTS];
+};
+
+/**
+ * @brief Current CLOCK_MONOTONIC time in nanoseconds
+ */
+inline uint64_t nowNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * @brief Ring of the calling thread (nullptr until its first event)
+ */
+inline Ring*& threadRing() {
+    static thread_local Ring* ring = nullptr;
+    return ring;
+}
+
+/**
+ * @brief Allocate and register the ring of the calling thread
+ */
+Ring* registerThread();
+
+/**
+ * @brief Append an event to the calling thread's ring, overwriting the oldest one when full
+ */
+inline void record(const char* name, Type type, uint64_t start_ns, uint64_t value) {
+    Ring* ring = threadRing();
+    if (ring == nullptr) {
+        ring = registerThread();
+    }
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event& e = ring->events[head & (RING_EVENTS - 1)];
+    e.name = name;
+    e.start_ns = start_ns;
+    e.value = value;
+    e.type = type;
+    ring->head.store(head + 1, std::memory_order_release);  // Publish the event to dump()
+}
+
+/**
+ * @brief Record a scope whose start and end times the caller already measured
+ */
+inline void complete(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    record(name, COMPLETE, start_ns, end_ns - start_ns);
+}
+
+/**
+ * @brief Record the current value of a counter
+ */
+inline void counter(const char* name, uint64_t value) {
+    record(name, COUNTER, nowNanos(), value);
+}
+
+/// Records the lifetime of a scope
+class Scope {
+public:
+    explicit Scope(const char* n) : name(n), start(nowNanos()) {}
+    ~Scope() { complete(name, start, nowNanos()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+/**
+ * @brief Write the events of every thread to a file in the Chrome trace event format
+ * @param path Destination; written to path + ".tmp" first and then renamed, so readers never see a partial file
+ * @return bool false if the file cannot be written
+ * @note May run while other threads record; events they overwrite during the dump are left out
+ */
+bool dump(const char* path);
+
+/**
+ * @brief Events recorded by all threads since start (including overwritten ones)
+ */
+uint64_t recorded();
+
+}  // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef WQM_TRACING
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_COMPLETE(name, start_ns, end_ns) Trace::complete(name, start_ns, end_ns)
+#define TRACE_COUNTER(name, value) Trace::counter(name, static_cast<uint64_t>(value))
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_COMPLETE(name, start_ns, end_ns) do {} while (0)
+#define TRACE_COUNTER(name, value) do {} while (0)
+#endif
+
+#endif // TRACE_H
@@ -1,6 +1,8 @@
 #ifndef WATER_QUALITY_H
 #define WATER_QUALITY_H
 
+#include "sample.h"
+
 /**
  * @brief Single instance class for water quality monitoring data (Hungry Man implementation)
  * 
@@ -13,12 +15,14 @@ private:
     float turbidity;  ///< Turbidity value, unit depends on sensor
     float pH;         ///< pH value, reflecting the acidity or alkalinity of water
     float ds18b20;    ///< Temperature values measured by the DS18B20 temperature sensor, in degrees Celsius
+    uint64_t sequence;     ///< Sequence number of the latest acquisition cycle
+    int64_t timestamp_us;  ///< Acquisition time of the latest cycle (CLOCK_REALTIME, microseconds)
     /**
      * @brief Private constructor
      * 
      * Initialise all water quality parameters to 0 and ensure that this class cannot be instantiated externally.
      */
-    WaterQuality() : turbidity(0), pH(0), ds18b20(0) {}
+    WaterQuality() : turbidity(0), pH(0), ds18b20(0), sequence(0), timestamp_us(0) {}
 
     /**
      * @brief Disable copy constructors
@@ -88,6 +92,45 @@ public:
      * @return float Current temperature value
      */
     float getDS18B20() const { return ds18b20; }
+
+    /**
+     * @brief Start a new acquisition cycle
+     * @param ts Acquisition time (CLOCK_REALTIME, microseconds)
+     * @note Increments the sequence number; the values set afterwards belong to this cycle
+     */
+    void beginSample(int64_t ts) { ++sequence; timestamp_us = ts; }
+
+    /**
+     * @brief Set the sequence number of the latest cycle
+     * @param seq Sequence number, normally the last one recovered from the history log at startup
+     */
+    void setSequence(uint64_t seq) { sequence = seq; }
+
+    /**
+     * @brief Obtain the sequence number of the latest cycle
+     * @return uint64_t Sequence number (0 before the first acquisition)
+     */
+    uint64_t getSequence() const { return sequence; }
+
+    /**
+     * @brief Obtain the acquisition time of the latest cycle
+     * @return int64_t CLOCK_REALTIME in microseconds
+     */
+    int64_t getTimestamp() const { return timestamp_us; }
+
+    /**
+     * @brief Copy the latest cycle into a self-contained sample
+     * @return Sample Sequence number, timestamp and the three values
+     */
+    Sample snapshot() const {
+        Sample s;
+        s.seq = sequence;
+        s.timestamp_us = timestamp_us;
+        s.turbidity = turbidity;
+        s.temperature = ds18b20;
+        s.pH = pH;
+        return s;
+    }
 };
 
 #endif // WATER_QUALITY_H
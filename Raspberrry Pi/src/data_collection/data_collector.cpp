@@ -1,5 +1,11 @@
 // data_collector.cpp
 #include "data_collector.h"
+#include "../common/metrics.h"
+
+DataCollector::DataCollector()
+    : ownedAdc(new PCF8591()), ownedThermometer(new DS18B20()), pcf8591(*ownedAdc), ds18b20(*ownedThermometer) {}
+
+DataCollector::DataCollector(PCF8591& adc, DS18B20& thermometer) : pcf8591(adc), ds18b20(thermometer) {}
 
 /**
  * @brief Perform a complete water quality data collection and processing
@@ -7,6 +13,9 @@
  *          The temperature data is read from DS18B20 and updated to the global water quality data singleton after conversion.
  */
 void DataCollector::collectData() {
+    // Stamp the cycle before touching the buses so the timestamp reflects the start of acquisition
+    WaterQuality::getInstance().beginSample(realtimeMicros());
+
     // Define the ADC channel to be read (0: turbidity sensor, 1: pH sensor)
     int channels[] = {0, 1};
     // Calculate the number of channels (number of array elements)
@@ -27,4 +36,6 @@ void DataCollector::collectData() {
     // Processing pH data: Convert ADC raw value (0-255) to pH value (0-14)
     // Formula description: Assuming that the sensor output is inversely proportional to the pH value (the larger the ADC value, the smaller the pH value), the full scale corresponds to pH 0-14
     WaterQuality::getInstance().setpH(14.0 - results[1] * 14.0 / 255.0);
+
+    Metrics::increment(Metrics::getInstance().samples_collected);
 }
@@ -8,6 +8,7 @@
 #ifndef DATA_COLLECTOR_H
 #define DATA_COLLECTOR_H
 
+#include <memory>
 #include "../common/com.h"          // Communication protocol and basic type definition
 #include "../data_collection/pcf8591.h"  // ADC Converter Driver
 #include "../data_collection/ds18b20.h"  // Temperature sensor driver
@@ -21,10 +22,25 @@
  */
 class DataCollector {
 private:
-    PCF8591 pcf8591;  // Analog signal acquisition (ADC) for sensors such as pH and turbidity
-    DS18B20 ds18b20;  // Digital temperature sensor, providing high-precision water temperature measurement
+    std::unique_ptr<PCF8591> ownedAdc;          // Drivers created by the default constructor
+    std::unique_ptr<DS18B20> ownedThermometer;
+    PCF8591& pcf8591;  // Analog signal acquisition (ADC) for sensors such as pH and turbidity
+    DS18B20& ds18b20;  // Digital temperature sensor, providing high-precision water temperature measurement
 
 public:
+    /**
+     * @brief Collect from the sensors of this node
+     */
+    DataCollector();
+
+    /**
+     * @brief Collect from the given drivers (simulated sensors in tests and benchmarks)
+     * @param adc ADC with the turbidity sensor on channel 0 and the pH sensor on channel 1
+     * @param thermometer Temperature sensor
+     * @note The drivers must outlive the collector
+     */
+    DataCollector(PCF8591& adc, DS18B20& thermometer);
+
     /**
      * @brief Perform a complete data collection cycle
      * @details Read data from all sensors in a preset order, perform unit conversion and calibration,
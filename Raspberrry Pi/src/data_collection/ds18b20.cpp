@@ -1,43 +1,54 @@
 #include "ds18b20.h"
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../common/metrics.h"
+#include "../common/trace.h"
+#include "../common/logger.h"
 
 constexpr const char* DS18B20_DEVICE_PATH = "/sys/bus/w1/devices/28-000000579aa1/w1_slave";
 
+DS18B20::DS18B20() : path(DS18B20_DEVICE_PATH) {}
+
+DS18B20::DS18B20(const char* device_path) : path(device_path) {}
+
 // Read temperature value from DS18B20 temperature sensor
 float DS18B20::readTemperature() {
-    // Open the DS18B20 device file
-    std::ifstream file(DS18B20_DEVICE_PATH);
-    if (!file.is_open()) {
+    TRACE_SCOPE("DS18B20::readTemperature");
+    // Open the DS18B20 device file; it is read into a stack buffer so a reading allocates nothing
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
         // Output error message and return -1 if file open fails
-        std::cerr << "Failed to open DS18B20 device" << std::endl;
+        Metrics::increment(Metrics::getInstance().w1_errors);
+        LOG_ERROR("Failed to open DS18B20 device");
         return -1;
     }
-    
-    std::string line;
-    std::string content;
-    // Read all content from the file and concatenate into a single string
-    while (std::getline(file, line)) {
-        content += line;
+
+    // The file is two short lines: "<bytes> : crc=<crc> YES" and "<bytes> t=<millidegrees>"
+    char content[128];
+    size_t len = 0;
+    ssize_t n;
+    while (len < sizeof(content) - 1 && (n = read(fd, content + len, sizeof(content) - 1 - len)) > 0) {
+        len += static_cast<size_t>(n);
     }
-    file.close();
-    
+    close(fd);
+    content[len] = '\0';
+
     // Find the starting position of temperature data (t=)
-    size_t pos = content.find("t=");
-    if (pos != std::string::npos) {
-        // Extract the temperature string
-        std::string tempStr = content.substr(pos + 2);
-        try {
-            // Convert the string to a float and convert unit from millidegrees to degrees Celsius
-            float temp = std::stof(tempStr) / 1000.0;
-            return temp;
-        } catch (const std::invalid_argument& e) {
-            // Output error message if conversion fails
-            std::cerr << "Invalid temperature data" << std::endl;
+    const char* pos = strstr(content, "t=");
+    if (pos != nullptr) {
+        char* end;
+        // Convert the string to a float and convert unit from millidegrees to degrees Celsius
+        float milli = strtof(pos + 2, &end);
+        if (end != pos + 2) {
+            return milli / 1000.0;
         }
+        // Output error message if conversion fails
+        LOG_ERROR("Invalid temperature data");
     }
-    
+
     // Return -1 if temperature data is not found or conversion fails
+    Metrics::increment(Metrics::getInstance().w1_errors);
     return -1;
-}
\ No newline at end of file
+}
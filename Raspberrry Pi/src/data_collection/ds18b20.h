@@ -3,8 +3,16 @@
 
 class DS18B20 {
     public:
+        // Read the sensor of this node from the 1-Wire sysfs interface
+        DS18B20();
+        // Read another w1_slave file (another sensor, or a simulated one in tests and benchmarks)
+        explicit DS18B20(const char* device_path);
+        virtual ~DS18B20() {}
+
         // Read temperature value from DS18B20 temperature sensor
         virtual float readTemperature();
+    private:
+        const char* path;  // w1_slave file of the sensor
     };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "pcf8591.h"
-#include <iostream>
+#include "../common/metrics.h"
+#include "../common/trace.h"
+#include "../common/logger.h"
 
 /**
  * PCF8591 I2C Analog-to-digital converter driver
@@ -10,13 +12,13 @@ PCF8591::PCF8591() {
     char filename[20] = {0};
     snprintf(filename, 19, I2C_DEV);  // Formatting I2C device paths
     if ((file = open(filename, O_RDWR)) < 0) {
-        std::cerr << "Failed to open the i2c bus" << std::endl;
+        LOG_ERROR("Failed to open the i2c bus");
         exit(1);  // Terminate the program if opening fails
     }
     
     // Set the I2C slave address (the default address for PCF8591 is 0x48)
     if (ioctl(file, I2C_SLAVE, PCF8591_ADDRESS) < 0) {
-        std::cerr << "Failed to acquire bus access and/or talk to slave" << std::endl;
+        LOG_ERROR("Failed to acquire bus access and/or talk to slave");
         exit(1);  // Terminate the program if setting fails
     }
 }
@@ -25,7 +27,9 @@ PCF8591::PCF8591() {
  * Destructor: Close the I2C device file
  */
 PCF8591::~PCF8591() {
-    close(file);  // Release file resources
+    if (file >= 0) {
+        close(file);  // Release file resources
+    }
 }
 
 /**
@@ -36,23 +40,28 @@ PCF8591::~PCF8591() {
  * @return Returns 0 on success, non-zero on failure
  */
 int PCF8591::readMultiple(int channels[], int numChannels, int results[]) {
+    TRACE_SCOPE("PCF8591::readMultiple");
     for (int i = 0; i < numChannels; ++i) {
+        TRACE_SCOPE("i2c_channel");
         // 1. Select the channel to read
         buf[0] = channels[i];  // Set the control byte and specify the channel number
         if (::write(file, buf, 1) != 1) {
-            std::cerr << "Failed to write to the i2c bus" << std::endl;
+            Metrics::increment(Metrics::getInstance().i2c_errors);
+            LOG_ERROR("Failed to write to the i2c bus");
             return 1;  // Write failed and returned error
         }
         
         // 2. First read (discarded) - Due to the nature of the PCF8591, the first read is the last conversion result
         if (::read(file, buf, 1) != 1) {
-            std::cerr << "Failed to read from the i2c bus" << std::endl;
+            Metrics::increment(Metrics::getInstance().i2c_errors);
+            LOG_ERROR("Failed to read from the i2c bus");
             return 1;  // Read failed and returned error
         }
         
         // 3. Second read - Get the actual conversion result of the current channel
         if (::read(file, buf, 1) != 1) {
-            std::cerr << "Failed to read from the i2c bus" << std::endl;
+            Metrics::increment(Metrics::getInstance().i2c_errors);
+            LOG_ERROR("Failed to read from the i2c bus");
             return 1;  // Read failed and returned error
         }
         
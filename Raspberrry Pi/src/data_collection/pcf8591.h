@@ -18,7 +18,7 @@ class PCF8591 {
         /**
          * Destructor: Close the I2C device connection
          */
-        ~PCF8591();
+        virtual ~PCF8591();
         /**
          * Read analog data from multiple channels
          * @param channels Array of channel numbers to read (0-3)
@@ -27,6 +27,13 @@ class PCF8591 {
          * @return Returns 0 on success and a non-zero error code on failure
          */
         virtual int readMultiple(int channels[], int numChannels, int results[]);
+    protected:
+        /**
+         * Constructor for simulated ADCs: attach to an already open descriptor (or -1) instead of the I2C bus
+         * Subclasses override readMultiple to produce their readings
+         * @param fd Descriptor closed by the destructor
+         */
+        explicit PCF8591(int fd) : file(fd) {}
     private:
         int file; // I2C Device File Descriptor
         char buf[2]; // Communication buffer for I2C data transmission
@@ -0,0 +1,67 @@
+/**
+ * @file baked_font.h
+ * @brief Glyphs rasterised at build time and compiled into the binary
+ * @details tools/bake_font.cpp renders a fixed set of characters with FreeType when the node is built, and writes
+ *          their metrics and 8-bit coverage (A8) as constexpr tables. The coverage is blended into the wanted colours
+ *          when a glyph is first drawn, so the baked glyphs look exactly like the ones FreeType renders at run time.
+ *          The dashboard needs no font file, no FreeType face and no rasterisation; FreeType is only loaded for a
+ *          character outside the baked set.
+ */
+
+#ifndef BAKED_FONT_H
+#define BAKED_FONT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct BakedFont
+ * @brief A baked glyph set: metrics, coverage and a lookup by character
+ */
+struct BakedFont {
+    /**
+     * @brief Metrics of one glyph and the place of its coverage in the table
+     */
+    struct Glyph {
+        uint32_t code;      ///< Unicode code point (the table is sorted by it)
+        int16_t left;       ///< Bitmap offset from the pen position (pixels, rightwards)
+        int16_t top;        ///< Bitmap rows above the baseline
+        uint16_t width;     ///< Bitmap columns
+        uint16_t rows;      ///< Bitmap rows
+        int16_t advance;    ///< Horizontal pen advance (pixels)
+        uint32_t offset;    ///< Index of the first coverage byte
+    };
+
+    const char* name;          ///< Font it was baked from
+    int16_t size;              ///< Pixel size
+    int16_t ascender;          ///< Rows above the baseline
+    int16_t height;            ///< Rows from one baseline to the next
+    const Glyph* glyphs;       ///< Glyphs, sorted by code
+    size_t count;              ///< Entries of glyphs
+    const uint8_t* coverage;   ///< width * rows bytes per glyph, row by row
+
+    /**
+     * @brief Glyph of a character
+     * @return nullptr if the character was not baked
+     */
+    const Glyph* find(wchar_t c) const {
+        size_t lo = 0;
+        size_t hi = count;
+        uint32_t code = static_cast<uint32_t>(c);
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (glyphs[mid].code < code) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo < count && glyphs[lo].code == code ? &glyphs[lo] : nullptr;
+    }
+};
+
+#ifdef WQM_BAKED_FONT
+extern const BakedFont DASHBOARD_FONT;  ///< Dashboard characters (BAKED_FONT_CHARS in CMakeLists), generated at build time
+#endif
+
+#endif // BAKED_FONT_H
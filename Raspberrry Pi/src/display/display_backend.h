@@ -0,0 +1,69 @@
+/**
+ * @file display_backend.h
+ * @brief Connection between the display driver and an ST7735 panel: control pins, SPI bytes and waits
+ * @details TFTFreetype reaches the panel only through this interface. SpidevBackend drives a real panel over gpiod and
+ *          spidev. HeadlessBackend decodes the same bytes into an in-memory panel, so the display can be tested and
+ *          benchmarked on any Linux machine.
+ */
+
+#ifndef DISPLAY_BACKEND_H
+#define DISPLAY_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class DisplayBackend
+ * @brief Pins, byte stream and delays of one panel
+ */
+class DisplayBackend {
+public:
+    /**
+     * @brief Control pins of the panel
+     */
+    enum Pin {
+        PIN_RST,    ///< Reset (active low)
+        PIN_DC,     ///< Data (1) or command (0)
+        PIN_BLK,    ///< Backlight
+        PIN_CS,     ///< Chip select (active low)
+        PIN_COUNT
+    };
+
+    static const int FRAME_MEMORY_LINES = 162;  ///< Lines of the controller's frame memory (160 are shown)
+
+    virtual ~DisplayBackend() {}
+
+    /**
+     * @brief Drive a control pin
+     * @param level 0 or 1
+     */
+    virtual void setPin(Pin pin, int level) = 0;
+
+    /**
+     * @brief Add bytes to the pending SPI message; the data/command pin applies to them
+     * @param data Bytes to send; not copied, so they must stay valid until submit()
+     * @param len Length (bytes)
+     */
+    virtual void queue(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * @brief Send everything queued
+     */
+    virtual void submit() = 0;
+
+    /**
+     * @brief Wait for the panel (reset and sleep-out timings)
+     * @param us Microseconds
+     */
+    virtual void sleepUs(unsigned us) = 0;
+
+    /**
+     * @brief Send one buffer on its own
+     */
+    void write(const uint8_t *data, size_t len) {
+        queue(data, len);
+        submit();
+    }
+};
+
+#endif // DISPLAY_BACKEND_H
@@ -0,0 +1,116 @@
+// framebuffer.cpp
+#include "framebuffer.h"
+#include <algorithm>
+#include <cstring>
+
+const int FrameBuffer::WIDTH;
+const int FrameBuffer::HEIGHT;
+const size_t FrameBuffer::MAX_DIRTY;
+const int FrameBuffer::TRANSFER_OVERHEAD;
+
+FrameBuffer::FrameBuffer() : pixels(WIDTH * HEIGHT, 0), dirty_count(0) {}
+
+bool FrameBuffer::clip(Rect& r) {
+    int x0 = std::max(r.x, 0);
+    int y0 = std::max(r.y, 0);
+    int x1 = std::min(r.x + r.w, WIDTH);
+    int y1 = std::min(r.y + r.h, HEIGHT);
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    r.x = x0;
+    r.y = y0;
+    r.w = x1 - x0;
+    r.h = y1 - y0;
+    return true;
+}
+
+FrameBuffer::Rect FrameBuffer::unite(const Rect& a, const Rect& b) {
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.w, b.x + b.w);
+    int y1 = std::max(a.y + a.h, b.y + b.h);
+    Rect u = {x0, y0, x1 - x0, y1 - y0};
+    return u;
+}
+
+void FrameBuffer::fill(int x, int y, int w, int h, uint16_t color) {
+    Rect r = {x, y, w, h};
+    if (!clip(r)) {
+        return;
+    }
+    uint16_t wire = static_cast<uint16_t>((color >> 8) | (color << 8));
+    for (int row = r.y; row < r.y + r.h; ++row) {
+        std::fill_n(&pixels[row * WIDTH + r.x], r.w, wire);
+    }
+    invalidate(r.x, r.y, r.w, r.h);
+}
+
+void FrameBuffer::blit(int x, int y, int w, int h, const uint16_t* src, int stride) {
+    Rect r = {x, y, w, h};
+    if (!clip(r)) {
+        return;
+    }
+    if (stride == 0) {
+        stride = w;
+    }
+    for (int row = r.y; row < r.y + r.h; ++row) {
+        const uint16_t* from = src + (row - y) * stride + (r.x - x);
+        std::memcpy(&pixels[row * WIDTH + r.x], from, r.w * sizeof(uint16_t));
+    }
+    invalidate(r.x, r.y, r.w, r.h);
+}
+
+uint16_t FrameBuffer::at(int x, int y) const {
+    uint16_t wire = pixels[y * WIDTH + x];
+    return static_cast<uint16_t>((wire >> 8) | (wire << 8));
+}
+
+void FrameBuffer::invalidate(int x, int y, int w, int h) {
+    Rect r = {x, y, w, h};
+    if (!clip(r)) {
+        return;
+    }
+    if (dirty_count == MAX_DIRTY) {
+        // Full: grow the rectangle that becomes the least expensive by taking this one in
+        size_t best = 0;
+        long best_growth = 0;
+        for (size_t i = 0; i < dirty_count; ++i) {
+            long growth = cost(unite(dirty[i], r)) - cost(dirty[i]);
+            if (i == 0 || growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        dirty[best] = unite(dirty[best], r);
+    } else {
+        dirty[dirty_count++] = r;
+    }
+    mergeCheap();
+}
+
+// Merge every pair whose union is cheaper to send than the two transfers, until none is left
+void FrameBuffer::mergeCheap() {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < dirty_count && !merged; ++i) {
+            for (size_t j = i + 1; j < dirty_count; ++j) {
+                Rect u = unite(dirty[i], dirty[j]);
+                if (cost(u) <= cost(dirty[i]) + cost(dirty[j])) {
+                    dirty[i] = u;
+                    dirty[j] = dirty[--dirty_count];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+size_t FrameBuffer::takeDirty(Rect* out) {
+    size_t n = dirty_count;
+    std::copy(dirty, dirty + n, out);
+    dirty_count = 0;
+    return n;
+}
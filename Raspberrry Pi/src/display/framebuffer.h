@@ -0,0 +1,86 @@
+/**
+ * @file framebuffer.h
+ * @brief Off-screen RGB565 image of the panel with dirty-rectangle tracking
+ * @details All drawing goes into this buffer; nothing is sent to the display until the owner flushes. Changed areas
+ *          are recorded as rectangles, and rectangles whose union costs less to send than the separate transfers
+ *          are merged. A flush therefore needs one window command and one bulk transfer per remaining rectangle.
+ *          Pixels are stored in the panel's byte order (high byte first), so rows go out without conversion.
+ */
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class FrameBuffer
+ * @brief Full-screen pixel buffer plus the list of areas not yet sent
+ */
+class FrameBuffer {
+public:
+    static const int WIDTH = 128;                 ///< Panel columns
+    static const int HEIGHT = 160;                ///< Panel rows
+    static const size_t MAX_DIRTY = 16;           ///< Rectangles tracked before the closest ones are merged
+    static const int TRANSFER_OVERHEAD = 64;      ///< Cost of one extra transfer (window commands, GPIO, syscall), in pixels
+
+    /**
+     * @brief Area of the screen, clipped to the panel
+     */
+    struct Rect {
+        int x;  ///< Left column
+        int y;  ///< Top row
+        int w;  ///< Columns
+        int h;  ///< Rows
+    };
+
+    FrameBuffer();
+
+    /**
+     * @brief Fill a rectangle with one colour and mark it dirty
+     * @param color RGB565 colour (native byte order)
+     */
+    void fill(int x, int y, int w, int h, uint16_t color);
+
+    /**
+     * @brief Copy a block of pixels into the buffer and mark it dirty; parts outside the panel are dropped
+     * @param src w * h pixels, row by row, in the panel's byte order (e.g. from GlyphCache)
+     * @param stride Pixels from one source row to the next (0: w), to copy part of a larger image
+     */
+    void blit(int x, int y, int w, int h, const uint16_t* src, int stride = 0);
+
+    /**
+     * @brief Pixel at a position (native byte order), for tests and diffs
+     */
+    uint16_t at(int x, int y) const;
+
+    /**
+     * @brief Record an area as changed
+     */
+    void invalidate(int x, int y, int w, int h);
+
+    /**
+     * @brief Hand over the dirty rectangles and start a new list
+     * @param out Receives up to MAX_DIRTY rectangles, merged where one transfer is cheaper than two
+     * @return Number of rectangles
+     */
+    size_t takeDirty(Rect* out);
+
+    /**
+     * @brief Pixels of a row from column x on, ready to send; rows follow each other without gaps
+     */
+    const uint16_t* row(int x, int y) const { return &pixels[y * WIDTH + x]; }
+
+private:
+    std::vector<uint16_t> pixels;   ///< WIDTH * HEIGHT pixels, high byte first
+    Rect dirty[MAX_DIRTY];          ///< Areas changed since the last takeDirty()
+    size_t dirty_count;             ///< Entries of dirty in use
+
+    static bool clip(Rect& r);
+    static Rect unite(const Rect& a, const Rect& b);
+    static long cost(const Rect& r) { return static_cast<long>(r.w) * r.h + TRANSFER_OVERHEAD; }
+    void mergeCheap();
+};
+
+#endif // FRAMEBUFFER_H
@@ -0,0 +1,160 @@
+// glyph_cache.cpp
+#include "glyph_cache.h"
+#include <stdexcept>
+#include "../common/logger.h"
+#include "../common/trace.h"
+
+GlyphCache::GlyphCache(const char* path, int size, const BakedFont* b)
+    : font_path(path), font_size(size), baked(b), library(nullptr), face(nullptr), face_failed(false), renders(0),
+      baked_used(0) {
+    // Without baked glyphs every character needs FreeType, so a missing font is fatal as before
+    if (baked == nullptr && !openFace()) {
+        throw std::runtime_error("Font（" + font_path + "）could not be loaded by FreeType");
+    }
+}
+
+GlyphCache::~GlyphCache() {
+    if (face != nullptr) {
+        FT_Done_Face(face);
+    }
+    if (library != nullptr) {
+        FT_Done_FreeType(library);
+    }
+}
+
+int GlyphCache::ascent() const {
+    return baked != nullptr ? baked->ascender : static_cast<int>(face->size->metrics.ascender >> 6);
+}
+
+int GlyphCache::lineHeight() const {
+    return baked != nullptr ? baked->height : static_cast<int>(face->size->metrics.height >> 6);  // 26.6 fixed point
+}
+
+// Load FreeType and the font the first time a glyph needs it
+bool GlyphCache::openFace() {
+    if (face != nullptr) {
+        return true;
+    }
+    if (face_failed) {
+        return false;
+    }
+    TRACE_SCOPE("GlyphCache::openFace");
+    if ((library == nullptr && FT_Init_FreeType(&library) != 0) ||
+        FT_New_Face(library, font_path.c_str(), 0, &face) != 0) {
+        face = nullptr;
+        face_failed = true;
+        if (baked != nullptr) {
+            LOG_WARN("Font {} unavailable, characters outside the baked set are drawn as replacements",
+                     font_path.c_str());
+        }
+        return false;
+    }
+    if (FT_Set_Pixel_Sizes(face, 0, font_size) != 0) {
+        FT_Done_Face(face);
+        face = nullptr;
+        face_failed = true;
+        return false;
+    }
+    return true;
+}
+
+const GlyphCache::Glyph& GlyphCache::get(wchar_t c, uint16_t fg, uint16_t bg) {
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(c)) << 32) | (static_cast<uint64_t>(fg) << 16) | bg;
+    auto it = glyphs.find(key);
+    if (it != glyphs.end()) {
+        return it->second;
+    }
+
+    Glyph g = Glyph();
+    const BakedFont::Glyph* b = baked != nullptr ? baked->find(c) : nullptr;
+    if (b != nullptr) {
+        copyBaked(*b, fg, bg, &g);
+        return glyphs.emplace(key, g).first->second;
+    }
+    if (!openFace()) {
+        // Baked font only: draw the baked replacement
+        LOG_WARN("No glyph for character {} in the baked font, drawing a replacement", static_cast<uint32_t>(c));
+        b = baked->find(L'\uFFFD');
+        b = b != nullptr ? b : baked->find(L'?');
+        if (b != nullptr) {
+            copyBaked(*b, fg, bg, &g);
+        } else {
+            g.advance = static_cast<int16_t>(font_size / 2);
+            g.offset = static_cast<uint32_t>(atlas.size());
+        }
+        return glyphs.emplace(key, g).first->second;
+    }
+
+    FT_UInt index = FT_Get_Char_Index(face, static_cast<FT_ULong>(c));
+    if (index == 0) {
+        // Logged once per character and colour pair: the replacement is cached under the missing character
+        LOG_WARN("No glyph for character {} in the font, drawing a replacement", static_cast<uint32_t>(c));
+        static const wchar_t replacements[] = {L'\uFFFD', L'?'};
+        for (wchar_t r : replacements) {
+            index = FT_Get_Char_Index(face, static_cast<FT_ULong>(r));
+            if (index != 0) {
+                break;
+            }
+        }
+        // Still 0: the font's .notdef glyph, usually an empty box
+    }
+
+    if (!render(index, fg, bg, &g)) {
+        // Nothing could be rendered: keep a blank cell so the rest of the text stays in place
+        g.advance = static_cast<int16_t>(face->size->metrics.x_ppem / 2);
+        g.offset = static_cast<uint32_t>(atlas.size());
+    }
+    return glyphs.emplace(key, g).first->second;
+}
+
+// Blend a baked glyph's coverage into the atlas; the same pixels FreeType would have produced
+void GlyphCache::copyBaked(const BakedFont::Glyph& b, uint16_t fg, uint16_t bg, Glyph* out) {
+    baked_used++;
+    out->left = b.left;
+    out->top = b.top;
+    out->width = b.width;
+    out->rows = b.rows;
+    out->advance = b.advance;
+    out->offset = static_cast<uint32_t>(atlas.size());
+    atlas.resize(atlas.size() + b.width * b.rows);
+    Rgb565::blendRow(baked->coverage + b.offset, b.width * b.rows, fg, bg, &atlas[out->offset]);
+}
+
+// Rasterise one glyph and append its blended pixels to the atlas
+bool GlyphCache::render(FT_UInt index, uint16_t fg, uint16_t bg, Glyph* out) {
+    TRACE_SCOPE("GlyphCache::render");
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER) != 0) {
+        return false;
+    }
+    renders++;
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+    out->left = static_cast<int16_t>(slot->bitmap_left);
+    out->top = static_cast<int16_t>(slot->bitmap_top);
+    out->width = static_cast<uint16_t>(bitmap.width);
+    out->rows = static_cast<uint16_t>(bitmap.rows);
+    out->advance = static_cast<int16_t>(slot->advance.x >> 6);  // 26.6 fixed point
+    out->offset = static_cast<uint32_t>(atlas.size());
+
+    atlas.resize(atlas.size() + bitmap.width * bitmap.rows);
+    uint16_t* dest = &atlas[out->offset];
+    if (bitmap.pixel_mode == FT_PIXEL_MODE_GRAY && bitmap.pitch == static_cast<int>(bitmap.width)) {
+        // Rows without padding: one run, so the kernel's scalar tail is paid once per glyph
+        Rgb565::blendRow(bitmap.buffer, bitmap.width * bitmap.rows, fg, bg, dest);
+        return true;
+    }
+    for (unsigned row = 0; row < bitmap.rows; row++) {
+        const uint8_t* line = bitmap.buffer + static_cast<int>(row) * bitmap.pitch;
+        if (bitmap.pixel_mode != FT_PIXEL_MODE_GRAY) {
+            // Monochrome (bitmap-only fonts): one bit per pixel, most significant first
+            mono_row.resize(bitmap.width);
+            for (unsigned col = 0; col < bitmap.width; col++) {
+                mono_row[col] = (line[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0;
+            }
+            line = mono_row.data();
+        }
+        Rgb565::blendRow(line, bitmap.width, fg, bg, dest + row * bitmap.width);  // High byte first in memory
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file glyph_cache.h
+ * @brief Atlas of glyphs rasterised once (at build time or by FreeType) and kept as ready-to-send RGB565 pixels
+ * @details The dashboard draws the same few dozen characters every second. Each (character, foreground, background)
+ *          combination is rendered by FreeType the first time it is drawn. The anti-aliased coverage is blended into
+ *          RGB565 a row at a time by the vector kernel of rgb565.h and appended to one contiguous atlas in the panel's byte order (high byte first), so a glyph is sent
+ *          to the display straight from the atlas. Later draws only look up the glyph. Characters missing from the
+ *          font are drawn as U+FFFD, '?' or the font's .notdef box instead.
+ *          With a baked font (baked_font.h), its characters are taken from the tables compiled into the binary, and
+ *          FreeType and the font file are only loaded when a character outside the baked set is first drawn.
+ */
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "baked_font.h"
+#include "rgb565.h"
+
+/**
+ * @class GlyphCache
+ * @brief Pre-rendered RGB565 glyphs with their metrics
+ */
+class GlyphCache {
+public:
+    /**
+     * @brief Metrics of one cached glyph and the place of its pixels in the atlas
+     */
+    struct Glyph {
+        int16_t left;       ///< Bitmap offset from the pen position (pixels, rightwards)
+        int16_t top;        ///< Bitmap rows above the baseline
+        uint16_t width;     ///< Bitmap columns (0 for blank glyphs such as the space)
+        uint16_t rows;      ///< Bitmap rows
+        int16_t advance;    ///< Horizontal pen advance (pixels)
+        uint32_t offset;    ///< Index of the first pixel in the atlas
+    };
+
+    /**
+     * @brief Constructor
+     * @param font_path Font file for the characters that are not baked
+     * @param font_size Pixel size (that of the baked font, if there is one)
+     * @param baked Glyphs compiled into the binary, or nullptr to render everything with FreeType
+     * @throws std::runtime_error Without baked glyphs, if FreeType cannot load the font (it is needed at once)
+     */
+    GlyphCache(const char* font_path, int font_size, const BakedFont* baked = nullptr);
+
+    /**
+     * @brief Releases the FreeType face and library, if they were loaded
+     */
+    ~GlyphCache();
+
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    /**
+     * @brief Look up a glyph, rendering it on the first use of this character and colour pair
+     * @param c Character
+     * @param fg Text colour (RGB565)
+     * @param bg Background colour the edges are blended with (RGB565)
+     * @return Glyph metrics; the reference stays valid for the life of the cache
+     */
+    const Glyph& get(wchar_t c, uint16_t fg, uint16_t bg);
+
+    /**
+     * @brief Pixels of a glyph, width * rows RGB565 values stored high byte first (ready for the panel)
+     * @note Valid until the next get() that renders a new glyph
+     */
+    const uint16_t* pixels(const Glyph& g) const { return atlas.data() + g.offset; }
+
+    size_t size() const { return glyphs.size(); }                    ///< Cached glyphs
+    size_t atlasBytes() const { return atlas.size() * sizeof(uint16_t); }  ///< Memory used by the pixels
+    uint64_t rendered() const { return renders; }                   ///< Glyphs rendered by FreeType so far
+    uint64_t fromBaked() const { return baked_used; }               ///< Glyphs taken from the baked tables so far
+    bool freetypeLoaded() const { return face != nullptr; }         ///< FreeType and the font file are in memory
+
+    int ascent() const;      ///< Rows above the baseline
+    int lineHeight() const;  ///< Rows from one baseline to the next
+
+    /**
+     * @brief Blend two RGB565 colours per channel (Rgb565::blend)
+     * @param fg Colour at full coverage
+     * @param bg Colour at zero coverage
+     * @param coverage Anti-aliasing coverage, 0-255
+     * @return Blended colour (native byte order)
+     */
+    static uint16_t blend(uint16_t fg, uint16_t bg, uint8_t coverage) { return Rgb565::blend(fg, bg, coverage); }
+
+private:
+    std::string font_path;                            ///< Font file for FreeType
+    int font_size;                                    ///< Pixel size
+    const BakedFont* baked;                           ///< Glyphs compiled into the binary (may be null)
+    FT_Library library;                               ///< FreeType, once loaded
+    FT_Face face;                                     ///< Font face, once loaded
+    bool face_failed;                                 ///< Loading the font failed; not retried
+    std::unordered_map<uint64_t, Glyph> glyphs;       ///< Keyed by character, foreground and background
+    std::vector<uint16_t> atlas;                      ///< Pixels of every glyph, back to back
+    uint64_t renders;                                 ///< FreeType renders
+    uint64_t baked_used;                              ///< Glyphs copied from the baked tables
+    std::vector<uint8_t> mono_row;                    ///< Coverage of a monochrome bitmap row, one byte per pixel
+
+    bool openFace();
+    bool render(FT_UInt index, uint16_t fg, uint16_t bg, Glyph* out);
+    void copyBaked(const BakedFont::Glyph& b, uint16_t fg, uint16_t bg, Glyph* out);
+};
+
+#endif // GLYPH_CACHE_H
@@ -0,0 +1,182 @@
+// headless_backend.cpp
+#include "headless_backend.h"
+#include <cstdio>
+#include "framebuffer.h"
+
+// ST7735 commands the display sends
+static const uint8_t CASET = 0x2A;
+static const uint8_t RASET = 0x2B;
+static const uint8_t RAMWR = 0x2C;
+static const uint8_t DISPOFF = 0x28;
+static const uint8_t DISPON = 0x29;
+static const uint8_t VSCRDEF = 0x33;
+static const uint8_t MADCTL = 0x36;
+static const uint8_t VSCSAD = 0x37;
+static const uint8_t MADCTL_MY = 0x80;
+
+HeadlessBackend::HeadlessBackend(int sink_fd)
+    : bus(sink_fd), byte_count(0), command_count(0), pin_level{0, 0, 0, 1}, pin_toggles(), slept_us(0),
+      memory(FRAME_MEMORY_LINES * FrameBuffer::WIDTH, 0) {
+    resetController();
+}
+
+// State after a hardware reset; the frame memory keeps its contents
+void HeadlessBackend::resetController() {
+    command = 0x00;  // NOP
+    param_count = 0;
+    pixel_high = -1;
+    col_start = 0;
+    col_end = FrameBuffer::WIDTH - 1;
+    row_start = 0;
+    row_end = FrameBuffer::HEIGHT - 1;
+    col = 0;
+    row = 0;
+    madctl = 0;
+    scroll_tfa = 0;
+    scroll_vsa = FRAME_MEMORY_LINES;
+    scroll_start = 0;
+    display_on = false;
+}
+
+void HeadlessBackend::setPin(Pin pin, int level) {
+    if (level == pin_level[pin]) {
+        return;
+    }
+    pin_level[pin] = level;
+    ++pin_toggles[pin];
+    if (pin == PIN_RST && level == 0) {
+        resetController();
+    } else if (pin == PIN_CS && level == 1) {
+        pixel_high = -1;  // Deselecting ends the transfer, so a half-sent pixel is dropped
+    }
+}
+
+uint64_t HeadlessBackend::gpioToggles() const {
+    uint64_t total = 0;
+    for (int i = 0; i < PIN_COUNT; ++i) {
+        total += pin_toggles[i];
+    }
+    return total;
+}
+
+void HeadlessBackend::queue(const uint8_t *data, size_t len) {
+    byte_count += len;
+    decode(data, len);
+    bus.queue(data, len);
+}
+
+void HeadlessBackend::decode(const uint8_t *data, size_t len) {
+    if (pin_level[PIN_CS] != 0) {
+        return;  // Not selected: the panel ignores the bus
+    }
+    if (pin_level[PIN_DC] == 0) {
+        for (size_t i = 0; i < len; ++i) {
+            command = data[i];
+            param_count = 0;
+            ++command_count;
+            if (command == DISPON) {
+                display_on = true;
+            } else if (command == DISPOFF) {
+                display_on = false;
+            } else if (command == RAMWR) {
+                col = col_start;
+                row = row_start;
+                pixel_high = -1;
+            }
+        }
+        return;
+    }
+    if (command != RAMWR) {
+        for (size_t i = 0; i < len; ++i) {
+            parameter(data[i]);
+        }
+        return;
+    }
+    // Pixels fill the window row by row, high byte first
+    for (size_t i = 0; i < len; ++i) {
+        if (pixel_high < 0) {
+            pixel_high = data[i];
+            continue;
+        }
+        if (row <= row_end && row < FrameBuffer::HEIGHT && col < FrameBuffer::WIDTH) {
+            memory[memoryLine(row) * FrameBuffer::WIDTH + col] = static_cast<uint16_t>((pixel_high << 8) | data[i]);
+        }
+        pixel_high = -1;
+        if (++col > col_end) {
+            col = col_start;
+            ++row;
+        }
+    }
+}
+
+void HeadlessBackend::parameter(uint8_t value) {
+    if (param_count == sizeof(params)) {
+        return;
+    }
+    params[param_count++] = value;
+    switch (command) {
+    case CASET:
+        if (param_count == 4) {
+            col_start = (params[0] << 8) | params[1];
+            col_end = (params[2] << 8) | params[3];
+        }
+        break;
+    case RASET:
+        if (param_count == 4) {
+            row_start = (params[0] << 8) | params[1];
+            row_end = (params[2] << 8) | params[3];
+        }
+        break;
+    case MADCTL:
+        madctl = params[0];
+        break;
+    case VSCRDEF:
+        if (param_count == 6) {
+            scroll_tfa = (params[0] << 8) | params[1];
+            scroll_vsa = (params[2] << 8) | params[3];
+        }
+        break;
+    case VSCSAD:
+        if (param_count == 2) {
+            scroll_start = (params[0] << 8) | params[1];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// MADCTL MY writes the rows bottom up: row y goes to line FRAME_MEMORY_LINES - 1 - y, and the scan shows it there
+int HeadlessBackend::memoryLine(int y) const {
+    return (madctl & MADCTL_MY) != 0 ? FRAME_MEMORY_LINES - 1 - y : y;
+}
+
+uint16_t HeadlessBackend::pixel(int x, int y) const {
+    int line = memoryLine(y);
+    if (scroll_vsa > 0 && line >= scroll_tfa && line < scroll_tfa + scroll_vsa) {
+        // The scroll area starts with line VSCSAD and wraps within itself
+        int shift = ((scroll_start - scroll_tfa) % scroll_vsa + scroll_vsa) % scroll_vsa;
+        line = scroll_tfa + (line - scroll_tfa + shift) % scroll_vsa;
+    }
+    return memory[line * FrameBuffer::WIDTH + x];
+}
+
+bool HeadlessBackend::dumpPpm(const std::string &path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", FrameBuffer::WIDTH, FrameBuffer::HEIGHT);
+    uint8_t line[FrameBuffer::WIDTH * 3];
+    for (int y = 0; y < FrameBuffer::HEIGHT; ++y) {
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            uint16_t p = pixel(x, y);
+            line[x * 3] = static_cast<uint8_t>(((p >> 11) * 255 + 15) / 31);
+            line[x * 3 + 1] = static_cast<uint8_t>((((p >> 5) & 0x3F) * 255 + 31) / 63);
+            line[x * 3 + 2] = static_cast<uint8_t>(((p & 0x1F) * 255 + 15) / 31);
+        }
+        fwrite(line, 1, sizeof(line), file);
+    }
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file headless_backend.h
+ * @brief Backend without hardware: an in-memory ST7735 that the display's bytes are decoded into
+ * @details The bytes sent while the panel is selected are read as the controller reads them: with the data/command
+ *          pin low as commands, otherwise as their parameters or pixels. The commands the display uses are applied
+ *          (CASET, RASET, RAMWR, MADCTL row order, VSCRDEF, VSCSAD, DISPON/DISPOFF, and the reset pin), so pixel()
+ *          shows what the panel would show, hardware scrolling included. The bytes, the SPI messages (split as
+ *          SpiBus splits them for spidev) and the pin changes are counted, and the waits are summed instead of slept.
+ *          The screen can be written as a PPM image.
+ */
+
+#ifndef HEADLESS_BACKEND_H
+#define HEADLESS_BACKEND_H
+
+#include <string>
+#include <vector>
+#include "display_backend.h"
+#include "spi_bus.h"
+
+/**
+ * @class HeadlessBackend
+ * @brief Simulated panel with transfer statistics
+ */
+class HeadlessBackend : public DisplayBackend {
+public:
+    /**
+     * @brief Constructor
+     * @param sink_fd Descriptor that also receives the raw SPI bytes (closed by the destructor), or -1 for none
+     */
+    explicit HeadlessBackend(int sink_fd = -1);
+
+    void setPin(Pin pin, int level) override;
+    void queue(const uint8_t *data, size_t len) override;
+    void submit() override { bus.submit(); }
+    void sleepUs(unsigned us) override { slept_us += us; }
+
+    uint64_t bytes() const { return byte_count; }               ///< Bytes sent on the bus
+    uint64_t transactions() const { return bus.messages(); }    ///< SPI messages (ioctls on spidev)
+    uint64_t commands() const { return command_count; }         ///< Command bytes received by the panel
+    uint64_t gpioToggles() const;                                ///< Level changes of all control pins
+    uint64_t toggles(Pin pin) const { return pin_toggles[pin]; } ///< Level changes of one pin
+    int pin(Pin p) const { return pin_level[p]; }                ///< Current level of a pin
+    uint64_t sleptUs() const { return slept_us; }               ///< Waits requested (microseconds)
+    bool displayOn() const { return display_on; }                ///< DISPON received since the last reset
+
+    /**
+     * @brief Pixel the panel shows, scrolling applied
+     * @param x 0 to FrameBuffer::WIDTH - 1
+     * @param y 0 to FrameBuffer::HEIGHT - 1
+     * @return RGB565 (native byte order)
+     */
+    uint16_t pixel(int x, int y) const;
+
+    /**
+     * @brief Write the screen as a binary PPM (P6) image
+     * @param path File to create or replace
+     * @return false if the file could not be written
+     */
+    bool dumpPpm(const std::string &path) const;
+
+private:
+    SpiBus bus;                       ///< Splits the bytes into messages as on the real bus (and feeds the sink)
+    uint64_t byte_count;              ///< Bytes sent
+    uint64_t command_count;           ///< Commands received
+    int pin_level[PIN_COUNT];         ///< Pin levels
+    uint64_t pin_toggles[PIN_COUNT];  ///< Pin level changes
+    uint64_t slept_us;                ///< Waits requested
+    std::vector<uint16_t> memory;     ///< Frame memory, FRAME_MEMORY_LINES lines in memory order
+    uint8_t command;                  ///< Last command byte
+    uint8_t params[6];                ///< Parameters received for it
+    size_t param_count;               ///< Entries of params in use
+    int pixel_high;                   ///< First byte of a pixel in RAMWR (-1 when none is pending)
+    int col_start;                    ///< CASET window
+    int col_end;
+    int row_start;                    ///< RASET window
+    int row_end;
+    int col;                          ///< RAMWR position
+    int row;
+    uint8_t madctl;                   ///< Memory access control
+    int scroll_tfa;                   ///< VSCRDEF top fixed area (lines)
+    int scroll_vsa;                   ///< VSCRDEF scroll area (lines)
+    int scroll_start;                 ///< VSCSAD: memory line shown at the start of the scroll area
+    bool display_on;                  ///< DISPON received
+
+    void resetController();
+    void decode(const uint8_t *data, size_t len);
+    void parameter(uint8_t value);
+    int memoryLine(int y) const;
+};
+
+#endif // HEADLESS_BACKEND_H
@@ -0,0 +1,125 @@
+// layout.cpp
+#include "layout.h"
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+
+const size_t Layout::VALUE_CHARS;
+
+static const int MARGIN = 2;  // Columns left free at both edges
+static const int GAP = 4;     // Columns between the widest label and the values
+
+Layout::Layout(TFTFreetype& display, const Probe* probes, size_t count, int first_row, int end_row,
+               int64_t period_us, const Style& colors)
+    : tft(display), top(first_row), height(end_row - first_row), page_us(period_us), style(colors), per_page(count),
+      current(0), shown_at(-1) {
+    int line = tft.lineHeight();
+    size_t rows = static_cast<size_t>(height / line);
+    if (count > rows) {
+        per_page = rows > 1 ? rows - 1 : 1;  // The last row shows the page indicator
+    }
+    size_t page_count = (count + per_page - 1) / per_page;
+    int pitch = height / static_cast<int>(page_count > 1 ? per_page + 1 : per_page);
+    int first_baseline = top + (pitch - line) / 2 + tft.ascent();
+
+    // Values start after the widest label, so they line up on every page
+    int label_width = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int w = textWidth(probes[i].label);
+        label_width = w > label_width ? w : label_width;
+    }
+    int value_x = MARGIN + label_width + GAP;
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        int baseline = first_baseline + static_cast<int>(i % per_page) * pitch;
+        Entry e = {probes[i], baseline, TextField(tft, value_x, baseline, style.value, style.background), NAN, false};
+        entries.push_back(e);
+    }
+
+    backgrounds.resize(page_count);
+    for (size_t p = 0; p < page_count; ++p) {
+        drawBackground(p, first_baseline + static_cast<int>(per_page) * pitch);
+    }
+    showPage(0);
+}
+
+// Entry after the last one of a page
+size_t Layout::pageEnd(size_t page) const {
+    return std::min((page + 1) * per_page, entries.size());
+}
+
+int Layout::textWidth(const wchar_t* text) const {
+    int w = 0;
+    for (; *text != L'\0'; ++text) {
+        w += tft.advance(*text, style.label, style.background);
+    }
+    return w;
+}
+
+// Draw the static parts of a page on the screen and keep a copy of the band
+void Layout::drawBackground(size_t page, int indicator_baseline) {
+    tft.freshScreen(style.background, 0, top, FrameBuffer::WIDTH, height);
+    int right = FrameBuffer::WIDTH - MARGIN;
+    size_t end = pageEnd(page);
+    for (size_t i = page * per_page; i < end; ++i) {
+        const Entry& e = entries[i];
+        tft.drawString(MARGIN, e.baseline, e.probe.label, style.label, style.background);
+        tft.drawString(right - textWidth(e.probe.unit), e.baseline, e.probe.unit, style.label, style.background);
+    }
+    if (backgrounds.size() > 1) {
+        wchar_t indicator[16];
+        std::swprintf(indicator, sizeof(indicator) / sizeof(wchar_t), L"%zu/%zu", page + 1, backgrounds.size());
+        tft.drawString(right - textWidth(indicator), indicator_baseline, indicator, style.label, style.background);
+    }
+
+    std::vector<uint16_t>& pixels = backgrounds[page];
+    pixels.resize(static_cast<size_t>(FrameBuffer::WIDTH) * height);
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* row = tft.frameBuffer().row(0, top + y);
+        std::copy(row, row + FrameBuffer::WIDTH, &pixels[static_cast<size_t>(y) * FrameBuffer::WIDTH]);
+    }
+}
+
+void Layout::showPage(size_t page) {
+    current = page;
+    tft.drawImage(0, top, FrameBuffer::WIDTH, height, backgrounds[page].data());
+    size_t end = pageEnd(page);
+    for (size_t i = page * per_page; i < end; ++i) {
+        entries[i].field.invalidate();  // Painted over by the background
+        entries[i].drawn = false;
+    }
+}
+
+size_t Layout::update(int64_t t_us, const float* values) {
+    if (backgrounds.size() > 1) {
+        if (shown_at < 0) {
+            shown_at = t_us;
+        } else if (t_us - shown_at >= page_us) {
+            showPage((current + 1) % backgrounds.size());
+            shown_at = t_us;
+        }
+    }
+
+    size_t redrawn = 0;
+    size_t end = pageEnd(current);
+    for (size_t i = current * per_page; i < end; ++i) {
+        Entry& e = entries[i];
+        float v = values[i];
+        if (e.drawn && (v == e.shown || (std::isnan(v) && std::isnan(e.shown)))) {
+            continue;  // Unchanged: not even formatted
+        }
+        // NaN limits compare false, so they never raise the alarm
+        bool alarm = !std::isfinite(v) || v < e.probe.alarm_low || v > e.probe.alarm_high;
+        e.field.setColor(alarm ? style.alarm : style.value);
+        wchar_t text[VALUE_CHARS];
+        if (std::isfinite(v)) {
+            std::swprintf(text, VALUE_CHARS, L"%.*f", e.probe.decimals, v);
+        } else {
+            std::wcscpy(text, L"--");
+        }
+        redrawn += e.field.set(text);
+        e.shown = v;
+        e.drawn = true;
+    }
+    return redrawn;
+}
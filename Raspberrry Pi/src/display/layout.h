@@ -0,0 +1,108 @@
+/**
+ * @file layout.h
+ * @brief Pages of probe readings: a cached static background with value fields composited over it
+ * @details Each probe takes one row: its label on the left, its value in a common column and its unit right-aligned.
+ *          The probes are split into pages of as many rows as fit. A page's static parts (labels, units and, with
+ *          several pages, a page indicator in the last row) are drawn once, when the layout is built, and kept as a
+ *          block of pixels. Showing a page copies that block to the screen, and the values are drawn over it as
+ *          retained text fields. An update formats and redraws only the values that changed since they were last
+ *          drawn, so its cost follows the changed fields and not the number of probes or labels. A value outside
+ *          its probe's alarm range, or one that is not a number (e.g. a failed sensor, shown as "--"), is drawn in the
+ *          alarm colour. With several pages, update() moves to the next page once the page period has passed.
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "text_field.h"
+#include "tft_freetype.h"
+
+/**
+ * @class Layout
+ * @brief Retained probe dashboard in a band of screen rows
+ */
+class Layout {
+public:
+    /**
+     * @brief One probe shown by the layout
+     */
+    struct Probe {
+        const wchar_t* label;   ///< Name at the left of the row
+        const wchar_t* unit;    ///< Unit at the right of the row (may be empty)
+        int decimals;           ///< Digits after the decimal point
+        float alarm_low;        ///< Lower alarm limit (NaN: none)
+        float alarm_high;       ///< Upper alarm limit (NaN: none)
+    };
+
+    /**
+     * @brief Colours of the layout (RGB565)
+     */
+    struct Style {
+        uint16_t label;         ///< Labels, units and the page indicator
+        uint16_t value;         ///< Values within their alarm range
+        uint16_t alarm;         ///< Values outside it
+        uint16_t background;    ///< Everything else
+    };
+
+    /**
+     * @brief Lay out the probes and draw the static background of every page; page 0 is shown
+     * @param display Display drawn on; outlives the layout
+     * @param probes Probes in display order; copied, but the strings must outlive the layout
+     * @param count Entries of probes (at least 1)
+     * @param top First row of the band
+     * @param bottom Row after the band
+     * @param page_us Time each page is shown (microseconds)
+     * @param style Colours
+     */
+    Layout(TFTFreetype& display, const Probe* probes, size_t count, int top, int bottom, int64_t page_us,
+           const Style& style);
+
+    /**
+     * @brief Draw the values that changed; moves to the next page when its time has come
+     * @param t_us Current time (monotonic microseconds)
+     * @param values One value per probe, in the order given to the constructor
+     * @return Number of character cells redrawn
+     */
+    size_t update(int64_t t_us, const float* values);
+
+    /**
+     * @brief Show a page: its background at once, its values with the next update()
+     * @param page 0 to pages() - 1
+     */
+    void showPage(size_t page);
+
+    size_t pages() const { return backgrounds.size(); }  ///< Pages
+    size_t page() const { return current; }               ///< Page shown
+    size_t rowsPerPage() const { return per_page; }       ///< Probes on a full page
+
+private:
+    static const size_t VALUE_CHARS = 16;  ///< Characters of a formatted value
+
+    struct Entry {
+        Probe probe;         ///< What is shown
+        int baseline;        ///< Baseline of its row
+        TextField field;     ///< Value
+        float shown;         ///< Value drawn
+        bool drawn;          ///< shown is on the screen
+    };
+
+    TFTFreetype& tft;                                  ///< Display drawn on
+    int top;                                           ///< First row of the band
+    int height;                                        ///< Rows of the band
+    int64_t page_us;                                   ///< Page period
+    Style style;                                       ///< Colours
+    size_t per_page;                                   ///< Probes per page
+    std::vector<Entry> entries;                        ///< Probes, page by page
+    std::vector<std::vector<uint16_t>> backgrounds;    ///< Static pixels of each page, WIDTH * height
+    size_t current;                                    ///< Page shown
+    int64_t shown_at;                                  ///< When it was shown (-1 until the first update)
+
+    void drawBackground(size_t page, int indicator_baseline);
+    size_t pageEnd(size_t page) const;
+    int textWidth(const wchar_t* text) const;
+};
+
+#endif // LAYOUT_H
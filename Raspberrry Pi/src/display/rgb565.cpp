@@ -0,0 +1,102 @@
+// rgb565.cpp
+#include "rgb565.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Rgb565 {
+
+uint16_t blend(uint16_t fg, uint16_t bg, uint8_t coverage) {
+    uint32_t a = coverage;
+    uint32_t r = (((fg >> 11) & 0x1F) * a + ((bg >> 11) & 0x1F) * (255 - a) + 127) / 255;
+    uint32_t g = (((fg >> 5) & 0x3F) * a + ((bg >> 5) & 0x3F) * (255 - a) + 127) / 255;
+    uint32_t b = ((fg & 0x1F) * a + (bg & 0x1F) * (255 - a) + 127) / 255;
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static inline uint16_t swapped(uint16_t color) {
+    return static_cast<uint16_t>((color >> 8) | (color << 8));
+}
+
+#if defined(__ARM_NEON)
+
+const char* kernel() {
+    return "NEON";
+}
+
+// v / 255 rounded, for v <= 255 * 255
+static inline uint16x8_t div255(uint16x8_t v) {
+    uint16x8_t y = vaddq_u16(v, vdupq_n_u16(128));
+    return vshrq_n_u16(vsraq_n_u16(y, y, 8), 8);
+}
+
+void blendRow(const uint8_t* coverage, size_t n, uint16_t fg, uint16_t bg, uint16_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t a = vmovl_u8(vld1_u8(coverage + i));
+        uint16x8_t inv = vsubq_u16(vdupq_n_u16(255), a);
+        uint16x8_t r = div255(vmlaq_n_u16(vmulq_n_u16(a, (fg >> 11) & 0x1F), inv, (bg >> 11) & 0x1F));
+        uint16x8_t g = div255(vmlaq_n_u16(vmulq_n_u16(a, (fg >> 5) & 0x3F), inv, (bg >> 5) & 0x3F));
+        uint16x8_t b = div255(vmlaq_n_u16(vmulq_n_u16(a, fg & 0x1F), inv, bg & 0x1F));
+        uint16x8_t p = vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+        vst1q_u16(out + i, vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(p))));
+    }
+    for (; i < n; ++i) {
+        out[i] = swapped(blend(fg, bg, coverage[i]));
+    }
+}
+
+#elif defined(__SSE2__)
+
+const char* kernel() {
+    return "SSE2";
+}
+
+// v / 255 rounded, for v <= 255 * 255
+static inline __m128i div255(__m128i v) {
+    __m128i y = _mm_add_epi16(v, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(y, _mm_srli_epi16(y, 8)), 8);
+}
+
+static inline __m128i mix(__m128i a, __m128i inv, int f, int b) {
+    return div255(_mm_add_epi16(_mm_mullo_epi16(a, _mm_set1_epi16(static_cast<short>(f))),
+                                _mm_mullo_epi16(inv, _mm_set1_epi16(static_cast<short>(b)))));
+}
+
+void blendRow(const uint8_t* coverage, size_t n, uint16_t fg, uint16_t bg, uint16_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(coverage + i)), zero);
+        __m128i inv = _mm_sub_epi16(full, a);
+        __m128i r = mix(a, inv, (fg >> 11) & 0x1F, (bg >> 11) & 0x1F);
+        __m128i g = mix(a, inv, (fg >> 5) & 0x3F, (bg >> 5) & 0x3F);
+        __m128i b = mix(a, inv, fg & 0x1F, bg & 0x1F);
+        __m128i p = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+        p = _mm_or_si128(_mm_srli_epi16(p, 8), _mm_slli_epi16(p, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p);
+    }
+    for (; i < n; ++i) {
+        out[i] = swapped(blend(fg, bg, coverage[i]));
+    }
+}
+
+#else
+
+const char* kernel() {
+    return "scalar";
+}
+
+void blendRow(const uint8_t* coverage, size_t n, uint16_t fg, uint16_t bg, uint16_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = swapped(blend(fg, bg, coverage[i]));
+    }
+}
+
+#endif
+
+}
@@ -0,0 +1,45 @@
+/**
+ * @file rgb565.h
+ * @brief Anti-aliasing kernel: blends 8-bit glyph coverage between two RGB565 colours
+ * @details Each channel is mixed as (fg * a + bg * (255 - a)) / 255, rounded to nearest, so a glyph edge takes the
+ *          right shade against any background. blendRow() handles eight pixels per step with NEON on the Pi 5 (and
+ *          any ARM with Advanced SIMD) or SSE2 on x86-64, with a scalar loop for the remainder and for other targets.
+ *          The vector paths divide by 255 with the exact ((v + 128) + ((v + 128) >> 8)) >> 8 identity, so every path
+ *          gives the same pixels. The output is stored high byte first, ready to be sent to the panel.
+ */
+
+#ifndef RGB565_H
+#define RGB565_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Rgb565 {
+
+/**
+ * @brief Blend two colours per channel (reference for the vector paths)
+ * @param fg Colour at full coverage
+ * @param bg Colour at zero coverage
+ * @param coverage 0-255
+ * @return Blended colour (native byte order)
+ */
+uint16_t blend(uint16_t fg, uint16_t bg, uint8_t coverage);
+
+/**
+ * @brief Blend a row of coverage values
+ * @param coverage n coverage values
+ * @param n Pixels
+ * @param fg Colour at full coverage
+ * @param bg Colour at zero coverage
+ * @param out n pixels, high byte first (panel order)
+ */
+void blendRow(const uint8_t* coverage, size_t n, uint16_t fg, uint16_t bg, uint16_t* out);
+
+/**
+ * @brief Instruction set blendRow() was compiled for: "NEON", "SSE2" or "scalar"
+ */
+const char* kernel();
+
+}
+
+#endif // RGB565_H
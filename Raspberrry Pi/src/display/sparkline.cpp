@@ -0,0 +1,85 @@
+// sparkline.cpp
+#include "sparkline.h"
+#include <cmath>
+
+const int Sparkline::CHANNELS;
+
+Sparkline::Sparkline(TFTFreetype& display, int first_row, int row_count, int64_t period_us,
+                     const Channel (&lanes)[CHANNELS])
+    : tft(display), top(first_row), rows(row_count), column_us(period_us), history(row_count), drawn(0),
+      open_period(-1) {
+    for (int i = 0; i < CHANNELS; ++i) {
+        channels[i] = lanes[i];
+    }
+    reset(open);
+    tft.setScrollArea(top, rows);
+}
+
+void Sparkline::reset(Column& c) {
+    for (int i = 0; i < CHANNELS; ++i) {
+        c.lo[i] = NAN;
+        c.hi[i] = NAN;
+    }
+}
+
+size_t Sparkline::add(int64_t t_us, const float (&values)[CHANNELS]) {
+    size_t before = drawn;
+    int64_t period = t_us / column_us;
+    if (open_period < 0) {
+        open_period = period;
+    }
+    if (period > open_period) {
+        push(open);
+        // Periods without samples repeat the column before them; more than a screenful would all scroll away
+        int64_t missed = period - open_period - 1;
+        for (int64_t i = 0; i < missed && i < rows; ++i) {
+            push(open);
+        }
+        reset(open);
+        open_period = period;
+    }
+    for (int i = 0; i < CHANNELS; ++i) {
+        float v = values[i];
+        if (!std::isfinite(v)) {
+            continue;
+        }
+        if (std::isnan(open.lo[i]) || v < open.lo[i]) {
+            open.lo[i] = v;
+        }
+        if (std::isnan(open.hi[i]) || v > open.hi[i]) {
+            open.hi[i] = v;
+        }
+    }
+    return drawn - before;
+}
+
+const Sparkline::Column& Sparkline::column(size_t age) const {
+    return history[(drawn - 1 - age) % rows];
+}
+
+// Overwrite the oldest row and scroll it to the bottom edge of the chart
+void Sparkline::push(const Column& c) {
+    int slot = static_cast<int>(drawn % rows);
+    history[slot] = c;
+    drawRow(top + slot, c);
+    tft.setScrollRow(top + slot);
+    ++drawn;
+}
+
+void Sparkline::drawRow(int row, const Column& c) {
+    const int lane_width = FrameBuffer::WIDTH / CHANNELS;
+    const int span = lane_width - 2;  // One blank column on each side separates the lanes
+    tft.freshScreen(0x0000, 0, row, FrameBuffer::WIDTH, 1);
+    for (int i = 0; i < CHANNELS; ++i) {
+        if (std::isnan(c.lo[i])) {
+            continue;  // No valid sample in this column
+        }
+        const Channel& ch = channels[i];
+        float scale = (span - 1) / (ch.max - ch.min);
+        int x0 = static_cast<int>(std::lround((c.lo[i] - ch.min) * scale));
+        int x1 = static_cast<int>(std::lround((c.hi[i] - ch.min) * scale));
+        x0 = x0 < 0 ? 0 : (x0 > span - 1 ? span - 1 : x0);
+        x1 = x1 < 0 ? 0 : (x1 > span - 1 ? span - 1 : x1);
+        tft.freshScreen(ch.color, i * lane_width + 1 + x0, row, x1 - x0 + 1, 1);
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file sparkline.h
+ * @brief Strip chart of the recent trend of each channel, advanced with the panel's hardware vertical scroll
+ * @details The chart is a band of panel rows below the text. Time runs along the rows because the ST7735 can only
+ *          scroll in that direction. Each row shows one time column: one lane per channel, with the range between the
+ *          lowest and highest value of that column drawn as a bar. Samples are reduced to the min/max envelope of
+ *          their column as they arrive, and a ring of the finished columns is kept in memory. When a column is done,
+ *          it is written over the oldest row and the scroll start moves by one row (VSCSAD). Advancing the chart
+ *          therefore sends one row of pixels and one command, and the plot is never redrawn. Columns are timed by
+ *          the sample timestamps. A period without samples (e.g. suppressed by a deadband filter) repeats the last
+ *          column, because the values stayed where they were.
+ */
+
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tft_freetype.h"
+
+/**
+ * @class Sparkline
+ * @brief Min/max envelope chart of up to CHANNELS values in the hardware scroll area
+ */
+class Sparkline {
+public:
+    static const int CHANNELS = 3;  ///< Lanes side by side
+
+    /**
+     * @brief Value range and colour of one lane
+     */
+    struct Channel {
+        float min;       ///< Value at the left edge of the lane
+        float max;       ///< Value at the right edge of the lane
+        uint16_t color;  ///< Bar colour (RGB565)
+    };
+
+    /**
+     * @brief Lowest and highest value of each channel over one column
+     */
+    struct Column {
+        float lo[CHANNELS];  ///< Lowest value (NaN if the channel had no valid sample)
+        float hi[CHANNELS];  ///< Highest value
+    };
+
+    /**
+     * @brief Constructor; defines the scroll area on the display (sent with the next flush)
+     * @param display Display drawn on; outlives the chart
+     * @param top First panel row of the chart
+     * @param rows Rows of the chart, i.e. time columns shown
+     * @param column_us Time covered by one column (microseconds)
+     * @param channels Range and colour of each lane
+     */
+    Sparkline(TFTFreetype& display, int top, int rows, int64_t column_us, const Channel (&channels)[CHANNELS]);
+
+    /**
+     * @brief Add a sample; finishes and draws the columns whose period has passed
+     * @param t_us Sample time (monotonic microseconds)
+     * @param values One value per channel; non-finite values are ignored
+     * @return Number of columns drawn
+     */
+    size_t add(int64_t t_us, const float (&values)[CHANNELS]);
+
+    size_t columns() const { return drawn; }  ///< Columns drawn so far
+
+    /**
+     * @brief A finished column
+     * @param age 0 for the newest; must be below both columns() and the row count
+     */
+    const Column& column(size_t age) const;
+
+private:
+    TFTFreetype& tft;              ///< Display drawn on
+    int top;                       ///< First row of the chart
+    int rows;                      ///< Rows of the chart
+    int64_t column_us;             ///< Period of one column
+    Channel channels[CHANNELS];    ///< Lanes
+    std::vector<Column> history;   ///< Finished columns, ring indexed like the chart rows
+    size_t drawn;                  ///< Columns drawn (the next one goes to row top + drawn % rows)
+    Column open;                   ///< Envelope of the column being filled
+    int64_t open_period;           ///< Period of the open column (-1 before the first sample)
+
+    void push(const Column& c);
+    void drawRow(int row, const Column& c);
+    static void reset(Column& c);
+};
+
+#endif // SPARKLINE_H
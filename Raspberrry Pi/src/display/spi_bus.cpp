@@ -0,0 +1,110 @@
+// spi_bus.cpp
+#include "spi_bus.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "../common/constants.h"
+#include "../common/logger.h"
+#include "../common/metrics.h"
+
+const size_t SpiBus::MAX_TRANSFERS;
+const size_t SpiBus::ALIGNMENT;
+
+static size_t aligned(size_t len) {
+    return (len + SpiBus::ALIGNMENT - 1) / SpiBus::ALIGNMENT * SpiBus::ALIGNMENT;
+}
+
+SpiBus::SpiBus(const char *device, uint8_t mode, uint32_t speed_hz)
+    : fd(-1), simulated(false), spi_mode(mode), spi_speed(speed_hz), message_limit(0), transfer_count(0),
+      message_bytes(0), message_count(0) {
+    fd = open(device, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("SPI device（" + std::string(device) + "）open failed：" + std::string(strerror(errno)));
+    }
+    uint8_t bits = 8;
+    if (ioctl(fd, SPI_IOC_WR_MODE, &spi_mode) == -1 || ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) == -1 || ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &spi_speed) == -1) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("SPI device（" + std::string(device) + "）configuration failed：" + error);
+    }
+    message_limit = readBufsiz() / ALIGNMENT * ALIGNMENT;
+    LOG_INFO("SPI {}: mode {}, {} Hz, messages of up to {} bytes", device, static_cast<int>(spi_mode), spi_speed,
+             message_limit);
+}
+
+SpiBus::SpiBus(int sink_fd)
+    : fd(sink_fd), simulated(true), spi_mode(0), spi_speed(0), message_limit(SPIDEV_BUFSIZ), transfer_count(0),
+      message_bytes(0), message_count(0) {}
+
+SpiBus::~SpiBus() {
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+// The driver's buffer size is a module parameter (spidev.bufsiz=); fall back to its default
+size_t SpiBus::readBufsiz() {
+    size_t bufsiz = SPIDEV_BUFSIZ;
+    int param = open("/sys/module/spidev/parameters/bufsiz", O_RDONLY | O_CLOEXEC);
+    if (param == -1) {
+        return bufsiz;
+    }
+    char text[32];
+    ssize_t n = read(param, text, sizeof(text) - 1);
+    close(param);
+    if (n > 0) {
+        text[n] = '\0';
+        long value = strtol(text, nullptr, 10);
+        if (value >= static_cast<long>(ALIGNMENT)) {
+            bufsiz = static_cast<size_t>(value);
+        }
+    }
+    return bufsiz;
+}
+
+void SpiBus::queue(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        if (transfer_count == MAX_TRANSFERS || message_bytes == message_limit) {
+            send();
+        }
+        // message_bytes and message_limit are multiples of ALIGNMENT, so a piece that fits raw also fits aligned
+        size_t piece = len < message_limit - message_bytes ? len : message_limit - message_bytes;
+        spi_ioc_transfer& t = transfers[transfer_count++];
+        std::memset(&t, 0, sizeof(t));
+        t.tx_buf = reinterpret_cast<uintptr_t>(data);
+        t.len = static_cast<uint32_t>(piece);
+        t.speed_hz = spi_speed;
+        t.bits_per_word = 8;
+        message_bytes += aligned(piece);
+        data += piece;
+        len -= piece;
+    }
+}
+
+void SpiBus::submit() {
+    if (transfer_count > 0) {
+        send();
+    }
+}
+
+void SpiBus::send() {
+    ++message_count;
+    if (simulated) {
+        for (size_t i = 0; i < transfer_count && fd != -1; ++i) {
+            const void *buf = reinterpret_cast<const void *>(static_cast<uintptr_t>(transfers[i].tx_buf));
+            if (::write(fd, buf, transfers[i].len) != static_cast<ssize_t>(transfers[i].len)) {
+                Metrics::increment(Metrics::getInstance().spi_errors);
+            }
+        }
+    } else if (ioctl(fd, SPI_IOC_MESSAGE(transfer_count), transfers) < 0) {
+        Metrics::increment(Metrics::getInstance().spi_errors);
+    }
+    transfer_count = 0;
+    message_bytes = 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file spi_bus.h
+ * @brief spidev transfer layer that sends queued buffers in as few SPI_IOC_MESSAGE ioctls as the driver accepts
+ * @details Callers queue the buffers of one command or data phase (for example the rows of a screen rectangle) and
+ *          submit them together. The buffers become spi_ioc_transfer entries of one message, without being copied.
+ *          spidev copies a whole message through a buffer of `bufsiz` bytes (module parameter, 4096 by default).
+ *          Every transfer is counted at the driver's 128-byte alignment, so each message stays within that limit.
+ *          A buffer longer than the room left is split across messages.
+ *          The chip select and data/command pins are GPIOs owned by the display and are not touched here.
+ */
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/spi/spidev.h>
+
+/**
+ * @class SpiBus
+ * @brief One spidev device, or a plain descriptor standing in for it
+ */
+class SpiBus {
+public:
+    static const size_t MAX_TRANSFERS = 256;  ///< Transfers of one message; a longer queue is sent in several
+    static const size_t ALIGNMENT = 128;      ///< spidev rounds each transfer up to this (ARCH_KMALLOC_MINALIGN on arm64)
+
+    /**
+     * @brief Open and configure a spidev device
+     * @param device Device path (e.g. /dev/spidev0.0)
+     * @param mode SPI mode (clock polarity and phase)
+     * @param speed_hz Clock rate; the rate the driver reports back is kept
+     * @throws std::runtime_error If the device cannot be opened or configured
+     */
+    SpiBus(const char *device, uint8_t mode, uint32_t speed_hz);
+
+    /**
+     * @brief Simulated bus (tests and benchmarks): the bytes are written to sink_fd with the same chunking
+     * @param sink_fd Descriptor receiving the bytes (e.g. /dev/null), closed by the destructor; -1 only counts them
+     */
+    explicit SpiBus(int sink_fd);
+
+    ~SpiBus();
+
+    SpiBus(const SpiBus&) = delete;
+    SpiBus& operator=(const SpiBus&) = delete;
+
+    /**
+     * @brief Add a buffer to the pending message; full messages are sent on the way
+     * @param data Bytes to send; not copied, so they must stay valid until submit()
+     * @param len Length (bytes)
+     */
+    void queue(const uint8_t *data, size_t len);
+
+    /**
+     * @brief Send everything queued
+     */
+    void submit();
+
+    /**
+     * @brief Send one buffer on its own
+     */
+    void write(const uint8_t *data, size_t len) {
+        queue(data, len);
+        submit();
+    }
+
+    uint8_t mode() const { return spi_mode; }                ///< SPI mode in use
+    uint32_t speed() const { return spi_speed; }             ///< Clock rate in use (0 when simulated)
+    size_t messageLimit() const { return message_limit; }    ///< Largest message, from spidev's bufsiz
+    uint64_t messages() const { return message_count; }      ///< Messages (ioctls) sent so far
+
+private:
+    int fd;                                      ///< spidev device, or the sink
+    bool simulated;                              ///< fd is not a spidev device; use write()
+    uint8_t spi_mode;                            ///< SPI mode
+    uint32_t spi_speed;                          ///< Clock rate (Hz)
+    size_t message_limit;                        ///< spidev bufsiz, rounded down to ALIGNMENT
+    spi_ioc_transfer transfers[MAX_TRANSFERS];   ///< Pending message
+    size_t transfer_count;                       ///< Entries of transfers in use
+    size_t message_bytes;                        ///< Size of the pending message as the driver counts it
+    uint64_t message_count;                      ///< Messages sent
+
+    void send();
+    static size_t readBufsiz();
+};
+
+#endif // SPI_BUS_H
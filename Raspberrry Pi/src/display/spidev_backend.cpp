@@ -0,0 +1,49 @@
+// spidev_backend.cpp
+#include "spidev_backend.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "../common/constants.h"
+
+SpidevBackend::SpidevBackend(const char *device, const char *gpio_chip)
+    : bus(device, SPI_MODE, SPI_SPEED_HZ), chip(nullptr), lines() {
+    chip = gpiod_chip_open_by_name(gpio_chip);
+    if (chip == nullptr) {
+        throw std::runtime_error("GPIO chip（" + std::string(gpio_chip) + "）open failed：" + std::string(strerror(errno)));
+    }
+    static const unsigned offsets[PIN_COUNT] = {RST_PIN, DC_PIN, BLK_PIN, CS_PIN};
+    static const char *const names[PIN_COUNT] = {"rst", "dc", "blk", "cs"};
+    static const int initial[PIN_COUNT] = {0, 0, 0, 1};  // SPI is disabled by default
+    for (int i = 0; i < PIN_COUNT; ++i) {
+        lines[i] = gpiod_chip_get_line(chip, offsets[i]);
+        if (lines[i] == nullptr || gpiod_line_request_output(lines[i], names[i], initial[i]) != 0) {
+            std::string error = strerror(errno);
+            lines[i] = nullptr;
+            release();
+            throw std::runtime_error("GPIO line（" + std::string(names[i]) + "）request failed：" + error);
+        }
+    }
+}
+
+SpidevBackend::~SpidevBackend() {
+    release();
+}
+
+void SpidevBackend::release() {
+    for (int i = 0; i < PIN_COUNT; ++i) {
+        if (lines[i] != nullptr) {
+            gpiod_line_release(lines[i]);
+        }
+    }
+    gpiod_chip_close(chip);
+}
+
+void SpidevBackend::setPin(Pin pin, int level) {
+    gpiod_line_set_value(lines[pin], level);
+}
+
+void SpidevBackend::sleepUs(unsigned us) {
+    usleep(us);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file spidev_backend.h
+ * @brief Backend of a real panel: control pins through libgpiod, bytes through spidev
+ */
+
+#ifndef SPIDEV_BACKEND_H
+#define SPIDEV_BACKEND_H
+
+#include <gpiod.h>
+#include "display_backend.h"
+#include "spi_bus.h"
+
+/**
+ * @class SpidevBackend
+ * @brief ST7735 on a spidev device, with the pins RST_PIN, DC_PIN, BLK_PIN and CS_PIN of a GPIO chip
+ */
+class SpidevBackend : public DisplayBackend {
+public:
+    /**
+     * @brief Open the SPI device (SPI_MODE, SPI_SPEED_HZ) and request the control pins as outputs
+     * The panel starts in reset, deselected, with the backlight off
+     * @param device SPI device path (e.g. /dev/spidev0.0)
+     * @param gpio_chip GPIO chip name (e.g. gpiochip0)
+     * @throws std::runtime_error If the device or a pin cannot be opened
+     */
+    SpidevBackend(const char *device, const char *gpio_chip);
+
+    /**
+     * @brief Release the pins; the SPI device is closed with the bus
+     */
+    ~SpidevBackend() override;
+
+    void setPin(Pin pin, int level) override;
+    void queue(const uint8_t *data, size_t len) override { bus.queue(data, len); }
+    void submit() override { bus.submit(); }
+    void sleepUs(unsigned us) override;
+
+    const SpiBus& spiBus() const { return bus; }  ///< Transfer layer and its statistics
+
+private:
+    SpiBus bus;                            ///< SPI device
+    struct gpiod_chip *chip;               ///< GPIO chip handle
+    struct gpiod_line *lines[PIN_COUNT];   ///< Control pin handles, indexed by Pin
+
+    void release();
+};
+
+#endif // SPIDEV_BACKEND_H
@@ -0,0 +1,53 @@
+// text_field.cpp
+#include "text_field.h"
+
+const size_t TextField::MAX_CELLS;
+
+TextField::TextField(TFTFreetype& display, int left, int base, uint16_t f, uint16_t b)
+    : tft(display), x(left), baseline(base), fg(f), bg(b), digit_width(0), count(0) {
+    for (wchar_t d = L'0'; d <= L'9'; ++d) {
+        int w = tft.advance(d, fg, bg);
+        digit_width = w > digit_width ? w : digit_width;
+    }
+}
+
+void TextField::setColor(uint16_t color) {
+    if (color != fg) {
+        fg = color;
+        invalidate();
+    }
+}
+
+void TextField::invalidate() {
+    for (size_t i = 0; i < count; ++i) {
+        cells[i].c = L'\0';  // Matches no character of a string
+    }
+}
+
+size_t TextField::set(const wchar_t* text) {
+    int old_end = count > 0 ? cells[count - 1].x + cells[count - 1].w : x;
+    size_t redrawn = 0;
+    size_t n = 0;
+    int pen = x;
+    for (; n < MAX_CELLS && text[n] != L'\0'; ++n) {
+        wchar_t c = text[n];
+        int w = (c >= L'0' && c <= L'9') ? digit_width : tft.advance(c, fg, bg);
+        Cell& cell = cells[n];
+        // A cell with the same character at the same place already shows the right pixels
+        if (n >= count || cell.c != c || cell.x != pen || cell.w != w) {
+            tft.drawCell(pen, baseline, w, c, fg, bg);
+            cell.c = c;
+            cell.x = static_cast<int16_t>(pen);
+            cell.w = static_cast<int16_t>(w);
+            ++redrawn;
+        }
+        pen += w;
+    }
+
+    // Erase what the previous string covered beyond the end of this one
+    if (old_end > pen) {
+        tft.freshScreen(bg, pen, baseline - tft.ascent(), old_end - pen, tft.lineHeight());
+    }
+    count = n;
+    return redrawn;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file text_field.h
+ * @brief Retained line of text that redraws only the character cells that changed
+ * @details Between refreshes of the dashboard usually only one or two digits of a value change. A TextField remembers
+ *          the character and position of every cell it drew. set() lays out the new string and redraws only the cells
+ *          whose character or position differ, and it erases what is left over when the string got shorter.
+ *          Digits get cells of one common width, so a changed digit never moves the characters after it. The label
+ *          part of a line is therefore drawn once, and a typical update redraws one or two digit cells.
+ */
+
+#ifndef TEXT_FIELD_H
+#define TEXT_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include "tft_freetype.h"
+
+/**
+ * @class TextField
+ * @brief One line of text at a fixed position, drawn cell by cell into the display's framebuffer
+ */
+class TextField {
+public:
+    static const size_t MAX_CELLS = 32;  ///< Characters kept; longer strings are cut
+
+    /**
+     * @brief Constructor; nothing is drawn until the first set()
+     * @param display Display drawn on; outlives the field
+     * @param x Left edge
+     * @param baseline Baseline row
+     * @param fg Text colour (RGB565)
+     * @param bg Background colour (RGB565)
+     */
+    TextField(TFTFreetype& display, int x, int baseline, uint16_t fg, uint16_t bg = 0x0000);
+
+    /**
+     * @brief Show a new string
+     * @param text String to show
+     * @return Number of cells redrawn (0 if the text is unchanged)
+     */
+    size_t set(const wchar_t* text);
+
+    /**
+     * @brief Change the text colour; the next set() redraws every cell
+     */
+    void setColor(uint16_t color);
+
+    /**
+     * @brief Forget the characters drawn (e.g. after the area was painted over); the next set() redraws every cell
+     * and still erases what a shorter string leaves of the old extent
+     */
+    void invalidate();
+
+private:
+    struct Cell {
+        wchar_t c;   ///< Character shown
+        int16_t x;   ///< Left edge
+        int16_t w;   ///< Width
+    };
+
+    TFTFreetype& tft;        ///< Display drawn on
+    int x;                   ///< Left edge of the first cell
+    int baseline;            ///< Baseline row
+    uint16_t fg;             ///< Text colour
+    uint16_t bg;             ///< Background colour
+    int digit_width;         ///< Width of every digit cell (widest digit of the font)
+    Cell cells[MAX_CELLS];   ///< Cells as drawn
+    size_t count;            ///< Entries of cells in use
+};
+
+#endif // TEXT_FIELD_H
@@ -1,63 +1,52 @@
 #include "tft_freetype.h"
-#include <iostream>
-#include <cstdlib>
+#include "spidev_backend.h"
+#include "../common/metrics.h"
+#include "../common/trace.h"
 
 /**
  * @brief Constructor to initialize the TFT screen and related resources
- * Initialize GPIO, SPI communication, LCD display and FreeType font library, turn on the backlight and clear the screen
+ * Initialize GPIO, SPI communication, LCD display and the glyphs, turn on the backlight and clear the screen
  */
-TFTFreetype::TFTFreetype() {
-    gpioInit();
-    spiInit();
-    lcdInit();
-    freetypeInit("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 16);
-    gpiod_line_set_value(blk_line, 1);
-    usleep(50000);
+TFTFreetype::TFTFreetype()
+#ifdef WQM_BAKED_FONT
+    : TFTFreetype(new SpidevBackend(SPI_DEV, "gpiochip0"), DASHBOARD_FONT_PATH, DASHBOARD_FONT.size, &DASHBOARD_FONT) {
+#else
+    : TFTFreetype(new SpidevBackend(SPI_DEV, "gpiochip0"), DASHBOARD_FONT_PATH, 16) {
+#endif
+    // Clear the panel before the backlight comes on, so the power-up contents are never shown
     fillScreen(0x0000);
-    usleep(2000000);
+    flush();
+    panel->setPin(DisplayBackend::PIN_BLK, 1);
+}
+
+TFTFreetype::TFTFreetype(DisplayBackend *backend, const char *font_path, int font_size, const BakedFont *baked)
+    : panel(backend), shown_valid(false), pixels_sent(0), scroll_top(0), scroll_rows(0), scroll_row(0),
+      scroll_area_pending(false), scroll_row_pending(false), dc_level(-1) {
+    lcdInit();
+    glyphs.reset(new GlyphCache(font_path, font_size, baked));
 }
 
 /**
  * @brief Destructor, releases all resources
- * Release FreeType library resources, close SPI devices, release GPIO pins and chip resources
+ * Release the glyphs, then the backend (SPI device, GPIO pins and chip)
  */
 TFTFreetype::~TFTFreetype() {
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
-    close(spi_fd);
-    gpiod_line_release(rst_line);
-    gpiod_line_release(dc_line);
-    gpiod_line_release(blk_line);
-    gpiod_line_release(cs_line);
-    gpiod_chip_close(chip);
+    glyphs.reset();
 }
 
-/**
- * @brief Initialize GPIO resources
- * Open the GPIO chip, get the control pins (reset, data/command, backlight, chip select) and configure them as output mode
- */
-void TFTFreetype::gpioInit() {
-    chip = gpiod_chip_open_by_name(gpio_chip);
-    rst_line = gpiod_chip_get_line(chip, RST_PIN);
-    dc_line = gpiod_chip_get_line(chip, DC_PIN);
-    blk_line = gpiod_chip_get_line(chip, BLK_PIN);
-    cs_line = gpiod_chip_get_line(chip, CS_PIN);
+void TFTFreetype::select() {
+    panel->setPin(DisplayBackend::PIN_CS, 0);
+}
 
-    // Configured as output mode
-    gpiod_line_request_output(rst_line, "rst", 0);
-    gpiod_line_request_output(dc_line, "dc", 0);
-    gpiod_line_request_output(blk_line, "blk", 0);
-    gpiod_line_request_output(cs_line, "cs", 1); // SPI is disabled by default
+void TFTFreetype::deselect() {
+    panel->setPin(DisplayBackend::PIN_CS, 1);
 }
 
-/**
- * @brief Initialize SPI communication
- * Open the SPI device file and configure the SPI communication speed
- */
-void TFTFreetype::spiInit() {
-    spi_fd = open(SPI_DEV, O_RDWR);
-    // ioctl(spi_fd, SPI_IOC_WR_MODE, &spi_mode);
-    ioctl(spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed);
+void TFTFreetype::setDC(int level) {
+    if (level != dc_level) {
+        panel->setPin(DisplayBackend::PIN_DC, level);
+        dc_level = level;
+    }
 }
 
 /**
@@ -65,10 +54,8 @@ void TFTFreetype::spiInit() {
  * @param cmd Control command to send
  */
 void TFTFreetype::sendCommand(uint8_t cmd) {
-    gpiod_line_set_value(cs_line, 0);
-    gpiod_line_set_value(dc_line, 0);
-    write(spi_fd, &cmd, 1);
-    gpiod_line_set_value(cs_line, 1);
+    setDC(0);
+    panel->write(&cmd, 1);
 }
 
 /**
@@ -76,11 +63,9 @@ void TFTFreetype::sendCommand(uint8_t cmd) {
  * @param data Data buffer pointer
  * @param len Data length
  */
-void TFTFreetype::sendData(uint8_t *data, int len) {
-    gpiod_line_set_value(dc_line, 1);
-    gpiod_line_set_value(cs_line, 0);
-    write(spi_fd, data, len);
-    gpiod_line_set_value(cs_line, 1);
+void TFTFreetype::sendData(const uint8_t *data, int len) {
+    setDC(1);
+    panel->write(data, len);
 }
 
 /**
@@ -89,13 +74,14 @@ void TFTFreetype::sendData(uint8_t *data, int len) {
  */
 void TFTFreetype::lcdInit() {
     // Hardware Reset
-    gpiod_line_set_value(rst_line, 0);
-    usleep(100000);
-    gpiod_line_set_value(rst_line, 1);
-    usleep(120000);
+    panel->setPin(DisplayBackend::PIN_RST, 0);
+    panel->sleepUs(100000);
+    panel->setPin(DisplayBackend::PIN_RST, 1);
+    panel->sleepUs(120000);
 
+    select();
     sendCommand(0x11);  // Sleep out
-    usleep(500000);
+    panel->sleepUs(500000);
 
     sendCommand(0x36);  // MADCTL
     uint8_t madctl[] = {0xC8}; // RGB order adjustment
@@ -106,6 +92,7 @@ void TFTFreetype::lcdInit() {
     sendData(colmod, 1);
 
     sendCommand(0x29);  // Turn on display
+    deselect();
 }
 
 /**
@@ -130,22 +117,13 @@ void TFTFreetype::setWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
  * @param color Fill color (RGB565 format)
  */
 void TFTFreetype::fillScreen(uint16_t color) {
-    uint8_t color_hi = color >> 8;
-    uint8_t color_lo = color & 0xFF;
-    uint8_t buf[128];
-
-    setWindow(0, 0, 128, 160);
-    sendCommand(0x2C);
+    TRACE_SCOPE("TFTFreetype::fillScreen");
+    frame.fill(0, 0, FrameBuffer::WIDTH, FrameBuffer::HEIGHT, color);
+}
 
-    for (int i = 0; i < 128; i += 2) {
-        buf[i] = color_hi;
-        buf[i + 1] = color_lo;
-    }
-    for (int y = 0; y < 128; y++) {
-        for (int x = 0; x < 160 * 2; x += 128) {
-            sendData(buf, 128);
-        }
-    }
+void TFTFreetype::drawImage(int x, int y, int w, int h, const uint16_t *pixels) {
+    TRACE_SCOPE("TFTFreetype::drawImage");
+    frame.blit(x, y, w, h, pixels);
 }
 
 /**
@@ -157,62 +135,103 @@ void TFTFreetype::fillScreen(uint16_t color) {
  * @param h Area Height
  */
 void TFTFreetype::freshScreen(uint16_t color, int x, int y, int w, int h) {
-    uint8_t color_hi = color >> 8;
-    uint8_t color_lo = color & 0xFF;
-    uint8_t buf[128];
+    TRACE_SCOPE("TFTFreetype::freshScreen");
+    frame.fill(x, y, w, h, color);
+}
 
-    setWindow(x, y, w, h);
-    sendCommand(0x2C);
+/**
+ * @brief Send the pixels of the back buffer that differ from the front buffer to the panel
+ */
+void TFTFreetype::flush() {
+    TRACE_SCOPE("TFTFreetype::flush");
+    if (!shown_valid) {
+        // The panel's contents are unknown until it has been written once
+        frame.invalidate(0, 0, FrameBuffer::WIDTH, FrameBuffer::HEIGHT);
+    }
+    FrameBuffer::Rect rects[FrameBuffer::MAX_DIRTY];
+    size_t n = frame.takeDirty(rects);
+    for (size_t i = 0; i < n; ++i) {
+        const FrameBuffer::Rect& r = rects[i];
+        for (int row = r.y; row < r.y + r.h; ++row) {
+            const uint16_t *back = frame.row(r.x, row);
+            const uint16_t *front = shown.row(r.x, row);
+            int first = 0;
+            int last = r.w - 1;
+            if (shown_valid) {
+                while (first < r.w && back[first] == front[first]) {
+                    ++first;
+                }
+                if (first == r.w) {
+                    continue;
+                }
+                while (back[last] == front[last]) {
+                    --last;
+                }
+            }
+            // Copying the span marks it dirty in the front buffer, which merges the spans into rectangles
+            shown.blit(r.x + first, row, last - first + 1, 1, back + first);
+        }
+    }
+    shown_valid = true;
 
-    for (int i = 0; i < w; i += 2) {
-        buf[i] = color_hi;
-        buf[i + 1] = color_lo;
+    n = shown.takeDirty(rects);
+    if (n == 0 && !scroll_area_pending && !scroll_row_pending) {
+        return;
     }
-    for (int y = 0; y < w; y++) {
-        for (int x = 0; x < h * 2; x += w) {
-            sendData(buf, w);
+    select();
+    for (size_t i = 0; i < n; ++i) {
+        const FrameBuffer::Rect& r = rects[i];
+        setWindow(r.x, r.y, r.x + r.w - 1, r.y + r.h - 1);
+        sendCommand(0x2C);
+        setDC(1);
+        if (r.w == FrameBuffer::WIDTH) {
+            // Whole rows are contiguous in the framebuffer
+            panel->queue(reinterpret_cast<const uint8_t *>(shown.row(0, r.y)), r.w * r.h * 2);
+        } else {
+            for (int row = r.y; row < r.y + r.h; ++row) {
+                panel->queue(reinterpret_cast<const uint8_t *>(shown.row(r.x, row)), r.w * 2);
+            }
         }
+        panel->submit();
+        pixels_sent += static_cast<uint64_t>(r.w) * r.h;
     }
+    sendScroll();
+    deselect();
 }
 
-/**
- * @brief Initialize the FreeType font library
- * @param font_path Font file path
- * @param font_size Font size (pixels)
- */
-void TFTFreetype::freetypeInit(const char *font_path, int font_size) {
-    FT_Error error = FT_Init_FreeType(&library);
-    if (error) {
-        std::cerr << "FT_Init_FreeType error: " << error << std::endl;
-        std::exit(1);
-    }
+// The controller has 162 lines of frame memory, and MADCTL MY (see lcdInit) mirrors the rows: row y is line 161 - y.
+// The scroll commands count lines of the frame memory, so the band's edges and its direction are mirrored as well.
 
-    error = FT_New_Face(library, font_path, 0, &face);
-    if (error) {
-        std::cerr << "FT_New_Face error: " << error << std::endl;
-        std::exit(1);
-    }
+void TFTFreetype::setScrollArea(int top, int rows) {
+    scroll_top = top;
+    scroll_rows = rows;
+    scroll_area_pending = true;
+    setScrollRow(top + rows - 1);  // Unscrolled
+}
 
-    error = FT_Set_Pixel_Sizes(face, 0, font_size);
-    if (error) {
-        std::cerr << "FT_Set_Pixel_Sizes error: " << error << std::endl;
-        std::exit(1);
-    }
+void TFTFreetype::setScrollRow(int row) {
+    scroll_row = row;
+    scroll_row_pending = true;
 }
 
-/**
- * @brief Loads the glyph data for the specified character
- * @param c character to load (wide character)
- */
-void TFTFreetype::loadGlyph(wchar_t c) {
-    FT_UInt glyph_index = FT_Get_Char_Index(face, c);
-    if (glyph_index == 0) {
-        std::cerr << "FT_Get_Char_Index error: character not found" << std::endl;
-        std::exit(1);
+void TFTFreetype::sendScroll() {
+    if (scroll_area_pending) {
+        int tfa = DisplayBackend::FRAME_MEMORY_LINES - scroll_top - scroll_rows;  // Below the band on screen
+        uint8_t vscrdef[] = {static_cast<uint8_t>(tfa >> 8), static_cast<uint8_t>(tfa & 0xFF),
+                             static_cast<uint8_t>(scroll_rows >> 8), static_cast<uint8_t>(scroll_rows & 0xFF),
+                             static_cast<uint8_t>(scroll_top >> 8), static_cast<uint8_t>(scroll_top & 0xFF)};
+        sendCommand(0x33);  // VSCRDEF: top fixed, scroll and bottom fixed lines
+        sendData(vscrdef, 6);
+        scroll_area_pending = false;
+    }
+    if (scroll_row_pending) {
+        // The line at the start of the band in memory order is the bottom edge on screen
+        int ssa = DisplayBackend::FRAME_MEMORY_LINES - 1 - scroll_row;
+        uint8_t vscsad[] = {static_cast<uint8_t>(ssa >> 8), static_cast<uint8_t>(ssa & 0xFF)};
+        sendCommand(0x37);  // VSCSAD: first line of the scroll area
+        sendData(vscsad, 2);
+        scroll_row_pending = false;
     }
-
-    FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER);
-    glyph_slot = face->glyph;
 }
 
 /**
@@ -221,29 +240,18 @@ void TFTFreetype::loadGlyph(wchar_t c) {
  * @param y Draw the starting point y coordinate
  * @param c The character to be drawn (wide character)
  * @param fg Character foreground color (RGB565 format)
+ * @param bg Background color (RGB565 format)
+ * @return The glyph drawn
  */
-void TFTFreetype::drawChar(uint8_t x, uint8_t y, wchar_t c, uint16_t fg) {
-    loadGlyph(c);
-
-    int bitmap_left = glyph_slot->bitmap_left;
-    int bitmap_top = glyph_slot->bitmap_top;
-    int bitmap_width = glyph_slot->bitmap.width;
-    int bitmap_rows = glyph_slot->bitmap.rows;
-
-    setWindow(x + bitmap_left, y - bitmap_top, x + bitmap_left + bitmap_width - 1, y - bitmap_top + bitmap_rows - 1);
-    sendCommand(0x2C);
-
-    uint8_t *bitmap_data = glyph_slot->bitmap.buffer;
-    for (int row = 0; row < bitmap_rows; row++) {
-        for (int col = 0; col < bitmap_width; col++) {
-            uint8_t pixel = bitmap_data[row * bitmap_width + col];
-            uint16_t color = (pixel > 0) ? fg : 0x0000;
-            uint8_t color_hi = color >> 8;
-            uint8_t color_lo = color & 0xFF;
-            sendData(&color_hi, 1);
-            sendData(&color_lo, 1);
-        }
+const GlyphCache::Glyph& TFTFreetype::drawChar(uint8_t x, uint8_t y, wchar_t c, uint16_t fg, uint16_t bg) {
+    TRACE_SCOPE("TFTFreetype::drawChar");
+    const GlyphCache::Glyph& g = glyphs->get(c, fg, bg);
+    if (g.width == 0 || g.rows == 0) {
+        return g;  // Blank glyph (space): only the advance matters
     }
+
+    frame.blit(x + g.left, y - g.top, g.width, g.rows, glyphs->pixels(g));
+    return g;
 }
 
 /**
@@ -254,13 +262,43 @@ void TFTFreetype::drawChar(uint8_t x, uint8_t y, wchar_t c, uint16_t fg) {
  * @param fg String foreground color (RGB565 format)
  * @note Contains automatic line wrapping processing, wrapping when exceeding the screen width
  */
-void TFTFreetype::drawString(uint8_t x, uint8_t y, const wchar_t *str, uint16_t fg) {
+void TFTFreetype::drawString(uint8_t x, uint8_t y, const wchar_t *str, uint16_t fg, uint16_t bg) {
+    TRACE_SCOPE("TFTFreetype::drawString");
     while (*str) {
-        drawChar(x, y, *str++, fg);
-        x += glyph_slot->advance.x >> 6; // 6 bits per pixel
+        x += drawChar(x, y, *str++, fg, bg).advance;
         if (x >= 160 - 8) { // Line break processing
             x = 0;
-            y += glyph_slot->advance.y >> 6;
+            y += lineHeight();
         }
     }
 }
+
+void TFTFreetype::drawCell(int x, int baseline, int width, wchar_t c, uint16_t fg, uint16_t bg) {
+    TRACE_SCOPE("TFTFreetype::drawCell");
+    int top = baseline - ascent();
+    int height = lineHeight();
+    frame.fill(x, top, width, height, bg);
+    const GlyphCache::Glyph& g = glyphs->get(c, fg, bg);
+    if (g.width == 0 || g.rows == 0) {
+        return;
+    }
+
+    // Glyph box, cut to the cell
+    int gx = x + (width - g.advance) / 2 + g.left;
+    int gy = baseline - g.top;
+    int x0 = gx > x ? gx : x;
+    int y0 = gy > top ? gy : top;
+    int x1 = gx + g.width < x + width ? gx + g.width : x + width;
+    int y1 = gy + g.rows < top + height ? gy + g.rows : top + height;
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    const uint16_t *src = glyphs->pixels(g) + (y0 - gy) * g.width + (x0 - gx);
+    frame.blit(x0, y0, x1 - x0, y1 - y0, src, g.width);
+}
+
+void TFTFreetype::preload(const wchar_t *chars, uint16_t fg, uint16_t bg) {
+    while (*chars) {
+        glyphs->get(*chars++, fg, bg);
+    }
+}
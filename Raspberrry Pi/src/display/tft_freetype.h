@@ -3,36 +3,116 @@
 
 #include "../common/com.h"
 #include "../common/constants.h"
+#include "display_backend.h"
+#include "framebuffer.h"
+#include "glyph_cache.h"
+#include <memory>
 
 
 /**
  * @brief TFT display driver class (integrated FreeType font rendering function)
  * Responsible for hardware initialization, graphics drawing and text rendering of TFT screen, based on SPI communication and GPIO control
  * Supports Unicode character display, suitable for embedded scenarios that require high-quality text rendering
+ * Drawing goes into an off-screen framebuffer (the back buffer); flush() compares it with a copy of what the panel
+ * shows (the front buffer) and sends only the pixels that differ
+ * The chip is selected once per flush, and the data/command pin only changes between a command and its data
+ * The panel is reached through a DisplayBackend: spidev and gpiod on the Pi, or an in-memory panel elsewhere
  */
 class TFTFreetype {
 public:
     /**
      * @brief Constructor
-     * Initialize GPIO, SPI, LCD display and FreeType font engine
+     * Initialize GPIO, SPI, LCD display and the glyphs (baked into the binary when built with BAKE_FONT, so
+     * FreeType and the font file are only loaded for characters outside the baked set)
      * Turn on the screen backlight and initialize the display status
      */
     TFTFreetype();
 
+    /**
+     * @brief Constructor on a given backend (e.g. a HeadlessBackend for tests and benchmarks)
+     * The panel is reset and initialised, but neither cleared nor lit
+     * @param backend Connection to the panel; owned by the display
+     * @param font_path Font file path
+     * @param font_size Font size (pixels)
+     * @param baked Glyphs compiled into the binary, used before the font file; nullptr for FreeType only
+     */
+    TFTFreetype(DisplayBackend *backend, const char *font_path, int font_size, const BakedFont *baked = nullptr);
+
     /**
      * @brief Destructor
-     * Release FreeType resources, close SPI devices and GPIO pins, and clean up hardware resources
+     * Release the glyphs and the backend
      */
     ~TFTFreetype();
 
+    /**
+     * @brief Send the pixels changed since the last flush to the panel
+     * Within the areas drawn, each row is narrowed to the span that differs from the front buffer. The spans are
+     * merged into rectangles; each costs one window command, and its rows are queued straight from the front
+     * buffer and sent in as few SPI messages as the driver's buffer allows. Redrawing identical content sends nothing.
+     */
+    void flush();
+
+    /**
+     * @brief Make a band of rows scroll in hardware (VSCRDEF); the rows above and below stay fixed
+     * Sent with the next flush. The band starts unscrolled.
+     * @param top First row of the band
+     * @param rows Rows of the band
+     */
+    void setScrollArea(int top, int rows);
+
+    /**
+     * @brief Scroll the band so that a row is shown at its bottom edge, the rows before it (wrapping) above it (VSCSAD)
+     * Sent with the next flush, after the pixels, so a row drawn in the same frame appears already complete
+     * @param row Row of the band
+     */
+    void setScrollRow(int row);
+
     /**
      * @brief Draw a wide string at the specified position (Unicode supported)
      * @param x Draw the starting X coordinate (upper left corner)
      * @param y Draw the starting Y coordinate (upper left corner)
      * @param str The wide string to be drawn (wchar_t type, supports Chinese, English, etc.)
      * @param fg Text foreground color (16-bit RGB565 format)
+     * @param bg Background the glyph edges are blended with (16-bit RGB565 format)
+     */
+    void drawString(uint8_t x, uint8_t y, const wchar_t *str, uint16_t fg, uint16_t bg = 0x0000);
+
+    /**
+     * @brief Draw one character in a cell, erasing what the cell showed before
+     * The cell spans the font's line height around the baseline; glyph parts outside it are cut off, so
+     * neighbouring cells can be redrawn independently
+     * @param x Left edge of the cell
+     * @param baseline Baseline row
+     * @param width Cell width; the glyph is centred in it
+     * @param c Character (a space only clears the cell)
+     * @param fg Text foreground color (16-bit RGB565 format)
+     * @param bg Cell background color (16-bit RGB565 format)
      */
-    void drawString(uint8_t x, uint8_t y, const wchar_t *str, uint16_t fg);
+    void drawCell(int x, int baseline, int width, wchar_t c, uint16_t fg, uint16_t bg);
+
+    /**
+     * @brief Horizontal advance of a character (pixels), rendering it if needed
+     */
+    int advance(wchar_t c, uint16_t fg, uint16_t bg) { return glyphs->get(c, fg, bg).advance; }
+
+    int ascent() const { return glyphs->ascent(); }          ///< Rows above the baseline
+    int lineHeight() const { return glyphs->lineHeight(); }  ///< Rows from one baseline to the next
+
+    /**
+     * @brief Render glyphs into the cache ahead of time, so that drawing them later needs no FreeType call
+     * @param chars Characters to render
+     * @param fg Text foreground color (16-bit RGB565 format)
+     * @param bg Background color (16-bit RGB565 format)
+     */
+    void preload(const wchar_t *chars, uint16_t fg, uint16_t bg = 0x0000);
+
+    const GlyphCache& glyphCache() const { return *glyphs; }  ///< Rendered glyphs and their statistics
+
+    const FrameBuffer& frameBuffer() const { return frame; }  ///< Back buffer, drawn into
+
+    uint64_t pixelsSent() const { return pixels_sent; }  ///< Pixels sent by flush() so far
+
+    const DisplayBackend& backend() const { return *panel; }  ///< Connection to the panel
 
     /**
      * @brief Fill the entire screen with the specified color
@@ -40,6 +120,12 @@ public:
      */
     void fillScreen(uint16_t color);
 
+    /**
+     * @brief Copy a block of pixels to the screen, e.g. an area saved earlier from frameBuffer()
+     * @param pixels w * h pixels, row by row, in the framebuffer's byte order (high byte first)
+     */
+    void drawImage(int x, int y, int w, int h, const uint16_t *pixels);
+
     /**
      * @brief Refresh the specified area to the specified color
      * @param color Fill color (16-bit RGB565 format)
@@ -51,43 +137,47 @@ public:
     void freshScreen(uint16_t color, int x, int y, int w, int h);
 
 private:
-    int spi_fd;                      ///< SPI device file descriptor
-    uint8_t spi_mode;                ///< SPI communication mode (default is SPI_MODE_3)
-    uint32_t spi_speed;              ///< SPI communication rate (default is 6MHz)
-    const char *gpio_chip;           ///< GPIO chip path (default is "gpiochip0")
-    FT_Library library;              ///< FreeType font library example
-    FT_Face face;                    ///< FreeType font face object (font instance)
-    FT_GlyphSlot glyph_slot;         ///< FreeType Current glyph slot (stores the glyph information currently being rendered)
-    struct gpiod_chip *chip;         ///< GPIO Chip handle
-    struct gpiod_line *rst_line;     ///< Screen reset pin handle
-    struct gpiod_line *dc_line;      ///< Data/command switching pin handle
-    struct gpiod_line *blk_line;     ///< Backlight control pin handle
-    struct gpiod_line *cs_line;      ///< SPI chip select pin handle
+    std::unique_ptr<DisplayBackend> panel;  ///< Pins and SPI bytes of the panel
+    std::unique_ptr<GlyphCache> glyphs;  ///< Glyphs rendered so far, as RGB565 pixels ready for the panel
+    FrameBuffer frame;               ///< Back buffer: what the panel shows once flushed
+    FrameBuffer shown;               ///< Front buffer: what the panel shows now
+    bool shown_valid;                ///< The front buffer matches the panel (false until the first flush)
+    uint64_t pixels_sent;            ///< Pixels sent by flush()
+    int scroll_top;                  ///< First row of the hardware scroll band
+    int scroll_rows;                 ///< Rows of the band (0: no scrolling)
+    int scroll_row;                  ///< Row shown at the bottom edge of the band
+    bool scroll_area_pending;        ///< VSCRDEF to send with the next flush
+    bool scroll_row_pending;         ///< VSCSAD to send with the next flush
+    int dc_level;                    ///< Last level driven on the data/command pin (-1 before the first)
+
+    /**
+     * @brief Select the panel (chip select low) for a sequence of commands
+     */
+    void select();
 
     /**
-     * @brief Initialize GPIO control pins
-     * Open the GPIO chip, obtain the reset, data/command, backlight, and SPI chip select pins and configure them as output mode
+     * @brief End the sequence (chip select high)
      */
-    void gpioInit();
+    void deselect();
 
     /**
-     * @brief Initialize the SPI communication interface
-     * Open the SPI device file and configure the communication mode and rate
+     * @brief Drive the data/command pin, unless it is already at that level
+     * @param level 0 for a command, 1 for data
      */
-    void spiInit();
+    void setDC(int level);
 
     /**
-     * @brief Sending commands to the LCD
+     * @brief Sending commands to the LCD; the panel must be selected
      * @param cmd Command byte to be sent
      */
     void sendCommand(uint8_t cmd);
 
     /**
-     * @brief Sending data to LCD
+     * @brief Sending data to LCD; the panel must be selected
      * @param data Buffer of data to be sent
      * @param len Data length (bytes)
      */
-    void sendData(uint8_t *data, int len);
+    void sendData(const uint8_t *data, int len);
 
     /**
      * @brief Initialize LCD display hardware
@@ -105,10 +195,9 @@ private:
     void setWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
 
     /**
-     * @brief Load the glyph data of the specified character (FreeType internal operation)
-     * @param c wide character to load
+     * @brief Send the pending scroll commands; the panel must be selected
      */
-    void loadGlyph(wchar_t c);
+    void sendScroll();
 
     /**
      * @brief Draws a single wide character at the specified position
@@ -116,15 +205,10 @@ private:
      * @param y Draw the starting Y coordinate
      * @param c The wide character to be drawn
      * @param fg Character foreground color (16-bit RGB565 format)
+     * @param bg Background color (16-bit RGB565 format)
+     * @return The glyph drawn, for its advance
      */
-    void drawChar(uint8_t x, uint8_t y, wchar_t c, uint16_t fg);
-
-    /**
-     * @brief Initialize the FreeType font engine
-     * @param font_path Font file path (such as ttf font file)
-     * @param font_size Font size (pixels)
-     */
-    void freetypeInit(const char *font_path, int font_size);
+    const GlyphCache::Glyph& drawChar(uint8_t x, uint8_t y, wchar_t c, uint16_t fg, uint16_t bg);
 };
 
 #endif
@@ -1,7 +1,18 @@
 #include "event_loop.h"
 #include <iostream>
 #include <cstring>
+#include <time.h>    // Provides clock_gettime() for the handler statistics
 #include <unistd.h>  // Provides the close() function to close file descriptors
+#include "../common/trace.h"
+
+const uint64_t EventLoop::BUCKET_BOUNDS_NS[EventLoop::LATENCY_BUCKETS] = {
+    100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL};
+
+static uint64_t monotonicNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
 
 /**
  * @brief Event loop constructor, initialise epoll instance
@@ -9,6 +20,8 @@
  * @throws If epoll_create1 fails, output an error message and terminate the program
  */
 EventLoop::EventLoop(std::atomic<bool>& run) : running(run) {
+    deferred_stats = HandlerStats();
+    deferred_stats.name = "deferred";
     // Create an epoll instance (use epoll_create1(0) to automatically select the best mode)
     epoll_fd = epoll_create1(0);
     if (epoll_fd == -1) {
@@ -23,6 +36,15 @@ EventLoop::EventLoop(std::atomic<bool>& run) : running(run) {
  */
 EventLoop::~EventLoop() {
     close(epoll_fd);  // Close the epoll file descriptor
+    for (Entry* e : entries) {
+        delete e;  // Release the handlers still registered
+    }
+    for (Entry* e : retired) {
+        delete e;
+    }
+    for (Entry* e : spare) {
+        delete e;
+    }
 }
 
 /**
@@ -33,16 +55,89 @@ EventLoop::~EventLoop() {
  * @note When using edge-triggered mode (EPOLLET), ensure that the processing function reads/writes completely
  */
 void EventLoop::add_fd(int fd, std::function<void()> handler) {
+    // Set up a read event listener and use edge trigger mode
+    attach(fd, EPOLLIN | EPOLLET)->plain = std::move(handler);
+}
+
+/**
+ * @brief Add file descriptors with an explicit event mask
+ * @param fd File descriptors to be monitored
+ * @param events epoll event mask
+ * @param handler Callback receiving the triggered events
+ * @throws If epoll_ctl fails, output an error message and terminate the program
+ */
+void EventLoop::add_fd(int fd, uint32_t events, Handler handler) {
+    attach(fd, events)->handler = std::move(handler);
+}
+
+// Register a descriptor with an empty entry; the caller moves its handler in
+EventLoop::Entry* EventLoop::attach(int fd, uint32_t events) {
+    // Reuse a recycled entry when one is available
+    Entry* e;
+    if (!spare.empty()) {
+        e = spare.back();
+        spare.pop_back();
+    } else {
+        e = new Entry();
+    }
+    e->stats = HandlerStats();
+
     epoll_event ev;
-    ev.events = EPOLLIN | EPOLLET;  // Set up a read event listener and use edge trigger mode
-    // Store the processing function pointer in ev.data.ptr（Dynamic memory allocation required）
-    ev.data.ptr = new std::function<void()>(handler);
+    ev.events = events;
+    // Store the entry pointer in ev.data.ptr
+    ev.data.ptr = e;
 
     // Add file descriptors to the epoll instance
     if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
         perror("epoll_ctl: add");  // Output failed addition information
         std::exit(EXIT_FAILURE);   // Abnormal program termination
     }
+    if (static_cast<size_t>(fd) >= entries.size()) {
+        entries.resize(fd + 1, nullptr);
+    }
+    entries[fd] = e;
+    return e;
+}
+
+/**
+ * @brief Remove a file descriptor from the event loop
+ * @param fd File descriptor to stop monitoring
+ * @note The handler is only recycled after the current batch, since later events of the batch may still point to it
+ */
+void EventLoop::remove_fd(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= entries.size() || entries[fd] == nullptr) {
+        return;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    retired.push_back(entries[fd]);
+    entries[fd] = nullptr;
+}
+
+/**
+ * @brief Queue a task to run after the current batch of events
+ * @param task Task to run once on the loop thread
+ */
+void EventLoop::post(std::function<void()> task) {
+    deferred.push_back(std::move(task));
+}
+
+void EventLoop::set_name(int fd, const char* name) {
+    if (fd >= 0 && static_cast<size_t>(fd) < entries.size() && entries[fd] != nullptr) {
+        entries[fd]->stats.name = name;
+    }
+}
+
+void EventLoop::record(HandlerStats& stats, uint64_t ns) {
+    stats.calls++;
+    stats.total_ns += ns;
+    if (ns > stats.max_ns) {
+        stats.max_ns = ns;
+    }
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        if (ns <= BUCKET_BOUNDS_NS[i]) {
+            stats.buckets[i]++;
+        }
+    }
 }
 
 /**
@@ -52,8 +147,8 @@ void EventLoop::add_fd(int fd, std::function<void()> handler) {
  */
 void EventLoop::run() {
     while (running) {  // Atomic variable control loop start/stop (thread-safe)
-        // Waiting for an event to occur（-1 indicates infinite blocking until an event is triggered）
-        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        // Waiting for an event to occur（-1 indicates infinite blocking until an event is triggered, 0 when tasks are pending）
+        int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, deferred.empty() ? -1 : 0);
         if (nfds == -1) {
             if (errno == EINTR)  // Handling signal interruptions
                 continue;        // Ignore interrupts and continue waiting for events
@@ -63,11 +158,48 @@ void EventLoop::run() {
 
         // Iterate through all triggered events
         for (int i = 0; i < nfds; ++i) {
-            if (events[i].events & EPOLLIN) {  // Check whether it is a read event
-                // From data.ptrObtain the processing function pointer and call it
-                auto handler = static_cast<std::function<void()>*>(events[i].data.ptr);
-                (*handler)();  // Execute event handling function
+            // From data.ptr Obtain the entry and call its handler
+            Entry* e = static_cast<Entry*>(events[i].data.ptr);
+            bool removed = false;
+            for (Entry* r : retired) {  // Skip handlers removed earlier in this batch
+                if (r == e) {
+                    removed = true;
+                    break;
+                }
             }
+            if (!removed) {
+                uint64_t start = monotonicNanos();
+                if (e->plain) {
+                    if (events[i].events & EPOLLIN) {  // Only read events are of interest to plain handlers
+                        e->plain();
+                    }
+                } else {
+                    e->handler(events[i].events);  // Execute event handling function
+                }
+                uint64_t end = monotonicNanos();
+                record(e->stats, end - start);
+                TRACE_COMPLETE(e->stats.name != nullptr ? e->stats.name : "fd", start, end);
+            }
+        }
+
+        // Run the tasks queued so far; tasks posted while running wait for the next iteration
+        if (!deferred.empty()) {
+            running_tasks.swap(deferred);
+            for (auto& task : running_tasks) {
+                uint64_t start = monotonicNanos();
+                task();
+                uint64_t end = monotonicNanos();
+                record(deferred_stats, end - start);
+                TRACE_COMPLETE("deferred", start, end);
+            }
+            running_tasks.clear();
+        }
+
+        for (Entry* e : retired) {
+            e->handler = nullptr;  // Release captured state now, keep the entry for reuse
+            e->plain = nullptr;
+            spare.push_back(e);
         }
+        retired.clear();
     }
 }
@@ -10,6 +10,8 @@
 #include <functional>   // Used for std::function (event handling callback)
 #include <sys/epoll.h>  // Used for epoll-related system calls (epoll_create, epoll_ctl, epoll_wait, etc.)
 #include <atomic>       // Used for std::atomic<bool> (thread-safe loop state control)
+#include <cstdint>      // Used for uint32_t event masks
+#include <vector>       // Used for deferred tasks and retired handlers
 
 /**
  * @class EventLoop
@@ -19,12 +21,49 @@
  * And automatically call the registered callback function to handle events. Supports dynamically stopping the loop through atomic variables.
  */
 class EventLoop {
+public:
+    typedef std::function<void(uint32_t)> Handler;  ///< Event callback, receives the triggered epoll event mask
+
+    static const int LATENCY_BUCKETS = 5;           ///< Number of finite latency histogram buckets
+    static const uint64_t BUCKET_BOUNDS_NS[LATENCY_BUCKETS];  ///< Upper bounds: 100 us, 1 ms, 10 ms, 100 ms, 1 s
+
+    /**
+     * @brief Run-time statistics of one handler (or of the deferred tasks)
+     */
+    struct HandlerStats {
+        const char* name;                   ///< Label given with set_name() (null if unnamed)
+        uint64_t calls;                     ///< Number of invocations
+        uint64_t total_ns;                  ///< Summed run time
+        uint64_t max_ns;                    ///< Longest single run time
+        uint64_t buckets[LATENCY_BUCKETS];  ///< Invocations not longer than each bound (cumulative)
+    };
+
 private:
+    /**
+     * @brief Registered handler with its statistics; recycled through a free list so that adding and removing
+     *        descriptors in steady state does not allocate
+     */
+    struct Entry {
+        Handler handler;              ///< Callback receiving the event mask (empty for plain handlers)
+        std::function<void()> plain;  ///< Plain callback, run on EPOLLIN (stored as given, not wrapped)
+        HandlerStats stats;           ///< Run-time statistics
+    };
+
     int epoll_fd;  ///< The file descriptor of the epoll instance, created via epoll_create
     static const int MAX_EVENTS = 10;  ///< Maximum number of events processed by a single epoll_wait
     epoll_event events[MAX_EVENTS];    ///< Store the event list returned by epoll_wait
     std::atomic<bool>& running;  ///< Atomic Boolean reference, controls whether the event loop runs (thread-safe)
 
+    std::vector<Entry*> entries;                    ///< Registered handlers indexed by file descriptor (owned)
+    std::vector<Entry*> retired;                    ///< Handlers removed during dispatch, recycled after the batch
+    std::vector<Entry*> spare;                      ///< Recycled handlers ready for reuse
+    std::vector<std::function<void()>> deferred;    ///< Tasks queued with post(), run after the current batch
+    std::vector<std::function<void()>> running_tasks;  ///< Tasks being run (kept to reuse its capacity)
+    HandlerStats deferred_stats;                    ///< Statistics of the deferred tasks
+
+    Entry* attach(int fd, uint32_t events);
+    static void record(HandlerStats& stats, uint64_t ns);
+
 public:
     /**
      * @brief Constructor, initialise the epoll instance and bind the loop control variable
@@ -46,6 +85,50 @@ public:
      */
     void add_fd(int fd, std::function<void()> handler);
 
+    /**
+     * @brief Add a file descriptor with an explicit event mask
+     * @param fd File descriptor to be monitored
+     * @param events epoll event mask (e.g. EPOLLIN | EPOLLOUT | EPOLLET)
+     * @param handler Callback receiving the triggered event mask (including EPOLLHUP/EPOLLERR)
+     */
+    void add_fd(int fd, uint32_t events, Handler handler);
+
+    /**
+     * @brief Stop monitoring a file descriptor and release its handler
+     * @param fd File descriptor previously passed to add_fd (the descriptor itself is not closed)
+     * @note Safe to call from inside a handler, including the handler being removed
+     */
+    void remove_fd(int fd);
+
+    /**
+     * @brief Queue a task to run on the loop thread after the current batch of events
+     * @param task Task to run once
+     * @note Used to split long jobs (e.g. bulk transfers) into slices so that timer events are never delayed;
+     *       epoll_wait does not block while tasks are pending.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Label a registered descriptor for the handler statistics
+     * @param fd Registered file descriptor
+     * @param name Static string (e.g. "data_timer"), not copied
+     */
+    void set_name(int fd, const char* name);
+
+    /**
+     * @brief Visit the statistics of every named handler and of the deferred tasks ("deferred")
+     * @param visit Called once per handler; unnamed handlers are skipped
+     */
+    template <typename Visitor>
+    void visit_stats(Visitor visit) const {
+        for (const Entry* e : entries) {
+            if (e != nullptr && e->stats.name != nullptr) {
+                visit(e->stats);
+            }
+        }
+        visit(deferred_stats);
+    }
+
     /**
      * @brief Start the event loop, continuously wait for and process events
      * @note Loop logic: Block and wait for events using epoll_wait, iterate through the triggered events, and call the corresponding callback functions,
@@ -0,0 +1,59 @@
+// deadband_filter.cpp
+#include "deadband_filter.h"
+#include <cmath>
+#include <cstring>
+#include "../common/sample.h"
+
+DeadbandFilter::DeadbandFilter(InfoUpdater* target, float tur_deadband, float tmp_deadband, float ph_deadband,
+                               uint32_t heartbeat_ms)
+    : target(target), last_forward_us(0), heartbeat_us(static_cast<int64_t>(heartbeat_ms) * 1000), primed(false) {
+    deadband[TURBIDITY] = tur_deadband;
+    deadband[TEMPERATURE] = tmp_deadband;
+    deadband[PH] = ph_deadband;
+    std::memset(last, 0, sizeof(last));
+    std::memset(&counters, 0, sizeof(counters));
+}
+
+void DeadbandFilter::update() {
+    const WaterQuality& wq = WaterQuality::getInstance();
+    float now_values[CHANNELS] = {wq.getTurbidity(), wq.getDS18B20(), wq.getpH()};
+    int64_t now = monotonicMicros();
+
+    bool changed[CHANNELS] = {false, false, false};
+    bool any = !primed;
+    for (int i = 0; i < CHANNELS; ++i) {
+        // A NaN reading compares false against everything, so treat a transition to or from NaN as a change.
+        // A channel without a deadband never triggers on its own: its value goes out with the other channels
+        if (std::isnan(now_values[i]) != std::isnan(last[i]) ||
+            (deadband[i] > 0 && std::fabs(now_values[i] - last[i]) >= deadband[i])) {
+            changed[i] = true;
+            any = true;
+        }
+    }
+    bool heartbeat = heartbeat_us > 0 && now - last_forward_us >= heartbeat_us;
+
+    if (!any && !heartbeat) {
+        counters.suppressed++;
+        return;
+    }
+
+    if (any) {
+        for (int i = 0; i < CHANNELS; ++i) {
+            if (changed[i] && primed) {
+                counters.triggered[i]++;
+            }
+        }
+    } else {
+        counters.heartbeats++;
+    }
+    counters.forwarded++;
+    std::memcpy(last, now_values, sizeof(last));
+    last_forward_us = now;
+    primed = true;
+    target->update();
+}
+
+double DeadbandFilter::suppressionRatio() const {
+    uint64_t total = counters.forwarded + counters.suppressed;
+    return total == 0 ? 0.0 : 100.0 * static_cast<double>(counters.suppressed) / static_cast<double>(total);
+}
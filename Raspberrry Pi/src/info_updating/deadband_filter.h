@@ -0,0 +1,81 @@
+/**
+ * @file deadband_filter.h
+ * @brief Report-by-exception filter placed in front of an information updater
+ * @details Wraps another InfoUpdater (network transmission, TFT display) and only lets an update through when one
+ *          of the water quality values has moved past its deadband since the last forwarded update, or when the
+ *          heartbeat interval has passed without any update. The reference is the last forwarded value, not the
+ *          last measured one, so slow drift is still reported once it adds up and noise around a threshold does not
+ *          toggle the output (hysteresis). A channel with a deadband of 0 never triggers an update by itself (only
+ *          its change to or from NaN does); its value is sent along when another channel or the heartbeat triggers
+ *          one. Suppressed samples remain in the on-device history.
+ */
+
+#ifndef DEADBAND_FILTER_H
+#define DEADBAND_FILTER_H
+
+#include <cstdint>
+#include "../common/water_quality.h"    // Water quality data single instance class, source of the compared values
+#include "info_updater.h"               // Information updater base class, defining a unified update interface
+
+/**
+ * @class DeadbandFilter
+ * @brief Forwards update() to the wrapped updater only on significant change or heartbeat expiry
+ */
+class DeadbandFilter : public InfoUpdater {
+public:
+    /**
+     * @brief Index of a filtered channel
+     */
+    enum Channel {
+        TURBIDITY,
+        TEMPERATURE,
+        PH,
+        CHANNELS
+    };
+
+    /**
+     * @brief Suppression statistics since construction
+     */
+    struct Stats {
+        uint64_t forwarded;              ///< Updates passed to the wrapped updater
+        uint64_t suppressed;             ///< Updates dropped because every value stayed inside its deadband
+        uint64_t heartbeats;             ///< Forwarded updates caused only by the heartbeat
+        uint64_t triggered[CHANNELS];    ///< Forwarded updates in which each channel left its deadband
+    };
+
+    /**
+     * @brief Constructor
+     * @param target Updater to forward to (not owned)
+     * @param tur_deadband Turbidity change needed to forward (0 or less: never on its own)
+     * @param tmp_deadband Temperature change needed to forward, in degrees Celsius (0 or less: never on its own)
+     * @param ph_deadband pH change needed to forward (0 or less: never on its own)
+     * @param heartbeat_ms Longest silence before an update is forwarded anyway (0 disables the heartbeat)
+     */
+    DeadbandFilter(InfoUpdater* target, float tur_deadband, float tmp_deadband, float ph_deadband, uint32_t heartbeat_ms);
+
+    /**
+     * @brief Compare the current values with the last forwarded ones and forward if needed
+     */
+    void update() override;
+
+    /**
+     * @brief Suppression statistics
+     */
+    const Stats& stats() const { return counters; }
+
+    /**
+     * @brief Percentage of updates that were suppressed
+     */
+    double suppressionRatio() const;
+
+private:
+    InfoUpdater* target;            ///< Wrapped updater
+    float deadband[CHANNELS];       ///< Threshold per channel
+    float last[CHANNELS];           ///< Values at the last forwarded update
+    int64_t last_forward_us;        ///< CLOCK_MONOTONIC time of the last forwarded update
+    int64_t heartbeat_us;           ///< Heartbeat interval (0 = none)
+    bool primed;                    ///< Whether anything has been forwarded yet
+    Stats counters;                 ///< Suppression statistics
+};
+
+#endif // DEADBAND_FILTER_H
@@ -1,18 +1,82 @@
 // socket_info_updater.cpp
 #include "socket_info_updater.h"
-#include <cstdio>
-#include <iostream>
-#include <sys/socket.h>
+#include "../common/sample.h"
+#include "../common/trace.h"
+#include "../common/logger.h"
 
-SocketInfoUpdater::SocketInfoUpdater(int s) : sock(s) {}
+SocketInfoUpdater::SocketInfoUpdater(EventLoop& loop, const std::vector<Target>& targets, SampleLog* history,
+                                     size_t queue_depth, uint32_t keyframe_interval)
+    : jsonEncoder(StreamEncoder::JSON, keyframe_interval), gorillaEncoder(StreamEncoder::GORILLA, keyframe_interval),
+      // Every endpoint can hold queue_depth distinct messages, plus one being encoded per encoding
+      pool(targets.size() * queue_depth + 2) {
+    for (const Target& t : targets) {
+        endpoints.push_back(std::unique_ptr<UpstreamEndpoint>(
+            new UpstreamEndpoint(loop, t.addr, t.encoding, queue_depth, history)));
+    }
+}
 
 void SocketInfoUpdater::update() {
-    char buf[128] = {0};
-    std::sprintf(buf, "{\"tur\":\"%.2f\", \"tmp\":\"%.2f\", \"pH\":\"%.2f\"}", 
-                 WaterQuality::getInstance().getTurbidity(), 
-                 WaterQuality::getInstance().getDS18B20(), 
-                 WaterQuality::getInstance().getpH());
-    std::cout << buf << std::endl;
+    TRACE_SCOPE("SocketInfoUpdater::update");
+    publish(WaterQuality::getInstance().snapshot());
+}
 
-    send(sock, buf, strlen(buf), 0);
-}
\ No newline at end of file
+void SocketInfoUpdater::publish(const Sample& s) {
+    int64_t now = monotonicMicros();
+    for (auto& ep : endpoints) {
+        ep->poll(now);
+    }
+    publishEncoded(jsonEncoder, s);
+    publishEncoded(gorillaEncoder, s);
+}
+
+// Encode once for all endpoints of this encoding; skipped entirely when none of them is connected
+void SocketInfoUpdater::publishEncoded(StreamEncoder& encoder, const Sample& s) {
+    bool needed = false;
+    for (auto& ep : endpoints) {
+        if (ep->encoding() == encoder.encoding() && ep->connected()) {
+            needed = true;
+            break;
+        }
+    }
+    BufferRef msg;
+    if (needed) {
+        msg = pool.acquire();
+    }
+    if (!msg) {
+        encoder.forceKeyframe();
+        for (auto& ep : endpoints) {
+            if (ep->encoding() == encoder.encoding()) {
+                ep->skip();
+            }
+        }
+        return;
+    }
+    {
+        TRACE_SCOPE(encoder.encoding() == StreamEncoder::JSON ? "encode_json" : "encode_gorilla");
+        msg->len = encoder.encode(s, msg->data, &msg->keyframe);
+    }
+    if (encoder.encoding() == StreamEncoder::JSON) {
+        LOG_INFO("{}", reinterpret_cast<const char*>(msg->data));
+    }
+
+    bool keyframe_wanted = false;
+    for (auto& ep : endpoints) {
+        if (ep->encoding() != encoder.encoding()) {
+            continue;
+        }
+        ep->offer(msg);
+        keyframe_wanted = keyframe_wanted || ep->wantsKeyframe();
+    }
+    // Let an endpoint that lost a frame (or just connected) resume with the next sample
+    if (keyframe_wanted) {
+        encoder.forceKeyframe();
+    }
+}
+
+unsigned long SocketInfoUpdater::droppedSamples() const {
+    unsigned long total = 0;
+    for (const auto& ep : endpoints) {
+        total += ep->droppedSamples();
+    }
+    return total;
+}
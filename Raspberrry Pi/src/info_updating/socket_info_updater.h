@@ -1,44 +1,89 @@
 /**
  * @file socket_info_updater.h
  * @brief Network socket information updater class interface, responsible for sending water quality data over the network
- * @details Defines the functionality to send real-time water quality monitoring data to the server through the connected socket,
+ * @details Defines the functionality to send real-time water quality monitoring data to the upstream servers,
  *          Inherited from the InfoUpdater abstract base class, it implements the specific logic for sending network data,
  *          It is the core module of ‘data output to the network’ in the system.
+ *          The node can stream to several servers at once (e.g. primary collector, backup collector, lab station).
+ *          Each is an UpstreamEndpoint with its own connection, reconnect state, queue and encoding; every sample is
+ *          encoded once per encoding in use and the same buffer is queued for all endpoints using that encoding.
  */
 
 #ifndef SOCKET_INFO_UPDATER_H
 #define SOCKET_INFO_UPDATER_H
 
+#include <memory>
+#include <vector>
+#include <netinet/in.h>
 #include "../common/com.h"              // Public types and utility function definitions
 #include "../common/water_quality.h"    // Water quality data single instance class, used to obtain data to be sent
+#include "../event_loop/event_loop.h"   // Event loop the upstream connections are registered with
+#include "../networking/shared_buffer.h"     // Encoded samples shared by all endpoints
+#include "../networking/stream_encoder.h"    // Wire encoding of live samples
+#include "../networking/upstream_endpoint.h" // Connection and queue of one upstream server
+#include "../storage/sample_log.h"      // On-device history answering BACKFILL requests
 #include "info_updater.h"               // Information updater base class, providing a unified update interface
 
 /**
  * @class SocketInfoUpdater
- * @brief A socket-based information updater responsible for sending real-time water quality data to the server via the network
- * @details Inherited from the InfoUpdater abstract base class, it receives a connected socket descriptor through the constructor,
+ * @brief A socket-based information updater responsible for sending real-time water quality data to the servers via the network
+ * @details Inherited from the InfoUpdater abstract base class, it receives the list of servers through the constructor,
  *          Implement data retrieval, formatting, and transmission in the rewritten update method, typically in conjunction with a timer
- *          Periodically (e.g., once per second) push the latest data to the server.
+ *          Periodically (e.g., once per second) push the latest data to the servers.
+ *          All sockets are non-blocking; a server that is down or slow never delays the others or the event loop,
+ *          samples it cannot take are counted as dropped (they remain available through backfill).
  */
 class SocketInfoUpdater: public InfoUpdater {
+public:
+    /**
+     * @brief One configured upstream server
+     */
+    struct Target {
+        sockaddr_in addr;                  ///< Server address
+        StreamEncoder::Encoding encoding;  ///< Wire encoding expected by the server
+    };
+
 private:
-    int sock;  ///< A socket descriptor that has been established for communication with the server, passed in by the constructor
+    StreamEncoder jsonEncoder;      ///< Shared JSON encoder
+    StreamEncoder gorillaEncoder;   ///< Shared gorilla encoder (one frame sequence for all gorilla endpoints)
+    BufferPool pool;                ///< Message buffers, endpoints * queue_depth + 2
+    std::vector<std::unique_ptr<UpstreamEndpoint>> endpoints;  ///< Configured servers
+
+    void publishEncoded(StreamEncoder& encoder, const Sample& s);
 
 public:
     /**
-     * @brief Constructor, initialise socket members
-     * @param s Connected socket descriptor (must be created in advance using Socket::connectToServer)
-     * @note The socket must be in a connected state, otherwise subsequent update methods may fail to send
+     * @brief Constructor, prepares one endpoint per server; connections are opened by the first update()
+     * @param loop Event loop the sockets are registered with
+     * @param targets Servers to stream to
+     * @param history Sample history used to answer backfill requests (null disables backfill)
+     * @param queue_depth Messages queued per server before its samples are dropped
+     * @param keyframe_interval Samples between keyframes (gorilla only)
      */
-    SocketInfoUpdater(int s);
+    SocketInfoUpdater(EventLoop& loop, const std::vector<Target>& targets, SampleLog* history, size_t queue_depth,
+                      uint32_t keyframe_interval = 60);
 
     /**
      * @brief Override the pure virtual method of the base class to execute network data transmission
      * @details Retrieve the latest water quality data (temperature, pH value, turbidity, etc.) from the WaterQuality singleton,
-     *          After formatting according to the preset format (such as string, JSON, etc.), it is sent to the server via a socket,
-     *          If the transmission fails, an error message will be output (the specific error handling logic is determined by the implementation).
+     *          Encode it once per encoding in use and queue it for every connected server,
+     *          Servers that are disconnected get a new connection attempt when their retry delay has passed.
      */
     void update() override;
+
+    /**
+     * @brief Send a sample to every server
+     * @param s Sample to send
+     */
+    void publish(const Sample& s);
+
+    size_t endpointCount() const { return endpoints.size(); }
+    const UpstreamEndpoint& endpoint(size_t i) const { return *endpoints[i]; }
+
+    /**
+     * @brief Number of samples not delivered, summed over all servers
+     */
+    unsigned long droppedSamples() const;
 };
 
 #endif // SOCKET_INFO_UPDATER_H
@@ -1,19 +1,102 @@
 // tft_info_updater.cpp
 #include "tft_info_updater.h"
 
-#include <cstring>  // Add the cstring header file
-#include <cwchar>
+#include <cmath>
+#include <pthread.h>
+
+// Every character the labels, units, values and page indicator can contain; rendered once at startup so updates
+// never call FreeType
+static const wchar_t* GLYPHS = L"Turb Temp pH 0123456789.-/%℃";
+
+// Readings, one row each above the chart; in the order of the values passed to Layout::update()
+static const Layout::Probe PROBES[] = {
+    {L"Turb", L"%", 2, NAN, NAN},
+    {L"Temp", L"℃", 2, 0.0f, 35.0f},
+    {L"pH", L"", 2, 6.5f, 8.5f},
+};
+static const Layout::Style STYLE = {0xBDF7, 0xFFFF, 0xF800, 0x0000};  // Grey labels, white values, red alarms
+static const int64_t PAGE_US = 5 * 1000000LL;  // With more probes than rows
+
+// Trend chart: rows 100-159 below the text, one row per minute, so the last hour is shown
+static const int TREND_TOP = 100;
+static const int TREND_ROWS = 60;
+static const int64_t TREND_COLUMN_US = 60 * 1000000LL;
+static const Sparkline::Channel TREND_CHANNELS[Sparkline::CHANNELS] = {
+    {0.0f, 100.0f, 0xFFE0},  // Turbidity (%), yellow
+    {0.0f, 40.0f, 0xF800},   // Temperature (℃), red
+    {0.0f, 14.0f, 0x07E0},   // pH, green
+};
+
+TFTInfoUpdater::TFTInfoUpdater()
+    : ownedTft(new TFTFreetype()), tft(*ownedTft),
+      dashboard(tft, PROBES, sizeof(PROBES) / sizeof(PROBES[0]), 0, TREND_TOP, PAGE_US, STYLE),
+      trend(tft, TREND_TOP, TREND_ROWS, TREND_COLUMN_US, TREND_CHANNELS), handed(0), drawn(0), stopping(false) {
+    tft.preload(GLYPHS, STYLE.value);
+    tft.preload(GLYPHS, STYLE.alarm);
+    renderer = std::thread(&TFTInfoUpdater::renderMain, this);
+}
+
+TFTInfoUpdater::TFTInfoUpdater(TFTFreetype& display)
+    : tft(display), dashboard(tft, PROBES, sizeof(PROBES) / sizeof(PROBES[0]), 0, TREND_TOP, PAGE_US, STYLE),
+      trend(tft, TREND_TOP, TREND_ROWS, TREND_COLUMN_US, TREND_CHANNELS), handed(0), drawn(0), stopping(false) {
+    tft.preload(GLYPHS, STYLE.value);
+    tft.preload(GLYPHS, STYLE.alarm);
+    renderer = std::thread(&TFTInfoUpdater::renderMain, this);
+}
+
+TFTInfoUpdater::~TFTInfoUpdater() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    renderer.join();
+}
 
 void TFTInfoUpdater::update() {
-    memset(turb, ' ', BUFFER_SIZE);
-    std::swprintf(turb, sizeof(turb) / sizeof(wchar_t), L"Turbidity: %.2f", WaterQuality::getInstance().getTurbidity());
-    tft.drawString(5, 20, turb,  0xFFFF);
+    WaterQuality& wq = WaterQuality::getInstance();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.seq = wq.getSequence();
+        pending.timestamp_us = monotonicMicros();  // Times the trend columns
+        pending.turbidity = wq.getTurbidity();
+        pending.temperature = wq.getDS18B20();
+        pending.pH = wq.getpH();
+        ++handed;
+    }
+    wake.notify_one();
+}
 
-    std::swprintf(turb, sizeof(turb) / sizeof(wchar_t), L"Temperature: %.2f℃", WaterQuality::getInstance().getDS18B20());
-    tft.drawString(5, 50, turb,  0xFFFF);
+void TFTInfoUpdater::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return drawn == handed || stopping; });
+}
+
+void TFTInfoUpdater::renderMain() {
+    pthread_setname_np(pthread_self(), "display");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return drawn != handed || stopping; });
+        if (stopping) {
+            break;
+        }
+        Sample s = pending;
+        uint64_t upto = handed;
+        lock.unlock();
+        render(s);
+        lock.lock();
+        drawn = upto;
+        idle.notify_all();
+    }
+    idle.notify_all();
+}
 
-    std::swprintf(turb, sizeof(turb) / sizeof(wchar_t), L"pH: %.2f", WaterQuality::getInstance().getpH());
-    tft.drawString(5, 80, turb,  0xFFFF);
+void TFTInfoUpdater::render(const Sample& s) {
+    // Only the values that changed are formatted, and only their changed character cells redrawn
+    float values[Sparkline::CHANNELS] = {s.turbidity, s.temperature, s.pH};
+    dashboard.update(s.timestamp_us, values);
+    trend.add(s.timestamp_us, values);
 
-    tft.fillScreen(0x0000);
+    // Only the pixels that differ from what the panel shows are sent
+    tft.flush();
 }
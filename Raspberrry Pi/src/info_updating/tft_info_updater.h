@@ -4,13 +4,23 @@
  * @details This file defines the specific implementation class used for TFT screen display updates, which inherits from the InfoUpdater abstract base class,
  *          Real-time screen refresh of water quality data (such as turbidity, temperature, pH value) through the TFT Freetype driver,
  *          It is the core module for visualising data in the system.
+ *          Rendering runs on a display thread of its own: the event loop only hands over a snapshot of the values,
+ *          so panel transfers never delay sampling.
  */
 
 #ifndef TFT_INFO_UPDATER_H
 #define TFT_INFO_UPDATER_H
 
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "../common/com.h"              // Public types and utility function definitions
+#include "../common/sample.h"           // Snapshot handed to the display thread
 #include "../common/water_quality.h"    // Water quality data single instance class, used to obtain data to be displayed
+#include "../display/layout.h"          // Probe rows over a cached background, redrawing only changed values
+#include "../display/sparkline.h"       // Trend chart below the values
 #include "../display/tft_freetype.h"    // TFT screen and font driver, providing display control interface
 #include "info_updater.h"               // Information updater base class, defining a unified update interface
 
@@ -23,16 +33,51 @@
  */
 class TFTInfoUpdater : public InfoUpdater{
 private:
-    TFTFreetype tft;                     ///< TFT screen and font controller for performing actual display operations
-    static const int BUFFER_SIZE = 20;   ///< String buffer size, used to format text to be displayed
-    wchar_t turb[BUFFER_SIZE] = {0};     ///< A wide character buffer that stores turbidity information for display on the screen
+    std::unique_ptr<TFTFreetype> ownedTft;  ///< Display opened by the default constructor (null if one was passed in)
+    TFTFreetype& tft;                    ///< TFT screen and font controller for performing actual display operations
+    Layout dashboard;                    ///< Probe readings above the chart, paged if they do not fit (display thread)
+    Sparkline trend;                     ///< Last hour of each value, one row per minute (display thread)
+
+    std::mutex mutex;                    ///< Guards the fields below
+    std::condition_variable wake;        ///< Signals the display thread: new snapshot or stop
+    std::condition_variable idle;        ///< Signals sync(): a snapshot has been drawn
+    Sample pending;                      ///< Latest snapshot handed over; older ones not yet drawn are skipped
+    uint64_t handed;                     ///< Snapshots handed over
+    uint64_t drawn;                      ///< Snapshots handed over before the last one drawn
+    bool stopping;                       ///< Destructor is waiting for the thread
+    std::thread renderer;                ///< Display thread: draws into the back buffer and flushes the difference
+
+    void renderMain();
+    void render(const Sample& s);
 
 public:
+    /**
+     * @brief Open the panel of this node (GPIO, SPI and font as configured in tft_freetype.cpp)
+     */
+    TFTInfoUpdater();
+
+    /**
+     * @brief Draw on a display opened elsewhere (e.g. a simulated panel in tests)
+     * @param display Display that outlives the updater
+     */
+    explicit TFTInfoUpdater(TFTFreetype& display);
+
+    /**
+     * @brief Stop the display thread; a snapshot not yet drawn is dropped
+     */
+    ~TFTInfoUpdater();
+
+    /**
+     * @brief Wait until the last snapshot handed over is on the panel (tests)
+     */
+    void sync();
+
     /**
      * @brief Override the pure virtual method of the base class to perform TFT screen display updates
      * @details Retrieve the latest water quality data (turbidity, temperature, pH value) from the WaterQuality singleton,
      *          Format as a human-readable wide string (e.g., ‘Turbidity: XX%’) and draw it to the specified position on the screen using the tft object,
      *          Real-time data display on TFT screens.
+     *          Only the snapshot is taken here; formatting, drawing and the SPI transfers happen on the display thread.
      */
     void update() override;
 };
@@ -0,0 +1,112 @@
+// backfill_session.cpp
+#include "backfill_session.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../common/sample_record.h"
+#include "../common/logger.h"
+
+BackfillSession::BackfillSession()
+    : log(nullptr), current(0), file_fd(-1), offset(0), remaining(0),
+      header_len(0), header_sent(0), is_active(false) {}
+
+BackfillSession::~BackfillSession() {
+    abort();
+}
+
+void BackfillSession::abort() {
+    if (file_fd >= 0) {
+        close(file_fd);
+        file_fd = -1;
+    }
+    extents.clear();
+    is_active = false;
+}
+
+void BackfillSession::start(const SampleLog& history, int64_t from_us, int64_t to_us) {
+    abort();
+    log = &history;
+    size_t total = history.findRange(from_us, to_us, extents);
+
+    // Raw records have a fixed size; encoded frames are self-delimiting (record size 0)
+    bool raw = history.format() == SampleLog::RAW;
+    header_len = static_cast<size_t>(std::snprintf(header, sizeof(header), "#BACKFILL %s %zu %zu\n",
+                                                   raw ? "raw" : "gorilla", raw ? SampleRecord::SIZE : 0, total));
+    header_sent = 0;
+    current = 0;
+    remaining = 0;
+    is_active = true;
+    LOG_INFO("Backfill requested: {} bytes in {} segment(s)", total, extents.size());
+}
+
+/**
+ * @brief Send the header, then the extents with sendfile(), at most SLICE_BYTES per call
+ * @details The socket is non-blocking, so EAGAIN simply means the peer is slower than the disk; the caller waits
+ *          for EPOLLOUT. Stopping after a slice keeps a multi-gigabyte transfer from starving the sampling timers.
+ */
+BackfillSession::Status BackfillSession::pump(int sock) {
+    if (!is_active) {
+        return DONE;
+    }
+
+    while (header_sent < header_len) {
+        ssize_t n = send(sock, header + header_sent, header_len - header_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+            abort();
+            return FAILED;
+        }
+        header_sent += static_cast<size_t>(n);
+    }
+
+    size_t budget = SLICE_BYTES;
+    while (budget > 0) {
+        if (remaining == 0) {
+            if (file_fd >= 0) {
+                close(file_fd);
+                file_fd = -1;
+            }
+            if (current >= extents.size()) {
+                abort();
+                return DONE;
+            }
+            const SampleLog::Extent& ext = extents[current++];
+            file_fd = log->openSegment(ext.segment);
+            if (file_fd < 0) {
+                // The segment was rotated away in the meantime; the byte count in the header can no longer be met
+                LOG_ERROR("Backfill aborted: history segment disappeared");
+                abort();
+                return FAILED;
+            }
+            offset = ext.offset;
+            remaining = ext.length;
+        }
+
+        size_t chunk = remaining < budget ? remaining : budget;
+        ssize_t n = sendfile(sock, file_fd, &offset, chunk);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return WOULD_BLOCK;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Backfill aborted: {}", strerror(errno));
+            abort();
+            return FAILED;
+        }
+        if (n == 0) {
+            // File shorter than expected
+            abort();
+            return FAILED;
+        }
+        remaining -= static_cast<size_t>(n);
+        budget -= static_cast<size_t>(n);
+    }
+    return YIELD;
+}
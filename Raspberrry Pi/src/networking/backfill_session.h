@@ -0,0 +1,89 @@
+/**
+ * @file backfill_session.h
+ * @brief Streams a range of the on-device history to the server with sendfile()
+ * @details The server requests a range with the text command "BACKFILL <from_ms> <to_ms>\n". The node answers with
+ *          one header line followed by the raw history bytes:
+ *              "#BACKFILL <format> <record_size> <byte_length>\n" <byte_length bytes>
+ *          where format is "raw" (fixed SampleRecord entries of record_size bytes) or "gorilla" (SampleCodec frames,
+ *          record_size 0, every segment extent starting with a keyframe). The bytes are copied from the segment
+ *          files to the socket inside the kernel. The sequence number in every record lets the server drop samples
+ *          it already has.
+ */
+
+#ifndef BACKFILL_SESSION_H
+#define BACKFILL_SESSION_H
+
+#include <cstddef>
+#include <vector>
+#include <sys/types.h>
+#include "../storage/sample_log.h"
+
+/**
+ * @class BackfillSession
+ * @brief One in-progress history transfer on a non-blocking socket
+ */
+class BackfillSession {
+public:
+    /**
+     * @brief Result of one pump() call
+     */
+    enum Status {
+        DONE,         ///< Transfer finished (or nothing to send)
+        WOULD_BLOCK,  ///< Socket buffer full, resume on EPOLLOUT
+        YIELD,        ///< Slice budget used up, resume soon without waiting for the socket
+        FAILED        ///< Socket or file error, the session has been aborted
+    };
+
+    static const size_t SLICE_BYTES = 256 * 1024;  ///< Maximum bytes sent per pump() call
+
+    BackfillSession();
+    ~BackfillSession();
+
+    BackfillSession(const BackfillSession&) = delete;
+    BackfillSession& operator=(const BackfillSession&) = delete;
+
+    /**
+     * @brief Look up a time range and prepare the response
+     * @param log History to read from
+     * @param from_us Inclusive start (CLOCK_REALTIME, microseconds)
+     * @param to_us Inclusive end (CLOCK_REALTIME, microseconds)
+     * @note An already running transfer is aborted first
+     */
+    void start(const SampleLog& log, int64_t from_us, int64_t to_us);
+
+    /**
+     * @brief Send the next slice of the response
+     * @param sock Connected non-blocking socket
+     * @return Status What the caller should do next
+     */
+    Status pump(int sock);
+
+    /**
+     * @brief Whether a transfer is in progress
+     */
+    bool active() const { return is_active; }
+
+    /**
+     * @brief Whether response bytes have been sent, so nothing else may be written until it completes
+     */
+    bool started() const { return is_active && header_sent > 0; }
+
+    /**
+     * @brief Drop the current transfer and close its file
+     */
+    void abort();
+
+private:
+    const SampleLog* log;                  ///< History being transferred
+    std::vector<SampleLog::Extent> extents;///< Byte ranges still to be sent
+    size_t current;                        ///< Index of the extent being sent
+    int file_fd;                           ///< Open segment file of the current extent (-1 if none)
+    off_t offset;                          ///< Next byte to send from the current segment
+    size_t remaining;                      ///< Bytes left in the current extent
+    char header[96];                       ///< Response header line
+    size_t header_len;                     ///< Length of the header line
+    size_t header_sent;                    ///< Header bytes already sent
+    bool is_active;                        ///< Transfer in progress
+};
+
+#endif // BACKFILL_SESSION_H
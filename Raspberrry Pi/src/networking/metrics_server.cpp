@@ -0,0 +1,239 @@
+// metrics_server.cpp
+#include "metrics_server.h"
+#include <cerrno>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sock.h"
+#include "../common/sample.h"
+#include "../common/logger.h"
+
+// Room kept in front of the body for the status line and headers, so the body is rendered in place
+static const size_t HEADER_RESERVE = 160;
+
+void MetricsWriter::append(const char* format, ...) {
+    if (overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(buf + len, cap - len, format, args);
+    va_end(args);
+    if (n < 0 || static_cast<size_t>(n) >= cap - len) {
+        overflow = true;
+        return;
+    }
+    len += static_cast<size_t>(n);
+}
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, double value) {
+    if (labels != nullptr && labels[0] != '\0') {
+        append("%s{%s} %.9g\n", name, labels, value);
+    } else {
+        append("%s %.9g\n", name, value);
+    }
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, uint64_t value) {
+    if (labels != nullptr && labels[0] != '\0') {
+        append("%s{%s} %" PRIu64 "\n", name, labels, value);
+    } else {
+        append("%s %" PRIu64 "\n", name, value);
+    }
+}
+
+const size_t MetricsServer::MAX_CONNECTIONS;
+const size_t MetricsServer::REQUEST_CAPACITY;
+const size_t MetricsServer::RESPONSE_CAPACITY;
+const int MetricsServer::IDLE_TIMEOUT_MS;
+
+MetricsServer::MetricsServer(EventLoop& l, int port, Renderer r)
+    : loop(l), listen_fd(-1), render(std::move(r)), served(0), rejected(0) {
+    for (Connection& c : slots) {
+        c.fd = -1;
+    }
+    listen_fd = Socket::createListener(port, 8);
+    loop.add_fd(listen_fd, [this]() { onAccept(); });
+    loop.set_name(listen_fd, "metrics_accept");
+    LOG_INFO("Metrics available at http://<node>:{}/metrics", port);
+}
+
+MetricsServer::~MetricsServer() {
+    for (Connection& c : slots) {
+        if (c.fd >= 0) {
+            closeConnection(&c);
+        }
+    }
+    if (listen_fd >= 0) {
+        loop.remove_fd(listen_fd);
+        close(listen_fd);
+    }
+}
+
+// A free slot, reclaiming one from a client that has been idle too long
+MetricsServer::Connection* MetricsServer::freeSlot() {
+    int64_t now = monotonicMicros();
+    for (Connection& c : slots) {
+        if (c.fd < 0) {
+            return &c;
+        }
+    }
+    for (Connection& c : slots) {
+        if (now - c.opened_us > static_cast<int64_t>(IDLE_TIMEOUT_MS) * 1000) {
+            closeConnection(&c);
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+// Edge-triggered: accept until the backlog is empty
+void MetricsServer::onAccept() {
+    static const char BUSY[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Metrics accept failed: {}", strerror(errno));
+            }
+            return;
+        }
+        Connection* c = freeSlot();
+        if (c == nullptr) {
+            // A fresh socket buffer is empty, so this cannot block
+            send(fd, BUSY, sizeof(BUSY) - 1, MSG_NOSIGNAL);
+            close(fd);
+            rejected++;
+            continue;
+        }
+        c->fd = fd;
+        c->opened_us = monotonicMicros();
+        c->request_len = 0;
+        c->out = nullptr;
+        c->out_len = 0;
+        // Two pointers fit in std::function's local storage and the loop recycles its entries: no allocation
+        loop.add_fd(fd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, [this, c](uint32_t events) { onEvent(c, events); });
+        loop.set_name(fd, "metrics_client");
+    }
+}
+
+void MetricsServer::onEvent(Connection* c, uint32_t events) {
+    if (events & EPOLLERR) {
+        closeConnection(c);
+        return;
+    }
+    if (c->out != nullptr) {
+        flush(c);
+        return;
+    }
+    // Read the request head; the body of a GET is empty
+    for (;;) {
+        ssize_t n = recv(c->fd, c->request + c->request_len, REQUEST_CAPACITY - 1 - c->request_len, 0);
+        if (n > 0) {
+            c->request_len += static_cast<size_t>(n);
+            c->request[c->request_len] = '\0';
+            if (std::strstr(c->request, "\r\n\r\n") != nullptr || std::strstr(c->request, "\n\n") != nullptr) {
+                respond(c);
+                return;
+            }
+            if (c->request_len == REQUEST_CAPACITY - 1) {
+                reply(c, "431 Request Header Fields Too Large", "text/plain", 0);
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (events & (EPOLLHUP | EPOLLRDHUP)) {
+                closeConnection(c);
+            }
+            return;
+        }
+        closeConnection(c);  // Closed by the peer before sending a full request, or failed
+        return;
+    }
+}
+
+// Route the request and render the response in place
+void MetricsServer::respond(Connection* c) {
+    const char* req = c->request;
+    bool get = std::strncmp(req, "GET ", 4) == 0;
+    bool head = std::strncmp(req, "HEAD ", 5) == 0;
+    if (!get && !head) {
+        reply(c, "405 Method Not Allowed", "text/plain", 0);
+        return;
+    }
+    const char* path = req + (get ? 4 : 5);
+    size_t path_len = std::strcspn(path, " ?\r\n");
+    if (path_len != 8 || std::strncmp(path, "/metrics", 8) != 0) {
+        reply(c, "404 Not Found", "text/plain", 0);
+        return;
+    }
+
+    MetricsWriter writer(c->response + HEADER_RESERVE, RESPONSE_CAPACITY - HEADER_RESERVE);
+    render(writer);
+    if (writer.overflowed()) {
+        LOG_ERROR("Metrics: response exceeds {} bytes", RESPONSE_CAPACITY);
+        reply(c, "500 Internal Server Error", "text/plain", 0);
+        return;
+    }
+    served++;
+    reply(c, "200 OK", "text/plain; version=0.0.4; charset=utf-8", head ? 0 : writer.length());
+}
+
+// Put the status line and headers directly in front of a body already at response + HEADER_RESERVE
+void MetricsServer::reply(Connection* c, const char* status, const char* content_type, size_t body_len) {
+    char header[HEADER_RESERVE];
+    int n = std::snprintf(header, sizeof(header),
+                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                          status, content_type, body_len);
+    if (n < 0 || static_cast<size_t>(n) >= sizeof(header)) {
+        closeConnection(c);
+        return;
+    }
+    char* start = c->response + HEADER_RESERVE - n;
+    std::memcpy(start, header, static_cast<size_t>(n));
+    c->out = start;
+    c->out_len = static_cast<size_t>(n) + body_len;
+    flush(c);
+}
+
+// Write as much of the response as the socket takes; EPOLLOUT resumes the rest
+void MetricsServer::flush(Connection* c) {
+    while (c->out_len > 0) {
+        ssize_t n = send(c->fd, c->out, c->out_len, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out += n;
+            c->out_len -= static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        break;
+    }
+    closeConnection(c);
+}
+
+void MetricsServer::closeConnection(Connection* c) {
+    loop.remove_fd(c->fd);
+    close(c->fd);
+    c->fd = -1;
+    c->out = nullptr;
+    c->out_len = 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file metrics_server.h
+ * @brief Prometheus /metrics endpoint served from the EventLoop
+ * @details A minimal non-blocking HTTP/1.1 responder: each scrape is read, rendered and written from the event loop
+ *          without blocking the sampling timers. A fixed number of connection slots each own a preallocated request
+ *          and response buffer, so a scrape performs no heap allocation; the text is written straight into the
+ *          response buffer by a MetricsWriter. Every response closes the connection.
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "../event_loop/event_loop.h"
+
+/**
+ * @class MetricsWriter
+ * @brief Appends Prometheus text exposition format into a fixed buffer
+ * @details Output that does not fit is cut off and reported by overflowed(); nothing is allocated.
+ */
+class MetricsWriter {
+public:
+    /**
+     * @brief Constructor
+     * @param buffer Destination buffer
+     * @param capacity Size of the buffer in bytes
+     */
+    MetricsWriter(char* buffer, size_t capacity) : buf(buffer), cap(capacity), len(0), overflow(false) {}
+
+    /**
+     * @brief Write the HELP and TYPE lines of a metric family
+     * @param name Metric name
+     * @param type "gauge", "counter" or "histogram"
+     * @param help One-line description
+     */
+    void family(const char* name, const char* type, const char* help);
+
+    /**
+     * @brief Write one sample line
+     * @param name Metric name (including a _bucket/_sum/_count suffix where applicable)
+     * @param labels Label set without braces (e.g. "handler=\"data_timer\""), or null
+     * @param value Sample value
+     */
+    void sample(const char* name, const char* labels, double value);
+
+    /**
+     * @brief Write one sample line with an integer value (exact for counters above 2^53)
+     */
+    void sample(const char* name, const char* labels, uint64_t value);
+
+    /**
+     * @brief printf-style append for anything the helpers do not cover
+     */
+    void append(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t length() const { return len; }         ///< Bytes written
+    bool overflowed() const { return overflow; }  ///< Some output did not fit
+
+private:
+    char* buf;      ///< Destination buffer
+    size_t cap;     ///< Buffer size
+    size_t len;     ///< Bytes written
+    bool overflow;  ///< Output was cut off
+};
+
+/**
+ * @class MetricsServer
+ * @brief Answers "GET /metrics" with the text produced by a render callback
+ */
+class MetricsServer {
+public:
+    typedef std::function<void(MetricsWriter&)> Renderer;  ///< Writes the current metrics
+
+    static const size_t MAX_CONNECTIONS = 2;       ///< Scrapes served at the same time
+    static const size_t REQUEST_CAPACITY = 1024;   ///< Longest accepted request head
+    static const size_t RESPONSE_CAPACITY = 32768; ///< Largest response (headers included)
+    static const int IDLE_TIMEOUT_MS = 5000;       ///< Connections silent for longer are closed when a slot is needed
+
+    /**
+     * @brief Constructor, starts listening
+     * @param loop Event loop the listener and the connections are registered with
+     * @param port TCP port to listen on
+     * @param render Callback writing the metrics of the node
+     * @throws std::runtime_error When the port cannot be opened
+     */
+    MetricsServer(EventLoop& loop, int port, Renderer render);
+
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    uint64_t scrapes() const { return served; }         ///< Successful /metrics responses
+    uint64_t rejectedClients() const { return rejected; }  ///< Connections refused because every slot was busy
+
+private:
+    /**
+     * @brief One connection slot with its preallocated buffers
+     */
+    struct Connection {
+        int fd;                               ///< Connected socket, -1 when the slot is free
+        int64_t opened_us;                    ///< Accept time, for the idle timeout
+        size_t request_len;                   ///< Bytes of the request head received
+        const char* out;                      ///< Start of the response being written, null while reading
+        size_t out_len;                       ///< Bytes of the response left to write
+        char request[REQUEST_CAPACITY];       ///< Request head
+        char response[RESPONSE_CAPACITY];     ///< Response headers and body
+    };
+
+    void onAccept();
+    void onEvent(Connection* c, uint32_t events);
+    void respond(Connection* c);
+    void reply(Connection* c, const char* status, const char* content_type, size_t body_len);
+    void flush(Connection* c);
+    void closeConnection(Connection* c);
+    Connection* freeSlot();
+
+    EventLoop& loop;                       ///< Loop the sockets are registered with
+    int listen_fd;                         ///< Listening socket
+    Renderer render;                       ///< Writes the metrics
+    Connection slots[MAX_CONNECTIONS];     ///< Connection slots
+    uint64_t served;                       ///< Successful /metrics responses
+    uint64_t rejected;                     ///< Connections refused because every slot was busy
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,71 @@
+// multicast_publisher.cpp
+#include "multicast_publisher.h"
+#include "../common/logger.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MulticastPublisher::MulticastPublisher(const std::string& group, int port, int ttl, const std::string& interface_ip,
+                                       uint32_t node_id)
+    : fd(-1), sent(0), dropped(0) {
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    if (inet_pton(AF_INET, group.c_str(), &dest.sin_addr) != 1 || !IN_MULTICAST(ntohl(dest.sin_addr.s_addr))) {
+        throw std::invalid_argument("Invalid multicast group: " + group);
+    }
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Multicast socket creation failed：" + std::string(strerror(errno)));
+    }
+    unsigned char hops = static_cast<unsigned char>(ttl < 0 ? 0 : (ttl > 255 ? 255 : ttl));
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to set multicast TTL：" + std::string(strerror(errno)));
+    }
+    if (!interface_ip.empty()) {
+        in_addr iface;
+        if (inet_pton(AF_INET, interface_ip.c_str(), &iface) != 1 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0) {
+            close(fd);
+            throw std::runtime_error("Invalid multicast interface: " + interface_ip);
+        }
+    }
+
+    // A new session id lets receivers tell a restart (sequence back to 0) from reordering
+    std::random_device rd;
+    header.node_id = node_id;
+    header.session_id = rd();
+    header.sequence = 0;
+    LOG_INFO("Multicast publishing to {}:{} (node {})", group, port, node_id);
+}
+
+MulticastPublisher::~MulticastPublisher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void MulticastPublisher::update() {
+    publish(WaterQuality::getInstance().snapshot());
+}
+
+void MulticastPublisher::publish(const Sample& s) {
+    uint8_t buf[Datagram::SIZE];
+    Datagram::encode(header, s, buf);
+    // The sequence number advances even if this datagram is dropped locally, so receivers count it as lost
+    header.sequence++;
+
+    if (sendto(fd, buf, sizeof(buf), 0, reinterpret_cast<const sockaddr*>(&dest), sizeof(dest)) < 0) {
+        if (dropped++ == 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Multicast send failed: {}", strerror(errno));
+        }
+        return;
+    }
+    sent++;
+}
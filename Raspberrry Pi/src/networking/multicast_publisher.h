@@ -0,0 +1,64 @@
+/**
+ * @file multicast_publisher.h
+ * @brief Publishes every sample as one UDP multicast datagram
+ * @details An alternative to per-client TCP streams for sites with many screens: the node sends one datagram per
+ *          sample to a multicast group and any number of receivers on the LAN join the group. The cost on the node
+ *          is one sendto() per sample regardless of how many receivers there are, and there is no per-receiver
+ *          state or buffering. Delivery is best effort; receivers detect lost datagrams from the sequence number
+ *          in the header (see datagram.h) and can recover the samples through a TCP backfill.
+ */
+
+#ifndef MULTICAST_PUBLISHER_H
+#define MULTICAST_PUBLISHER_H
+
+#include <cstdint>
+#include <string>
+#include <netinet/in.h>
+#include "../common/datagram.h"
+#include "../common/water_quality.h"
+#include "../info_updating/info_updater.h"
+
+/**
+ * @class MulticastPublisher
+ * @brief InfoUpdater sending the current sample to a multicast group
+ */
+class MulticastPublisher : public InfoUpdater {
+public:
+    /**
+     * @brief Constructor, creates the non-blocking UDP socket
+     * @param group Multicast group address (e.g. "239.255.0.1")
+     * @param port Destination port
+     * @param ttl Multicast TTL (1 keeps datagrams on the local subnet)
+     * @param interface_ip Address of the outgoing interface (empty for the system default)
+     * @param node_id Identifier of this node carried in every datagram
+     * @throws std::runtime_error When the address is invalid or the socket cannot be set up
+     */
+    MulticastPublisher(const std::string& group, int port, int ttl, const std::string& interface_ip, uint32_t node_id);
+    ~MulticastPublisher();
+
+    MulticastPublisher(const MulticastPublisher&) = delete;
+    MulticastPublisher& operator=(const MulticastPublisher&) = delete;
+
+    /**
+     * @brief Send the current sample
+     */
+    void update() override;
+
+    /**
+     * @brief Send a sample
+     * @param s Sample to send
+     */
+    void publish(const Sample& s);
+
+    uint64_t sentDatagrams() const { return sent; }        ///< Datagrams handed to the kernel
+    uint64_t droppedDatagrams() const { return dropped; }  ///< Datagrams not sent (socket buffer full or error)
+
+private:
+    int fd;                   ///< UDP socket
+    sockaddr_in dest;         ///< Group address and port
+    Datagram::Header header;  ///< Node, session and next sequence number
+    uint64_t sent;            ///< Datagrams sent
+    uint64_t dropped;         ///< Datagrams not sent
+};
+
+#endif // MULTICAST_PUBLISHER_H
@@ -0,0 +1,72 @@
+// outbound_queue.cpp
+#include "outbound_queue.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+OutboundQueue::OutboundQueue(size_t capacity)
+    : ring(capacity > 0 ? capacity : 1), head(0), count(0), head_offset(0) {}
+
+bool OutboundQueue::push(const BufferRef& buf) {
+    if (!buf || buf->len == 0) {
+        return true;  // Nothing to send
+    }
+    if (count == ring.size()) {
+        return false;
+    }
+    ring[(head + count) % ring.size()] = buf;
+    count++;
+    return true;
+}
+
+void OutboundQueue::clear() {
+    while (count > 0) {
+        ring[head].reset();
+        head = (head + 1) % ring.size();
+        count--;
+    }
+    head = 0;
+    head_offset = 0;
+}
+
+OutboundQueue::Status OutboundQueue::flush(int fd) {
+    static const size_t MAX_IOV = 16;
+
+    while (count > 0) {
+        iovec iov[MAX_IOV];
+        size_t n = count < MAX_IOV ? count : MAX_IOV;
+        for (size_t i = 0; i < n; ++i) {
+            SharedBuffer* b = ring[(head + i) % ring.size()].get();
+            size_t skip = i == 0 ? head_offset : 0;
+            iov[i].iov_base = b->data + skip;
+            iov[i].iov_len = b->len - skip;
+        }
+
+        msghdr msg = msghdr();
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? WOULD_BLOCK : FAILED;
+        }
+
+        // Release the fully written messages, keep the offset into a partially written one
+        size_t left = static_cast<size_t>(sent);
+        while (left > 0) {
+            size_t rest = ring[head]->len - head_offset;
+            if (left < rest) {
+                head_offset += left;
+                break;
+            }
+            left -= rest;
+            ring[head].reset();
+            head = (head + 1) % ring.size();
+            count--;
+            head_offset = 0;
+        }
+    }
+    return DRAINED;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file outbound_queue.h
+ * @brief Bounded per-connection queue of shared message buffers
+ * @details Each receiver owns one queue. A slow receiver fills its own queue and starts losing messages; it never
+ *          holds up the others, which only share the buffers, not the queue. Flushing gathers the queued buffers
+ *          into a single sendmsg() call and remembers how far into the first buffer a partial send got.
+ */
+
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <cstddef>
+#include <vector>
+#include "shared_buffer.h"
+
+/**
+ * @class OutboundQueue
+ * @brief Fixed-capacity ring of BufferRefs waiting to be written to a non-blocking socket
+ */
+class OutboundQueue {
+public:
+    /**
+     * @brief Result of flush()
+     */
+    enum Status {
+        DRAINED,      ///< Everything queued has been sent
+        WOULD_BLOCK,  ///< Socket buffer full, wait for EPOLLOUT
+        FAILED        ///< Socket error, the connection should be closed
+    };
+
+    /**
+     * @brief Constructor
+     * @param capacity Maximum number of queued messages
+     */
+    explicit OutboundQueue(size_t capacity);
+
+    /**
+     * @brief Queue a message
+     * @param buf Message to send (shared, not copied)
+     * @return bool False if the queue is full and the message was not queued
+     */
+    bool push(const BufferRef& buf);
+
+    /**
+     * @brief Write as much of the queue as the socket accepts
+     * @param fd Connected non-blocking socket
+     * @return Status Outcome of the attempt
+     */
+    Status flush(int fd);
+
+    /**
+     * @brief Drop every queued message
+     */
+    void clear();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == ring.size(); }
+
+    /**
+     * @brief Whether the first message has been partially written (it must be finished before anything else)
+     */
+    bool midMessage() const { return head_offset > 0; }
+
+private:
+    std::vector<BufferRef> ring;  ///< Queued messages
+    size_t head;                  ///< Index of the oldest message
+    size_t count;                 ///< Number of queued messages
+    size_t head_offset;           ///< Bytes of the oldest message already sent
+};
+
+#endif // OUTBOUND_QUEUE_H
@@ -0,0 +1,180 @@
+// pubsub_server.cpp
+#include "pubsub_server.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sock.h"
+#include "../common/logger.h"
+
+static_assert(StreamEncoder::MAX_MESSAGE <= SharedBuffer::CAPACITY, "shared buffers must hold one encoded sample");
+
+PubSubServer::PubSubServer(EventLoop& l, int port, StreamEncoder::Encoding encoding, size_t max, size_t depth,
+                           uint32_t keyframe_interval)
+    : loop(l), listen_fd(-1), encoder(encoding, keyframe_interval), max_clients(max > 0 ? max : 1),
+      queue_depth(depth > 0 ? depth : 1),
+      // Every subscriber can hold queue_depth distinct messages, plus the one being encoded
+      pool(max_clients * queue_depth + 1), dropped(0), rejected(0) {
+    listen_fd = Socket::createListener(port, 16);
+    clients.reserve(max_clients);
+    loop.add_fd(listen_fd, [this]() { onAccept(); });
+    LOG_INFO("Subscriber server listening on port {} ({}, up to {} subscribers)", port, encoding == StreamEncoder::GORILLA ? "gorilla" : "json", max_clients);
+}
+
+PubSubServer::~PubSubServer() {
+    for (auto& c : clients) {
+        loop.remove_fd(c->fd);
+        close(c->fd);
+    }
+    if (listen_fd >= 0) {
+        loop.remove_fd(listen_fd);
+        close(listen_fd);
+    }
+}
+
+size_t PubSubServer::queuedMessages() const {
+    size_t total = 0;
+    for (const auto& c : clients) {
+        total += c->queue.size();
+    }
+    return total;
+}
+
+// Edge-triggered: accept until the backlog is empty
+void PubSubServer::onAccept() {
+    for (;;) {
+        sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Subscriber accept failed: {}", strerror(errno));
+            }
+            return;
+        }
+        if (clients.size() >= max_clients) {
+            rejected++;
+            close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Client> c(new Client(fd, queue_depth));
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        std::snprintf(c->peer, sizeof(c->peer), "%s:%u", ip, static_cast<unsigned>(ntohs(addr.sin_port)));
+
+        // A fresh socket buffer is empty, so the announcement cannot block
+        const char* hello = StreamEncoder::hello(encoder.encoding());
+        send(fd, hello, strlen(hello), MSG_NOSIGNAL);
+        // Let the new subscriber start decoding with the next sample instead of waiting a whole keyframe interval
+        encoder.forceKeyframe();
+
+        Client* raw = c.get();
+        loop.add_fd(fd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, [this, raw](uint32_t events) {
+            onClientEvent(raw, events);
+        });
+        clients.push_back(std::move(c));
+        LOG_INFO("Subscriber connected: {} ({} total)", raw->peer, clients.size());
+    }
+}
+
+void PubSubServer::onClientEvent(Client* c, uint32_t events) {
+    if (events & EPOLLIN) {
+        // Subscribers have nothing to say; drain the socket to notice an orderly close
+        char buf[256];
+        for (;;) {
+            ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                c->closing = true;
+            }
+            break;
+        }
+    }
+    if (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+        c->closing = true;
+    }
+    if (!c->closing && (events & EPOLLOUT)) {
+        flushClient(c);
+    }
+    if (c->closing) {
+        sweepClients();
+    }
+}
+
+void PubSubServer::flushClient(Client* c) {
+    if (c->queue.flush(c->fd) == OutboundQueue::FAILED) {
+        c->closing = true;
+    }
+}
+
+void PubSubServer::update() {
+    publish(WaterQuality::getInstance().snapshot());
+}
+
+void PubSubServer::publish(const Sample& s) {
+    if (clients.empty()) {
+        return;
+    }
+    BufferRef msg = pool.acquire();
+    if (!msg) {
+        // Cannot happen with the pool sized for every queue; count it rather than crash
+        dropped += clients.size();
+        return;
+    }
+    msg->len = encoder.encode(s, msg->data, &msg->keyframe);
+
+    for (auto& c : clients) {
+        if (c->resync && !msg->keyframe) {
+            c->dropped++;
+            dropped++;
+            continue;
+        }
+        if (!c->queue.push(msg)) {
+            c->dropped++;
+            dropped++;
+            // A gorilla subscriber cannot decode the following deltas; a JSON subscriber only lost this sample
+            c->resync = encoder.encoding() == StreamEncoder::GORILLA;
+            continue;
+        }
+        c->resync = false;
+        flushClient(c.get());
+    }
+    sweepClients();
+
+    // Send a keyframe next as soon as a subscriber waiting for one has room again; a subscriber that is still
+    // stalled does not make everyone pay for keyframes
+    for (auto& c : clients) {
+        if (c->resync && !c->queue.full()) {
+            encoder.forceKeyframe();
+            break;
+        }
+    }
+}
+
+void PubSubServer::closeClient(Client* c) {
+    LOG_INFO("Subscriber disconnected: {} ({} samples lost)", c->peer, c->dropped);
+    loop.remove_fd(c->fd);
+    close(c->fd);
+    c->queue.clear();
+}
+
+// Remove the subscribers marked as closing (never while iterating over clients)
+void PubSubServer::sweepClients() {
+    for (size_t i = 0; i < clients.size();) {
+        if (clients[i]->closing) {
+            closeClient(clients[i].get());
+            clients[i].swap(clients.back());
+            clients.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
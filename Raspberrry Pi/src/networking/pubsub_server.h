@@ -0,0 +1,100 @@
+/**
+ * @file pubsub_server.h
+ * @brief Server mode of the node: any number of subscribers receive the live sample stream
+ * @details Dashboards and loggers connect to the node's subscriber port instead of waiting for the node to connect to
+ *          them. The listening socket and every subscriber are registered with the EventLoop; nothing blocks.
+ *          Every sample is encoded once into a pooled SharedBuffer and a reference is queued for each subscriber.
+ *          Each subscriber has its own bounded OutboundQueue: a subscriber that stops reading loses its own samples
+ *          (counted per subscriber) while the others keep receiving. With the gorilla encoding, a subscriber that lost
+ *          a frame is skipped until the next keyframe, and the next sample is encoded as one.
+ */
+
+#ifndef PUBSUB_SERVER_H
+#define PUBSUB_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <netinet/in.h>
+#include "../event_loop/event_loop.h"
+#include "../common/water_quality.h"
+#include "../info_updating/info_updater.h"
+#include "outbound_queue.h"
+#include "shared_buffer.h"
+#include "stream_encoder.h"
+
+/**
+ * @class PubSubServer
+ * @brief Accepts subscribers and fans every published sample out to all of them
+ * @details Used as an InfoUpdater: update() publishes the current WaterQuality snapshot.
+ */
+class PubSubServer : public InfoUpdater {
+public:
+    /**
+     * @brief Constructor, starts listening
+     * @param loop Event loop the listener and the subscribers are registered with
+     * @param port TCP port to listen on
+     * @param encoding Wire encoding sent to every subscriber
+     * @param max_clients Subscribers accepted at the same time (further connections are closed)
+     * @param queue_depth Messages queued per subscriber before it starts losing samples
+     * @param keyframe_interval Samples between keyframes (GORILLA only)
+     * @throws std::runtime_error When the port cannot be opened
+     */
+    PubSubServer(EventLoop& loop, int port, StreamEncoder::Encoding encoding, size_t max_clients, size_t queue_depth,
+                 uint32_t keyframe_interval = 60);
+
+    ~PubSubServer();
+
+    PubSubServer(const PubSubServer&) = delete;
+    PubSubServer& operator=(const PubSubServer&) = delete;
+
+    /**
+     * @brief Publish the current sample to every subscriber
+     */
+    void update() override;
+
+    /**
+     * @brief Publish a sample to every subscriber
+     * @param s Sample to publish
+     */
+    void publish(const Sample& s);
+
+    size_t subscriberCount() const { return clients.size(); }   ///< Currently connected subscribers
+    uint64_t droppedSamples() const { return dropped; }         ///< Samples lost by slow subscribers (all time)
+    uint64_t rejectedClients() const { return rejected; }       ///< Connections refused because the server was full
+    size_t queuedMessages() const;                               ///< Messages waiting to be written, all subscribers
+
+private:
+    /**
+     * @brief State of one connected subscriber
+     */
+    struct Client {
+        int fd;                  ///< Connected non-blocking socket
+        OutboundQueue queue;     ///< Messages not yet written
+        bool resync;             ///< Lost a frame; waiting for the next keyframe
+        bool closing;            ///< Failed; removed after the current pass
+        uint64_t dropped;        ///< Samples this subscriber lost
+        char peer[INET_ADDRSTRLEN + 8];  ///< Address for log messages
+
+        Client(int f, size_t depth) : fd(f), queue(depth), resync(false), closing(false), dropped(0) { peer[0] = '\0'; }
+    };
+
+    void onAccept();
+    void onClientEvent(Client* c, uint32_t events);
+    void flushClient(Client* c);
+    void closeClient(Client* c);
+    void sweepClients();
+
+    EventLoop& loop;                                ///< Loop the sockets are registered with
+    int listen_fd;                                  ///< Listening socket
+    StreamEncoder encoder;                          ///< Shared encoder; one message per sample for all subscribers
+    size_t max_clients;                             ///< Subscriber limit
+    size_t queue_depth;                             ///< Per-subscriber queue capacity
+    BufferPool pool;                                ///< Message buffers, max_clients * queue_depth + 1
+    std::vector<std::unique_ptr<Client>> clients;   ///< Connected subscribers
+    uint64_t dropped;                               ///< Samples lost by slow subscribers
+    uint64_t rejected;                              ///< Connections refused because the server was full
+};
+
+#endif // PUBSUB_SERVER_H
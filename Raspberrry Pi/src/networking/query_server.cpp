@@ -0,0 +1,284 @@
+// query_server.cpp
+#include "query_server.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sock.h"
+#include "../common/water_quality.h"
+#include "../common/logger.h"
+
+const size_t QueryServer::MAX_CONNECTIONS;
+const size_t QueryServer::CHUNK_SAMPLES;
+const size_t QueryServer::SLICE_CHUNKS;
+
+QueryServer::QueryServer(EventLoop& l, const std::string& path, const SampleLog* log)
+    : loop(l), socket_path(path), listen_fd(-1), history(log), answered(0) {
+    for (Connection& c : slots) {
+        c.fd = -1;
+        c.busy = false;
+        c.posted = false;
+    }
+    listen_fd = Socket::createUnixListener(path, 8);
+    loop.add_fd(listen_fd, [this]() { onAccept(); });
+    loop.set_name(listen_fd, "query_accept");
+    LOG_INFO("Query socket listening on {}", path);
+}
+
+QueryServer::~QueryServer() {
+    for (Connection& c : slots) {
+        if (c.fd >= 0) {
+            closeConnection(&c);
+        }
+    }
+    if (listen_fd >= 0) {
+        loop.remove_fd(listen_fd);
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+// Edge-triggered: accept until the backlog is empty
+void QueryServer::onAccept() {
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Query accept failed: {}", strerror(errno));
+            }
+            return;
+        }
+        adopt(fd);
+    }
+}
+
+bool QueryServer::adopt(int fd) {
+    Connection* c = nullptr;
+    for (Connection& slot : slots) {
+        if (slot.fd < 0) {
+            c = &slot;
+            break;
+        }
+    }
+    if (c == nullptr) {
+        close(fd);
+        return false;
+    }
+    c->fd = fd;
+    c->request_len = 0;
+    c->busy = false;
+    c->eof = false;
+    c->out_len = 0;
+    c->out_sent = 0;
+    loop.add_fd(fd, EPOLLIN | EPOLLOUT | EPOLLET, [this, c](uint32_t events) { onEvent(c, events); });
+    loop.set_name(fd, "query_client");
+    return true;
+}
+
+void QueryServer::onEvent(Connection* c, uint32_t events) {
+    if (events & EPOLLERR) {
+        closeConnection(c);
+        return;
+    }
+    if (c->busy) {
+        if (events & EPOLLOUT) {
+            pump(c);
+        }
+        return;  // Further requests are read once the current answer is sent
+    }
+    if (events & (EPOLLIN | EPOLLHUP)) {
+        readRequests(c);
+    }
+}
+
+// Read requests until one starts an answer, the socket is drained or the peer is done
+void QueryServer::readRequests(Connection* c) {
+    c->reading = true;
+    while (c->fd >= 0 && !c->busy) {
+        ssize_t n = recv(c->fd, c->request + c->request_len, QueryProtocol::REQUEST_SIZE - c->request_len, 0);
+        if (n > 0) {
+            c->request_len += static_cast<size_t>(n);
+            if (c->request_len == QueryProtocol::REQUEST_SIZE) {
+                c->request_len = 0;
+                startQuery(c);
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        closeConnection(c);  // Peer finished sending and every answer has been sent, or an error
+        break;
+    }
+    c->reading = false;
+}
+
+void QueryServer::startQuery(Connection* c) {
+    QueryProtocol::Request& q = c->query;
+    c->busy = true;
+    c->out_len = 0;
+    c->out_sent = 0;
+    c->final_sent = false;
+    uint8_t* payload = c->out + QueryProtocol::RESPONSE_HEADER;
+
+    if (!QueryProtocol::decodeRequest(c->request, &q) ||
+        (q.op != QueryProtocol::LATEST && q.op != QueryProtocol::RANGE && q.op != QueryProtocol::AGGREGATE)) {
+        // The stream can no longer be trusted to be aligned on requests
+        q.id = SampleRecord::get32(c->request + 4);
+        q.op = c->request[2];
+        c->eof = true;
+        finishChunk(c, QueryProtocol::BAD_REQUEST, QueryProtocol::FLAG_FINAL, 0);
+    } else if (q.op == QueryProtocol::LATEST) {
+        const WaterQuality& wq = WaterQuality::getInstance();
+        if (wq.getTimestamp() == 0) {
+            finishChunk(c, QueryProtocol::NOT_FOUND, QueryProtocol::FLAG_FINAL, 0);
+        } else {
+            SampleRecord::encode(wq.snapshot(), payload);
+            finishChunk(c, QueryProtocol::OK, QueryProtocol::FLAG_FINAL, SampleRecord::SIZE);
+        }
+    } else if (history == nullptr) {
+        finishChunk(c, QueryProtocol::NO_HISTORY, QueryProtocol::FLAG_FINAL, 0);
+    } else {
+        c->cursor.start(*history, q.from_us, q.to_us);
+        c->aggregate = QueryProtocol::Aggregate();
+        c->sums[0] = c->sums[1] = c->sums[2] = 0;
+    }
+    pump(c);
+}
+
+// Send and produce chunks until the answer is complete, the socket is full or the slice budget is used up
+void QueryServer::pump(Connection* c) {
+    for (size_t chunks = 0; c->fd >= 0 && c->busy;) {
+        if (c->out_sent < c->out_len) {
+            if (!flush(c)) {
+                return;  // Resumed by EPOLLOUT, or closed
+            }
+            if (c->final_sent) {
+                c->busy = false;
+                answered++;
+                if (c->eof) {
+                    closeConnection(c);
+                    return;
+                }
+                if (!c->reading) {
+                    readRequests(c);  // Edge-triggered: requests may already be waiting
+                }
+                return;
+            }
+        }
+        if (chunks == SLICE_CHUNKS) {
+            schedule(c);  // Let the timers run before reading more history
+            return;
+        }
+        produce(c);
+        chunks++;
+    }
+}
+
+void QueryServer::schedule(Connection* c) {
+    if (!c->posted) {
+        c->posted = true;
+        loop.post([this, c]() {
+            c->posted = false;
+            pump(c);
+        });
+    }
+}
+
+// Fill the chunk buffer with the next part of a RANGE or AGGREGATE answer (may leave it empty)
+void QueryServer::produce(Connection* c) {
+    const QueryProtocol::Request& q = c->query;
+    uint8_t* payload = c->out + QueryProtocol::RESPONSE_HEADER;
+    size_t n = c->cursor.next(samples, CHUNK_SAMPLES);
+
+    if (q.op == QueryProtocol::RANGE) {
+        size_t len = 0;
+        bool compressed = (q.flags & QueryProtocol::FLAG_COMPRESSED) != 0;
+        c->encoder.reset();  // Every chunk starts with a keyframe
+        for (size_t i = 0; i < n; ++i) {
+            if (compressed) {
+                len += c->encoder.encode(samples[i], payload + len);
+            } else {
+                SampleRecord::encode(samples[i], payload + len);
+                len += SampleRecord::SIZE;
+            }
+        }
+        uint8_t flags = (compressed ? QueryProtocol::FLAG_COMPRESSED : 0) | (c->cursor.active() ? 0 : QueryProtocol::FLAG_FINAL);
+        finishChunk(c, QueryProtocol::OK, flags, len);
+        return;
+    }
+
+    QueryProtocol::Aggregate& a = c->aggregate;
+    for (size_t i = 0; i < n; ++i) {
+        const Sample& s = samples[i];
+        float values[3] = {s.turbidity, s.temperature, s.pH};
+        if (a.count == 0) {
+            a.first_us = s.timestamp_us;
+            for (int k = 0; k < 3; ++k) {
+                a.min[k] = a.max[k] = values[k];
+            }
+        }
+        a.last_us = s.timestamp_us;
+        for (int k = 0; k < 3; ++k) {
+            if (values[k] < a.min[k]) a.min[k] = values[k];
+            if (values[k] > a.max[k]) a.max[k] = values[k];
+            c->sums[k] += values[k];
+        }
+        a.count++;
+    }
+    if (c->cursor.active()) {
+        c->out_len = 0;
+        c->out_sent = 0;
+        return;
+    }
+    if (a.count == 0) {
+        finishChunk(c, QueryProtocol::NOT_FOUND, QueryProtocol::FLAG_FINAL, 0);
+        return;
+    }
+    for (int k = 0; k < 3; ++k) {
+        a.mean[k] = static_cast<float>(c->sums[k] / static_cast<double>(a.count));
+    }
+    QueryProtocol::encodeAggregate(a, payload);
+    finishChunk(c, QueryProtocol::OK, QueryProtocol::FLAG_FINAL, QueryProtocol::AGGREGATE_SIZE);
+}
+
+void QueryServer::finishChunk(Connection* c, uint8_t status, uint8_t flags, size_t payload_len) {
+    QueryProtocol::encodeHeader(c->query.op, status, flags, c->query.id, static_cast<uint32_t>(payload_len), c->out);
+    c->out_len = QueryProtocol::RESPONSE_HEADER + payload_len;
+    c->out_sent = 0;
+    c->final_sent = (flags & QueryProtocol::FLAG_FINAL) != 0;
+}
+
+// Write the rest of the chunk; false if the socket is full or the connection was closed
+bool QueryServer::flush(Connection* c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        closeConnection(c);
+        return false;
+    }
+    return true;
+}
+
+void QueryServer::closeConnection(Connection* c) {
+    loop.remove_fd(c->fd);
+    close(c->fd);
+    c->fd = -1;
+    c->busy = false;
+    c->cursor.abort();
+}
@@ -0,0 +1,100 @@
+/**
+ * @file query_server.h
+ * @brief Unix domain socket API answering history queries from local tools
+ * @details Requests and responses use the binary format of common/query_protocol.h: latest value, time range and
+ *          aggregates (count, min, max, mean) over the on-device history. The listening socket and the connections
+ *          are registered with the EventLoop. A query is answered in slices: each slice reads at most a few buffers of
+ *          history and then yields with EventLoop::post(), so the sampling timers run between slices however large
+ *          the range is. History is streamed through one fixed chunk buffer per connection and never collected into
+ *          a temporary container.
+ */
+
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../event_loop/event_loop.h"
+#include "../common/query_protocol.h"
+#include "../common/sample_codec.h"
+#include "../storage/history_cursor.h"
+#include "../storage/sample_log.h"
+
+/**
+ * @class QueryServer
+ * @brief Serves QueryProtocol requests on a Unix domain socket
+ */
+class QueryServer {
+public:
+    static const size_t MAX_CONNECTIONS = 4;     ///< Clients served at the same time (further connections are closed)
+    static const size_t CHUNK_SAMPLES = 128;     ///< Samples per RANGE chunk
+    static const size_t SLICE_CHUNKS = 16;       ///< Chunks (of up to CHUNK_SAMPLES samples) produced before yielding
+
+    /**
+     * @brief Constructor, starts listening
+     * @param loop Event loop the sockets are registered with
+     * @param path Socket path
+     * @param history On-device history (null if none is kept)
+     * @throws std::runtime_error When the socket cannot be created
+     */
+    QueryServer(EventLoop& loop, const std::string& path, const SampleLog* history);
+
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+     * @brief Serve a socket that is already connected, as if it had been accepted (e.g. one end of a socketpair)
+     * @param fd Non-blocking connected stream socket; owned from now on
+     * @return bool false if every connection slot is taken, in which case fd has been closed
+     */
+    bool adopt(int fd);
+
+    uint64_t queries() const { return answered; }  ///< Requests answered since start
+
+private:
+    /**
+     * @brief One client with the query it is being answered
+     */
+    struct Connection {
+        int fd;                              ///< Connected socket, -1 when the slot is free
+        uint8_t request[QueryProtocol::REQUEST_SIZE];  ///< Request being received
+        size_t request_len;                  ///< Bytes of the request received
+        bool busy;                           ///< A query is being answered
+        bool posted;                         ///< A continuation is queued on the loop
+        bool eof;                            ///< Close once the current answer is sent (bad request)
+        bool reading;                        ///< Inside readRequests() (answers completed meanwhile do not recurse)
+        QueryProtocol::Request query;        ///< Query being answered
+        HistoryCursor cursor;                ///< Position in the history
+        SampleEncoder encoder;               ///< Frame encoder for COMPRESSED ranges
+        QueryProtocol::Aggregate aggregate;  ///< Running aggregate
+        double sums[3];                      ///< Running sums for the means
+        uint8_t out[QueryProtocol::RESPONSE_HEADER + CHUNK_SAMPLES * SampleCodec::MAX_FRAME];  ///< Chunk being sent
+        size_t out_len;                      ///< Bytes of the chunk
+        size_t out_sent;                     ///< Bytes of the chunk already sent
+        bool final_sent;                     ///< The chunk being sent is the last one of the answer
+    };
+
+    void onAccept();
+    void onEvent(Connection* c, uint32_t events);
+    void readRequests(Connection* c);
+    void startQuery(Connection* c);
+    void pump(Connection* c);
+    void schedule(Connection* c);
+    bool flush(Connection* c);
+    void produce(Connection* c);
+    void finishChunk(Connection* c, uint8_t status, uint8_t flags, size_t payload_len);
+    void closeConnection(Connection* c);
+
+    EventLoop& loop;                      ///< Loop the sockets are registered with
+    std::string socket_path;              ///< Removed on destruction
+    int listen_fd;                        ///< Listening socket
+    const SampleLog* history;             ///< History being queried
+    Connection slots[MAX_CONNECTIONS];    ///< Connection slots
+    Sample samples[CHUNK_SAMPLES];        ///< Scratch for one chunk of samples (the loop is single-threaded)
+    uint64_t answered;                    ///< Requests answered
+};
+
+#endif // QUERY_SERVER_H
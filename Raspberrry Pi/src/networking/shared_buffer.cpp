@@ -0,0 +1,30 @@
+// shared_buffer.cpp
+#include "shared_buffer.h"
+
+BufferPool::BufferPool(size_t count) : slots(count), free_list(nullptr), free_count(0) {
+    for (SharedBuffer& b : slots) {
+        b.len = 0;
+        b.keyframe = false;
+        b.refs = 0;
+        b.pool = this;
+        put(&b);
+    }
+}
+
+BufferRef BufferPool::acquire() {
+    if (free_list == nullptr) {
+        return BufferRef();
+    }
+    SharedBuffer* b = free_list;
+    free_list = b->next_free;
+    free_count--;
+    b->len = 0;
+    b->keyframe = false;
+    return BufferRef(b);
+}
+
+void BufferPool::put(SharedBuffer* b) {
+    b->next_free = free_list;
+    free_list = b;
+    free_count++;
+}
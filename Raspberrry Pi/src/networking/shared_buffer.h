@@ -0,0 +1,126 @@
+/**
+ * @file shared_buffer.h
+ * @brief Reference-counted message buffers taken from a fixed pool
+ * @details One encoded sample is written into one SharedBuffer and a BufferRef to it is queued for every receiver,
+ *          so the bytes exist once no matter how many clients are attached. The buffer returns to its pool when the
+ *          last reference is dropped. All buffers are allocated when the pool is created; the steady state does not
+ *          touch the heap. The reference count is not atomic: buffers are only used on the event loop thread.
+ */
+
+#ifndef SHARED_BUFFER_H
+#define SHARED_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BufferPool;
+
+/**
+ * @class SharedBuffer
+ * @brief Fixed-capacity message storage owned by a BufferPool
+ */
+class SharedBuffer {
+public:
+    static const size_t CAPACITY = 192;  ///< Largest message in bytes (a JSON sample is about 80)
+
+    uint8_t data[CAPACITY];  ///< Message bytes
+    size_t len;              ///< Number of valid bytes in data
+    bool keyframe;           ///< Whether the message can be decoded without its predecessors
+
+private:
+    friend class BufferPool;
+    friend class BufferRef;
+
+    uint32_t refs;           ///< Number of live BufferRef handles
+    BufferPool* pool;        ///< Pool to return to
+    SharedBuffer* next_free; ///< Free-list link while unused
+};
+
+/**
+ * @class BufferRef
+ * @brief Counted handle to a SharedBuffer; copying shares the buffer
+ */
+class BufferRef {
+public:
+    BufferRef() : buf(nullptr) {}
+    BufferRef(const BufferRef& other) : buf(other.buf) { retain(); }
+    ~BufferRef() { release(); }
+
+    BufferRef& operator=(const BufferRef& other) {
+        if (buf != other.buf) {
+            release();
+            buf = other.buf;
+            retain();
+        }
+        return *this;
+    }
+
+    SharedBuffer* get() const { return buf; }
+    SharedBuffer* operator->() const { return buf; }
+    explicit operator bool() const { return buf != nullptr; }
+
+    /**
+     * @brief Drop the reference (the handle becomes empty)
+     */
+    void reset() {
+        release();
+        buf = nullptr;
+    }
+
+private:
+    friend class BufferPool;
+    explicit BufferRef(SharedBuffer* b) : buf(b) { retain(); }
+
+    void retain() {
+        if (buf) {
+            buf->refs++;
+        }
+    }
+    inline void release();
+
+    SharedBuffer* buf;  ///< Referenced buffer (null if empty)
+};
+
+/**
+ * @class BufferPool
+ * @brief Preallocated set of SharedBuffers with a free list
+ */
+class BufferPool {
+public:
+    /**
+     * @brief Constructor, allocates every buffer up front
+     * @param count Number of buffers
+     */
+    explicit BufferPool(size_t count);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief Take a free buffer
+     * @return BufferRef Handle to an empty buffer, or an empty handle when the pool is exhausted
+     */
+    BufferRef acquire();
+
+    /**
+     * @brief Number of buffers not referenced by anyone
+     */
+    size_t available() const { return free_count; }
+
+private:
+    friend class BufferRef;
+    void put(SharedBuffer* b);
+
+    std::vector<SharedBuffer> slots;  ///< Storage of every buffer (never resized)
+    SharedBuffer* free_list;          ///< First unused buffer
+    size_t free_count;                ///< Length of the free list
+};
+
+inline void BufferRef::release() {
+    if (buf && --buf->refs == 0) {
+        buf->pool->put(buf);
+    }
+}
+
+#endif // SHARED_BUFFER_H
@@ -2,6 +2,8 @@
 #include <cstring>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <stdexcept>
 
@@ -119,6 +121,77 @@ void Socket::init(int *ser_sock, int *cli_sock) {
 }
 
 
+/**
+ * @brief Create a non-blocking listening socket (the caller accepts connections from the event loop)
+ * @param port Port to listen on
+ * @param backlog Maximum length of the pending connection queue
+ * @return int Listening socket descriptor
+ */
+int Socket::createListener(int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Listening socket creation failed：" + std::string(strerror(errno)));
+    }
+
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to set socket options：" + std::string(strerror(errno)));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        throw std::runtime_error("Binding port（" + std::to_string(port) + "）Failure：" + std::string(strerror(errno)));
+    }
+    if (listen(fd, backlog) < 0) {
+        close(fd);
+        throw std::runtime_error("Listening port（" + std::to_string(port) + "）Failure：" + std::string(strerror(errno)));
+    }
+    return fd;
+}
+
+/**
+ * @brief Create a non-blocking Unix domain listening socket
+ * @param path Socket path
+ * @param backlog Maximum length of the pending connection queue
+ * @return int Listening socket descriptor
+ */
+int Socket::createUnixListener(const std::string& path, int backlog) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Invalid socket path：" + path);
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Listening socket creation failed：" + std::string(strerror(errno)));
+    }
+    // Only a socket file can be left behind by a previous run; anything else is not ours to remove
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        throw std::runtime_error("Binding socket（" + path + "）Failure：" + std::string(strerror(errno)));
+    }
+    if (listen(fd, backlog) < 0) {
+        close(fd);
+        unlink(path.c_str());
+        throw std::runtime_error("Listening socket（" + path + "）Failure：" + std::string(strerror(errno)));
+    }
+    return fd;
+}
+
+
 /**
  * @brief Handling client connections (receiving data and echoing)
  * @param client_socket Client socket descriptor
@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <string>
 
 #include "../common/com.h"
 
@@ -32,6 +33,24 @@ public:
      * @throws When initialization fails, error information is output through standard error and the program is terminated.
      */
     static void init(int *ser_sock, int *cli_sock);
+
+    /**
+     * Create a non-blocking TCP listening socket for use with the event loop
+     * @param port Port to listen on (all interfaces)
+     * @param backlog Length of the pending connection queue
+     * @return Listening socket descriptor
+     * @throws std::runtime_error When the socket cannot be created, bound or put into listening state
+     */
+    static int createListener(int port, int backlog);
+
+    /**
+     * Create a non-blocking Unix domain listening socket for use with the event loop
+     * @param path Socket path; a stale socket file left by a previous run is replaced
+     * @param backlog Length of the pending connection queue
+     * @return Listening socket descriptor
+     * @throws std::runtime_error When the socket cannot be created, bound or put into listening state
+     */
+    static int createUnixListener(const std::string& path, int backlog);
     
     /**
      * Handle client connections
@@ -0,0 +1,31 @@
+// stream_encoder.cpp
+#include "stream_encoder.h"
+#include <cinttypes>
+#include <cstdio>
+
+StreamEncoder::StreamEncoder(Encoding encoding, uint32_t keyframe_interval)
+    : enc(encoding), codec(keyframe_interval) {}
+
+size_t StreamEncoder::encode(const Sample& s, uint8_t* out, bool* keyframe) {
+    if (enc == GORILLA) {
+        size_t len = codec.encode(s, out);
+        *keyframe = out[0] == SampleCodec::KEYFRAME;
+        return len;
+    }
+    int len = std::snprintf(reinterpret_cast<char*>(out), MAX_MESSAGE,
+                            "{\"seq\":%" PRIu64 ", \"ts\":%" PRId64 ", \"tur\":\"%.2f\", \"tmp\":\"%.2f\", \"pH\":\"%.2f\"}",
+                            s.seq, s.timestamp_us, s.turbidity, s.temperature, s.pH);
+    *keyframe = true;
+    if (len < 0) {
+        return 0;
+    }
+    return static_cast<size_t>(len) < MAX_MESSAGE ? static_cast<size_t>(len) : MAX_MESSAGE - 1;
+}
+
+const char* StreamEncoder::hello(Encoding encoding) {
+    return encoding == GORILLA ? "#STREAM gorilla\n" : "#STREAM json\n";
+}
+
+StreamEncoder::Encoding StreamEncoder::parse(const std::string& name) {
+    return name == "gorilla" ? GORILLA : JSON;
+}
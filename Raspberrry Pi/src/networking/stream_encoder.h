@@ -0,0 +1,73 @@
+/**
+ * @file stream_encoder.h
+ * @brief Encodes live samples in one of the wire encodings understood by QtServer
+ * @details A stream starts with the line returned by hello() ("#STREAM json" or "#STREAM gorilla") followed by one
+ *          message per sample: a JSON object, or a SampleCodec frame. Everything that streams samples (the upstream
+ *          connection, the subscriber server) encodes through this class, so each sample is formatted once per
+ *          encoding and the result is shared by every receiver using it.
+ */
+
+#ifndef STREAM_ENCODER_H
+#define STREAM_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../common/sample.h"
+#include "../common/sample_codec.h"
+
+/**
+ * @class StreamEncoder
+ * @brief Stateful per-stream sample encoder
+ */
+class StreamEncoder {
+public:
+    /**
+     * @brief Wire encoding of live samples
+     */
+    enum Encoding {
+        JSON,     ///< One JSON object per sample (about 80 bytes)
+        GORILLA   ///< One SampleCodec frame per sample (about 8 bytes)
+    };
+
+    static const size_t MAX_MESSAGE = 192;  ///< Upper bound of one encoded sample in bytes
+
+    /**
+     * @brief Constructor
+     * @param encoding Wire encoding
+     * @param keyframe_interval Samples between keyframes (GORILLA only)
+     */
+    explicit StreamEncoder(Encoding encoding, uint32_t keyframe_interval = 60);
+
+    /**
+     * @brief Encode one sample
+     * @param s Sample to encode
+     * @param out Destination of at least MAX_MESSAGE bytes
+     * @param keyframe Set to whether the message decodes without its predecessors (always true for JSON)
+     * @return size_t Message length in bytes
+     */
+    size_t encode(const Sample& s, uint8_t* out, bool* keyframe);
+
+    /**
+     * @brief Make the next message a keyframe (a receiver joined or lost a message)
+     */
+    void forceKeyframe() { codec.reset(); }
+
+    Encoding encoding() const { return enc; }
+
+    /**
+     * @brief Stream announcement line for an encoding
+     */
+    static const char* hello(Encoding encoding);
+
+    /**
+     * @brief Parse a configuration value ("json" or "gorilla"; anything else is JSON)
+     */
+    static Encoding parse(const std::string& name);
+
+private:
+    Encoding enc;          ///< Wire encoding
+    SampleEncoder codec;   ///< Frame encoder (GORILLA only)
+};
+
+#endif // STREAM_ENCODER_H
@@ -0,0 +1,264 @@
+// upstream_endpoint.cpp
+#include "upstream_endpoint.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../common/sample.h"
+#include "../common/trace.h"
+#include "../common/logger.h"
+
+const int64_t UpstreamEndpoint::CONNECT_TIMEOUT_US;
+const int64_t UpstreamEndpoint::MIN_BACKOFF_US;
+const int64_t UpstreamEndpoint::MAX_BACKOFF_US;
+
+UpstreamEndpoint::UpstreamEndpoint(EventLoop& l, const sockaddr_in& a, StreamEncoder::Encoding e, size_t queue_depth,
+                                   SampleLog* h)
+    : loop(l), addr(a), enc(e), history(h), fd(-1), state(DISCONNECTED), deadline_us(0), backoff_us(MIN_BACKOFF_US),
+      control(1), queue(queue_depth), resync(false), command_len(0), dropped(0), connects(0) {
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    std::snprintf(label, sizeof(label), "%s:%u", ip, static_cast<unsigned>(ntohs(addr.sin_port)));
+}
+
+UpstreamEndpoint::~UpstreamEndpoint() {
+    if (fd >= 0) {
+        loop.remove_fd(fd);
+        close(fd);
+    }
+}
+
+void UpstreamEndpoint::poll(int64_t now_us) {
+    if (state == DISCONNECTED && now_us >= deadline_us) {
+        startConnect(now_us);
+    } else if (state == CONNECTING && now_us >= deadline_us) {
+        disconnect("connection timed out");
+    }
+}
+
+void UpstreamEndpoint::startConnect(int64_t now_us) {
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Upstream {}: socket creation failed - {}", label, strerror(errno));
+        deadline_us = now_us + backoff_us;
+        return;
+    }
+    state = CONNECTING;
+    deadline_us = now_us + CONNECT_TIMEOUT_US;
+    loop.add_fd(fd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, [this](uint32_t events) { onSocketEvent(events); });
+
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+        onConnected();
+    } else if (errno != EINPROGRESS) {
+        disconnect(strerror(errno));
+    }
+    // EINPROGRESS: completion is reported by EPOLLOUT
+}
+
+void UpstreamEndpoint::onConnected() {
+    state = CONNECTED;
+    backoff_us = MIN_BACKOFF_US;
+    connects++;
+    command_len = 0;
+    // Gorilla deltas are only meaningful after a keyframe
+    resync = enc == StreamEncoder::GORILLA;
+
+    // A fresh socket buffer is empty, so the announcement cannot block
+    const char* hello = StreamEncoder::hello(enc);
+    send(fd, hello, strlen(hello), MSG_NOSIGNAL);
+    LOG_INFO("Upstream {}: connected", label);
+}
+
+// Close the connection and schedule the next attempt; the queue is dropped, the samples remain in the history
+void UpstreamEndpoint::disconnect(const char* reason) {
+    if (state == CONNECTED) {
+        LOG_WARN("Upstream {}: disconnected ({})", label, reason);
+    } else {
+        LOG_WARN("Upstream {}: connection failed ({}), retrying in {} s", label, reason, backoff_us / 1000000);
+    }
+    if (fd >= 0) {
+        loop.remove_fd(fd);
+        close(fd);
+        fd = -1;
+    }
+    dropped += queue.size();
+    queue.clear();
+    backfill.abort();
+
+    deadline_us = monotonicMicros() + backoff_us;
+    backoff_us = backoff_us * 2 < MAX_BACKOFF_US ? backoff_us * 2 : MAX_BACKOFF_US;
+    state = DISCONNECTED;
+}
+
+bool UpstreamEndpoint::offer(const BufferRef& msg) {
+    if (state != CONNECTED || (resync && !msg->keyframe)) {
+        dropped++;
+        return false;
+    }
+    if (!queue.push(msg)) {
+        dropped++;
+        resync = enc == StreamEncoder::GORILLA;
+        return false;
+    }
+    resync = false;
+    if (!backfill.active()) {
+        flush();
+    }
+    return true;
+}
+
+void UpstreamEndpoint::flush() {
+    TRACE_SCOPE("UpstreamEndpoint::flush");
+    if (queue.flush(fd) == OutboundQueue::FAILED) {
+        disconnect(strerror(errno));
+    }
+    TRACE_COUNTER("upstream_queue", queue.size());
+}
+
+void UpstreamEndpoint::onSocketEvent(uint32_t events) {
+    if (state == CONNECTING) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            disconnect(strerror(err));
+            return;
+        }
+        onConnected();
+        return;
+    }
+    if (state != CONNECTED) {
+        return;
+    }
+
+    if (events & EPOLLIN) {
+        readCommands();
+        if (state != CONNECTED) {
+            return;
+        }
+    }
+    if (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+        disconnect("closed by server");
+        return;
+    }
+    if (events & EPOLLOUT) {
+        if (backfill.active()) {
+            pumpBackfill();
+        } else {
+            flush();
+        }
+    }
+}
+
+// Drain the socket (edge-triggered) and execute every complete command line
+void UpstreamEndpoint::readCommands() {
+    char buf[256];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            disconnect("closed by server");
+            return;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                disconnect(strerror(errno));
+            }
+            return;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == '\n') {
+                command[command_len] = '\0';
+                handleCommand(command);
+                command_len = 0;
+                if (state != CONNECTED) {
+                    return;
+                }
+            } else if (command_len < sizeof(command) - 1) {
+                command[command_len++] = buf[i];
+            }
+        }
+    }
+}
+
+void UpstreamEndpoint::handleCommand(const char* line) {
+    long long from_ms = 0;
+    long long to_ms = 0;
+    if (std::sscanf(line, "BACKFILL %lld %lld", &from_ms, &to_ms) == 2) {
+        if (history == nullptr) {
+            LOG_WARN("Upstream {}: backfill requested but no history is kept", label);
+            return;
+        }
+        if (backfill.active()) {
+            // Restarting would cut the running response short of the length its header announced
+            LOG_WARN("Upstream {}: backfill requested while one is in progress", label);
+            sendControl("#BUSY BACKFILL\n");
+            return;
+        }
+        backfill.start(*history, from_ms * 1000, to_ms * 1000 + 999);
+        pumpBackfill();
+        return;
+    }
+    long long server_us = 0;
+    if (std::sscanf(line, "PING %lld", &server_us) == 1) {
+        // Stamped on receipt; an answer delayed by a full queue only makes this round trip a poor estimate,
+        // which the server discards in favour of the fastest recent one
+        char reply[64];
+        std::snprintf(reply, sizeof(reply), "#PONG %lld %lld\n", server_us, static_cast<long long>(realtimeMicros()));
+        sendControl(reply);
+        return;
+    }
+    LOG_WARN("Upstream {}: unknown command: {}", label, line);
+}
+
+// Queue a reply line between the messages; dropped while the previous reply is still queued
+void UpstreamEndpoint::sendControl(const char* text) {
+    BufferRef reply = control.acquire();
+    if (!reply) {
+        return;
+    }
+    int len = std::snprintf(reinterpret_cast<char*>(reply->data), SharedBuffer::CAPACITY, "%s", text);
+    reply->len = static_cast<size_t>(len);
+    reply->keyframe = false;
+    if (queue.push(reply) && !backfill.active()) {
+        flush();
+    }
+}
+
+/**
+ * @brief Send one slice of the backfill
+ * @details The response must not start in the middle of a live message, so the queue is written out before its
+ *          first byte; live messages arriving once it has started wait in the queue and are sent when it completes.
+ */
+void UpstreamEndpoint::pumpBackfill() {
+    if (state != CONNECTED || !backfill.active()) {
+        return;
+    }
+    if (!backfill.started() && !queue.empty()) {
+        OutboundQueue::Status st = queue.flush(fd);
+        if (st == OutboundQueue::FAILED) {
+            disconnect(strerror(errno));
+            return;
+        }
+        if (st == OutboundQueue::WOULD_BLOCK) {
+            return;
+        }
+    }
+    switch (backfill.pump(fd)) {
+    case BackfillSession::YIELD:
+        loop.post([this]() { pumpBackfill(); });
+        break;
+    case BackfillSession::DONE:
+        flush();
+        break;
+    case BackfillSession::FAILED:
+        disconnect("backfill failed");
+        break;
+    case BackfillSession::WOULD_BLOCK:
+        break;
+    }
+}
@@ -0,0 +1,130 @@
+/**
+ * @file upstream_endpoint.h
+ * @brief One server the node streams its samples to
+ * @details Each endpoint owns a non-blocking connection, its reconnect state, a bounded OutboundQueue and the choice
+ *          of wire encoding. Connecting never blocks: connect() is started from the sampling tick and completes on
+ *          EPOLLOUT. A lost or refused connection is retried with exponential backoff (1 s doubling up to 30 s).
+ *          Messages are SharedBuffers encoded once for all endpoints; an endpoint that is down or slow only loses
+ *          its own samples (they stay in the history for a later BACKFILL) and holds at most its queue.
+ *          Commands from the server ("BACKFILL <from_ms> <to_ms>") are answered on the same connection; live
+ *          messages are queued while a transfer runs and follow it. A BACKFILL received while one is still running
+ *          is refused with "#BUSY BACKFILL", as its response cannot start before the current one ends.
+ *          "PING <server_us>" is answered with
+ *          "#PONG <server_us> <node_us>", queued between messages, so the server can estimate the clock offset
+ *          between the two machines and correct the latency of the samples it receives.
+ */
+
+#ifndef UPSTREAM_ENDPOINT_H
+#define UPSTREAM_ENDPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <netinet/in.h>
+#include "../event_loop/event_loop.h"
+#include "../storage/sample_log.h"
+#include "backfill_session.h"
+#include "outbound_queue.h"
+#include "shared_buffer.h"
+#include "stream_encoder.h"
+
+/**
+ * @class UpstreamEndpoint
+ * @brief Connection state machine and queue for one upstream server
+ */
+class UpstreamEndpoint {
+public:
+    /**
+     * @brief Connection state
+     */
+    enum State {
+        DISCONNECTED,  ///< Waiting for the next connection attempt
+        CONNECTING,    ///< connect() in progress
+        CONNECTED      ///< Streaming
+    };
+
+    static const int64_t CONNECT_TIMEOUT_US = 5000000;  ///< Abandon a connection attempt after 5 s
+    static const int64_t MIN_BACKOFF_US = 1000000;      ///< First retry delay
+    static const int64_t MAX_BACKOFF_US = 30000000;     ///< Longest retry delay
+
+    /**
+     * @brief Constructor (does not connect yet; see poll())
+     * @param loop Event loop the connection is registered with
+     * @param addr Server address
+     * @param encoding Wire encoding expected by this server
+     * @param queue_depth Messages queued before samples are dropped
+     * @param history History answering BACKFILL requests (may be null)
+     */
+    UpstreamEndpoint(EventLoop& loop, const sockaddr_in& addr, StreamEncoder::Encoding encoding, size_t queue_depth,
+                     SampleLog* history);
+    ~UpstreamEndpoint();
+
+    UpstreamEndpoint(const UpstreamEndpoint&) = delete;
+    UpstreamEndpoint& operator=(const UpstreamEndpoint&) = delete;
+
+    /**
+     * @brief Drive connection attempts and timeouts; called once per sample
+     * @param now_us CLOCK_MONOTONIC time in microseconds
+     */
+    void poll(int64_t now_us);
+
+    /**
+     * @brief Queue one message for this endpoint
+     * @param msg Sample encoded with this endpoint's encoding
+     * @return bool False if the sample was dropped (not connected, queue full, or waiting for a keyframe)
+     */
+    bool offer(const BufferRef& msg);
+
+    /**
+     * @brief Count a sample that was not encoded for this endpoint (nobody with its encoding was connected)
+     */
+    void skip() { dropped++; }
+
+    /**
+     * @brief Whether the next gorilla message should be a keyframe for this endpoint to resume decoding
+     */
+    bool wantsKeyframe() const { return state == CONNECTED && resync && !queue.full(); }
+
+    /**
+     * @brief Whether messages for this endpoint should be encoded at all
+     */
+    bool connected() const { return state == CONNECTED; }
+
+    StreamEncoder::Encoding encoding() const { return enc; }
+    State currentState() const { return state; }
+    const char* name() const { return label; }
+    uint64_t droppedSamples() const { return dropped; }     ///< Samples this endpoint did not get
+    uint64_t reconnects() const { return connects > 0 ? connects - 1 : 0; }  ///< Successful connections after the first one
+    size_t queued() const { return queue.size(); }          ///< Messages waiting to be written
+
+private:
+    void startConnect(int64_t now_us);
+    void onConnected();
+    void disconnect(const char* reason);
+    void onSocketEvent(uint32_t events);
+    void flush();
+    void readCommands();
+    void handleCommand(const char* line);
+    void sendControl(const char* text);
+    void pumpBackfill();
+
+    EventLoop& loop;                  ///< Loop the socket is registered with
+    sockaddr_in addr;                 ///< Server address
+    char label[INET_ADDRSTRLEN + 8];  ///< "ip:port" for log messages
+    StreamEncoder::Encoding enc;      ///< Wire encoding
+    SampleLog* history;               ///< History answering BACKFILL requests (may be null)
+    int fd;                           ///< Socket (-1 when disconnected)
+    State state;                      ///< Connection state
+    int64_t deadline_us;              ///< Next connection attempt, or timeout of the current one
+    int64_t backoff_us;               ///< Delay before the next attempt after a failure
+    BufferPool control;               ///< Buffer for PONG replies (one outstanding at a time; outlives the queue)
+    OutboundQueue queue;              ///< Live messages not yet written
+    BackfillSession backfill;         ///< Current history transfer
+    bool resync;                      ///< Waiting for a keyframe before queueing gorilla deltas
+    char command[128];                ///< Partially received command line
+    size_t command_len;               ///< Number of bytes in command
+    uint64_t dropped;                 ///< Samples not queued
+    uint64_t connects;                ///< Successful connections
+};
+
+#endif // UPSTREAM_ENDPOINT_H
@@ -0,0 +1,138 @@
+// history_cursor.cpp
+#include "history_cursor.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include "../common/sample_record.h"
+
+HistoryCursor::HistoryCursor()
+    : log(nullptr), current(0), file_fd(-1), offset(0), remaining(0), from(0), to(0), buffer_len(0), buffer_pos(0),
+      is_active(false) {}
+
+HistoryCursor::~HistoryCursor() {
+    abort();
+}
+
+void HistoryCursor::start(const SampleLog& l, int64_t from_us, int64_t to_us) {
+    abort();
+    log = &l;
+    from = from_us;
+    to = to_us;
+    l.findRange(from_us, to_us, extents);
+    current = 0;
+    is_active = !extents.empty();
+}
+
+void HistoryCursor::abort() {
+    if (file_fd >= 0) {
+        close(file_fd);
+        file_fd = -1;
+    }
+    extents.clear();  // Keeps the capacity for the next query
+    current = 0;
+    remaining = 0;
+    buffer_len = 0;
+    buffer_pos = 0;
+    decoder.reset();
+    is_active = false;
+}
+
+// Read the next block of the current extent behind any undecoded bytes; false once every extent is read
+bool HistoryCursor::fill() {
+    while (remaining == 0) {
+        if (file_fd >= 0) {
+            close(file_fd);
+            file_fd = -1;
+            current++;
+        }
+        if (current >= extents.size()) {
+            return false;
+        }
+        const SampleLog::Extent& ext = extents[current];
+        file_fd = log->openSegment(ext.segment);
+        if (file_fd < 0) {
+            current++;  // Removed by retention since the lookup
+            continue;
+        }
+        offset = ext.offset;
+        remaining = ext.length;
+        // Every extent starts on a record or keyframe boundary; a partial frame of the previous one is useless
+        buffer_len = 0;
+        buffer_pos = 0;
+        decoder.reset();
+    }
+
+    if (buffer_pos > 0) {
+        std::memmove(buffer, buffer + buffer_pos, buffer_len - buffer_pos);
+        buffer_len -= buffer_pos;
+        buffer_pos = 0;
+    }
+    size_t want = BUFFER_SIZE - buffer_len;
+    if (want > remaining) {
+        want = remaining;
+    }
+    ssize_t n = pread(file_fd, buffer + buffer_len, want, offset);
+    if (n <= 0) {
+        if (n < 0 && errno == EINTR) {
+            return true;
+        }
+        remaining = 0;  // Truncated or unreadable: continue with the next extent
+        return true;
+    }
+    offset += n;
+    remaining -= static_cast<size_t>(n);
+    buffer_len += static_cast<size_t>(n);
+    return true;
+}
+
+// Decode the buffered bytes into samples of the range
+size_t HistoryCursor::drain(Sample* out, size_t max) {
+    size_t count = 0;
+    if (log->format() == SampleLog::RAW) {
+        while (count < max && buffer_len - buffer_pos >= SampleRecord::SIZE) {
+            Sample s;
+            bool valid = SampleRecord::decode(buffer + buffer_pos, &s);
+            buffer_pos += SampleRecord::SIZE;
+            if (valid && s.timestamp_us >= from && s.timestamp_us <= to) {
+                out[count++] = s;
+            }
+        }
+        return count;
+    }
+    while (count < max && buffer_pos < buffer_len) {
+        Sample s;
+        size_t used = 0;
+        SampleDecoder::Status st = decoder.decode(buffer + buffer_pos, buffer_len - buffer_pos, &s, &used);
+        if (st == SampleDecoder::NEED_MORE) {
+            if (remaining == 0) {
+                buffer_pos = buffer_len;  // Torn frame at the end of the extent
+            }
+            break;
+        }
+        if (st == SampleDecoder::CORRUPT) {
+            buffer_pos++;
+            continue;
+        }
+        buffer_pos += used;
+        if (st == SampleDecoder::SAMPLE && s.timestamp_us >= from && s.timestamp_us <= to) {
+            out[count++] = s;
+        }
+    }
+    return count;
+}
+
+size_t HistoryCursor::next(Sample* out, size_t max) {
+    if (!is_active || max == 0) {
+        return 0;
+    }
+    for (;;) {
+        size_t count = drain(out, max);
+        if (count > 0) {
+            return count;
+        }
+        if (!fill()) {
+            abort();
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file history_cursor.h
+ * @brief Incremental reader of a time range of the on-device history
+ * @details The range is mapped onto segment extents with SampleLog::findRange() and then read through one fixed
+ *          buffer, a few kilobytes at a time, so a query over months of history never holds more than one buffer of
+ *          it in memory and can be interleaved with the sampling ticks. Both segment formats are supported; samples
+ *          outside the range (GORILLA extents start at a keyframe) are skipped.
+ */
+
+#ifndef HISTORY_CURSOR_H
+#define HISTORY_CURSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+#include "sample_log.h"
+#include "../common/sample_codec.h"
+
+/**
+ * @class HistoryCursor
+ * @brief Yields the stored samples of a time range in ascending order
+ */
+class HistoryCursor {
+public:
+    static const size_t BUFFER_SIZE = 4096;  ///< Bytes read from a segment file at a time
+
+    HistoryCursor();
+    ~HistoryCursor();
+
+    HistoryCursor(const HistoryCursor&) = delete;
+    HistoryCursor& operator=(const HistoryCursor&) = delete;
+
+    /**
+     * @brief Look up a time range
+     * @param log History to read from
+     * @param from_us Inclusive start (CLOCK_REALTIME, microseconds)
+     * @param to_us Inclusive end
+     * @note A running iteration is dropped first
+     */
+    void start(const SampleLog& log, int64_t from_us, int64_t to_us);
+
+    /**
+     * @brief Read the next samples of the range
+     * @param out Destination array
+     * @param max Size of the destination array
+     * @return size_t Number of samples stored; 0 once the range is exhausted
+     * @note Reads at most one buffer from the segment files per call unless it held no sample of the range
+     */
+    size_t next(Sample* out, size_t max);
+
+    /**
+     * @brief Whether samples remain
+     */
+    bool active() const { return is_active; }
+
+    /**
+     * @brief Drop the iteration and close its file
+     */
+    void abort();
+
+private:
+    bool fill();
+    size_t drain(Sample* out, size_t max);
+
+    const SampleLog* log;                   ///< History being read
+    std::vector<SampleLog::Extent> extents; ///< Byte ranges of the query
+    size_t current;                         ///< Index of the extent being read
+    int file_fd;                            ///< Open segment file of the current extent (-1 if none)
+    off_t offset;                           ///< Next byte to read from the current segment
+    size_t remaining;                       ///< Bytes left in the current extent
+    int64_t from;                           ///< Range start
+    int64_t to;                             ///< Range end
+    SampleDecoder decoder;                  ///< Frame decoder (GORILLA segments)
+    uint8_t buffer[BUFFER_SIZE];            ///< Bytes read but not yet decoded
+    size_t buffer_len;                      ///< Valid bytes in the buffer
+    size_t buffer_pos;                      ///< Next byte to decode
+    bool is_active;                         ///< Iteration in progress
+};
+
+#endif // HISTORY_CURSOR_H
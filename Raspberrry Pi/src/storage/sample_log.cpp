@@ -0,0 +1,454 @@
+// sample_log.cpp
+#include "sample_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../common/sample_record.h"
+#include "../common/logger.h"
+
+SampleLog::SampleLog() : max_segments(0), active_fd(-1), index_fd(-1), last_seq(0), fmt(RAW) {}
+
+SampleLog::~SampleLog() {
+    if (active_fd >= 0) {
+        close(active_fd);
+    }
+    if (index_fd >= 0) {
+        close(index_fd);
+    }
+}
+
+SampleLog::Path SampleLog::segmentPath(uint64_t segment) const {
+    Path path;
+    std::snprintf(path.str, sizeof(path.str), "%s/seg-%016" PRIx64 ".%s", dir.c_str(), segment, fmt == RAW ? "dat" : "gor");
+    return path;
+}
+
+SampleLog::Path SampleLog::indexPath(uint64_t segment) const {
+    Path path;
+    std::snprintf(path.str, sizeof(path.str), "%s/seg-%016" PRIx64 ".idx", dir.c_str(), segment);
+    return path;
+}
+
+/**
+ * @brief Open the history directory and rebuild the segment table from the files found in it
+ * @details Only the first and last record of each segment are read, so recovery cost does not grow with the
+ *          amount of history kept on the device.
+ */
+bool SampleLog::open(const std::string& directory, size_t max_segs, Format format, uint32_t keyframe_interval) {
+    max_segments = max_segs > 0 ? max_segs : 1;
+    fmt = format;
+    encoder = SampleEncoder(keyframe_interval);
+    const char* extension = fmt == RAW ? "dat" : "gor";
+    const char* other = fmt == RAW ? "gor" : "dat";
+
+    if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+        LOG_ERROR("Unable to create history directory {}: {}", directory, strerror(errno));
+        return false;
+    }
+
+    DIR* d = opendir(directory.c_str());
+    if (d == nullptr) {
+        LOG_ERROR("Unable to open history directory {}: {}", directory, strerror(errno));
+        return false;
+    }
+    std::vector<uint64_t> found;
+    size_t foreign = 0;
+    while (dirent* entry = readdir(d)) {
+        uint64_t first_seq;
+        char tail[8];
+        if (std::sscanf(entry->d_name, "seg-%16" SCNx64 ".%4s", &first_seq, tail) == 2) {
+            if (std::strcmp(tail, extension) == 0) {
+                found.push_back(first_seq);
+            } else if (std::strcmp(tail, other) == 0) {
+                foreign++;
+            }
+        }
+    }
+    closedir(d);
+    // Sequence numbers and retention follow one format only: appending next to the other would restart the numbering
+    if (foreign > 0) {
+        LOG_ERROR("History directory {} holds {} segments of the other history_format; move them away or switch back",
+                  directory, foreign);
+        return false;
+    }
+    dir = directory;
+    std::sort(found.begin(), found.end());
+
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (fmt == RAW) {
+            recoverSegment(found[i]);
+        } else {
+            recoverEncodedSegment(found[i]);
+        }
+    }
+    enforceRetention();
+    segments.reserve(max_segments + 1);  // Rolling to a new segment never grows the table
+
+    // Keep appending to the newest segment if it still has room
+    if (!segments.empty() && segments.back().count < SEGMENT_RECORDS) {
+        active_fd = ::open(segmentPath(segments.back().first_seq).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (active_fd < 0) {
+            LOG_ERROR("Unable to reopen history segment: {}", strerror(errno));
+        }
+        if (fmt == GORILLA) {
+            index_fd = ::open(indexPath(segments.back().first_seq).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        }
+    }
+    return true;
+}
+
+// Read the boundaries of one segment and drop any partially written tail
+bool SampleLog::recoverSegment(uint64_t first_seq) {
+    Path path = segmentPath(first_seq);
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+    uint64_t count = static_cast<uint64_t>(st.st_size) / SampleRecord::SIZE;
+
+    uint8_t rec[SampleRecord::SIZE];
+    Sample first, last;
+    // Walk back over records that fail their checksum (torn writes at power loss)
+    while (count > 0) {
+        off_t off = static_cast<off_t>((count - 1) * SampleRecord::SIZE);
+        if (pread(fd, rec, sizeof(rec), off) == static_cast<ssize_t>(sizeof(rec)) && SampleRecord::decode(rec, &last)) {
+            break;
+        }
+        count--;
+    }
+    if (static_cast<uint64_t>(st.st_size) != count * SampleRecord::SIZE) {
+        LOG_WARN("Truncating damaged tail of {}", path.c_str());
+        if (ftruncate(fd, static_cast<off_t>(count * SampleRecord::SIZE)) == -1) {
+            LOG_ERROR("Truncating {} failed: {}", path.c_str(), strerror(errno));
+        }
+    }
+    if (count == 0 || pread(fd, rec, sizeof(rec), 0) != static_cast<ssize_t>(sizeof(rec)) || !SampleRecord::decode(rec, &first)) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+    close(fd);
+
+    Segment seg;
+    seg.first_seq = first_seq;
+    seg.count = count;
+    seg.bytes = count * SampleRecord::SIZE;
+    seg.first_ts = first.timestamp_us;
+    seg.last_ts = last.timestamp_us;
+    segments.push_back(seg);
+    last_seq = std::max(last_seq, last.seq);
+    return true;
+}
+
+// Read the keyframe index of a segment into memory
+bool SampleLog::readIndex(uint64_t segment, std::vector<uint8_t>& index) const {
+    int fd = ::open(indexPath(segment).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+    index.resize(static_cast<size_t>(st.st_size) / INDEX_ENTRY_SIZE * INDEX_ENTRY_SIZE);
+    ssize_t n = index.empty() ? 0 : pread(fd, &index[0], index.size(), 0);
+    close(fd);
+    if (n != static_cast<ssize_t>(index.size())) {
+        index.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Recover an encoded segment
+ * @details Decodes from the last indexed keyframe to the end of the file to find the newest sample, then cuts off
+ *          any partial frame and any index entry that points past the surviving data.
+ */
+bool SampleLog::recoverEncodedSegment(uint64_t first_seq) {
+    Path path = segmentPath(first_seq);
+    std::vector<uint8_t> index;
+    readIndex(first_seq, index);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+
+    // Index entries are written before their keyframe, so the tail may point at data that never made it
+    while (!index.empty() && SampleRecord::get64(&index[index.size() - INDEX_ENTRY_SIZE] + 16) >= size) {
+        index.resize(index.size() - INDEX_ENTRY_SIZE);
+    }
+    uint64_t start = 0;
+    size_t good = 0;
+    uint64_t decoded = 0;
+    Sample first = Sample();
+    Sample last = Sample();
+    std::vector<uint8_t> tail;
+    uint64_t limit = size;  // Decoding window end, moves back when a damaged keyframe is skipped
+    for (;;) {
+        start = index.empty() ? 0 : SampleRecord::get64(&index[index.size() - INDEX_ENTRY_SIZE] + 16);
+        tail.resize(static_cast<size_t>(limit - start));
+        if (!tail.empty() && pread(fd, &tail[0], tail.size(), static_cast<off_t>(start)) != static_cast<ssize_t>(tail.size())) {
+            tail.clear();
+        }
+        SampleDecoder decoder;
+        good = 0;
+        decoded = 0;
+        while (good < tail.size()) {
+            Sample s;
+            size_t used = 0;
+            if (decoder.decode(&tail[good], tail.size() - good, &s, &used) != SampleDecoder::SAMPLE) {
+                break;
+            }
+            if (decoded++ == 0) {
+                first = s;
+            }
+            last = s;
+            good += used;
+        }
+        // A damaged keyframe: fall back to the previous one
+        if (decoded > 0 || index.empty()) {
+            break;
+        }
+        index.resize(index.size() - INDEX_ENTRY_SIZE);
+        limit = start;
+    }
+    uint64_t end = start + good;
+    if (end != size) {
+        LOG_WARN("Truncating damaged tail of {}", path.c_str());
+        if (ftruncate(fd, static_cast<off_t>(end)) == -1) {
+            LOG_ERROR("Truncating {} failed: {}", path.c_str(), strerror(errno));
+        }
+    }
+    close(fd);
+
+    if (decoded == 0) {
+        unlink(path.c_str());
+        unlink(indexPath(first_seq).c_str());
+        return false;
+    }
+    if (truncate(indexPath(first_seq).c_str(), static_cast<off_t>(index.size())) == -1 && errno != ENOENT) {
+        LOG_ERROR("Truncating {} failed: {}", indexPath(first_seq).c_str(), strerror(errno));
+    }
+
+    Segment seg;
+    seg.first_seq = first_seq;
+    // Samples before the last keyframe are derived from its sequence number (exact unless the sequence has gaps)
+    seg.count = (index.empty() ? 0 : SampleRecord::get64(&index[index.size() - INDEX_ENTRY_SIZE] + 8) - first_seq) + decoded;
+    seg.bytes = end;
+    seg.first_ts = index.empty() ? first.timestamp_us : static_cast<int64_t>(SampleRecord::get64(&index[0]));
+    seg.last_ts = last.timestamp_us;
+    segments.push_back(seg);
+    last_seq = std::max(last_seq, last.seq);
+    return true;
+}
+
+// Create a new, empty segment and make it the append target
+bool SampleLog::startSegment(uint64_t first_seq) {
+    if (active_fd >= 0) {
+        close(active_fd);
+    }
+    active_fd = ::open(segmentPath(first_seq).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_TRUNC | O_CLOEXEC, 0644);
+    if (active_fd < 0) {
+        LOG_ERROR("Unable to create history segment: {}", strerror(errno));
+        return false;
+    }
+    if (fmt == GORILLA) {
+        if (index_fd >= 0) {
+            close(index_fd);
+        }
+        index_fd = ::open(indexPath(first_seq).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_TRUNC | O_CLOEXEC, 0644);
+        encoder.reset();  // Every segment starts with a keyframe so it decodes on its own
+    }
+    Segment seg;
+    seg.first_seq = first_seq;
+    seg.count = 0;
+    seg.bytes = 0;
+    seg.first_ts = 0;
+    seg.last_ts = 0;
+    segments.push_back(seg);
+    enforceRetention();
+    return true;
+}
+
+// Delete the oldest segments beyond the retention limit
+void SampleLog::enforceRetention() {
+    while (segments.size() > max_segments) {
+        unlink(segmentPath(segments.front().first_seq).c_str());
+        if (fmt == GORILLA) {
+            unlink(indexPath(segments.front().first_seq).c_str());
+        }
+        segments.erase(segments.begin());
+    }
+}
+
+bool SampleLog::append(const Sample& s) {
+    if (dir.empty()) {
+        return false;  // Not open
+    }
+    if (active_fd < 0 || segments.empty() || segments.back().count >= SEGMENT_RECORDS) {
+        if (!startSegment(s.seq)) {
+            return false;
+        }
+    }
+
+    Segment& seg = segments.back();
+    uint8_t rec[SampleCodec::MAX_FRAME];
+    size_t len = SampleRecord::SIZE;
+    if (fmt == RAW) {
+        SampleRecord::encode(s, rec);
+    } else {
+        len = encoder.encode(s, rec);
+        if (rec[0] == SampleCodec::KEYFRAME) {
+            // Index the keyframe before writing it; recovery drops entries that point past the data
+            uint8_t entry[INDEX_ENTRY_SIZE];
+            SampleRecord::put64(entry, static_cast<uint64_t>(s.timestamp_us));
+            SampleRecord::put64(entry + 8, s.seq);
+            SampleRecord::put64(entry + 16, seg.bytes);
+            if (index_fd < 0 || write(index_fd, entry, sizeof(entry)) != static_cast<ssize_t>(sizeof(entry))) {
+                LOG_ERROR("Writing the history index failed: {}", strerror(errno));
+            }
+        }
+    }
+    if (write(active_fd, rec, len) != static_cast<ssize_t>(len)) {
+        LOG_ERROR("Writing the history failed: {}", strerror(errno));
+        encoder.reset();  // The next frame must not depend on one that was not stored
+        return false;
+    }
+
+    if (seg.count == 0) {
+        seg.first_ts = s.timestamp_us;
+    }
+    seg.last_ts = s.timestamp_us;
+    seg.count++;
+    seg.bytes += len;
+    last_seq = s.seq;
+    return true;
+}
+
+uint64_t SampleLog::lastSequence() const {
+    return last_seq;
+}
+
+uint64_t SampleLog::size() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        total += segments[i].count;
+    }
+    return total;
+}
+
+int SampleLog::openSegment(uint64_t segment) const {
+    return ::open(segmentPath(segment).c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * @brief Binary search over the fixed-size records of one segment file
+ * @param after false: first record with timestamp >= ts; true: first record with timestamp > ts
+ * @return uint64_t Record index in [0, count]
+ */
+uint64_t SampleLog::searchRecords(int fd, uint64_t count, int64_t ts, bool after) const {
+    uint64_t lo = 0;
+    uint64_t hi = count;
+    uint8_t rec[SampleRecord::SIZE];
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int64_t mid_ts = 0;
+        if (pread(fd, rec, sizeof(rec), static_cast<off_t>(mid * SampleRecord::SIZE)) == static_cast<ssize_t>(sizeof(rec))) {
+            mid_ts = static_cast<int64_t>(SampleRecord::get64(rec + 8));
+        }
+        if (mid_ts < ts || (after && mid_ts == ts)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+size_t SampleLog::findRange(int64_t from_us, int64_t to_us, std::vector<Extent>& out) const {
+    size_t total = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const Segment& seg = segments[i];
+        if (seg.count == 0 || seg.last_ts < from_us || seg.first_ts > to_us) {
+            continue;
+        }
+        if (fmt == GORILLA) {
+            total += encodedRange(seg, from_us, to_us, out);
+            continue;
+        }
+        uint64_t begin = 0;
+        uint64_t end = seg.count;
+        // Only search inside segments that are cut by the range boundaries
+        if (seg.first_ts < from_us || seg.last_ts > to_us) {
+            int fd = openSegment(seg.first_seq);
+            if (fd < 0) {
+                continue;
+            }
+            begin = seg.first_ts < from_us ? searchRecords(fd, seg.count, from_us, false) : 0;
+            end = seg.last_ts > to_us ? searchRecords(fd, seg.count, to_us, true) : seg.count;
+            close(fd);
+        }
+        if (end <= begin) {
+            continue;
+        }
+        Extent ext;
+        ext.segment = seg.first_seq;
+        ext.offset = static_cast<off_t>(begin * SampleRecord::SIZE);
+        ext.length = static_cast<size_t>((end - begin) * SampleRecord::SIZE);
+        out.push_back(ext);
+        total += ext.length;
+    }
+    return total;
+}
+
+/**
+ * @brief Map a time range onto one encoded segment using its keyframe index
+ * @details The extent starts at the last keyframe at or before from_us and ends at the first keyframe after to_us.
+ */
+size_t SampleLog::encodedRange(const Segment& seg, int64_t from_us, int64_t to_us, std::vector<Extent>& out) const {
+    uint64_t begin = 0;
+    uint64_t end = seg.bytes;
+    std::vector<uint8_t> index;
+    if (readIndex(seg.first_seq, index)) {
+        for (size_t off = 0; off < index.size(); off += INDEX_ENTRY_SIZE) {
+            int64_t ts = static_cast<int64_t>(SampleRecord::get64(&index[off]));
+            uint64_t pos = SampleRecord::get64(&index[off] + 16);
+            if (ts <= from_us) {
+                begin = pos;
+            } else if (ts > to_us) {
+                end = std::min(end, pos);
+                break;
+            }
+        }
+    }
+    if (end <= begin) {
+        return 0;
+    }
+    Extent ext;
+    ext.segment = seg.first_seq;
+    ext.offset = static_cast<off_t>(begin);
+    ext.length = static_cast<size_t>(end - begin);
+    out.push_back(ext);
+    return ext.length;
+}
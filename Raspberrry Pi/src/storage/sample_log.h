@@ -0,0 +1,146 @@
+/**
+ * @file sample_log.h
+ * @brief Append-only on-device history of every collected sample
+ * @details Samples are stored as fixed-size SampleRecord entries in segment files named "seg-<first seq>.dat"
+ *          inside the history directory. A segment holds at most SEGMENT_RECORDS records (one day at 1 Hz);
+ *          the oldest segments are removed once the configured segment count is exceeded.
+ *          Because records have a fixed size, a time range maps directly onto byte extents of the segment
+ *          files, which can then be streamed to a socket without passing through user space.
+ *          Alternatively the log stores SampleCodec frames ("seg-<first seq>.gor"), roughly a quarter of the size.
+ *          A sidecar "seg-<first seq>.idx" then lists the timestamp, sequence number and byte offset of every
+ *          keyframe (24 bytes per entry, little-endian), so ranges still map onto extents that start at a keyframe.
+ */
+
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <climits>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "../common/sample.h"
+#include "../common/sample_codec.h"
+
+/**
+ * @class SampleLog
+ * @brief Segmented, append-only sample history with time-range lookup
+ * @note Range lookup assumes timestamps do not go backwards within the log; the sequence number stored in
+ *       every record remains the authoritative key for de-duplication on the receiving side.
+ */
+class SampleLog {
+public:
+    static const uint64_t SEGMENT_RECORDS = 86400;  ///< Records per segment file
+    static const size_t INDEX_ENTRY_SIZE = 24;      ///< Size of one keyframe index entry
+
+    /**
+     * @brief On-disk encoding of the segment files
+     */
+    enum Format {
+        RAW,      ///< Fixed-size SampleRecord entries
+        GORILLA   ///< SampleCodec frames plus a keyframe index
+    };
+
+    /**
+     * @brief A contiguous byte range of one segment file
+     */
+    struct Extent {
+        uint64_t segment;  ///< First sequence number of the segment (identifies the file)
+        off_t offset;      ///< Byte offset of the first record in range
+        size_t length;     ///< Length in bytes (a multiple of SampleRecord::SIZE)
+    };
+
+    SampleLog();
+    ~SampleLog();
+
+    SampleLog(const SampleLog&) = delete;
+    SampleLog& operator=(const SampleLog&) = delete;
+
+    /**
+     * @brief Open (and create if needed) the history directory and recover existing segments
+     * @param directory History directory
+     * @param max_segments Number of segment files to keep before the oldest is deleted
+     * @param format Encoding of new and recovered segments
+     * @param keyframe_interval Samples between keyframes for the GORILLA format
+     * @return bool false if the directory cannot be created or read, or holds segments of the other format (the
+     *         log then stays closed)
+     * @note A torn record at the end of the newest segment (power loss during a write) is truncated away
+     */
+    bool open(const std::string& directory, size_t max_segments, Format format = RAW, uint32_t keyframe_interval = 60);
+
+    /**
+     * @brief Encoding of the segment files
+     */
+    Format format() const { return fmt; }
+
+    /**
+     * @brief Append one sample to the newest segment, starting a new segment when it is full
+     * @param s Sample to store
+     * @return bool false on write failure or if the log is not open
+     */
+    bool append(const Sample& s);
+
+    /**
+     * @brief Sequence number of the newest stored sample
+     * @return uint64_t 0 if the log is empty
+     */
+    uint64_t lastSequence() const;
+
+    /**
+     * @brief Total number of stored samples
+     */
+    uint64_t size() const;
+
+    /**
+     * @brief Map a time range onto segment byte extents
+     * @param from_us Inclusive start (CLOCK_REALTIME, microseconds)
+     * @param to_us Inclusive end (CLOCK_REALTIME, microseconds)
+     * @param out Extents in ascending sequence order (appended)
+     * @return size_t Total number of bytes covered by the extents
+     * @note For the GORILLA format extents are widened to keyframe boundaries, so a few samples outside the
+     *       range may be included
+     */
+    size_t findRange(int64_t from_us, int64_t to_us, std::vector<Extent>& out) const;
+
+    /**
+     * @brief Open a segment file for reading
+     * @param segment First sequence number of the segment
+     * @return int File descriptor, or -1 on failure
+     */
+    int openSegment(uint64_t segment) const;
+
+private:
+    struct Segment {
+        uint64_t first_seq;  ///< Sequence number of the first record (also the file name)
+        uint64_t count;      ///< Number of complete records
+        uint64_t bytes;      ///< Size of the segment file
+        int64_t first_ts;    ///< Timestamp of the first record
+        int64_t last_ts;     ///< Timestamp of the last record
+    };
+
+    std::string dir;               ///< History directory
+    size_t max_segments;           ///< Retention limit in segment files
+    std::vector<Segment> segments; ///< Known segments, oldest first
+    int active_fd;                 ///< Append descriptor of the newest segment (-1 if none)
+    int index_fd;                  ///< Append descriptor of the newest keyframe index (GORILLA only)
+    uint64_t last_seq;             ///< Newest stored sequence number
+    Format fmt;                    ///< Segment encoding
+    SampleEncoder encoder;         ///< Frame encoder of the newest segment (GORILLA only)
+
+    /// File path formatted on the stack, so rolling to a new segment does not allocate
+    struct Path {
+        char str[PATH_MAX];
+        const char* c_str() const { return str; }
+    };
+
+    Path segmentPath(uint64_t segment) const;
+    Path indexPath(uint64_t segment) const;
+    bool recoverSegment(uint64_t first_seq);
+    bool recoverEncodedSegment(uint64_t first_seq);
+    bool readIndex(uint64_t segment, std::vector<uint8_t>& index) const;
+    bool startSegment(uint64_t first_seq);
+    void enforceRetention();
+    uint64_t searchRecords(int fd, uint64_t count, int64_t ts, bool after) const;
+    size_t encodedRange(const Segment& seg, int64_t from_us, int64_t to_us, std::vector<Extent>& out) const;
+};
+
+#endif // SAMPLE_LOG_H
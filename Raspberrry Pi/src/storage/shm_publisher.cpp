@@ -0,0 +1,84 @@
+// shm_publisher.cpp
+#include "shm_publisher.h"
+#include "../common/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmPublisher::ShmPublisher() : header(nullptr), size(0) {}
+
+ShmPublisher::~ShmPublisher() {
+    close();
+}
+
+bool ShmPublisher::open(const std::string& name, uint32_t capacity) {
+    close();
+    if (capacity == 0) {
+        capacity = 1;
+    }
+    // Start from a fresh region: readers still mapping an old one keep it until they reopen
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Shared memory {}: {}", name, strerror(errno));
+        return false;
+    }
+    size_t length = Shm::regionSize(capacity);
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        LOG_ERROR("Shared memory {}: {}", name, strerror(errno));
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the region
+    if (mem == MAP_FAILED) {
+        LOG_ERROR("Shared memory {}: {}", name, strerror(errno));
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate() zero-filled the region: counters, slots and reserved bytes start at 0
+    header = static_cast<Shm::Header*>(mem);
+    size = length;
+    shm_name = name;
+    header->version = Shm::VERSION;
+    header->header_size = sizeof(Shm::Header);
+    header->slot_size = sizeof(Shm::Slot);
+    header->capacity = capacity;
+    header->writer_pid = static_cast<uint32_t>(getpid());
+    header->created_us = realtimeMicros();
+    // Readers check the magic first, so it is written once everything else is in place
+    header->magic.store(Shm::MAGIC, std::memory_order_release);
+    LOG_INFO("Shared memory {}: latest sample and {} samples of history", name, capacity);
+    return true;
+}
+
+void ShmPublisher::close() {
+    if (header == nullptr) {
+        return;
+    }
+    header->closed.store(1, std::memory_order_release);
+    munmap(header, size);
+    shm_unlink(shm_name.c_str());
+    header = nullptr;
+    size = 0;
+}
+
+void ShmPublisher::publish(const Sample& s) {
+    if (header == nullptr) {
+        return;
+    }
+    uint64_t position = header->published.load(std::memory_order_relaxed);
+    Shm::write(Shm::ring(header)[position % header->capacity], position, s);
+    Shm::write(header->latest, position, s);
+    // Publishing the count last makes a sample visible in the ring and as the latest value together
+    header->published.store(position + 1, std::memory_order_release);
+}
+
+uint64_t ShmPublisher::published() const {
+    return header != nullptr ? header->published.load(std::memory_order_relaxed) : 0;
+}
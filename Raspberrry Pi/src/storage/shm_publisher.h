@@ -0,0 +1,56 @@
+/**
+ * @file shm_publisher.h
+ * @brief Publishes every sample into a POSIX shared-memory region for local consumers
+ * @details Local processes (a logger, a local web UI, a dosing pump control loop) map the region with ShmReader and
+ *          read the newest values without any system call. The layout is documented in common/shm_layout.h.
+ */
+
+#ifndef SHM_PUBLISHER_H
+#define SHM_PUBLISHER_H
+
+#include <cstdint>
+#include <string>
+#include "../common/shm_layout.h"
+
+/**
+ * @class ShmPublisher
+ * @brief Single writer of the shared-memory region
+ */
+class ShmPublisher {
+public:
+    ShmPublisher();
+    ~ShmPublisher();
+
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    /**
+     * @brief Create the region, replacing any region left by a previous run
+     * @param name shm_open() name, e.g. "/water_quality"
+     * @param capacity Samples kept in the history ring
+     * @return bool false if the region cannot be created
+     */
+    bool open(const std::string& name, uint32_t capacity);
+
+    /**
+     * @brief Mark the region closed, unmap and remove it
+     * @note Readers that still have it mapped keep the last values and see closed() set
+     */
+    void close();
+
+    /**
+     * @brief Store a sample as the latest value and append it to the ring
+     * @param s Sample to publish
+     */
+    void publish(const Sample& s);
+
+    bool isOpen() const { return header != nullptr; }  ///< Region created
+    uint64_t published() const;                        ///< Samples published since open()
+
+private:
+    std::string shm_name;   ///< Name passed to shm_open()
+    Shm::Header* header;    ///< Mapped region, null when closed
+    size_t size;            ///< Mapped length
+};
+
+#endif // SHM_PUBLISHER_H
@@ -0,0 +1,305 @@
+// allocation_test.cpp
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../src/common/logger.h"
+#include "../src/common/water_quality.h"
+#include "../src/data_collection/data_collector.h"
+#include "../src/display/headless_backend.h"
+#include "../src/event_loop/event_loop.h"
+#include "../src/info_updating/deadband_filter.h"
+#include "../src/info_updating/debug_info_updater.h"
+#include "../src/info_updating/socket_info_updater.h"
+#include "../src/info_updating/tft_info_updater.h"
+#include "../src/networking/multicast_publisher.h"
+#include "../src/networking/pubsub_server.h"
+#include "../src/storage/sample_log.h"
+#include "../src/storage/shm_publisher.h"
+
+// Every operator new of the test binary goes through these replacements. While counting is armed, each call is
+// counted (from any thread) and the stack of the first one is kept for the failure message
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocations(0);
+static void* first_stack[32];
+static int first_depth = 0;
+
+static void* countedNew(std::size_t size) {
+    if (counting.load(std::memory_order_relaxed) && allocations.fetch_add(1) == 0) {
+        first_depth = backtrace(first_stack, 32);
+    }
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size) { return countedNew(size); }
+void* operator new[](std::size_t size) { return countedNew(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return countedNew(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& nt) noexcept { return operator new(size, nt); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+namespace {
+
+const char* FONT = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+
+// ADC readings that change a little every cycle, so the deadband filter forwards some samples and drops others
+class SimulatedADC : public PCF8591 {
+public:
+    SimulatedADC() : PCF8591(-1), tick(0) {}
+    int readMultiple(int* /* channels */, int numChannels, int* results) override {
+        ++tick;
+        for (int i = 0; i < numChannels; ++i) {
+            results[i] = 120 + static_cast<int>((tick + i) % 7);
+        }
+        return 0;
+    }
+
+private:
+    unsigned tick;
+};
+
+// Loopback TCP listener standing in for the upstream server
+int listenLoopback(int* port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(fd, 4) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int freePort() {
+    int port = 0;
+    int fd = listenLoopback(&port);
+    close(fd);
+    return port;
+}
+
+// Read whatever the node sent, returns the number of bytes
+size_t drain(int fd) {
+    char buf[4096];
+    size_t total = 0;
+    ssize_t n;
+    while (fd >= 0 && (n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+}  // namespace
+
+/**
+ * @brief The acquisition and sink path of App::init, driven tick by tick without the timers
+ * @details Every driver that touches hardware is replaced: the ADC is simulated, the DS18B20 reads a w1_slave
+ *          file, the panel writes to /dev/null and the servers talk to loopback peers. Everything else is the code
+ *          the node runs.
+ */
+class SteadyStateTest : public ::testing::Test {
+protected:
+    SteadyStateTest() : running(false), loop(running) {}
+
+    void SetUp() override {
+        backtrace(first_stack, 1);  // Loads the unwinder now rather than inside the first counted allocation
+
+        char templ[] = "/tmp/wqm_alloc_XXXXXX";
+        ASSERT_NE(mkdtemp(templ), nullptr);
+        dir = templ;
+        w1_slave = dir + "/w1_slave";
+        FILE* f = std::fopen(w1_slave.c_str(), "w");
+        ASSERT_NE(f, nullptr);
+        std::fputs("72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n72 01 4b 46 7f ff 0e 10 57 t=23125\n", f);
+        std::fclose(f);
+
+        thermometer.reset(new DS18B20(w1_slave.c_str()));
+        collector.reset(new DataCollector(adc, *thermometer));
+        ASSERT_TRUE(history.open(dir + "/history", 4, SampleLog::GORILLA, 60));
+        shm_name = "/wqm_alloc_test_" + std::to_string(getpid());
+        ASSERT_TRUE(shm.open(shm_name, 64));
+
+        int upstream_port = 0;
+        upstream_listener = listenLoopback(&upstream_port);
+        ASSERT_GE(upstream_listener, 0);
+        SocketInfoUpdater::Target target;
+        target.addr = sockaddrFor(upstream_port);
+        target.encoding = StreamEncoder::JSON;
+        socket_updater.reset(new SocketInfoUpdater(loop, std::vector<SocketInfoUpdater::Target>(1, target), &history, 16, 60));
+        socket_filter.reset(new DeadbandFilter(socket_updater.get(), 0.5f, 0.1f, 0.05f, 60000));
+
+        int pubsub_port = freePort();
+        pubsub.reset(new PubSubServer(loop, pubsub_port, StreamEncoder::GORILLA, 4, 16, 60));
+        subscriber = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr = sockaddrFor(pubsub_port);
+        ASSERT_EQ(connect(subscriber, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+        multicast.reset(new MulticastPublisher("239.255.0.1", freePort(), 0, "127.0.0.1", 1));
+
+        if (access(FONT, R_OK) == 0) {
+            panel.reset(new TFTFreetype(new HeadlessBackend(), FONT, 16));
+            tft.reset(new TFTInfoUpdater(*panel));
+        }
+
+        // The debug lines go through the logger thread, as on the node, into /dev/null
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+        Logger::getInstance().start();
+    }
+
+    void TearDown() override {
+        counting = false;
+        restoreStdout();
+        close(upstream_peer);
+        close(upstream_listener);
+        close(subscriber);
+        shm.close();
+        std::system(("rm -rf " + dir).c_str());
+    }
+
+    // Stop the logger and give the standard output back to the test report
+    void restoreStdout() {
+        Logger::getInstance().stop();
+        if (saved_stdout >= 0) {
+            dup2(saved_stdout, STDOUT_FILENO);
+            close(saved_stdout);
+            saved_stdout = -1;
+        }
+    }
+
+    static sockaddr_in sockaddrFor(int port) {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return addr;
+    }
+
+    // One cycle of every timer handler of App::init, then one pass of the event loop for the socket events
+    void tick() {
+        collector->collectData();
+        Sample sample = WaterQuality::getInstance().snapshot();
+        history.append(sample);
+        shm.publish(sample);
+        debug.update();
+        if (tft) {
+            tft->update();
+        }
+        socket_filter->update();
+        pubsub->update();
+        multicast->update();
+
+        running = true;
+        loop.post([this]() { running = false; });
+        loop.run();
+
+        if (upstream_peer < 0) {
+            upstream_peer = accept4(upstream_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        }
+        upstream_bytes += drain(upstream_peer);
+        subscriber_bytes += drain(subscriber);
+    }
+
+    std::atomic<bool> running;
+    EventLoop loop;
+    std::string dir;
+    std::string w1_slave;
+    std::string shm_name;
+    SimulatedADC adc;
+    std::unique_ptr<DS18B20> thermometer;
+    std::unique_ptr<DataCollector> collector;
+    SampleLog history;
+    ShmPublisher shm;
+    DebugInfoUpdater debug;
+    std::unique_ptr<TFTFreetype> panel;
+    std::unique_ptr<TFTInfoUpdater> tft;
+    std::unique_ptr<SocketInfoUpdater> socket_updater;
+    std::unique_ptr<DeadbandFilter> socket_filter;
+    std::unique_ptr<PubSubServer> pubsub;
+    std::unique_ptr<MulticastPublisher> multicast;
+    int upstream_listener = -1;
+    int upstream_peer = -1;
+    int subscriber = -1;
+    int saved_stdout = -1;
+    size_t upstream_bytes = 0;
+    size_t subscriber_bytes = 0;
+};
+
+// After the warm-up (connections established, queues and rings touched once) a tick must not allocate
+TEST_F(SteadyStateTest, TicksDoNotAllocate) {
+    const int WARMUP_TICKS = 20;
+    const int TICKS = 200;
+    for (int i = 0; i < WARMUP_TICKS; ++i) {
+        tick();
+        usleep(1000);
+    }
+    bool connected = socket_updater->endpoint(0).connected() && pubsub->subscriberCount() == 1;
+
+    allocations = 0;
+    upstream_bytes = 0;
+    subscriber_bytes = 0;
+    counting = true;
+    for (int i = 0; i < TICKS; ++i) {
+        tick();
+    }
+    counting = false;
+    restoreStdout();
+
+    ASSERT_TRUE(connected);
+    EXPECT_GT(upstream_bytes, 0u);
+    EXPECT_GT(subscriber_bytes, 0u);
+
+    if (allocations > 0) {
+        std::fprintf(stderr, "First allocation during the ticks:\n");
+        backtrace_symbols_fd(first_stack, first_depth, STDERR_FILENO);
+    }
+    EXPECT_EQ(allocations.load(), 0u) << "heap allocations in " << TICKS << " ticks";
+    EXPECT_FLOAT_EQ(WaterQuality::getInstance().getDS18B20(), 23.125f);
+}
+
+// Rolling the history to a new segment (once a day on the node) and retiring the oldest must not allocate either
+TEST_F(SteadyStateTest, SegmentRollDoesNotAllocate) {
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir + "/roll", 1, SampleLog::RAW, 60));
+    Sample s = WaterQuality::getInstance().snapshot();
+    s.seq = 0;
+    log.append(s);
+
+    allocations = 0;
+    counting = true;
+    for (uint64_t i = 1; i <= SampleLog::SEGMENT_RECORDS; ++i) {
+        s.seq = i;
+        log.append(s);
+    }
+    counting = false;
+    restoreStdout();
+
+    if (allocations > 0) {
+        std::fprintf(stderr, "First allocation during the appends:\n");
+        backtrace_symbols_fd(first_stack, first_depth, STDERR_FILENO);
+    }
+    EXPECT_EQ(allocations.load(), 0u);
+    EXPECT_EQ(log.size(), 1u);  // The full segment was deleted, the new one holds the last sample
+}
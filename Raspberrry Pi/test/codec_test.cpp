@@ -0,0 +1,262 @@
+// codec_test.cpp
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "../src/common/sample_codec.h"
+
+namespace {
+
+uint32_t bitsOf(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+// Values are compared as bit patterns, so NaN payloads and the sign of zero must survive too
+void expectSame(const Sample& expected, const Sample& actual) {
+    EXPECT_EQ(actual.seq, expected.seq);
+    EXPECT_EQ(actual.timestamp_us, expected.timestamp_us);
+    EXPECT_EQ(bitsOf(actual.turbidity), bitsOf(expected.turbidity));
+    EXPECT_EQ(bitsOf(actual.temperature), bitsOf(expected.temperature));
+    EXPECT_EQ(bitsOf(actual.pH), bitsOf(expected.pH));
+}
+
+std::vector<uint8_t> encodeAll(SampleEncoder& enc, const std::vector<Sample>& samples, std::vector<size_t>& starts) {
+    std::vector<uint8_t> out;
+    uint8_t frame[SampleCodec::MAX_FRAME];
+    for (const Sample& s : samples) {
+        size_t n = enc.encode(s, frame);
+        EXPECT_LE(n, SampleCodec::MAX_FRAME);
+        starts.push_back(out.size());
+        out.insert(out.end(), frame, frame + n);
+    }
+    return out;
+}
+
+// A mix of steady readings, a failed sensor (NaN), values below zero, signed zero and clock steps both ways
+std::vector<Sample> awkwardSamples() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    int64_t t0 = 1760000000000000LL;
+    std::vector<Sample> v = {
+        {1, t0, 12.5f, 21.25f, 7.5f},
+        {2, t0 + 1000000, 12.5f, 21.25f, 7.5f},
+        {3, t0 + 2000000, 12.75f, 21.5f, 7.51f},
+        {4, t0 + 3000000, nan, -3.5f, 7.49f},
+        {5, t0 + 4000000, nan, -0.0f, 0.0f},
+        {7, t0 + 3500000, 0.1f, -40.0f, 14.0f},      // Sequence gap, timestamp steps back
+        {8, t0 - 86400000000LL, -inf, 85.0f, inf},   // Clock set a day back
+        {9, t0 - 86399000000LL, 99.9f, 85.0f, -1.0f},
+        {10, t0 + 10000000, 99.9f, 85.0f, -1.0f},
+        {11, 0, 1e-38f, -1e38f, 3.14159f},
+        {12, -5, 1e-38f, -1e38f, 3.14159f},           // Before the epoch
+        {13, -5, 50.0f, 20.0f, 7.0f},
+    };
+    return v;
+}
+
+// Decode a stream the way the receivers do: a byte is dropped after CORRUPT, and decoding stops at NEED_MORE
+std::vector<Sample> decodeStream(const std::vector<uint8_t>& stream, size_t* skipped, size_t* corrupt) {
+    SampleDecoder dec;
+    std::vector<Sample> decoded;
+    *skipped = 0;
+    *corrupt = 0;
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        Sample s;
+        size_t used = 0;
+        SampleDecoder::Status st = dec.decode(&stream[pos], stream.size() - pos, &s, &used);
+        if (st == SampleDecoder::NEED_MORE) {
+            break;
+        }
+        if (st == SampleDecoder::CORRUPT) {
+            (*corrupt)++;
+            pos++;
+            continue;
+        }
+        if (st == SampleDecoder::SKIPPED) {
+            (*skipped)++;
+        } else {
+            decoded.push_back(s);
+        }
+        pos += used;
+    }
+    return decoded;
+}
+
+}  // namespace
+
+// Every sample decodes to exactly what was encoded, with keyframes at the interval and deltas between them
+TEST(SampleCodecTest, RoundTrip) {
+    std::vector<Sample> samples = awkwardSamples();
+    SampleEncoder enc(4);
+    std::vector<size_t> starts;
+    std::vector<uint8_t> stream = encodeAll(enc, samples, starts);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        EXPECT_EQ(stream[starts[i]], i % 4 == 0 ? SampleCodec::KEYFRAME : SampleCodec::DELTA) << "frame " << i;
+    }
+
+    SampleDecoder dec;
+    size_t pos = 0;
+    for (const Sample& expected : samples) {
+        Sample s;
+        size_t used = 0;
+        ASSERT_EQ(dec.decode(&stream[pos], stream.size() - pos, &s, &used), SampleDecoder::SAMPLE);
+        expectSame(expected, s);
+        pos += used;
+    }
+    EXPECT_EQ(pos, stream.size());
+}
+
+// With an interval of 1 every frame stands alone; a sequence number that goes back forces a keyframe
+TEST(SampleCodecTest, Keyframes) {
+    uint8_t frame[SampleCodec::MAX_FRAME];
+    SampleEncoder every(1);
+    Sample a = {100, 1000, 1.0f, 2.0f, 3.0f};
+    Sample b = {101, 2000, 1.0f, 2.0f, 3.0f};
+    every.encode(a, frame);
+    every.encode(b, frame);
+    EXPECT_EQ(frame[0], SampleCodec::KEYFRAME);
+
+    SampleEncoder enc(60);
+    enc.encode(a, frame);
+    enc.encode(b, frame);
+    EXPECT_EQ(frame[0], SampleCodec::DELTA);
+    Sample restarted = {1, 3000, 1.0f, 2.0f, 3.0f};
+    size_t n = enc.encode(restarted, frame);
+    EXPECT_EQ(frame[0], SampleCodec::KEYFRAME);
+
+    // A decoder in the middle of a delta run takes the keyframe as its new reference
+    SampleDecoder dec;
+    uint8_t first[SampleCodec::MAX_FRAME];
+    SampleEncoder other(60);
+    size_t m = other.encode(a, first);
+    Sample s;
+    size_t used = 0;
+    ASSERT_EQ(dec.decode(first, m, &s, &used), SampleDecoder::SAMPLE);
+    ASSERT_EQ(dec.decode(frame, n, &s, &used), SampleDecoder::SAMPLE);
+    expectSame(restarted, s);
+
+    // reset() starts the next stream with a keyframe
+    enc.reset();
+    enc.encode(b, frame);
+    EXPECT_EQ(frame[0], SampleCodec::KEYFRAME);
+}
+
+// A stable reading costs a few bytes per delta frame
+TEST(SampleCodecTest, StableStreamIsSmall) {
+    SampleEncoder enc(60);
+    uint8_t frame[SampleCodec::MAX_FRAME];
+    size_t total = 0;
+    for (uint64_t i = 0; i < 60; ++i) {
+        Sample s = {i + 1, static_cast<int64_t>(i) * 1000000, 12.5f, 21.25f, 7.5f};
+        total += enc.encode(s, frame);
+    }
+    EXPECT_LT(total, 60u * 8);
+}
+
+// Any prefix of a frame asks for more data and consumes nothing
+TEST(SampleCodecTest, TruncatedFrames) {
+    std::vector<Sample> samples = awkwardSamples();
+    SampleEncoder enc(4);
+    std::vector<size_t> starts;
+    std::vector<uint8_t> stream = encodeAll(enc, samples, starts);
+    starts.push_back(stream.size());
+
+    SampleDecoder dec;
+    for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        size_t frame_len = starts[i + 1] - starts[i];
+        for (size_t len = 0; len < frame_len; ++len) {
+            Sample s;
+            size_t used = 0;
+            EXPECT_EQ(dec.decode(&stream[starts[i]], len, &s, &used), SampleDecoder::NEED_MORE)
+                << "frame " << i << ", " << len << " bytes";
+        }
+        Sample s;
+        size_t used = 0;
+        ASSERT_EQ(dec.decode(&stream[starts[i]], frame_len, &s, &used), SampleDecoder::SAMPLE);
+        expectSame(samples[i], s);
+    }
+}
+
+// A single flipped bit is never decoded as a sample: the check byte catches it, or the length no longer fits
+TEST(SampleCodecTest, BitFlips) {
+    std::vector<Sample> samples = awkwardSamples();
+    SampleEncoder enc(4);
+    std::vector<size_t> starts;
+    std::vector<uint8_t> stream = encodeAll(enc, samples, starts);
+    starts.push_back(stream.size());
+
+    for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        size_t frame_len = starts[i + 1] - starts[i];
+        for (size_t byte = 0; byte < frame_len; ++byte) {
+            for (int bit = 0; bit < 8; ++bit) {
+                // Decode from the preceding keyframe, so deltas have their reference
+                SampleDecoder dec;
+                size_t key = i - i % 4;
+                std::vector<uint8_t> copy(stream.begin() + starts[key], stream.begin() + starts[i + 1]);
+                size_t at = starts[i] - starts[key];
+                copy[at + byte] ^= static_cast<uint8_t>(1 << bit);
+                Sample s;
+                size_t used = 0;
+                size_t pos = 0;
+                for (size_t k = key; k < i; ++k) {
+                    ASSERT_EQ(dec.decode(&copy[pos], copy.size() - pos, &s, &used), SampleDecoder::SAMPLE);
+                    pos += used;
+                }
+                SampleDecoder::Status st = dec.decode(&copy[at], copy.size() - at, &s, &used);
+                if (byte == 1) {
+                    EXPECT_TRUE(st == SampleDecoder::CORRUPT || st == SampleDecoder::NEED_MORE)
+                        << "frame " << i << " length bit " << bit;
+                } else {
+                    EXPECT_EQ(st, SampleDecoder::CORRUPT) << "frame " << i << " byte " << byte << " bit " << bit;
+                }
+            }
+        }
+    }
+}
+
+// Joining mid-stream: deltas are skipped until a keyframe, and garbage is dropped a byte at a time
+TEST(SampleCodecTest, Resynchronise) {
+    std::vector<Sample> samples = awkwardSamples();
+    SampleEncoder enc(4);
+    std::vector<size_t> starts;
+    std::vector<uint8_t> stream = encodeAll(enc, samples, starts);
+
+    // Start at the second frame, behind three bytes of noise
+    std::vector<uint8_t> joined = {0x00, 'K', 0xFF};
+    joined.insert(joined.end(), stream.begin() + starts[1], stream.end());
+
+    size_t skipped = 0;
+    size_t corrupt = 0;
+    std::vector<Sample> decoded = decodeStream(joined, &skipped, &corrupt);
+    EXPECT_GE(corrupt, 3u);
+    EXPECT_EQ(skipped, 3u);  // Deltas 1-3 precede the first keyframe seen
+    ASSERT_EQ(decoded.size(), samples.size() - 4);
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        expectSame(samples[i + 4], decoded[i]);
+    }
+}
+
+// A damaged frame mid-stream drops the reference: the deltas after it are skipped, not applied to an older sample
+TEST(SampleCodecTest, CorruptFrameDropsReference) {
+    std::vector<Sample> samples = awkwardSamples();
+    SampleEncoder enc(4);
+    std::vector<size_t> starts;
+    std::vector<uint8_t> stream = encodeAll(enc, samples, starts);
+    ASSERT_EQ(stream[starts[1]], SampleCodec::DELTA);
+    stream[starts[1] + 3] ^= 0x10;  // First payload byte of frame 1: the check byte no longer matches
+
+    size_t skipped = 0;
+    size_t corrupt = 0;
+    std::vector<Sample> decoded = decodeStream(stream, &skipped, &corrupt);
+    EXPECT_GE(corrupt, 1u);
+    EXPECT_EQ(skipped, 2u);  // Deltas 2 and 3, up to the keyframe at 4
+    ASSERT_EQ(decoded.size(), samples.size() - 3);
+    expectSame(samples[0], decoded[0]);
+    for (size_t i = 1; i < decoded.size(); ++i) {
+        expectSame(samples[i + 3], decoded[i]);
+    }
+}
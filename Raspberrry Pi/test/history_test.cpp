@@ -0,0 +1,390 @@
+// history_test.cpp
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "../src/common/sample_codec.h"
+#include "../src/common/sample_record.h"
+#include "../src/storage/history_cursor.h"
+#include "../src/storage/sample_log.h"
+
+namespace {
+
+const int64_t T0 = 1760000000000000LL;  // Timestamp of sequence number 1; one sample per second after it
+
+Sample sampleAt(uint64_t seq) {
+    Sample s;
+    s.seq = seq;
+    s.timestamp_us = T0 + static_cast<int64_t>(seq - 1) * 1000000;
+    s.turbidity = 10.0f + static_cast<float>(seq % 7);
+    s.temperature = 20.0f + static_cast<float>(seq % 3) * 0.25f;
+    s.pH = 7.0f + static_cast<float>(seq % 5) * 0.01f;
+    return s;
+}
+
+int64_t timeOf(uint64_t seq) {
+    return sampleAt(seq).timestamp_us;
+}
+
+off_t fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+void appendBytes(const std::string& path, const void* data, size_t len) {
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0) << path;
+    ASSERT_EQ(write(fd, data, len), static_cast<ssize_t>(len));
+    close(fd);
+}
+
+void flipByte(const std::string& path, off_t offset) {
+    int fd = open(path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0) << path;
+    uint8_t b = 0;
+    ASSERT_EQ(pread(fd, &b, 1, offset), 1);
+    b ^= 0x5A;
+    ASSERT_EQ(pwrite(fd, &b, 1, offset), 1);
+    close(fd);
+}
+
+std::string segmentFile(const std::string& dir, uint64_t first_seq, const char* extension) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/seg-%016llx.%s", static_cast<unsigned long long>(first_seq), extension);
+    return dir + name;
+}
+
+// Read an extent back and decode it: records for RAW, frames (starting with a keyframe) for GORILLA
+std::vector<Sample> readExtent(const SampleLog& log, const SampleLog::Extent& ext) {
+    std::vector<uint8_t> bytes(ext.length);
+    std::vector<Sample> samples;
+    int fd = log.openSegment(ext.segment);
+    EXPECT_GE(fd, 0);
+    if (fd < 0 || pread(fd, bytes.data(), bytes.size(), ext.offset) != static_cast<ssize_t>(bytes.size())) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        ADD_FAILURE() << "extent not readable";
+        return samples;
+    }
+    close(fd);
+    if (log.format() == SampleLog::RAW) {
+        EXPECT_EQ(ext.length % SampleRecord::SIZE, 0u);
+        for (size_t off = 0; off + SampleRecord::SIZE <= bytes.size(); off += SampleRecord::SIZE) {
+            Sample s;
+            EXPECT_TRUE(SampleRecord::decode(&bytes[off], &s));
+            samples.push_back(s);
+        }
+        return samples;
+    }
+    EXPECT_EQ(bytes[0], SampleCodec::KEYFRAME);
+    SampleDecoder decoder;
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        Sample s;
+        size_t used = 0;
+        if (decoder.decode(&bytes[pos], bytes.size() - pos, &s, &used) != SampleDecoder::SAMPLE) {
+            ADD_FAILURE() << "undecodable frame at " << pos;
+            break;
+        }
+        samples.push_back(s);
+        pos += used;
+    }
+    return samples;
+}
+
+}  // namespace
+
+class SampleLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char templ[] = "/tmp/wqm_history_XXXXXX";
+        ASSERT_NE(mkdtemp(templ), nullptr);
+        dir = std::string(templ) + "/history";
+    }
+
+    void TearDown() override {
+        std::system(("rm -rf " + dir.substr(0, dir.rfind('/'))).c_str());
+    }
+
+    void fill(SampleLog& log, uint64_t first, uint64_t last) {
+        for (uint64_t seq = first; seq <= last; ++seq) {
+            ASSERT_TRUE(log.append(sampleAt(seq)));
+        }
+    }
+
+    std::string dir;
+};
+
+// A full segment rolls over to a file named after its first sequence number; the oldest beyond the limit is deleted
+TEST_F(SampleLogTest, SegmentRollAndRetention) {
+    const uint64_t N = SampleLog::SEGMENT_RECORDS;
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 2));
+        fill(log, 1, N + 10);
+        EXPECT_EQ(log.size(), N + 10);
+        EXPECT_EQ(fileSize(segmentFile(dir, 1, "dat")), static_cast<off_t>(N * SampleRecord::SIZE));
+        EXPECT_EQ(fileSize(segmentFile(dir, N + 1, "dat")), static_cast<off_t>(10 * SampleRecord::SIZE));
+
+        // A range across the roll maps onto the tail of one file and the head of the next
+        std::vector<SampleLog::Extent> extents;
+        size_t total = log.findRange(timeOf(N - 1), timeOf(N + 2), extents);
+        ASSERT_EQ(extents.size(), 2u);
+        EXPECT_EQ(total, 4 * SampleRecord::SIZE);
+        EXPECT_EQ(extents[0].segment, 1u);
+        EXPECT_EQ(extents[0].offset, static_cast<off_t>((N - 2) * SampleRecord::SIZE));
+        EXPECT_EQ(extents[0].length, 2 * SampleRecord::SIZE);
+        EXPECT_EQ(extents[1].segment, N + 1);
+        EXPECT_EQ(extents[1].offset, 0);
+        EXPECT_EQ(extents[1].length, 2 * SampleRecord::SIZE);
+        EXPECT_EQ(readExtent(log, extents[1])[1].seq, N + 2);
+
+        fill(log, N + 11, 2 * N + 1);
+        EXPECT_EQ(log.size(), N + 1);
+        EXPECT_EQ(fileSize(segmentFile(dir, 1, "dat")), -1);  // Retired
+        EXPECT_EQ(fileSize(segmentFile(dir, 2 * N + 1, "dat")), static_cast<off_t>(SampleRecord::SIZE));
+    }
+
+    // Reopening finds the same segments and keeps appending to the newest
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 2));
+    EXPECT_EQ(log.size(), N + 1);
+    EXPECT_EQ(log.lastSequence(), 2 * N + 1);
+    fill(log, 2 * N + 2, 2 * N + 2);
+    EXPECT_EQ(fileSize(segmentFile(dir, 2 * N + 1, "dat")), static_cast<off_t>(2 * SampleRecord::SIZE));
+
+    // A lower limit retires the surplus at once
+    SampleLog trimmed;
+    ASSERT_TRUE(trimmed.open(dir, 1));
+    EXPECT_EQ(trimmed.size(), 2u);
+    EXPECT_EQ(fileSize(segmentFile(dir, N + 1, "dat")), -1);
+}
+
+// Range lookup in raw records is exact: boundaries between samples and on them, and ranges outside the data
+TEST_F(SampleLogTest, RawRangeExtents) {
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 4));
+    fill(log, 1, 100);
+
+    std::vector<SampleLog::Extent> extents;
+    EXPECT_EQ(log.findRange(timeOf(5), timeOf(9), extents), 5 * SampleRecord::SIZE);
+    ASSERT_EQ(extents.size(), 1u);
+    EXPECT_EQ(extents[0].offset, static_cast<off_t>(4 * SampleRecord::SIZE));
+    std::vector<Sample> got = readExtent(log, extents[0]);
+    ASSERT_EQ(got.size(), 5u);
+    EXPECT_EQ(got.front().seq, 5u);
+    EXPECT_EQ(got.back().seq, 9u);
+
+    extents.clear();
+    EXPECT_EQ(log.findRange(timeOf(5) - 1, timeOf(9) + 1, extents), 5 * SampleRecord::SIZE);
+    extents.clear();
+    EXPECT_EQ(log.findRange(timeOf(5) + 1, timeOf(6) - 1, extents), 0u);  // Between two samples
+    EXPECT_TRUE(extents.empty());
+    EXPECT_EQ(log.findRange(timeOf(1) - 10000000, timeOf(1) - 1, extents), 0u);
+    EXPECT_EQ(log.findRange(timeOf(101), timeOf(200), extents), 0u);
+    EXPECT_TRUE(extents.empty());
+    EXPECT_EQ(log.findRange(0, INT64_MAX, extents), 100 * SampleRecord::SIZE);
+    ASSERT_EQ(extents.size(), 1u);
+    EXPECT_EQ(extents[0].offset, 0);
+}
+
+// Encoded extents widen to the keyframes around the range, so they decode on their own
+TEST_F(SampleLogTest, EncodedRangeExtents) {
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 4, SampleLog::GORILLA, 60));
+    fill(log, 1, 130);  // Keyframes at 1, 61 and 121
+    EXPECT_EQ(fileSize(segmentFile(dir, 1, "idx")), static_cast<off_t>(3 * SampleLog::INDEX_ENTRY_SIZE));
+
+    struct Case {
+        uint64_t from;
+        uint64_t to;
+        uint64_t first;  // Sample at the start of the extent
+        uint64_t last;   // Sample at its end
+    };
+    const Case cases[] = {
+        {61, 61, 61, 120},    // Exactly on a keyframe
+        {60, 62, 1, 120},     // Across one
+        {120, 120, 61, 120},  // Last sample before a keyframe
+        {125, 500, 121, 130}, // Past the end
+        {1, 130, 1, 130},
+    };
+    for (const Case& c : cases) {
+        std::vector<SampleLog::Extent> extents;
+        size_t total = log.findRange(timeOf(c.from), timeOf(c.to), extents);
+        ASSERT_EQ(extents.size(), 1u) << c.from << "-" << c.to;
+        EXPECT_EQ(total, extents[0].length);
+        std::vector<Sample> got = readExtent(log, extents[0]);
+        ASSERT_FALSE(got.empty());
+        EXPECT_EQ(got.front().seq, c.first) << c.from << "-" << c.to;
+        EXPECT_EQ(got.back().seq, c.last) << c.from << "-" << c.to;
+        EXPECT_EQ(got.front().timestamp_us, timeOf(c.first));
+    }
+    std::vector<SampleLog::Extent> extents;
+    EXPECT_EQ(log.findRange(timeOf(131), timeOf(200), extents), 0u);
+}
+
+// Power loss mid-write: a partial record at the end is cut off, and so is a complete one that fails its checksum
+TEST_F(SampleLogTest, RawTornTailIsTruncated) {
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 4));
+        fill(log, 1, 10);
+    }
+    std::string path = segmentFile(dir, 1, "dat");
+    uint8_t partial[SampleRecord::SIZE];
+    SampleRecord::encode(sampleAt(11), partial);
+    appendBytes(path, partial, 17);
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 4));
+        EXPECT_EQ(log.size(), 10u);
+        EXPECT_EQ(log.lastSequence(), 10u);
+        EXPECT_EQ(fileSize(path), static_cast<off_t>(10 * SampleRecord::SIZE));
+    }
+
+    flipByte(path, 9 * SampleRecord::SIZE + 20);  // Temperature of record 10
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 4));
+    EXPECT_EQ(log.size(), 9u);
+    EXPECT_EQ(log.lastSequence(), 9u);
+    EXPECT_EQ(fileSize(path), static_cast<off_t>(9 * SampleRecord::SIZE));
+
+    // Appending resumes right after the last good record
+    fill(log, 10, 12);
+    std::vector<SampleLog::Extent> extents;
+    log.findRange(timeOf(9), timeOf(12), extents);
+    ASSERT_EQ(extents.size(), 1u);
+    std::vector<Sample> got = readExtent(log, extents[0]);
+    ASSERT_EQ(got.size(), 4u);
+    EXPECT_EQ(got[1].seq, 10u);
+}
+
+// Encoded segments lose a partial frame and any index entry whose keyframe never reached the file
+TEST_F(SampleLogTest, EncodedTornTailIsTruncated) {
+    off_t complete = 0;
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 4, SampleLog::GORILLA, 60));
+        fill(log, 1, 130);
+    }
+    std::string path = segmentFile(dir, 1, "gor");
+    std::string index = segmentFile(dir, 1, "idx");
+    complete = fileSize(path);
+
+    // The next keyframe was indexed, then only half of it was written
+    uint8_t frame[SampleCodec::MAX_FRAME];
+    SampleEncoder enc(60);
+    size_t n = enc.encode(sampleAt(131), frame);
+    uint8_t entry[SampleLog::INDEX_ENTRY_SIZE];
+    SampleRecord::put64(entry, static_cast<uint64_t>(timeOf(131)));
+    SampleRecord::put64(entry + 8, 131);
+    SampleRecord::put64(entry + 16, static_cast<uint64_t>(complete));
+    appendBytes(index, entry, sizeof(entry));
+    appendBytes(path, frame, n / 2);
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 4, SampleLog::GORILLA, 60));
+        EXPECT_EQ(log.size(), 130u);
+        EXPECT_EQ(log.lastSequence(), 130u);
+        EXPECT_EQ(fileSize(path), complete);
+        EXPECT_EQ(fileSize(index), static_cast<off_t>(3 * SampleLog::INDEX_ENTRY_SIZE));
+    }
+
+    // A damaged last keyframe: everything from it on is dropped, back to the previous keyframe's run
+    std::vector<uint8_t> entries(3 * SampleLog::INDEX_ENTRY_SIZE);
+    int fd = open(index.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(pread(fd, entries.data(), entries.size(), 0), static_cast<ssize_t>(entries.size()));
+    close(fd);
+    off_t third = static_cast<off_t>(SampleRecord::get64(&entries[2 * SampleLog::INDEX_ENTRY_SIZE + 16]));
+    flipByte(path, third + 3);
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 4, SampleLog::GORILLA, 60));
+    EXPECT_EQ(log.size(), 120u);
+    EXPECT_EQ(log.lastSequence(), 120u);
+    EXPECT_EQ(fileSize(path), third);
+    EXPECT_EQ(fileSize(index), static_cast<off_t>(2 * SampleLog::INDEX_ENTRY_SIZE));
+
+    // New samples start a keyframe run where the damaged one was, and decode
+    fill(log, 121, 125);
+    std::vector<SampleLog::Extent> extents;
+    log.findRange(timeOf(121), timeOf(125), extents);
+    ASSERT_EQ(extents.size(), 1u);
+    std::vector<Sample> got = readExtent(log, extents[0]);
+    ASSERT_FALSE(got.empty());
+    EXPECT_EQ(got.back().seq, 125u);
+}
+
+// Switching history_format on a directory that holds the other format is refused, so numbering never restarts
+TEST_F(SampleLogTest, OtherFormatIsRefused) {
+    {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir, 4));
+        fill(log, 1, 10);
+    }
+    {
+        SampleLog log;
+        EXPECT_FALSE(log.open(dir, 4, SampleLog::GORILLA, 60));
+        EXPECT_FALSE(log.append(sampleAt(1)));  // Stays closed
+        EXPECT_EQ(log.lastSequence(), 0u);
+    }
+    EXPECT_EQ(fileSize(segmentFile(dir, 1, "gor")), -1);
+
+    SampleLog log;
+    ASSERT_TRUE(log.open(dir, 4));
+    EXPECT_EQ(log.lastSequence(), 10u);
+
+    std::string other = dir + "-gorilla";
+    {
+        SampleLog encoded;
+        ASSERT_TRUE(encoded.open(other, 4, SampleLog::GORILLA, 60));
+        fill(encoded, 1, 10);
+    }
+    SampleLog raw;
+    EXPECT_FALSE(raw.open(other, 4));
+    EXPECT_EQ(fileSize(segmentFile(other, 1, "dat")), -1);
+}
+
+// The cursor yields exactly the samples of the range, in order and across buffers, from either format
+TEST_F(SampleLogTest, CursorReadsRange) {
+    const SampleLog::Format formats[] = {SampleLog::RAW, SampleLog::GORILLA};
+    for (SampleLog::Format format : formats) {
+        SampleLog log;
+        ASSERT_TRUE(log.open(dir + (format == SampleLog::RAW ? "-raw" : "-gorilla"), 4, format, 60));
+        fill(log, 1, 5000);
+
+        // Starts between two samples and mid keyframe run; at most max samples per call
+        HistoryCursor cursor;
+        cursor.start(log, timeOf(1000) + 1, timeOf(4000));
+        Sample out[50];
+        uint64_t next = 1001;
+        size_t n;
+        while ((n = cursor.next(out, 50)) > 0) {
+            ASSERT_LE(n, 50u);
+            for (size_t i = 0; i < n; ++i) {
+                ASSERT_EQ(out[i].seq, next) << "format " << format;
+                EXPECT_EQ(out[i].timestamp_us, timeOf(next));
+                EXPECT_EQ(out[i].pH, sampleAt(next).pH);
+                next++;
+            }
+        }
+        EXPECT_EQ(next, 4001u) << "format " << format;
+        EXPECT_FALSE(cursor.active());
+
+        cursor.start(log, timeOf(5001), timeOf(6000));
+        EXPECT_EQ(cursor.next(out, 50), 0u);
+        EXPECT_FALSE(cursor.active());
+
+        cursor.start(log, timeOf(1), timeOf(5000));
+        EXPECT_GT(cursor.next(out, 50), 0u);
+        EXPECT_TRUE(cursor.active());
+        cursor.abort();
+        EXPECT_FALSE(cursor.active());
+        EXPECT_EQ(cursor.next(out, 50), 0u);
+    }
+}
@@ -1,10 +1,31 @@
-#include "../main.cpp"
 #include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../src/common/water_quality.h"
+#include "../src/data_collection/data_collector.h"
+#include "../src/display/headless_backend.h"
+#include "../src/display/layout.h"
+#include "../src/display/rgb565.h"
+#include "../src/display/sparkline.h"
+#include "../src/display/spi_bus.h"
+#include "../src/display/text_field.h"
+#include "../src/display/tft_freetype.h"
+#include "../src/info_updating/deadband_filter.h"
+#include "../src/info_updating/debug_info_updater.h"
+#include "../src/info_updating/tft_info_updater.h"
+#include "../src/networking/stream_encoder.h"
 
 // A simulated PCF8591 class
 class MockPCF8591 : public PCF8591 {
 public:
-    int readMultiple(int* channels, int numChannels, int* results) override {
+    MockPCF8591() : PCF8591(-1) {}  // No I2C bus
+    int readMultiple(int* /* channels */, int numChannels, int* results) override {
         // Simulated reading result
         for (int i = 0; i < numChannels; ++i) {
             results[i] = 128; // Simulated fixed value
@@ -21,86 +42,491 @@ public:
     }
 };
 
+// Counts the updates a filter lets through
+class CountingUpdater : public InfoUpdater {
+public:
+    CountingUpdater() : count(0) {}
+    void update() override { count++; }
+    int count;
+};
+
+// Run a function with the standard output (file descriptor 1) redirected to a buffer
+static std::string captureStdout(const std::function<void()>& fn) {
+    fflush(stdout);
+    FILE* tmp = tmpfile();
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(tmp), STDOUT_FILENO);
+    fn();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    std::string output;
+    char buf[256];
+    rewind(tmp);
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), tmp)) > 0) {
+        output.append(buf, n);
+    }
+    fclose(tmp);
+    return output;
+}
+
 // Test data acquisition timer callback function
 TEST(MainTest, DataCollectionTimerCallback) {
     MockPCF8591 pcf8591;
     MockDS18B20 ds18b20;
-    int channels[] = {0, 1};
-    int numChannels = 2;
-    int results[2];
+    DataCollector collector(pcf8591, ds18b20);
 
-    pcf8591.readMultiple(channels, numChannels, results);
-    g_water_quality.turbidity = 100 - results[0] * 100.0 / 255;
-    g_water_quality.ds18b20 = ds18b20.readTemperature();
-    g_water_quality.pH = 14.0 - results[1] * 14.0 / 255.0;
+    collector.collectData();
 
-    EXPECT_FLOAT_EQ(g_water_quality.turbidity, 100 - 128 * 100.0 / 255);
-    EXPECT_FLOAT_EQ(g_water_quality.ds18b20, 25.0);
-    EXPECT_FLOAT_EQ(g_water_quality.pH, 14.0 - 128 * 14.0 / 255.0);
+    WaterQuality& wq = WaterQuality::getInstance();
+    EXPECT_FLOAT_EQ(wq.getTurbidity(), 100 - 128 * 100.0 / 255);
+    EXPECT_FLOAT_EQ(wq.getDS18B20(), 25.0);
+    EXPECT_FLOAT_EQ(wq.getpH(), 14.0 - 128 * 14.0 / 255.0);
 }
 
 // Update function for test and debug information
 TEST(MainTest, UpdateDebugInfo) {
     // Simulated water quality parameters
-    g_water_quality.turbidity = 50.0;
-    g_water_quality.ds18b20 = 20.0;
-    g_water_quality.pH = 7.0;
-
-    // Redirect the standard output to the buffer
-    std::stringstream buffer;
-    std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
-
-    update_debug_info();
+    WaterQuality::getInstance().setTurbidity(50.0);
+    WaterQuality::getInstance().setDS18B20(20.0);
+    WaterQuality::getInstance().setpH(7.0);
 
-    // Restore standard output
-    std::cout.rdbuf(old);
+    // The logger thread is not started, so the lines are written before update() returns
+    DebugInfoUpdater updater;
+    std::string output = captureStdout([&updater]() { updater.update(); });
 
-    std::string output = buffer.str();
     EXPECT_TRUE(output.find("Debugging information update") != std::string::npos);
-    EXPECT_TRUE(output.find("AIN0 value -> Turbidity: 50") != std::string::npos);
-    EXPECT_TRUE(output.find("DS18B20 value -> Temperature: 20℃") != std::string::npos);
+    EXPECT_TRUE(output.find("AIN0 value -> turbidity: 50") != std::string::npos);
+    EXPECT_TRUE(output.find("DS18B20 value -> temperature: 20℃") != std::string::npos);
     EXPECT_TRUE(output.find("pH value -> pH: 7") != std::string::npos);
 }
 
-// Test the TFT information update function
+// Only a value leaving its deadband, a sensor failing or recovering, or the heartbeat lets an update through
+TEST(MainTest, DeadbandFilter) {
+    WaterQuality& wq = WaterQuality::getInstance();
+    wq.setTurbidity(50.0f);
+    wq.setDS18B20(20.0f);
+    wq.setpH(7.0f);
+    CountingUpdater sink;
+    DeadbandFilter filter(&sink, 0.5f, 0.0f, 0.05f, 0);  // No temperature deadband, no heartbeat
+
+    filter.update();  // The first update always goes out
+    EXPECT_EQ(sink.count, 1);
+
+    // Noise inside the deadbands, and any temperature change, is suppressed
+    wq.setTurbidity(50.4f);
+    wq.setpH(7.03f);
+    wq.setDS18B20(35.0f);
+    filter.update();
+    EXPECT_EQ(sink.count, 1);
+
+    // Drift is measured from the last forwarded value, so it is reported once it adds up
+    wq.setTurbidity(50.6f);
+    filter.update();
+    EXPECT_EQ(sink.count, 2);
+    EXPECT_EQ(filter.stats().triggered[DeadbandFilter::TURBIDITY], 1u);
+    EXPECT_EQ(filter.stats().triggered[DeadbandFilter::TEMPERATURE], 0u);
+
+    wq.setpH(6.9f);
+    filter.update();
+    EXPECT_EQ(sink.count, 3);
+    EXPECT_EQ(filter.stats().triggered[DeadbandFilter::PH], 1u);
+    EXPECT_EQ(filter.stats().triggered[DeadbandFilter::TURBIDITY], 1u);
+
+    // A failed sensor is reported on every channel, deadband or not, and so is its recovery
+    wq.setDS18B20(NAN);
+    filter.update();
+    filter.update();
+    EXPECT_EQ(sink.count, 4);
+    EXPECT_EQ(filter.stats().triggered[DeadbandFilter::TEMPERATURE], 1u);
+    wq.setDS18B20(20.0f);
+    filter.update();
+    EXPECT_EQ(sink.count, 5);
+
+    EXPECT_EQ(filter.stats().forwarded, 5u);
+    EXPECT_EQ(filter.stats().suppressed, 2u);
+    EXPECT_EQ(filter.stats().heartbeats, 0u);
+    EXPECT_NEAR(filter.suppressionRatio(), 100.0 * 2 / 7, 1e-9);
+
+    // Without any change, the heartbeat forwards once its interval has passed
+    DeadbandFilter beating(&sink, 0.5f, 0.0f, 0.0f, 20);
+    beating.update();
+    beating.update();
+    EXPECT_EQ(sink.count, 6);
+    usleep(25000);
+    beating.update();
+    EXPECT_EQ(sink.count, 7);
+    EXPECT_EQ(beating.stats().heartbeats, 1u);
+    beating.update();
+    EXPECT_EQ(sink.count, 7);
+}
+
+// Test the TFT text output on a simulated panel
 TEST(MainTest, UpdateTFTInfo) {
-    // Simulated water quality parameters
-    g_water_quality.turbidity = 60.0;
-    g_water_quality.ds18b20 = 22.0;
-    g_water_quality.pH = 7.5;
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    FILE* spi = tmpfile();
+    {
+        TFTFreetype tft(new HeadlessBackend(dup(fileno(spi))), font, 16);
+        tft.drawString(5, 80, L"pH: 7.50", 0xFFFF);
+        tft.flush();
+    }
 
-    update_tft_info();
+    // Every glyph is a window command followed by its RGB565 pixels
+    fseek(spi, 0, SEEK_END);
+    EXPECT_GT(ftell(spi), 0);
+    fclose(spi);
+}
 
-    // Due to the specific implementation of the TFTFreetype class, it is not possible to directly verify the drawing result here.
-    // It is advisable to add some methods to the TFTFreetype class to obtain the drawing information for verification purposes.
+// The display thread draws the snapshot handed over and sends only the pixels that changed
+TEST(MainTest, TFTDisplayThread) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    TFTFreetype tft(new HeadlessBackend(), font, 16);
+    TFTInfoUpdater updater(tft);
+    WaterQuality& wq = WaterQuality::getInstance();
+    wq.setTurbidity(42.25f);
+    wq.setDS18B20(20.5f);
+    wq.setpH(7.5f);
+
+    // The first frame covers the whole panel, whose contents are unknown
+    updater.update();
+    updater.sync();
+    uint64_t full = tft.pixelsSent();
+    EXPECT_EQ(full, static_cast<uint64_t>(FrameBuffer::WIDTH * FrameBuffer::HEIGHT));
+
+    // Same values: the frame is redrawn but nothing is sent
+    updater.update();
+    updater.sync();
+    EXPECT_EQ(tft.pixelsSent(), full);
+
+    // One digit changes: only its neighbourhood is sent
+    wq.setpH(7.51f);
+    updater.update();
+    updater.sync();
+    EXPECT_GT(tft.pixelsSent(), full);
+    EXPECT_LT(tft.pixelsSent() - full, 16u * 20u);
 }
 
-// Test the socket communication function
-TEST(MainTest, UpdateSocketInfo) {
-    // Simulated water quality parameters
-    g_water_quality.turbidity = 70.0;
-    g_water_quality.ds18b20 = 23.0;
-    g_water_quality.pH = 8.0;
+// A text field redraws only the cells that changed and ends up with the same pixels as a fresh draw
+TEST(MainTest, TextField) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    TFTFreetype tft(new HeadlessBackend(), font, 16);
+    TextField field(tft, 5, 20, 0xFFFF);
+    EXPECT_EQ(field.set(L"pH: 7.50"), 8u);
+    EXPECT_EQ(field.set(L"pH: 7.50"), 0u);
+    EXPECT_EQ(field.set(L"pH: 7.51"), 1u);
+    EXPECT_EQ(field.set(L"pH: 7.5"), 0u);    // Shorter: the last cell is only erased
+    EXPECT_EQ(field.set(L"pH: 12.5"), 4u);   // "7.5" -> "12.5"
+    EXPECT_EQ(field.set(L"pH: 10.5"), 1u);   // Digit cells share one width, so nothing moves
+
+    TFTFreetype fresh(new HeadlessBackend(), font, 16);
+    TextField reference(fresh, 5, 20, 0xFFFF);
+    reference.set(L"pH: 10.5");
+    int differing = 0;
+    for (int y = 0; y < FrameBuffer::HEIGHT; ++y) {
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            differing += tft.frameBuffer().at(x, y) != fresh.frameBuffer().at(x, y);
+        }
+    }
+    EXPECT_EQ(differing, 0);
+}
 
-    // Simulated socket
-    int sock = 1; // Simulated socket descriptor
+// Labels come from the cached page background; an update redraws only the values that changed, and pages rotate
+TEST(MainTest, Layout) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    TFTFreetype tft(new HeadlessBackend(), font, 16);
+    const Layout::Probe probes[] = {
+        {L"pH", L"", 1, 6.5f, 8.5f}, {L"T1", L"%", 1, NAN, NAN}, {L"T2", L"%", 1, NAN, NAN}, {L"T3", L"%", 1, NAN, NAN},
+        {L"T4", L"%", 1, NAN, NAN},  {L"T5", L"%", 1, NAN, NAN}, {L"T6", L"%", 1, NAN, NAN},
+    };
+    const Layout::Style style = {0xBDF7, 0xFFFF, 0xF800, 0x0000};
+    Layout layout(tft, probes, 7, 0, 100, 1000, style);
+    EXPECT_EQ(layout.rowsPerPage(), 4u);  // Five rows of 19 pixels, the last one for the page indicator
+    EXPECT_EQ(layout.pages(), 2u);
 
-    // Redirect the standard output to the buffer
-    std::stringstream buffer;
-    std::streambuf* old = std::cout.rdbuf(buffer.rdbuf());
+    auto alarmShown = [&tft]() {
+        for (int y = 0; y < 100; ++y) {
+            for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+                if (tft.frameBuffer().at(x, y) == 0xF800) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    float values[] = {7.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+    EXPECT_EQ(layout.update(0, values), 12u);  // Three cells per value of page 0
+    EXPECT_EQ(layout.update(10, values), 0u);
+    values[2] = 2.5f;
+    values[5] = 9.0f;  // Not on the page shown
+    EXPECT_EQ(layout.update(20, values), 1u);
+    EXPECT_FALSE(alarmShown());
+    values[0] = 9.0f;
+    EXPECT_EQ(layout.update(30, values), 3u);  // New colour: every cell
+    EXPECT_TRUE(alarmShown());
+    std::vector<uint16_t> page0;
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            page0.push_back(tft.frameBuffer().at(x, y));
+        }
+    }
 
-    update_socket_info(sock);
+    // After a page period the next page is shown with its values, then the first one comes back unchanged
+    EXPECT_EQ(layout.update(1030, values), 9u);
+    EXPECT_EQ(layout.page(), 1u);
+    EXPECT_FALSE(alarmShown());
+    EXPECT_EQ(layout.update(2030, values), 12u);
+    EXPECT_EQ(layout.page(), 0u);
+    int differing = 0;
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            differing += tft.frameBuffer().at(x, y) != page0[y * FrameBuffer::WIDTH + x];
+        }
+    }
+    EXPECT_EQ(differing, 0);
+}
 
-    // Restore standard output
-    std::cout.rdbuf(old);
+// Samples are reduced to min/max columns; each column is one row followed by a hardware scroll command
+TEST(MainTest, Sparkline) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    FILE* spi = tmpfile();
+    TFTFreetype tft(new HeadlessBackend(dup(fileno(spi))), font, 16);
+    const Sparkline::Channel lanes[Sparkline::CHANNELS] = {{0, 100, 0xFFE0}, {0, 40, 0xF800}, {0, 14, 0x07E0}};
+    Sparkline chart(tft, 100, 60, 1000, lanes);  // 1 ms per column
+    tft.flush();
+    uint64_t sent = tft.pixelsSent();
 
-    std::string output = buffer.str();
-    std::string expected = "{\"tur\":\"70.00\", \"tmp\":\"23.00\", \"pH\":\"8.00\"}";
-    EXPECT_TRUE(output.find(expected) != std::string::npos);
+    float a[] = {10.0f, 20.0f, 7.0f};
+    float b[] = {30.0f, 20.0f, NAN};
+    EXPECT_EQ(chart.add(0, a), 0u);
+    EXPECT_EQ(chart.add(500, b), 0u);
+    EXPECT_EQ(chart.add(1000, a), 1u);
+    EXPECT_FLOAT_EQ(chart.column(0).lo[0], 10.0f);
+    EXPECT_FLOAT_EQ(chart.column(0).hi[0], 30.0f);
+    EXPECT_FLOAT_EQ(chart.column(0).hi[2], 7.0f);
+
+    // Only the new row is sent; the turbidity bar spans 10-30 % of its 40-pixel lane
+    tft.flush();
+    EXPECT_LE(tft.pixelsSent() - sent, static_cast<uint64_t>(FrameBuffer::WIDTH));
+    EXPECT_EQ(tft.frameBuffer().at(4, 100), 0x0000);
+    EXPECT_EQ(tft.frameBuffer().at(5, 100), 0xFFE0);
+    EXPECT_EQ(tft.frameBuffer().at(13, 100), 0xFFE0);
+    EXPECT_EQ(tft.frameBuffer().at(14, 100), 0x0000);
+
+    // Periods without samples repeat the last column
+    EXPECT_EQ(chart.add(4500, a), 3u);
+    EXPECT_EQ(chart.columns(), 4u);
+    tft.flush();
+
+    // The flush ends with VSCSAD showing row 103 at the bottom: frame memory line 161 - 103
+    fflush(spi);
+    uint8_t tail[3];
+    ASSERT_EQ(fseek(spi, -3, SEEK_END), 0);
+    ASSERT_EQ(fread(tail, 1, 3, spi), 3u);
+    EXPECT_EQ(tail[0], 0x37);
+    EXPECT_EQ(tail[1], 0x00);
+    EXPECT_EQ(tail[2], 58);
+    fclose(spi);
+}
+
+// The vector blend kernel gives the same pixels as the scalar reference, including the tail of a row
+TEST(MainTest, BlendKernel) {
+    uint8_t coverage[259];
+    for (size_t i = 0; i < sizeof(coverage); ++i) {
+        coverage[i] = static_cast<uint8_t>(i * 97);  // Every value, in scattered order
+    }
+    const uint16_t colors[][2] = {{0xFFFF, 0x0000}, {0x0000, 0xFFFF}, {0xF800, 0x07E0}, {0x1234, 0xABCD}};
+    uint16_t out[sizeof(coverage)];
+    for (const auto& c : colors) {
+        Rgb565::blendRow(coverage, sizeof(coverage), c[0], c[1], out);
+        int differing = 0;
+        for (size_t i = 0; i < sizeof(coverage); ++i) {
+            uint16_t expected = Rgb565::blend(c[0], c[1], coverage[i]);
+            differing += out[i] != static_cast<uint16_t>((expected >> 8) | (expected << 8));
+        }
+        EXPECT_EQ(differing, 0) << Rgb565::kernel() << " kernel, " << c[0] << " on " << c[1];
+    }
+}
+
+// Glyphs are rendered once; characters missing from the font are drawn as a replacement
+TEST(MainTest, GlyphCache) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    TFTFreetype tft(new HeadlessBackend(), font, 16);
+    tft.drawString(5, 20, L"pH: 7.77", 0xFFFF);
+    uint64_t rendered = tft.glyphCache().rendered();
+    EXPECT_EQ(rendered, 6u);  // 'p', 'H', ':', ' ', '7', '.'
+
+    tft.drawString(5, 20, L"pH: 7.77", 0xFFFF);
+    EXPECT_EQ(tft.glyphCache().rendered(), rendered);
+
+    // U+10FFFD (private use) is in no font
+    tft.drawString(5, 50, L"\U0010FFFD", 0xFFFF);
+    EXPECT_EQ(tft.glyphCache().size(), 7u);
+
+    EXPECT_EQ(GlyphCache::blend(0xFFFF, 0x0000, 255), 0xFFFF);
+    EXPECT_EQ(GlyphCache::blend(0xFFFF, 0x0000, 0), 0x0000);
+    EXPECT_EQ(GlyphCache::blend(0xF800, 0x001F, 128), (16 << 11) | 15);
 }
 
-// Remove the custom main function and use the main function provided by Google Test instead.
-// int main(int argc, char **argv) {
-//     ::testing::InitGoogleTest(&argc, argv);
-//     return RUN_ALL_TESTS();
-// }
+#ifdef WQM_BAKED_FONT
+// Baked glyphs draw the dashboard without the font file, with the same pixels as FreeType
+TEST(MainTest, BakedFont) {
+    TFTFreetype baked(new HeadlessBackend(), "/nonexistent/font.ttf", DASHBOARD_FONT.size, &DASHBOARD_FONT);
+    baked.drawString(5, 20, L"pH 7.50", 0xFFFF);
+    EXPECT_EQ(baked.glyphCache().rendered(), 0u);
+    EXPECT_EQ(baked.glyphCache().fromBaked(), 7u);  // 'p', 'H', ' ', '7', '.', '5', '0'
+    EXPECT_FALSE(baked.glyphCache().freetypeLoaded());
+
+    // Not baked and no font: the baked replacement keeps the text in place
+    baked.drawString(5, 50, L"\u00E9", 0xFFFF);
+    EXPECT_GT(baked.advance(L'\u00E9', 0xFFFF, 0x0000), 0);
+
+    if (access(DASHBOARD_FONT_PATH, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    TFTFreetype rendered(new HeadlessBackend(), DASHBOARD_FONT_PATH, DASHBOARD_FONT.size);
+    rendered.drawString(5, 20, L"pH 7.50", 0xFFFF);
+    rendered.drawString(5, 50, L"\uFFFD", 0xFFFF);
+    EXPECT_EQ(rendered.ascent(), baked.ascent());
+    EXPECT_EQ(rendered.lineHeight(), baked.lineHeight());
+    int differing = 0;
+    for (int y = 0; y < FrameBuffer::HEIGHT; ++y) {
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            differing += *rendered.frameBuffer().row(x, y) != *baked.frameBuffer().row(x, y);
+        }
+    }
+    EXPECT_EQ(differing, 0);
+}
+#endif
+
+// The headless panel decodes the bytes into the same screen as the framebuffer, scrolling included
+TEST(MainTest, HeadlessBackend) {
+    const char* font = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    if (access(font, R_OK) != 0) {
+        GTEST_SKIP() << "font not installed";
+    }
+    HeadlessBackend* panel = new HeadlessBackend();
+    TFTFreetype tft(panel, font, 16);
+    EXPECT_TRUE(panel->displayOn());
+    EXPECT_EQ(panel->sleptUs(), 720000u);  // Reset and sleep-out waits, not slept
+    EXPECT_EQ(panel->toggles(DisplayBackend::PIN_RST), 1u);
+
+    const Sparkline::Channel lanes[Sparkline::CHANNELS] = {{0, 100, 0xFFE0}, {0, 40, 0xF800}, {0, 14, 0x07E0}};
+    Sparkline chart(tft, 100, 60, 1000, lanes);
+    tft.drawString(5, 20, L"pH: 7.50", 0xFFFF);
+    float a[] = {10.0f, 20.0f, 7.0f};
+    chart.add(0, a);
+    chart.add(1000, a);
+    uint64_t bytes = panel->bytes();
+    uint64_t toggles = panel->toggles(DisplayBackend::PIN_CS);
+    tft.flush();
+    EXPECT_GT(panel->bytes() - bytes, static_cast<uint64_t>(FrameBuffer::WIDTH * FrameBuffer::HEIGHT * 2));
+    EXPECT_EQ(panel->toggles(DisplayBackend::PIN_CS) - toggles, 2u);  // Selected once per flush
+    EXPECT_GE(panel->transactions(), 10u);  // A full frame in bufsiz-sized messages
+
+    // The chart's first column (frame row 100) is scrolled to the bottom edge of the band
+    int differing = 0;
+    for (int y = 0; y < FrameBuffer::HEIGHT; ++y) {
+        int row = y == FrameBuffer::HEIGHT - 1 ? 100 : y >= 100 ? y + 1 : y;
+        for (int x = 0; x < FrameBuffer::WIDTH; ++x) {
+            differing += panel->pixel(x, y) != tft.frameBuffer().at(x, row);
+        }
+    }
+    EXPECT_EQ(differing, 0);
+
+    std::string path = testing::TempDir() + "headless_backend.ppm";
+    ASSERT_TRUE(panel->dumpPpm(path));
+    FILE* ppm = fopen(path.c_str(), "rb");
+    ASSERT_NE(ppm, nullptr);
+    fseek(ppm, 0, SEEK_END);
+    long header = static_cast<long>(strlen("P6\n128 160\n255\n"));
+    EXPECT_EQ(ftell(ppm), header + FrameBuffer::WIDTH * FrameBuffer::HEIGHT * 3);
+    fclose(ppm);
+    remove(path.c_str());
+}
+
+// Nearby changes are sent as one rectangle, distant ones separately, and each area only once
+TEST(MainTest, FrameBufferDirtyRects) {
+    FrameBuffer fb;
+    FrameBuffer::Rect rects[FrameBuffer::MAX_DIRTY];
+    uint16_t glyph[10 * 12];
+    for (uint16_t& p : glyph) {
+        p = 0xFFFF;
+    }
+
+    // A line of text: adjacent glyph cells merge into one transfer
+    for (int i = 0; i < 8; ++i) {
+        fb.blit(5 + i * 10, 20, 10, 12, glyph);
+    }
+    fb.blit(100, 140, 10, 12, glyph);
+    ASSERT_EQ(fb.takeDirty(rects), 2u);
+    EXPECT_EQ(rects[0].x, 5);
+    EXPECT_EQ(rects[0].w, 80);
+    EXPECT_EQ(rects[0].h, 12);
+    EXPECT_EQ(rects[1].y, 140);
+    EXPECT_EQ(fb.takeDirty(rects), 0u);
+
+    // Clipped to the panel; a full-screen fill swallows everything else
+    fb.blit(-5, -5, 10, 12, glyph);
+    fb.fill(0, 0, 1000, 1000, 0x001F);
+    ASSERT_EQ(fb.takeDirty(rects), 1u);
+    EXPECT_EQ(rects[0].w, FrameBuffer::WIDTH);
+    EXPECT_EQ(rects[0].h, FrameBuffer::HEIGHT);
+    EXPECT_EQ(fb.at(127, 159), 0x001F);
+}
+
+// Queued buffers are packed into messages that fit spidev's buffer once each transfer is aligned
+TEST(MainTest, SpiBusMessages) {
+    SpiBus bus(open("/dev/null", O_WRONLY));
+    static uint8_t frame[FrameBuffer::WIDTH * FrameBuffer::HEIGHT * 2];
+    ASSERT_EQ(bus.messageLimit(), 4096u);
+
+    // A full frame: 40960 contiguous bytes, ten full messages
+    bus.write(frame, sizeof(frame));
+    EXPECT_EQ(bus.messages(), 10u);
+
+    // 160 rows of a 20-pixel rectangle: 40 bytes each, counted as 128, so 32 rows per message
+    for (int row = 0; row < FrameBuffer::HEIGHT; ++row) {
+        bus.queue(frame + row * FrameBuffer::WIDTH * 2, 40);
+    }
+    bus.submit();
+    EXPECT_EQ(bus.messages(), 15u);
+
+    // Nothing queued, nothing sent
+    bus.submit();
+    EXPECT_EQ(bus.messages(), 15u);
+}
+
+// Test the socket communication function
+TEST(MainTest, UpdateSocketInfo) {
+    Sample s = {1, 1700000000000000LL, 70.0f, 23.0f, 8.0f};
+    StreamEncoder encoder(StreamEncoder::JSON);
+    uint8_t out[StreamEncoder::MAX_MESSAGE];
+    bool keyframe = false;
+
+    size_t len = encoder.encode(s, out, &keyframe);
+
+    std::string output(reinterpret_cast<const char*>(out), len);
+    std::string expected = "\"tur\":\"70.00\", \"tmp\":\"23.00\", \"pH\":\"8.00\"}";
+    EXPECT_TRUE(output.find(expected) != std::string::npos);
+    EXPECT_TRUE(keyframe);
+}
@@ -0,0 +1,353 @@
+// query_test.cpp
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "../src/common/query_protocol.h"
+#include "../src/common/sample_codec.h"
+#include "../src/common/sample_record.h"
+#include "../src/common/water_quality.h"
+#include "../src/event_loop/event_loop.h"
+#include "../src/networking/query_server.h"
+#include "../src/storage/sample_log.h"
+
+namespace {
+
+const int64_t T0 = 1760000000000000LL;  // Timestamp of sequence number 1; one sample per second after it
+const uint64_t STORED = 3000;           // More than SLICE_CHUNKS chunks of CHUNK_SAMPLES samples
+
+Sample sampleAt(uint64_t seq) {
+    Sample s;
+    s.seq = seq;
+    s.timestamp_us = T0 + static_cast<int64_t>(seq - 1) * 1000000;
+    s.turbidity = 10.0f + static_cast<float>(seq % 7);
+    s.temperature = 20.0f + static_cast<float>(seq % 3) * 0.25f;
+    s.pH = 7.0f + static_cast<float>(seq % 5) * 0.01f;
+    return s;
+}
+
+int64_t timeOf(uint64_t seq) {
+    return sampleAt(seq).timestamp_us;
+}
+
+void expectSample(const Sample& s, uint64_t seq) {
+    Sample expected = sampleAt(seq);
+    EXPECT_EQ(s.seq, seq);
+    EXPECT_EQ(s.timestamp_us, expected.timestamp_us);
+    EXPECT_EQ(s.turbidity, expected.turbidity);
+    EXPECT_EQ(s.temperature, expected.temperature);
+    EXPECT_EQ(s.pH, expected.pH);
+}
+
+// One response chunk as the client sees it
+struct Chunk {
+    uint8_t op;
+    uint8_t status;
+    uint8_t flags;
+    uint32_t id;
+    std::vector<uint8_t> payload;
+};
+
+}  // namespace
+
+// A server over a stored history, talking to the test through a socketpair; the loop is turned by hand
+class QueryServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char templ[] = "/tmp/wqm_query_XXXXXX";
+        ASSERT_NE(mkdtemp(templ), nullptr);
+        dir = templ;
+        ASSERT_TRUE(log.open(dir + "/history", 2));
+        for (uint64_t seq = 1; seq <= STORED; ++seq) {
+            ASSERT_TRUE(log.append(sampleAt(seq)));
+        }
+        loop.reset(new EventLoop(running));
+        server.reset(new QueryServer(*loop, dir + "/query.sock", &log));
+
+        int sv[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv), 0);
+        // A small send buffer, so long answers wait for the client to read (EPOLLOUT)
+        int size = 4096;
+        setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        ASSERT_TRUE(server->adopt(sv[0]));
+        client = sv[1];
+    }
+
+    void TearDown() override {
+        if (client >= 0) {
+            close(client);
+        }
+        server.reset();
+        loop.reset();
+        std::system(("rm -rf " + dir).c_str());
+    }
+
+    // One pass of the loop: ready handlers, then the tasks they posted
+    void turn() {
+        running = true;
+        loop->post([this]() { running = false; });
+        loop->run();
+    }
+
+    void request(uint8_t op, uint8_t flags, uint32_t id, int64_t from_us, int64_t to_us) {
+        QueryProtocol::Request r = {op, flags, id, from_us, to_us};
+        uint8_t buf[QueryProtocol::REQUEST_SIZE];
+        QueryProtocol::encodeRequest(r, buf);
+        sendRaw(buf, sizeof(buf));
+    }
+
+    void sendRaw(const uint8_t* data, size_t len) {
+        ASSERT_EQ(send(client, data, len, MSG_NOSIGNAL), static_cast<ssize_t>(len));
+    }
+
+    // Read whatever the server has sent; false once it has closed the connection
+    bool drain() {
+        uint8_t buf[8192];
+        for (;;) {
+            ssize_t n = recv(client, buf, sizeof(buf), 0);
+            if (n > 0) {
+                received.insert(received.end(), buf, buf + n);
+                continue;
+            }
+            return n < 0;  // EAGAIN: still open
+        }
+    }
+
+    // Next chunk, turning the loop until it has arrived
+    bool receive(Chunk* c) {
+        for (int turns = 0; turns < 10000; ++turns) {
+            if (received.size() >= QueryProtocol::RESPONSE_HEADER) {
+                size_t len = SampleRecord::get32(&received[8]);
+                if (received.size() >= QueryProtocol::RESPONSE_HEADER + len) {
+                    EXPECT_EQ(received[0], QueryProtocol::RESPONSE_MAGIC);
+                    c->op = received[1];
+                    c->status = received[2];
+                    c->flags = received[3];
+                    c->id = SampleRecord::get32(&received[4]);
+                    c->payload.assign(received.begin() + QueryProtocol::RESPONSE_HEADER,
+                                      received.begin() + QueryProtocol::RESPONSE_HEADER + len);
+                    received.erase(received.begin(), received.begin() + QueryProtocol::RESPONSE_HEADER + len);
+                    return true;
+                }
+            }
+            turn();
+            if (!drain()) {
+                peer_closed = true;
+                if (received.size() < QueryProtocol::RESPONSE_HEADER) {
+                    return false;
+                }
+            }
+        }
+        ADD_FAILURE() << "no response";
+        return false;
+    }
+
+    // Every chunk of the next answer, up to the FINAL one
+    std::vector<Chunk> answer() {
+        std::vector<Chunk> chunks;
+        Chunk c;
+        while (receive(&c)) {
+            chunks.push_back(c);
+            if (c.flags & QueryProtocol::FLAG_FINAL) {
+                break;
+            }
+        }
+        return chunks;
+    }
+
+    std::string dir;
+    SampleLog log;
+    std::atomic<bool> running;
+    std::unique_ptr<EventLoop> loop;
+    std::unique_ptr<QueryServer> server;
+    int client = -1;
+    std::vector<uint8_t> received;
+    bool peer_closed = false;
+};
+
+// LATEST answers the sample being shown, or NOT_FOUND before the first acquisition
+TEST_F(QueryServerTest, Latest) {
+    WaterQuality& wq = WaterQuality::getInstance();
+    wq.beginSample(0);
+    request(QueryProtocol::LATEST, 0, 1, 0, 0);
+    std::vector<Chunk> chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::NOT_FOUND);
+    EXPECT_TRUE(chunks[0].payload.empty());
+
+    Sample latest = sampleAt(STORED + 1);
+    wq.setSequence(latest.seq - 1);
+    wq.beginSample(latest.timestamp_us);
+    wq.setTurbidity(latest.turbidity);
+    wq.setDS18B20(latest.temperature);
+    wq.setpH(latest.pH);
+    request(QueryProtocol::LATEST, 0, 2, 0, 0);
+    chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].op, QueryProtocol::LATEST);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::OK);
+    EXPECT_EQ(chunks[0].flags, QueryProtocol::FLAG_FINAL);
+    EXPECT_EQ(chunks[0].id, 2u);
+    ASSERT_EQ(chunks[0].payload.size(), SampleRecord::SIZE);
+    Sample s;
+    ASSERT_TRUE(SampleRecord::decode(chunks[0].payload.data(), &s));
+    expectSample(s, STORED + 1);
+    EXPECT_EQ(server->queries(), 2u);
+}
+
+// A long RANGE arrives in chunks of records, in order, with FINAL on the last chunk only
+TEST_F(QueryServerTest, RawRange) {
+    request(QueryProtocol::RANGE, 0, 7, timeOf(1), timeOf(STORED));
+    std::vector<Chunk> chunks = answer();
+    ASSERT_GE(chunks.size(), STORED / QueryServer::CHUNK_SAMPLES);
+    uint64_t next = 1;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk& c = chunks[i];
+        EXPECT_EQ(c.op, QueryProtocol::RANGE);
+        EXPECT_EQ(c.status, QueryProtocol::OK);
+        EXPECT_EQ(c.id, 7u);
+        EXPECT_EQ(c.flags, i + 1 == chunks.size() ? QueryProtocol::FLAG_FINAL : 0) << "chunk " << i;
+        ASSERT_EQ(c.payload.size() % SampleRecord::SIZE, 0u);
+        EXPECT_LE(c.payload.size(), QueryServer::CHUNK_SAMPLES * SampleRecord::SIZE);
+        for (size_t off = 0; off < c.payload.size(); off += SampleRecord::SIZE) {
+            Sample s;
+            ASSERT_TRUE(SampleRecord::decode(&c.payload[off], &s));
+            expectSample(s, next++);
+        }
+    }
+    EXPECT_EQ(next, STORED + 1);
+    EXPECT_EQ(server->queries(), 1u);
+}
+
+// A COMPRESSED RANGE: every chunk starts with a keyframe and decodes on its own
+TEST_F(QueryServerTest, CompressedRange) {
+    const uint64_t first = 100;
+    const uint64_t last = 2000;
+    request(QueryProtocol::RANGE, QueryProtocol::FLAG_COMPRESSED, 8, timeOf(first), timeOf(last));
+    std::vector<Chunk> chunks = answer();
+    ASSERT_GT(chunks.size(), 1u);
+    uint64_t next = first;
+    size_t bytes = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk& c = chunks[i];
+        uint8_t final_flag = i + 1 == chunks.size() ? QueryProtocol::FLAG_FINAL : 0;
+        EXPECT_EQ(c.status, QueryProtocol::OK);
+        EXPECT_EQ(c.flags, QueryProtocol::FLAG_COMPRESSED | final_flag) << "chunk " << i;
+        if (c.payload.empty()) {
+            continue;
+        }
+        EXPECT_EQ(c.payload[0], SampleCodec::KEYFRAME);
+        SampleDecoder decoder;
+        size_t pos = 0;
+        while (pos < c.payload.size()) {
+            Sample s;
+            size_t used = 0;
+            ASSERT_EQ(decoder.decode(&c.payload[pos], c.payload.size() - pos, &s, &used), SampleDecoder::SAMPLE);
+            expectSample(s, next++);
+            pos += used;
+        }
+        bytes += c.payload.size();
+    }
+    EXPECT_EQ(next, last + 1);
+    EXPECT_LT(bytes, (last - first + 1) * SampleRecord::SIZE);
+}
+
+// AGGREGATE over an empty range is NOT_FOUND; pipelined requests are answered in order
+TEST_F(QueryServerTest, Aggregate) {
+    request(QueryProtocol::AGGREGATE, 0, 1, timeOf(1) - 10000000, timeOf(1) - 1);
+    request(QueryProtocol::AGGREGATE, 0, 2, timeOf(10), timeOf(19));
+    request(QueryProtocol::AGGREGATE, 0, 3, 0, timeOf(STORED) + 1);
+
+    std::vector<Chunk> chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].id, 1u);
+    EXPECT_EQ(chunks[0].op, QueryProtocol::AGGREGATE);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::NOT_FOUND);
+    EXPECT_EQ(chunks[0].flags, QueryProtocol::FLAG_FINAL);
+    EXPECT_TRUE(chunks[0].payload.empty());
+
+    chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].id, 2u);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::OK);
+    ASSERT_EQ(chunks[0].payload.size(), QueryProtocol::AGGREGATE_SIZE);
+    const uint8_t* p = chunks[0].payload.data();
+    EXPECT_EQ(SampleRecord::get64(p), 10u);
+    EXPECT_EQ(static_cast<int64_t>(SampleRecord::get64(p + 8)), timeOf(10));
+    EXPECT_EQ(static_cast<int64_t>(SampleRecord::get64(p + 16)), timeOf(19));
+    for (int k = 0; k < 3; ++k) {
+        float lo = INFINITY;
+        float hi = -INFINITY;
+        double sum = 0;
+        for (uint64_t seq = 10; seq <= 19; ++seq) {
+            Sample s = sampleAt(seq);
+            float v = k == 0 ? s.turbidity : (k == 1 ? s.temperature : s.pH);
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            sum += v;
+        }
+        EXPECT_EQ(SampleRecord::bitsFloat(SampleRecord::get32(p + 24 + 12 * k)), lo) << "value " << k;
+        EXPECT_EQ(SampleRecord::bitsFloat(SampleRecord::get32(p + 28 + 12 * k)), hi) << "value " << k;
+        EXPECT_FLOAT_EQ(SampleRecord::bitsFloat(SampleRecord::get32(p + 32 + 12 * k)), static_cast<float>(sum / 10))
+            << "value " << k;
+    }
+
+    // The whole history takes several slices but still yields one answer
+    chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].id, 3u);
+    ASSERT_EQ(chunks[0].payload.size(), QueryProtocol::AGGREGATE_SIZE);
+    EXPECT_EQ(SampleRecord::get64(chunks[0].payload.data()), STORED);
+    EXPECT_EQ(server->queries(), 3u);
+}
+
+// A malformed request is answered with BAD_REQUEST and the connection is closed; what followed it is ignored
+TEST_F(QueryServerTest, BadRequestCloses) {
+    uint8_t buf[2 * QueryProtocol::REQUEST_SIZE];
+    QueryProtocol::Request r = {QueryProtocol::LATEST, 0, 42, 0, 0};
+    QueryProtocol::encodeRequest(r, buf);
+    buf[1] = QueryProtocol::VERSION + 1;
+    r.id = 43;
+    QueryProtocol::encodeRequest(r, buf + QueryProtocol::REQUEST_SIZE);
+    sendRaw(buf, sizeof(buf));
+
+    std::vector<Chunk> chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].id, 42u);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::BAD_REQUEST);
+    EXPECT_EQ(chunks[0].flags, QueryProtocol::FLAG_FINAL);
+    EXPECT_TRUE(chunks[0].payload.empty());
+
+    Chunk c;
+    EXPECT_FALSE(receive(&c));
+    EXPECT_TRUE(peer_closed);
+    EXPECT_TRUE(received.empty());
+}
+
+// An unknown operation is a bad request too; the freed slot serves a new connection
+TEST_F(QueryServerTest, UnknownOperation) {
+    request(9, 0, 5, 0, 0);
+    std::vector<Chunk> chunks = answer();
+    ASSERT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks[0].op, 9);
+    EXPECT_EQ(chunks[0].status, QueryProtocol::BAD_REQUEST);
+    Chunk c;
+    EXPECT_FALSE(receive(&c));
+
+    for (size_t i = 0; i < QueryServer::MAX_CONNECTIONS; ++i) {
+        int sv[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv), 0);
+        EXPECT_TRUE(server->adopt(sv[0]));
+        close(sv[1]);
+    }
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv), 0);
+    EXPECT_FALSE(server->adopt(sv[0]));  // Every slot is taken
+    close(sv[1]);
+}
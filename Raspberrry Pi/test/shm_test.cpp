@@ -0,0 +1,281 @@
+// shm_test.cpp
+#include <gtest/gtest.h>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include "../src/common/shm_reader.h"
+#include "../src/storage/shm_publisher.h"
+
+namespace {
+
+// Every field derives from the sequence number, so a torn copy shows as a mismatch
+Sample sampleFor(uint64_t seq) {
+    Sample s = Sample();
+    s.seq = seq;
+    s.timestamp_us = static_cast<int64_t>(seq) * 1000;
+    s.turbidity = static_cast<float>(seq % 1000);
+    s.temperature = static_cast<float>(seq % 1000) + 0.5f;
+    s.pH = static_cast<float>(seq % 14);
+    return s;
+}
+
+bool consistent(const Sample& s) {
+    Sample expected = sampleFor(s.seq);
+    return s.timestamp_us == expected.timestamp_us && s.turbidity == expected.turbidity &&
+           s.temperature == expected.temperature && s.pH == expected.pH;
+}
+
+// The writer, run from the fault the reader takes half-way through copying a slot
+struct Interruption {
+    Shm::Slot* slot;     ///< Writable view of the slot
+    void* guarded;       ///< Page of the reader's view made inaccessible
+    size_t page;         ///< Page size
+    int faults;          ///< Faults taken
+};
+Interruption interruption;
+
+void rewriteSlot(int, siginfo_t*, void*) {
+    interruption.faults++;
+    Shm::write(*interruption.slot, 7, sampleFor(7));
+    mprotect(interruption.guarded, interruption.page, PROT_READ);
+}
+
+}  // namespace
+
+class ShmTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        name = "/wqm_shm_test_" + std::to_string(getpid());
+    }
+
+    void TearDown() override {
+        unmapWritable();
+        publisher.close();
+        shm_unlink(name.c_str());
+    }
+
+    // A second, writable mapping of the region, to damage it as another version of the node would
+    Shm::Header* mapWritable() {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        EXPECT_GE(fd, 0);
+        if (fd < 0) {
+            return nullptr;
+        }
+        length = Shm::regionSize(publisher_capacity);
+        void* mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        EXPECT_NE(mem, MAP_FAILED);
+        writable = mem == MAP_FAILED ? nullptr : static_cast<Shm::Header*>(mem);
+        return writable;
+    }
+
+    void unmapWritable() {
+        if (writable != nullptr) {
+            munmap(writable, length);
+            writable = nullptr;
+        }
+    }
+
+    bool openPublisher(uint32_t capacity) {
+        publisher_capacity = capacity;
+        return publisher.open(name, capacity);
+    }
+
+    std::string name;
+    ShmPublisher publisher;
+    uint32_t publisher_capacity = 0;
+    Shm::Header* writable = nullptr;
+    size_t length = 0;
+};
+
+// Readers only attach to an initialised region of the layout version they know
+TEST_F(ShmTest, LayoutCheck) {
+    ShmReader reader;
+    EXPECT_FALSE(reader.open(name));  // Not created yet
+    ASSERT_TRUE(openPublisher(8));
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(reader.capacity(), 8u);
+    EXPECT_FALSE(reader.closed());
+    reader.close();
+
+    Shm::Header* h = mapWritable();
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(h->writer_pid, static_cast<uint32_t>(getpid()));
+    h->version = Shm::VERSION + 1;
+    EXPECT_FALSE(reader.open(name));
+    h->version = Shm::VERSION;
+    h->slot_size = sizeof(Shm::Slot) + 8;
+    EXPECT_FALSE(reader.open(name));
+    h->slot_size = sizeof(Shm::Slot);
+    h->capacity = 9;  // Ring would end past the region
+    EXPECT_FALSE(reader.open(name));
+    h->capacity = 8;
+    h->magic.store(0);  // Still being initialised
+    EXPECT_FALSE(reader.open(name));
+    h->magic.store(Shm::MAGIC);
+    EXPECT_TRUE(reader.open(name));
+}
+
+// The latest sample is readable as soon as it is published; after the writer exits it stays, marked closed
+TEST_F(ShmTest, LatestSample) {
+    ASSERT_TRUE(openPublisher(8));
+    ShmReader reader;
+    ASSERT_TRUE(reader.open(name));
+    Sample s;
+    EXPECT_FALSE(reader.latest(&s));
+
+    publisher.publish(sampleFor(41));
+    publisher.publish(sampleFor(42));
+    ASSERT_TRUE(reader.latest(&s));
+    EXPECT_EQ(s.seq, 42u);
+    EXPECT_TRUE(consistent(s));
+    EXPECT_EQ(reader.published(), 2u);
+
+    publisher.close();
+    EXPECT_TRUE(reader.closed());
+    ASSERT_TRUE(reader.latest(&s));
+    EXPECT_EQ(s.seq, 42u);
+    ShmReader late;
+    EXPECT_FALSE(late.open(name));  // Removed with the writer
+}
+
+// Once the ring has wrapped, only the last capacity samples are returned, oldest first
+TEST_F(ShmTest, RecentAcrossWrap) {
+    ASSERT_TRUE(openPublisher(8));
+    ShmReader reader;
+    ASSERT_TRUE(reader.open(name));
+    for (uint64_t seq = 1; seq <= 20; ++seq) {
+        publisher.publish(sampleFor(seq));
+    }
+
+    Sample out[16];
+    ASSERT_EQ(reader.recent(out, 16), 8u);
+    for (size_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(out[i].seq, 13 + i);
+        EXPECT_TRUE(consistent(out[i]));
+    }
+    ASSERT_EQ(reader.recent(out, 3), 3u);
+    EXPECT_EQ(out[0].seq, 18u);
+    EXPECT_EQ(out[2].seq, 20u);
+
+    // A poller that fell behind skips what was overwritten, then gets only the new samples
+    uint64_t next = 0;
+    ASSERT_EQ(reader.since(5, out, 16, &next), 8u);
+    EXPECT_EQ(out[0].seq, 13u);
+    EXPECT_EQ(next, 20u);
+    publisher.publish(sampleFor(21));
+    ASSERT_EQ(reader.since(next, out, 16, &next), 1u);
+    EXPECT_EQ(out[0].seq, 21u);
+    EXPECT_EQ(next, 21u);
+    EXPECT_EQ(reader.since(next, out, 16, &next), 0u);
+
+    // A count beyond the region's belongs to a previous run: nothing is returned and the poller restarts here
+    EXPECT_EQ(reader.since(1000, out, 16, &next), 0u);
+    EXPECT_EQ(next, 21u);
+}
+
+// A slot being written (odd counter) is not read, and no copy the reader accepts is torn
+TEST_F(ShmTest, ReaderRetries) {
+    ASSERT_TRUE(openPublisher(4));
+    ShmReader reader;
+    ASSERT_TRUE(reader.open(name));
+    publisher.publish(sampleFor(1));
+
+    Shm::Header* h = mapWritable();
+    ASSERT_NE(h, nullptr);
+    uint32_t lock = h->latest.lock.load();
+    EXPECT_EQ(lock % 2, 0u);
+    h->latest.lock.store(lock + 1);  // A writer stopped half-way
+    Sample s;
+    EXPECT_FALSE(reader.latest(&s));
+    Shm::Slot* ring = Shm::ring(h);
+    ring[0].lock.store(ring[0].lock.load() + 1);
+    Sample out[4];
+    EXPECT_EQ(reader.recent(out, 4), 0u);
+    h->latest.lock.store(lock + 2);
+    ring[0].lock.store(ring[0].lock.load() + 1);
+    ASSERT_TRUE(reader.latest(&s));
+    EXPECT_EQ(s.seq, 1u);
+    EXPECT_EQ(reader.recent(out, 4), 1u);
+
+    // With several cores: a writer rewriting the slots as fast as it can, every copy the reader accepts is whole
+    std::atomic<bool> stop(false);
+    std::thread writer([this, &stop]() {
+        for (uint64_t seq = 2; !stop.load(std::memory_order_relaxed); ++seq) {
+            publisher.publish(sampleFor(seq));
+        }
+    });
+    uint64_t reads = 0;
+    uint64_t torn = 0;
+    uint64_t last = 0;
+    uint64_t backwards = 0;
+    for (int i = 0; i < 200000; ++i) {
+        if (reader.latest(&s)) {
+            reads++;
+            torn += !consistent(s);
+            backwards += s.seq < last;
+            last = s.seq;
+        }
+        size_t n = reader.recent(out, 4);
+        for (size_t k = 0; k < n; ++k) {
+            torn += !consistent(out[k]);
+        }
+    }
+    stop = true;
+    writer.join();
+    EXPECT_GT(reads, 0u);
+    EXPECT_EQ(torn, 0u);
+    EXPECT_EQ(backwards, 0u);
+}
+
+// A slot rewritten while the reader copies it: the changed counter makes the reader copy it again
+TEST(ShmSeqlockTest, RetryOnChangedCounter) {
+    // Two views of one file with a slot across a page boundary: counter and position on the first page, the sample
+    // on the second, which the reader's view cannot access until the "writer" has run
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    FILE* file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(ftruncate(fileno(file), static_cast<off_t>(2 * page)), 0);
+    uint8_t* writer = static_cast<uint8_t*>(mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(file), 0));
+    uint8_t* reader = static_cast<uint8_t*>(mmap(nullptr, 2 * page, PROT_READ, MAP_SHARED, fileno(file), 0));
+    fclose(file);
+    ASSERT_NE(writer, MAP_FAILED);
+    ASSERT_NE(reader, MAP_FAILED);
+    size_t offset = page - offsetof(Shm::Slot, sample);
+    Shm::Slot* slot = reinterpret_cast<Shm::Slot*>(writer + offset);
+    Shm::write(*slot, 1, sampleFor(1));
+
+    interruption.slot = slot;
+    interruption.guarded = reader + page;
+    interruption.page = page;
+    interruption.faults = 0;
+    struct sigaction sa = {};
+    struct sigaction saved;
+    sa.sa_sigaction = rewriteSlot;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    ASSERT_EQ(sigaction(SIGSEGV, &sa, &saved), 0);
+    ASSERT_EQ(mprotect(reader + page, page, PROT_NONE), 0);
+
+    // The first copy has the old position and the new sample; only the second one is accepted
+    Sample s;
+    uint64_t position = 0;
+    bool ok = Shm::read(*reinterpret_cast<const Shm::Slot*>(reader + offset), &s, &position);
+    sigaction(SIGSEGV, &saved, nullptr);
+    EXPECT_EQ(interruption.faults, 1);
+    ASSERT_TRUE(ok);
+    EXPECT_EQ(position, 7u);
+    EXPECT_EQ(s.seq, 7u);
+    EXPECT_TRUE(consistent(s));
+
+    // A writer that never finishes: the reader gives up instead of spinning
+    slot->lock.store(slot->lock.load() + 1);
+    EXPECT_FALSE(Shm::read(*reinterpret_cast<const Shm::Slot*>(reader + offset), &s, &position, 4));
+    munmap(reader, 2 * page);
+    munmap(writer, 2 * page);
+}
@@ -0,0 +1,133 @@
+// bake_font.cpp
+// Build-time generator of src/display/baked_font.h tables: renders a set of characters with FreeType and writes
+// their metrics and 8-bit coverage as constexpr arrays.
+//
+// Usage: bake_font <font file> <pixel size> <characters, UTF-8> <symbol> <output .cpp>
+// The replacement characters U+FFFD and '?' are always added, so missing characters can be drawn without FreeType.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+struct Baked {
+    uint32_t code;
+    int left;
+    int top;
+    unsigned width;
+    unsigned rows;
+    int advance;
+    size_t offset;
+};
+
+// Code points of a UTF-8 string; invalid bytes are skipped
+static std::vector<uint32_t> decodeUtf8(const std::string& s) {
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i < s.size();) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        int extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xE ? 2 : (c >> 3) == 0x1E ? 3 : -1;
+        if (extra < 0 || i + extra >= s.size()) {
+            ++i;
+            continue;
+        }
+        uint32_t code = extra == 0 ? c : c & (0x3F >> extra);
+        for (int k = 1; k <= extra; ++k) {
+            code = (code << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+        }
+        out.push_back(code);
+        i += extra + 1;
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 6) {
+        fprintf(stderr, "Usage: %s <font file> <pixel size> <characters> <symbol> <output .cpp>\n", argv[0]);
+        return 1;
+    }
+    const char* font_path = argv[1];
+    int size = atoi(argv[2]);
+    std::vector<uint32_t> codes = decodeUtf8(argv[3]);
+    const char* symbol = argv[4];
+    const char* output = argv[5];
+
+    codes.push_back(0xFFFD);
+    codes.push_back('?');
+    std::sort(codes.begin(), codes.end());
+    codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+
+    FT_Library library;
+    FT_Face face;
+    if (FT_Init_FreeType(&library) != 0 || FT_New_Face(library, font_path, 0, &face) != 0 ||
+        FT_Set_Pixel_Sizes(face, 0, size) != 0) {
+        fprintf(stderr, "bake_font: cannot load %s at %d px\n", font_path, size);
+        return 1;
+    }
+
+    std::vector<Baked> glyphs;
+    std::vector<uint8_t> coverage;
+    for (uint32_t code : codes) {
+        FT_UInt index = FT_Get_Char_Index(face, code);
+        if (index == 0) {
+            fprintf(stderr, "bake_font: no glyph for U+%04X in %s, skipped\n", code, font_path);
+            continue;
+        }
+        // Same load flags as GlyphCache, so baked and run-time glyphs are identical
+        if (FT_Load_Glyph(face, index, FT_LOAD_RENDER) != 0) {
+            fprintf(stderr, "bake_font: cannot render U+%04X\n", code);
+            return 1;
+        }
+        const FT_Bitmap& bitmap = face->glyph->bitmap;
+        Baked g = {code, face->glyph->bitmap_left, face->glyph->bitmap_top, bitmap.width, bitmap.rows,
+                   static_cast<int>(face->glyph->advance.x >> 6), coverage.size()};
+        for (unsigned row = 0; row < bitmap.rows; ++row) {
+            const uint8_t* line = bitmap.buffer + static_cast<int>(row) * bitmap.pitch;
+            for (unsigned col = 0; col < bitmap.width; ++col) {
+                if (bitmap.pixel_mode == FT_PIXEL_MODE_GRAY) {
+                    coverage.push_back(line[col]);
+                } else {
+                    coverage.push_back((line[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0);
+                }
+            }
+        }
+        glyphs.push_back(g);
+    }
+    int ascender = static_cast<int>(face->size->metrics.ascender >> 6);
+    int height = static_cast<int>(face->size->metrics.height >> 6);
+    std::string family = face->family_name != nullptr ? face->family_name : "";
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+
+    FILE* out = fopen(output, "w");
+    if (out == nullptr) {
+        perror(output);
+        return 1;
+    }
+    fprintf(out, "// Generated by tools/bake_font.cpp from %s at %d px; do not edit\n", font_path, size);
+    fprintf(out, "#include \"src/display/baked_font.h\"\n\n");
+    fprintf(out, "namespace {\n\nconstexpr BakedFont::Glyph GLYPHS[] = {\n");
+    for (const Baked& g : glyphs) {
+        fprintf(out, "    {0x%04X, %d, %d, %u, %u, %d, %zu},\n", g.code, g.left, g.top, g.width, g.rows, g.advance,
+                g.offset);
+    }
+    fprintf(out, "};\n\nconstexpr uint8_t COVERAGE[] = {");
+    for (size_t i = 0; i < coverage.size(); ++i) {
+        fprintf(out, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", coverage[i]);
+    }
+    if (coverage.empty()) {
+        fprintf(out, "0");
+    }
+    fprintf(out, "\n};\n\n}\n\n");
+    fprintf(out, "extern const BakedFont %s = {\"%s\", %d, %d, %d, GLYPHS, %zu, COVERAGE};\n", symbol, family.c_str(),
+            size, ascender, height, glyphs.size());
+    if (fclose(out) != 0) {
+        perror(output);
+        return 1;
+    }
+    printf("bake_font: %zu glyphs, %zu coverage bytes from %s at %d px\n", glyphs.size(), coverage.size(), font_path,
+           size);
+    return 0;
+}